@@ -107,6 +107,240 @@ fn test_basic_pid_stats() {
     };
 }
 
+#[test]
+fn test_pid_stats_update_with_timestamp() {
+    unsafe {
+        let mut stats = ptr::null_mut();
+        assert_eq!(pid_stats_alloc(&mut stats as _), 0);
+
+        let data = std::fs::read("../test-data/demo.ts").unwrap();
+        let batch = 7 * 188;
+
+        /* Replay the capture on a synthetic clock, 2ms per 7 packets, no wallclock involved. */
+        let mut ts = libc::timeval {
+            tv_sec: 1_000_000,
+            tv_usec: 0,
+        };
+        for chunk in data.chunks_exact(batch) {
+            pid_stats_update_with_timestamp(stats, chunk.as_ptr(), 7, &ts);
+            ts.tv_usec += 2000;
+            if ts.tv_usec >= 1_000_000 {
+                ts.tv_sec += 1;
+                ts.tv_usec = 0;
+            }
+        }
+
+        let pc = pid_stats_pid_get_packet_count(stats, 0x31);
+        assert_eq!(pc, 4212);
+        assert_eq!(pid_stats_stream_get_cc_errors(stats), 0);
+        assert_eq!(pid_stats_stream_get_notmultipleofseven_errors(stats), 0);
+
+        /* Exactly 500 calls of 7 packets landed in the first complete second. */
+        assert_eq!((*stats).pps, 3500);
+
+        pid_stats_free(stats);
+    };
+}
+
+#[test]
+fn test_pid_stats_packed_counters() {
+    let demo = std::fs::read("../test-data/demo.ts").unwrap();
+
+    /* Drop packets throughout, so both layouts have CC errors to count */
+    let damaged: Vec<u8> = demo
+        .chunks(188)
+        .enumerate()
+        .filter(|(i, _)| i % 97 != 5)
+        .flat_map(|(_, pkt)| pkt.to_vec())
+        .collect();
+
+    unsafe {
+        let mut classic: *mut stream_statistics_s = ptr::null_mut();
+        let mut packed: *mut stream_statistics_s = ptr::null_mut();
+        assert_eq!(pid_stats_alloc(&mut classic as _), 0);
+        assert_eq!(pid_stats_alloc(&mut packed as _), 0);
+        assert_eq!(pid_stats_enable_packed_counters(packed), 0);
+
+        /* Identical timestamps for both, ending close to now so the bitrates haven't expired */
+        let mut ts = libc::timeval {
+            tv_sec: 0,
+            tv_usec: 0,
+        };
+        libc::gettimeofday(&mut ts, ptr::null_mut());
+        ts.tv_sec -= 2;
+        for _ in 0..3 {
+            for chunk in damaged.chunks_exact(7 * 188) {
+                ts.tv_usec += 1000;
+                if ts.tv_usec >= 1_000_000 {
+                    ts.tv_sec += 1;
+                    ts.tv_usec -= 1_000_000;
+                }
+                pid_stats_update_with_timestamp(classic, chunk.as_ptr(), 7, &ts);
+                pid_stats_update_with_timestamp(packed, chunk.as_ptr(), 7, &ts);
+            }
+        }
+
+        assert_eq!(pid_stats_stream_get_packet_count(packed), pid_stats_stream_get_packet_count(classic));
+        assert_eq!(pid_stats_stream_get_cc_errors(packed), pid_stats_stream_get_cc_errors(classic));
+        assert_eq!(pid_stats_stream_get_pps(packed), pid_stats_stream_get_pps(classic));
+        assert_eq!(pid_stats_stream_get_bps(packed), pid_stats_stream_get_bps(classic));
+        assert_eq!(pid_stats_stream_get_mbps(packed), pid_stats_stream_get_mbps(classic));
+        assert!(pid_stats_stream_get_cc_errors(classic) > 0);
+
+        for pid in [0x0, 0x30, 0x31, 0x32, 0x33, 0x1fff] {
+            assert_eq!(pid_stats_pid_get_packet_count(packed, pid), pid_stats_pid_get_packet_count(classic, pid));
+            assert_eq!(pid_stats_pid_get_cc_errors(packed, pid), pid_stats_pid_get_cc_errors(classic, pid));
+            assert_eq!(pid_stats_pid_get_pps(packed, pid), pid_stats_pid_get_pps(classic, pid));
+            assert_eq!(pid_stats_pid_get_bps(packed, pid), pid_stats_pid_get_bps(classic, pid));
+            assert_eq!(pid_stats_pid_get_mbps(packed, pid), pid_stats_pid_get_mbps(classic, pid));
+        }
+        assert!(pid_stats_pid_get_mbps(classic, 0x31) > 0.0);
+
+        pid_stats_free(classic);
+        pid_stats_free(packed);
+    }
+}
+
+#[test]
+fn test_ts_header_scan() {
+    unsafe {
+        let data = std::fs::read("../test-data/demo.ts").unwrap();
+        let count = (data.len() / 188) as u32;
+
+        let mut vec = ptr::null_mut();
+        assert_eq!(ts_header_vector_alloc(&mut vec as _, count), 0);
+        let v = &*vec;
+
+        assert_eq!(ts_header_scan(vec, data.as_ptr(), count), count as c_int);
+        assert_eq!(v.syncErrorCount, 0);
+        assert_eq!(v.teiCount, 0);
+
+        /* Every field must agree with the scalar helpers in ts.h, whichever kernel was dispatched. */
+        for i in 0..count as usize {
+            let pkt = &data[i * 188..];
+            assert_eq!(*v.pid.add(i), ((pkt[1] as u16 & 0x1f) << 8) | pkt[2] as u16);
+            assert_eq!(*v.cc.add(i), pkt[3] & 0x0f);
+            assert_eq!(*v.afc.add(i), (pkt[3] >> 4) & 0x03);
+            assert_eq!(*v.scrambling.add(i), pkt[3] >> 6);
+            let pusi = (*v.pusi.add(i / 64) >> (i % 64)) & 1;
+            assert_eq!(pusi as u8, (pkt[1] >> 6) & 1);
+        }
+
+        /* Corrupt a sync byte and confirm it is flagged. */
+        let mut corrupt = data[..188 * 11].to_vec();
+        corrupt[188 * 9] = 0x00;
+        assert_eq!(ts_header_scan(vec, corrupt.as_ptr(), 11), 11);
+        assert_eq!(v.syncErrorCount, 1);
+        assert_eq!(*v.syncErrors, 1 << 9);
+
+        ts_header_vector_free(vec);
+    };
+}
+
+#[test]
+fn test_bytescan_kernels() {
+    let kernel = unsafe { std::ffi::CStr::from_ptr(bytescan_kernel_name()) };
+    println!("Bytescan kernel {:?}", kernel);
+
+    const UUID: [u8; 16] = [
+        0x59, 0x96, 0xff, 0x28, 0x17, 0xca, 0x41, 0x96, 0x8d, 0xe3, 0xe5, 0x3f, 0xe2, 0xf9, 0x92,
+        0xae,
+    ];
+    let offset = |r: *const u8, buf: &Vec<u8>| {
+        if r.is_null() {
+            -1
+        } else {
+            r as isize - buf.as_ptr() as isize
+        }
+    };
+
+    /* Matches at every position, straddling the 16 and 32 byte vector widths and
+     * truncated by the end of the buffer. Buffers are exactly sized, no slack to read into.
+     */
+    for length in 0..100usize {
+        for pos in 0..=length {
+            let mut buf = vec![0xaau8; length];
+            for (k, b) in [0u8, 0, 1]
+                .iter()
+                .enumerate()
+                .filter(|(k, _)| pos + k < length)
+            {
+                buf[pos + k] = *b;
+            }
+            for from in 0..=length as c_int {
+                let (vector, scalar) = unsafe {
+                    (
+                        bytescan_start_code(buf.as_ptr(), length as c_int, from),
+                        bytescan_start_code_scalar(buf.as_ptr(), length as c_int, from),
+                    )
+                };
+                assert_eq!(
+                    vector, scalar,
+                    "start code length {} pos {} from {}",
+                    length, pos, from
+                );
+            }
+
+            let mut buf = vec![0xaau8; length];
+            for k in (0..16).filter(|k| pos + k < length) {
+                buf[pos + k] = UUID[k];
+            }
+            if pos >= 17 {
+                buf[..15].copy_from_slice(&UUID[..15]); /* Near miss ahead of the real match */
+            }
+            let (vector, scalar) = unsafe {
+                (
+                    bytescan_memmem(buf.as_ptr(), length, UUID.as_ptr(), UUID.len()),
+                    bytescan_memmem_scalar(buf.as_ptr(), length, UUID.as_ptr(), UUID.len()),
+                )
+            };
+            assert_eq!(
+                offset(vector, &buf),
+                offset(scalar, &buf),
+                "memmem length {} pos {}",
+                length,
+                pos
+            );
+            if pos + 16 <= length {
+                assert_eq!(offset(vector, &buf), pos as isize);
+            }
+        }
+    }
+
+    /* Dense 00 and 01 bytes, many candidates per vector */
+    let mut seed = 1u32;
+    for _ in 0..20000 {
+        let mut next = || {
+            seed = seed.wrapping_mul(1103515245).wrapping_add(12345);
+            seed >> 16
+        };
+        let length = (next() % 200) as usize;
+        let buf: Vec<u8> = (0..length)
+            .map(|_| match next() % 4 {
+                0 => 1,
+                1 | 2 => 0,
+                _ => next() as u8,
+            })
+            .collect();
+        let from = if length > 0 {
+            (next() as usize % length) as c_int
+        } else {
+            0
+        };
+        unsafe {
+            assert_eq!(
+                bytescan_start_code(buf.as_ptr(), length as c_int, from),
+                bytescan_start_code_scalar(buf.as_ptr(), length as c_int, from)
+            );
+            let needle = [0u8, 0, 1];
+            let vector = bytescan_memmem(buf.as_ptr(), length, needle.as_ptr(), needle.len());
+            let scalar =
+                bytescan_memmem_scalar(buf.as_ptr(), length, needle.as_ptr(), needle.len());
+            assert_eq!(offset(vector, &buf), offset(scalar, &buf));
+        }
+    }
+}
+
 #[test]
 fn test_basic_stream_model() {
     let mut handle = ptr::null_mut();
@@ -159,6 +393,454 @@ fn test_basic_stream_model() {
     assert_eq!(val, 1);
 }
 
+#[test]
+fn test_psi_model() {
+    let mut handle = ptr::null_mut();
+
+    unsafe {
+        streammodel_alloc(&mut handle as _, ptr::null_mut());
+    }
+
+    let data = std::fs::read("../test-data/demo.ts").unwrap();
+    let mut model: *const psi_model_s = ptr::null();
+
+    for chunk in data.chunks_exact(128 * 188) {
+        let mut complete: i32 = 0;
+        unsafe {
+            let mut timestamp: libc::timeval = libc::timeval {
+                tv_sec: 0,
+                tv_usec: 0,
+            };
+            libc::gettimeofday(&mut timestamp, std::ptr::null_mut());
+
+            streammodel_write(handle, chunk.as_ptr(), 128, &mut complete, &mut timestamp);
+            if complete == 1 {
+                assert_eq!(streammodel_query_psi_model(handle, &mut model), 0);
+                break;
+            }
+        }
+    }
+    assert!(!model.is_null());
+
+    unsafe {
+        /* Each query shares the same model */
+        let mut again: *const psi_model_s = ptr::null();
+        assert_eq!(streammodel_query_psi_model(handle, &mut again), 0);
+        assert_eq!(again, model);
+        psi_model_unref(again);
+
+        /* Kilobytes, not megabytes */
+        assert!(psi_model_get_size(model) < 4096);
+        assert!(psi_model_get_size(model) < std::mem::size_of::<pat_s>() / 100);
+
+        let mut e = 0;
+        let mut program: *const psi_program_s = ptr::null();
+        assert_eq!(psi_model_enum_services_video(model, &mut e, &mut program), 0);
+        let mut pid: u16 = 0;
+        let mut estype: u8 = 0;
+        assert_eq!(psi_program_query_video_pid(program, &mut pid, &mut estype), 0);
+        assert_eq!(pid, 0x31);
+        assert_eq!((*program).program_map_PID, 0x30);
+        assert_eq!((*program).has_pmt, 1);
+
+        let mut pcrpid: u16 = 0;
+        assert_eq!(psi_model_query_first_program_pcr_pid(model, &mut pcrpid), 0);
+        assert_eq!(pcrpid, 0x31);
+
+        /* The model outlives the framework, and survives a round trip through the legacy struct */
+        streammodel_free(handle);
+
+        let pat = psi_model_to_pat(model);
+        assert!(!pat.is_null());
+        let copy = psi_model_alloc_from_pat(pat);
+        assert_eq!(psi_model_compare(model, copy), 0);
+        assert_eq!(psi_model_get_size(copy), psi_model_get_size(model));
+        pat_free(pat);
+
+        psi_model_unref(copy);
+        psi_model_unref(model);
+    }
+}
+
+#[allow(clippy::missing_safety_doc)]
+pub unsafe extern "C" fn psi_change_callback(
+    user_context: *mut c_void,
+    previous: *const psi_model_s,
+    current: *const psi_model_s,
+    changes: *const psi_change_s,
+    change_count: c_int,
+) {
+    unsafe {
+        let seen = &mut *(user_context as *mut Vec<(psi_change_e, u32)>);
+
+        /* The first model, every program is new */
+        assert!(previous.is_null());
+        assert!(!current.is_null());
+
+        for c in std::slice::from_raw_parts(changes, change_count as usize) {
+            assert!(c.programOld.is_null());
+            assert!(!c.programNew.is_null());
+            seen.push((c.type_, c.pid));
+        }
+    }
+}
+
+#[test]
+fn test_psi_model_diff() {
+    let mut handle = ptr::null_mut();
+    let mut seen: Vec<(psi_change_e, u32)> = Vec::new();
+
+    unsafe {
+        streammodel_alloc(&mut handle as _, &mut seen as *mut _ as *mut c_void);
+        assert_eq!(streammodel_set_change_callback(handle, Some(psi_change_callback)), 0);
+    }
+
+    let data = std::fs::read("../test-data/demo.ts").unwrap();
+    let mut model: *const psi_model_s = ptr::null();
+
+    for chunk in data.chunks_exact(7 * 188) {
+        let mut complete: i32 = 0;
+        unsafe {
+            let mut timestamp: libc::timeval = libc::timeval {
+                tv_sec: 0,
+                tv_usec: 0,
+            };
+            libc::gettimeofday(&mut timestamp, std::ptr::null_mut());
+
+            streammodel_write(handle, chunk.as_ptr(), 7, &mut complete, &mut timestamp);
+            if complete == 1 {
+                assert_eq!(streammodel_query_psi_model(handle, &mut model), 0);
+                break;
+            }
+        }
+    }
+    assert!(!model.is_null());
+    assert!(seen.contains(&(psi_change_e::LTNTSTOOLS_PSI_CHANGE_PROGRAM_ADDED, 0x30)));
+
+    unsafe {
+        /* A model never differs from itself, or from its round trip copy */
+        let mut changes: *mut psi_change_s = ptr::null_mut();
+        let mut count: c_int = -1;
+        assert_eq!(psi_model_diff(model, model, &mut changes, &mut count), 0);
+        assert_eq!(count, 0);
+        assert!(changes.is_null());
+
+        let pat = psi_model_to_pat(model);
+        let copy = psi_model_alloc_from_pat(pat);
+        assert_eq!(psi_model_diff(model, copy, &mut changes, &mut count), 0);
+        assert_eq!(count, 0);
+
+        /* Against nothing, every program is added */
+        assert_eq!(psi_model_diff(ptr::null(), model, &mut changes, &mut count), 0);
+        assert_eq!(count as u32, (*model).program_count);
+        libc::free(changes as *mut c_void);
+
+        pat_free(pat);
+        psi_model_unref(copy);
+        psi_model_unref(model);
+        streammodel_free(handle);
+    }
+}
+
+#[allow(clippy::missing_safety_doc)]
+pub unsafe extern "C" fn section_callback(user_context: *mut c_void, section: *const section_s) {
+    let seen = unsafe { &mut *(user_context as *mut Vec<(u8, u16, i32, i32)>) };
+    let section = unsafe { &*section };
+    assert!(!section.data.is_null());
+    seen.push((section.tableId, section.lengthBytes, section.crcValid, section.cached));
+}
+
+fn build_section(table_id: u8, length: usize) -> Vec<u8> {
+    let mut section: Vec<u8> = (0..length).map(|i| (i * 7) as u8).collect();
+    section[0] = table_id;
+    section[1] = 0xb0 | ((length - 3) >> 8) as u8;
+    section[2] = (length - 3) as u8;
+    let mut crc: u32 = 0;
+    unsafe { getCRC32(section.as_ptr(), (length - 4) as c_int, &mut crc) };
+    section[length - 4..].copy_from_slice(&crc.to_be_bytes());
+    section
+}
+
+#[test]
+fn test_section_reassembler() {
+    /* A section spanning six packets, with a short section packed in behind it */
+    let first = build_section(0x42, 1000);
+    let second = build_section(0x46, 20);
+    let mut payload = first.clone();
+    payload.extend_from_slice(&second);
+
+    let mut packets: Vec<u8> = Vec::new();
+    let mut pos = 0;
+    let mut cc = 0u8;
+    while pos < payload.len() {
+        let mut pkt = vec![0xffu8; 188];
+        pkt[..4].copy_from_slice(&[0x47, 0x00, 0x11, 0x10 | (cc & 0x0f)]);
+        cc += 1;
+        let start = if pos == 0 || (pos < first.len() && pos + 183 > first.len()) {
+            pkt[1] |= 0x40;
+            pkt[4] = if pos == 0 { 0 } else { (first.len() - pos) as u8 };
+            5
+        } else {
+            4
+        };
+        let n = (payload.len() - pos).min(188 - start);
+        pkt[start..start + n].copy_from_slice(&payload[pos..pos + n]);
+        pos += n;
+        packets.extend_from_slice(&pkt);
+    }
+    assert_eq!(packets.len() / 188, 6);
+
+    let mut seen: Vec<(u8, u16, i32, i32)> = Vec::new();
+    unsafe {
+        let mut handle = ptr::null_mut();
+        assert_eq!(
+            sectionreassembler_alloc(&mut handle as _, Some(section_callback), &mut seen as *mut _ as *mut c_void),
+            0
+        );
+        assert_eq!(sectionreassembler_add_pid(handle, 0x11), 0);
+
+        /* First time around the CRC is calculated, the repeat is found in the cache */
+        sectionreassembler_write(handle, packets.as_ptr(), 6);
+        for pkt in packets.chunks(188) {
+            sectionreassembler_write(handle, pkt.as_ptr(), 1);
+        }
+        sectionreassembler_free(handle);
+    }
+
+    assert_eq!(
+        seen,
+        vec![(0x42, 1000, 1, 0), (0x46, 20, 1, 0), (0x42, 1000, 1, 1), (0x46, 20, 1, 1)]
+    );
+}
+
+/* A long form PSI section, version and section numbers as given, the CRC appended */
+fn psi_section(table_id: u8, extension: u16, version: u8, section_number: u8, last_section: u8, body: &[u8]) -> Vec<u8> {
+    let length = 8 + body.len() + 4;
+    let mut section = vec![
+        table_id,
+        0xb0 | ((length - 3) >> 8) as u8,
+        (length - 3) as u8,
+        (extension >> 8) as u8,
+        extension as u8,
+        0xc1 | (version << 1),
+        section_number,
+        last_section,
+    ];
+    section.extend_from_slice(body);
+    let mut crc: u32 = 0;
+    unsafe { getCRC32(section.as_ptr(), section.len() as c_int, &mut crc) };
+    section.extend_from_slice(&crc.to_be_bytes());
+    section
+}
+
+/* Sections packed back to back on a pid, the pointer_field locates the first section starting in a packet */
+fn psi_packets(pid: u16, cc: &mut u8, sections: &[Vec<u8>]) -> Vec<u8> {
+    let mut starts = Vec::new();
+    let mut payload = Vec::new();
+    for section in sections {
+        starts.push(payload.len());
+        payload.extend_from_slice(section);
+    }
+
+    let mut packets = Vec::new();
+    let mut pos = 0;
+    while pos < payload.len() {
+        let mut pkt = vec![0xffu8; 188];
+        pkt[..4].copy_from_slice(&[0x47, (pid >> 8) as u8, pid as u8, 0x10 | (*cc & 0x0f)]);
+        *cc = cc.wrapping_add(1);
+        let start = match starts.iter().find(|&&s| s >= pos && s - pos <= 182) {
+            Some(&s) => {
+                pkt[1] |= 0x40;
+                pkt[4] = (s - pos) as u8;
+                5
+            }
+            None => 4,
+        };
+        let n = (payload.len() - pos).min(188 - start);
+        pkt[start..start + n].copy_from_slice(&payload[pos..pos + n]);
+        pos += n;
+        packets.extend_from_slice(&pkt);
+    }
+    packets
+}
+
+/* Elementary pids follow the PCR pid, padding bytes of private descriptors make the section longer */
+fn pmt_section(program_number: u16, version: u8, pcr_pid: u16, streams: u16, padding: usize) -> Vec<u8> {
+    let mut descriptors = Vec::new();
+    let mut remain = padding;
+    while remain > 0 {
+        let n = remain.min(200);
+        descriptors.extend_from_slice(&[0x80, n as u8]);
+        descriptors.extend((0..n).map(|i| i as u8));
+        remain -= n;
+    }
+
+    let mut body = vec![
+        0xe0 | (pcr_pid >> 8) as u8,
+        pcr_pid as u8,
+        0xf0 | (descriptors.len() >> 8) as u8,
+        descriptors.len() as u8,
+    ];
+    body.extend_from_slice(&descriptors);
+    for i in 0..streams {
+        let pid = pcr_pid + i;
+        body.extend_from_slice(&[if i == 0 { 0x1b } else { 0x0f }, 0xe0 | (pid >> 8) as u8, pid as u8, 0xf0, 0x00]);
+    }
+    psi_section(0x02, program_number, version, 0, 0, &body)
+}
+
+fn sdt_section(services: &[(u16, &str, &str)]) -> Vec<u8> {
+    /* original_network_id */
+    let mut body = vec![0x00, 0x01, 0xff];
+    for &(service_id, provider, name) in services {
+        let mut descriptor = vec![0x48, (3 + provider.len() + name.len()) as u8, 0x01, provider.len() as u8];
+        descriptor.extend_from_slice(provider.as_bytes());
+        descriptor.push(name.len() as u8);
+        descriptor.extend_from_slice(name.as_bytes());
+        body.extend_from_slice(&[(service_id >> 8) as u8, service_id as u8, 0xfc, 0x80, descriptor.len() as u8]);
+        body.extend_from_slice(&descriptor);
+    }
+    psi_section(0x42, 0x1234, 0, 0, 0, &body)
+}
+
+/* One repetition of the PSI for a two program stream. The PAT carries a program in each of its two
+ * sections, both PMTs share pid 0x100. Program 2's short PMT goes first with program 1's PMT packed
+ * in behind it, the pair is sent twice so the second copy begins part way into a packet.
+ * cc holds the SDT, PAT and PMT pid continuity counters.
+ */
+fn psi_repetition(cc: &mut [u8; 3], pmt_version: u8, pmt_streams: u16, pmt_padding: usize) -> Vec<u8> {
+    let mut packets = psi_packets(0x11, &mut cc[0], &[sdt_section(&[(1, "LTN", "Service One"), (2, "LTN", "Service Two")])]);
+    packets.extend(psi_packets(0x00, &mut cc[1], &[psi_section(0x00, 0x1234, 1, 0, 1, &[0x00, 0x01, 0xe1, 0x00])]));
+    packets.extend(psi_packets(0x00, &mut cc[1], &[psi_section(0x00, 0x1234, 1, 1, 1, &[0x00, 0x02, 0xe1, 0x00])]));
+
+    let short = pmt_section(2, 1, 0x201, 1, 0);
+    let long = pmt_section(1, pmt_version, 0x101, pmt_streams, pmt_padding);
+    packets.extend(psi_packets(0x100, &mut cc[2], &[short.clone(), long.clone(), short, long]));
+    packets
+}
+
+/* Write a repetition a packet at a time, optionally each packet twice, true once a model completes */
+fn psi_repetition_write(handle: *mut c_void, packets: &[u8], duplicate: bool, timestamp: &mut libc::timeval) -> bool {
+    let mut completed = false;
+    for pkt in packets.chunks(188) {
+        let pat = pkt[1] & 0x1f == 0 && pkt[2] == 0;
+        let copies = if duplicate && !pat { 2 } else { 1 };
+        for _ in 0..copies {
+            let mut complete: c_int = 0;
+            unsafe { streammodel_write(handle, pkt.as_ptr(), 1, &mut complete, timestamp) };
+            completed |= complete == 1;
+        }
+    }
+
+    timestamp.tv_usec += 40000;
+    if timestamp.tv_usec >= 1000000 {
+        timestamp.tv_usec -= 1000000;
+        timestamp.tv_sec += 1;
+    }
+    completed
+}
+
+fn psi_program_name(name: &[u8; 32]) -> &str {
+    std::ffi::CStr::from_bytes_until_nul(name).unwrap().to_str().unwrap()
+}
+
+#[test]
+fn test_streammodel_synthetic_psi() {
+    let mut cc = [0u8; 3];
+    let mut timestamp = libc::timeval { tv_sec: 1000, tv_usec: 0 };
+
+    /* Program 1's PMT spans two packets, the packet it ends in locates the next section by pointer_field */
+    let packets = psi_repetition(&mut [0u8; 3], 1, 2, 160);
+    let pmt: Vec<&[u8]> = packets.chunks(188).filter(|p| p[1] & 0x1f == 0x01 && p[2] == 0x00).collect();
+    assert_eq!(pmt.len(), 3);
+    assert!(pmt[1][1] & 0x40 != 0 && pmt[1][4] > 0);
+
+    let mut handle = ptr::null_mut();
+    unsafe { streammodel_alloc(&mut handle as _, ptr::null_mut()) };
+
+    let mut completions = Vec::new();
+    for repetition in 0..200 {
+        /* Program 1 gains a stream in a new PMT version, the current model sees it and a new model follows */
+        let packets = if repetition < 100 {
+            psi_repetition(&mut cc, 1, 2, 160)
+        } else {
+            psi_repetition(&mut cc, 2, 3, 160)
+        };
+        if !psi_repetition_write(handle, &packets, false, &mut timestamp) {
+            continue;
+        }
+
+        let mut model: *const psi_model_s = ptr::null();
+        unsafe {
+            assert_eq!(streammodel_query_psi_model(handle, &mut model), 0);
+            let m = &*model;
+            let programs = std::slice::from_raw_parts(m.programs, m.program_count as usize);
+            completions.push((repetition, streammodel_get_current_version(handle)));
+
+            assert_eq!(m.transport_stream_id, 0x1234);
+            assert_eq!(m.version_number, 1);
+            assert_eq!(programs.len(), 2);
+
+            let p1 = programs.iter().find(|p| p.program_number == 1).unwrap();
+            let p2 = programs.iter().find(|p| p.program_number == 2).unwrap();
+            assert_eq!((p1.program_map_PID, p1.has_pmt, p1.PCR_PID), (0x100, 1, 0x101));
+            assert_eq!((p2.program_map_PID, p2.has_pmt, p2.PCR_PID), (0x100, 1, 0x201));
+            assert_eq!((psi_program_name(&p1.service_name), psi_program_name(&p1.service_provider)), ("Service One", "LTN"));
+            assert_eq!((psi_program_name(&p2.service_name), psi_program_name(&p2.service_provider)), ("Service Two", "LTN"));
+            assert_eq!(p2.stream_count, 1);
+
+            let streams = std::slice::from_raw_parts(p1.streams, p1.stream_count as usize);
+            if repetition < 100 {
+                assert_eq!(p1.version_number, 1);
+                let types: Vec<(u32, u32)> = streams.iter().map(|s| (s.stream_type, s.elementary_PID)).collect();
+                assert_eq!(types, vec![(0x1b, 0x101), (0x0f, 0x102)]);
+            } else {
+                assert_eq!(p1.version_number, 2);
+                assert_eq!(streams.len(), 3);
+                assert_eq!((streams[2].stream_type, streams[2].elementary_PID), (0x0f, 0x103));
+            }
+            psi_model_unref(model);
+        }
+    }
+    unsafe { streammodel_free(handle) };
+
+    /* The first model from the first repetition, the PMT change well inside the next scheduled scan */
+    assert_eq!(completions.len(), 2);
+    assert_eq!(completions[0], (0, 1));
+    assert!(completions[1].0 >= 100 && completions[1].0 < 110);
+    assert_eq!(completions[1].1, 2);
+}
+
+#[test]
+fn test_streammodel_duplicate_packets() {
+    /* Program 1's PMT spans three packets, a repeated packet in the middle of it must not end the section.
+     * PAT packets aren't repeated, the model takes a PAT CC repeat for a discontinuity and starts over.
+     */
+    let mut cc = [0u8; 3];
+    let mut timestamp = libc::timeval { tv_sec: 1000, tv_usec: 0 };
+
+    let mut handle = ptr::null_mut();
+    unsafe { streammodel_alloc(&mut handle as _, ptr::null_mut()) };
+
+    let packets = psi_repetition(&mut cc, 1, 2, 400);
+    assert!(psi_repetition_write(handle, &packets, true, &mut timestamp));
+
+    let mut model: *const psi_model_s = ptr::null();
+    unsafe {
+        assert_eq!(streammodel_query_psi_model(handle, &mut model), 0);
+        let m = &*model;
+        let programs = std::slice::from_raw_parts(m.programs, m.program_count as usize);
+        assert_eq!(programs.len(), 2);
+
+        let p1 = programs.iter().find(|p| p.program_number == 1).unwrap();
+        assert_eq!((p1.has_pmt, p1.PCR_PID, p1.stream_count), (1, 0x101, 2));
+        assert_eq!(psi_program_name(&p1.service_name), "Service One");
+
+        psi_model_unref(model);
+        streammodel_free(handle);
+    }
+}
+
 #[allow(clippy::missing_safety_doc)]
 pub unsafe extern "C" fn basic_pe_callback(_user_context: *mut c_void, pes: *mut ltn_pes_packet_s) {
     unsafe {
@@ -222,6 +904,197 @@ fn test_basic_pes_extractor() {
     }
 }
 
+#[allow(clippy::missing_safety_doc)]
+pub unsafe extern "C" fn pooled_pe_callback(user_context: *mut c_void, pes: *mut ltn_pes_packet_s) {
+    unsafe {
+        let held = &mut *(user_context as *mut Vec<*mut ltn_pes_packet_s>);
+        {
+            let pes = &*pes;
+
+            /* Payload must live inside the pooled raw buffer, not in a second copy. */
+            assert!(!pes.pool.is_null());
+            assert_eq!(pes.dataIsReference, 1);
+            let raw = pes.rawBuffer as usize;
+            let data = pes.data as usize;
+            assert!(data > raw);
+            assert!(data + pes.dataLengthBytes as usize <= raw + pes.rawBufferLengthBytes as usize);
+            assert!(pes.rawBufferLengthBytes <= pes.rawBufferCapacityBytes);
+        }
+
+        /* Hold on to the first, return the rest to the pool. */
+        if held.is_empty() {
+            held.push(pes);
+        } else {
+            ltn_pes_packet_free(pes);
+        }
+    };
+}
+
+#[test]
+fn test_pooled_pes_extractor() {
+    let mut handle = ptr::null_mut();
+    let mut held: Vec<*mut ltn_pes_packet_s> = Vec::new();
+
+    let data = std::fs::read("../test-data/demo.ts").unwrap();
+
+    unsafe {
+        pes_extractor_alloc(
+            &mut handle as _,
+            0x31,
+            0xe0,
+            Some(pooled_pe_callback),
+            &mut held as *mut _ as *mut c_void,
+            -1,
+            -1
+        );
+        pes_extractor_set_skip_data(handle, 0);
+        assert_eq!(pes_extractor_set_pooled_output(handle, 1), 0);
+
+        for chunk in data.chunks_exact(7 * 188) {
+            pes_extractor_write(handle, chunk.as_ptr(), 7);
+        }
+
+        pes_extractor_free(handle);
+    }
+
+    /* Packets may outlive their extractor, the pool goes away with the last one. */
+    assert_eq!(held.len(), 1);
+    unsafe {
+        let pes = held[0];
+        assert_eq!((*pes).PTS, 3591437680);
+        let copy = ltn_pes_packet_clone(pes);
+        assert!((*copy).pool.is_null());
+        assert_eq!((*copy).dataIsReference, 0);
+        ltn_pes_packet_free(pes);
+        ltn_pes_packet_free(copy);
+    }
+}
+
+/* cargo test --release -- --ignored --nocapture bench_pes_header_parse
+ * ltn_pes_packet_parse() throughput on a video PES with PTS and DTS, the klbs_read_bits() hot path.
+ */
+#[test]
+#[ignore]
+fn bench_pes_header_parse() {
+    let mut buf = vec![0x5au8; 19 + 2000];
+    buf[..19].copy_from_slice(&[
+        0x00, 0x00, 0x01, 0xe0, 0x00, 0x00, 0x80, 0xc0, 0x0a, /* PTS and DTS */
+        0x31, 0x00, 0x03, 0x00, 0x03, 0x11, 0x00, 0x03, 0x00, 0x01,
+    ]);
+
+    unsafe {
+        let pes = ltn_pes_packet_alloc();
+        for (label, skip_data) in [("header only", 1), ("with payload", 0)] {
+            let iterations = 500000;
+            let start = time::Instant::now();
+            for _ in 0..iterations {
+                let mut bs = klbs_context_s {
+                    buf: buf.as_mut_ptr(),
+                    buflen: buf.len() as u32,
+                    ..Default::default()
+                };
+                ltn_pes_packet_init(pes);
+                assert!(ltn_pes_packet_parse(pes, &mut bs, skip_data) > 0);
+            }
+            let ns = start.elapsed().as_nanos() as f64 / iterations as f64;
+            println!("pes parse {:12} {:6.1} ns/header, {:.1} M headers/s", label, ns, 1000.0 / ns);
+
+            assert_eq!((*pes).PTS, 32769);
+            assert_eq!((*pes).DTS, 32768);
+            assert_eq!((*pes).dataLengthBytes, if skip_data == 1 { 0 } else { 2000 });
+        }
+        ltn_pes_packet_free(pes);
+    }
+}
+
+#[allow(clippy::missing_safety_doc)]
+pub unsafe extern "C" fn counting_demux_pes_callback(user_context: *mut c_void, _pid: u16, _pes: *mut ltn_pes_packet_s) {
+    unsafe { *(user_context as *mut u64) += 1 };
+}
+
+/* Round robin MPTS of MPEG audio pids starting at 0x200, a PES header every 8th packet per pid.
+ * Each pid gets a multiple of 16 packets, so the continuity counters wrap cleanly when replayed.
+ */
+fn synthetic_audio_mpts(pids: usize, packets: usize) -> Vec<u8> {
+    let mut buf = vec![0xffu8; packets * 188];
+    for (i, pkt) in buf.chunks_exact_mut(188).enumerate() {
+        let pid = 0x200 + (i % pids) as u16;
+        let seq = i / pids;
+        let pusi = seq % 8 == 0;
+        pkt[0] = 0x47;
+        pkt[1] = ((pusi as u8) << 6) | (pid >> 8) as u8;
+        pkt[2] = pid as u8;
+        pkt[3] = 0x10 | (seq & 0x0f) as u8;
+        if pusi {
+            pkt[4..18].copy_from_slice(&[0, 0, 1, 0xc0, 0, 0, 0x80, 0x80, 5, 0x21, 0, 1, 0, 1]);
+        }
+    }
+    buf
+}
+
+/* cargo test --release -- --ignored --nocapture bench_demux_dispatch
+ * Per packet demux cost should stay flat as the number of elementary streams grows.
+ */
+#[test]
+#[ignore]
+fn bench_demux_dispatch() {
+    const PACKETS: usize = 7 * 16 * 48;
+
+    for pids in [2usize, 8, 16, 48] {
+        let mut pes_count = 0u64;
+        let data = synthetic_audio_mpts(pids, PACKETS);
+
+        unsafe {
+            /* LTNTSTOOLS_PMT_ENTRIES_MAX streams per program */
+            let pat = pat_alloc();
+            (*pat).program_count = ((pids + 15) / 16) as u32;
+            for i in 0..pids {
+                let program = &mut (*pat).programs[i / 16];
+                program.program_number = 1 + (i / 16) as u32;
+                program.program_map_PID = 0x100 + (i / 16) as u32;
+                program.pmt.program_number = program.program_number;
+                program.pmt.PCR_PID = 0x200;
+                let stream = &mut program.pmt.streams[program.pmt.stream_count as usize];
+                stream.stream_type = 0x03; /* MPEG-1 audio */
+                stream.elementary_PID = 0x200 + i as u32;
+                program.pmt.stream_count += 1;
+            }
+
+            let callbacks = demux_callbacks {
+                cb_pes: Some(counting_demux_pes_callback),
+                cb_section: None,
+            };
+            let mut handle = ptr::null_mut();
+            assert_eq!(
+                demux_alloc_from_pat(&mut handle as _, &mut pes_count as *mut u64 as *mut c_void, &callbacks, pat),
+                0
+            );
+            pat_free(pat);
+
+            let iterations = 20;
+            let mut elapsed = time::Duration::ZERO;
+            for pass in 0..=iterations {
+                let start = time::Instant::now();
+                for chunk in data.chunks_exact(7 * 188) {
+                    demux_write(handle, chunk.as_ptr(), 7);
+                }
+                if pass > 0 {
+                    elapsed += start.elapsed(); /* First pass warms up */
+                }
+            }
+            demux_free(handle);
+
+            println!(
+                "demux {:2} es pids {:7.1} ns/pkt, {} pes",
+                pids,
+                elapsed.as_nanos() as f64 / (iterations * PACKETS) as f64,
+                pes_count
+            );
+            assert!(pes_count > 0);
+        }
+    }
+}
+
 #[allow(clippy::missing_safety_doc)]
 pub unsafe extern "C" fn basic_smoother_callback(_user_context: *mut c_void, _buf: *mut u8, _byte_count: i32, _array: *mut pcr_position_s, _array_length: i32) -> i32 {
     //println!("basic_smoother_callback - {:6?} bytes, arrayLength {:?}", byte_count, array_length);
@@ -274,3 +1147,597 @@ fn test_pcr_smoother() {
         smoother_pcr_free(handle);
     }
 }
+
+#[allow(clippy::missing_safety_doc)]
+pub unsafe extern "C" fn batch_udp_callback(user_context: *mut c_void, list: *mut udp_datagram_s, count: c_int) {
+    unsafe {
+        let received = &*(user_context as *const std::sync::atomic::AtomicUsize);
+        for d in std::slice::from_raw_parts(list, count as usize) {
+            /* RTP header stripped, payload is whole transport packets. */
+            assert_eq!(d.byteCount, 7 * 188);
+            assert_eq!(*d.buf, 0x47);
+            /* Kernel receive time. */
+            assert!(d.ts.tv_sec > 0);
+        }
+        received.fetch_add(count as usize, std::sync::atomic::Ordering::SeqCst);
+    }
+}
+
+#[test]
+fn test_udp_receiver_batch() {
+    let received = std::sync::atomic::AtomicUsize::new(0);
+    let mut rx: *mut udp_receiver_s = ptr::null_mut();
+    let addr = std::ffi::CString::new("127.0.0.1").unwrap();
+
+    unsafe {
+        assert_eq!(udp_receiver_alloc(&mut rx, 4 * 1024 * 1024, addr.as_ptr(), 4011, None,
+            &received as *const _ as *mut c_void, 1), 0);
+        assert_eq!(udp_receiver_set_batch_mode(rx, 16, Some(batch_udp_callback)), 0);
+        assert_eq!(udp_receiver_enable_kernel_timestamps(rx, None), 0);
+        assert_eq!(udp_receiver_thread_start(rx), 0);
+    }
+
+    let mut datagram = [0x47u8; 12 + (7 * 188)];
+    datagram[..12].copy_from_slice(&[0x80, 0x21, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]);
+    let tx = std::net::UdpSocket::bind("127.0.0.1:0").unwrap();
+    for _ in 0..100 {
+        tx.send_to(&datagram, "127.0.0.1:4011").unwrap();
+    }
+
+    for _ in 0..200 {
+        if received.load(std::sync::atomic::Ordering::SeqCst) == 100 {
+            break;
+        }
+        thread::sleep(time::Duration::from_millis(10));
+    }
+    assert_eq!(received.load(std::sync::atomic::Ordering::SeqCst), 100);
+
+    unsafe {
+        udp_receiver_free(&mut rx);
+    }
+}
+
+#[allow(clippy::missing_safety_doc)]
+pub unsafe extern "C" fn packet_receiver_callback(user_context: *mut c_void, buf: *mut u8, byte_count: c_int, ts: *const libc::timeval) {
+    unsafe {
+        let received = &*(user_context as *const std::sync::atomic::AtomicUsize);
+        assert_eq!(byte_count, 7 * 188);
+        assert_eq!(*buf, 0x47);
+        assert!((*ts).tv_sec > 0);
+        received.fetch_add(1, std::sync::atomic::Ordering::SeqCst);
+    }
+}
+
+#[test]
+fn test_packet_receiver_loopback() {
+    let received = std::sync::atomic::AtomicUsize::new(0);
+    let mut hdl: *mut c_void = ptr::null_mut();
+    let ifname = std::ffi::CString::new("lo").unwrap();
+    let addr = std::ffi::CString::new("127.0.0.1").unwrap();
+
+    unsafe {
+        if packet_receiver_alloc(&mut hdl, ifname.as_ptr(), 1 << 20, 4) < 0 {
+            println!("AF_PACKET capture needs CAP_NET_RAW, skipping");
+            return;
+        }
+        assert_eq!(packet_receiver_add_stream(hdl, addr.as_ptr(), 4012, Some(packet_receiver_callback),
+            &received as *const _ as *mut c_void, 1), 0);
+        /* Duplicates are rejected */
+        assert!(packet_receiver_add_stream(hdl, addr.as_ptr(), 4012, Some(packet_receiver_callback),
+            &received as *const _ as *mut c_void, 1) < 0);
+        assert_eq!(packet_receiver_thread_start(hdl), 0);
+    }
+
+    let mut datagram = [0x47u8; 12 + (7 * 188)];
+    datagram[..12].copy_from_slice(&[0x80, 0x21, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]);
+    let tx = std::net::UdpSocket::bind("127.0.0.1:0").unwrap();
+    for _ in 0..100 {
+        tx.send_to(&datagram, "127.0.0.1:4012").unwrap();
+        /* Not registered, counted as unmatched */
+        tx.send_to(&datagram, "127.0.0.1:4013").unwrap();
+    }
+
+    for _ in 0..200 {
+        if received.load(std::sync::atomic::Ordering::SeqCst) == 100 {
+            break;
+        }
+        thread::sleep(time::Duration::from_millis(10));
+    }
+    assert_eq!(received.load(std::sync::atomic::Ordering::SeqCst), 100);
+
+    unsafe {
+        let mut stats: packet_receiver_stats_s = std::mem::zeroed();
+        assert_eq!(packet_receiver_get_stats(hdl, &mut stats), 0);
+        assert_eq!(stats.packets, 100);
+        assert_eq!(stats.unmatched, 100);
+        assert_eq!(packet_receiver_remove_stream(hdl, addr.as_ptr(), 4012), 0);
+        packet_receiver_free(hdl);
+    }
+}
+
+#[allow(clippy::missing_safety_doc)]
+pub unsafe extern "C" fn reactor_udp_callback(user_context: *mut c_void, buf: *mut u8, byte_count: c_int) {
+    unsafe {
+        let received = &*(user_context as *const std::sync::atomic::AtomicUsize);
+        assert_eq!(byte_count, 7 * 188);
+        assert_eq!(*buf, 0x47);
+        received.fetch_add(1, std::sync::atomic::Ordering::SeqCst);
+    }
+}
+
+#[test]
+fn test_udp_receiver_reactor() {
+    let received = std::sync::atomic::AtomicUsize::new(0);
+    let mut reactor: *mut c_void = ptr::null_mut();
+    let mut rx: [*mut udp_receiver_s; 4] = [ptr::null_mut(); 4];
+    let addr = std::ffi::CString::new("127.0.0.1").unwrap();
+
+    unsafe {
+        assert_eq!(udp_receiver_reactor_alloc(&mut reactor, 2, ptr::null(), 0), 0);
+        for (i, r) in rx.iter_mut().enumerate() {
+            assert_eq!(udp_receiver_alloc(r, 1024 * 1024, addr.as_ptr(), 4014 + i as u16, Some(reactor_udp_callback),
+                &received as *const _ as *mut c_void, 1), 0);
+            /* Round robin over two workers */
+            assert_eq!(udp_receiver_reactor_add(reactor, *r), (i % 2) as c_int);
+        }
+        /* Already registered */
+        assert!(udp_receiver_reactor_add(reactor, rx[0]) < 0);
+    }
+
+    let mut datagram = [0x47u8; 12 + (7 * 188)];
+    datagram[..12].copy_from_slice(&[0x80, 0x21, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]);
+    let tx = std::net::UdpSocket::bind("127.0.0.1:0").unwrap();
+    for _ in 0..50 {
+        for port in 4014..4018 {
+            tx.send_to(&datagram, ("127.0.0.1", port)).unwrap();
+        }
+    }
+
+    for _ in 0..200 {
+        if received.load(std::sync::atomic::Ordering::SeqCst) == 200 {
+            break;
+        }
+        thread::sleep(time::Duration::from_millis(10));
+    }
+    assert_eq!(received.load(std::sync::atomic::Ordering::SeqCst), 200);
+
+    unsafe {
+        assert_eq!(udp_receiver_reactor_remove(reactor, rx[0]), 0);
+        assert!(udp_receiver_reactor_remove(reactor, rx[0]) < 0);
+        for r in rx.iter_mut() {
+            udp_receiver_free(r);
+        }
+        udp_receiver_reactor_free(reactor);
+    }
+}
+
+#[test]
+fn test_udp_transmitter_rtp_batch() {
+    let rx = std::net::UdpSocket::bind("127.0.0.1:4018").unwrap();
+    rx.set_read_timeout(Some(time::Duration::from_millis(500))).unwrap();
+    let mut tx: *mut c_void = ptr::null_mut();
+    let addr = std::ffi::CString::new("127.0.0.1").unwrap();
+    let payload = [0x47u8; 7 * 188];
+
+    unsafe {
+        assert_eq!(udp_transmitter_alloc(&mut tx, addr.as_ptr(), 4018, 16), 0);
+        assert_eq!(udp_transmitter_set_rtp(tx, 33, 0x11223344), 0);
+        /* 40 datagrams, two automatic batches of 16 and a final flush of 8 */
+        for _ in 0..40 {
+            assert_eq!(udp_transmitter_write(tx, payload.as_ptr(), payload.len() as c_int), 0);
+        }
+        assert_eq!(udp_transmitter_flush(tx), 8);
+
+        let mut stats: udp_transmitter_stats_s = std::mem::zeroed();
+        assert_eq!(udp_transmitter_get_stats(tx, &mut stats), 0);
+        assert_eq!(stats.datagrams, 40);
+        assert_eq!(stats.sendErrors, 0);
+    }
+
+    let mut buf = [0u8; 2048];
+    for seq in 0..40u16 {
+        let n = rx.recv(&mut buf).unwrap();
+        assert_eq!(n, 12 + 7 * 188);
+        assert_eq!(buf[0], 0x80);
+        assert_eq!(buf[1], 33);
+        assert_eq!(u16::from_be_bytes([buf[2], buf[3]]), seq);
+        assert_eq!(u32::from_be_bytes([buf[8], buf[9], buf[10], buf[11]]), 0x11223344);
+        assert_eq!(buf[12], 0x47);
+    }
+
+    unsafe {
+        udp_transmitter_free(tx);
+    }
+}
+
+#[test]
+fn test_segmentwriter_direct_engine() {
+    let prefix = std::env::temp_dir().join(format!("segmentwriter-direct-{}", std::process::id()));
+    let prefix = std::ffi::CString::new(prefix.to_str().unwrap()).unwrap();
+    let suffix = std::ffi::CString::new(".ts").unwrap();
+    let header = [0xa5u8; 24];
+    let payload = [0x47u8; 7 * 188];
+    let mut hdl: *mut c_void = ptr::null_mut();
+    let mut filename = [0 as std::ffi::c_char; 512];
+
+    unsafe {
+        assert_eq!(
+            segmentwriter_alloc_with_engine(
+                &mut hdl,
+                prefix.as_ptr(),
+                suffix.as_ptr(),
+                SEGMENTEDWRITER_SINGLE_FILE as c_int,
+                SEGMENTEDWRITER_ENGINE_DIRECT as c_int
+            ),
+            0
+        );
+        assert_eq!(segmentwriter_set_header(hdl, header.as_ptr(), header.len()), 0);
+        /* Spans several 1MB buffers and leaves an unaligned tail */
+        for _ in 0..3000 {
+            assert_eq!(segmentwriter_write(hdl, payload.as_ptr(), payload.len()), payload.len() as isize);
+        }
+
+        let mut tries = 0;
+        while segmentwriter_get_current_filename(hdl, filename.as_mut_ptr(), filename.len() as c_int) != 0 {
+            tries += 1;
+            assert!(tries < 100);
+            thread::sleep(time::Duration::from_millis(10));
+        }
+
+        let mut stats: segmentwriter_stats_s = std::mem::zeroed();
+        assert_eq!(segmentwriter_get_stats(hdl, &mut stats), 0);
+        assert_eq!(stats.overruns, 0);
+
+        segmentwriter_free(hdl);
+    }
+
+    let filename = unsafe { std::ffi::CStr::from_ptr(filename.as_ptr()) };
+    let filename = filename.to_str().unwrap().to_owned();
+    let mut contents = Vec::new();
+    File::open(&filename).unwrap().read_to_end(&mut contents).unwrap();
+    std::fs::remove_file(&filename).unwrap();
+
+    assert_eq!(contents.len(), header.len() + 3000 * payload.len());
+    assert_eq!(&contents[..header.len()], &header[..]);
+    assert!(contents[header.len()..].iter().all(|&b| b == 0x47));
+}
+
+#[test]
+fn test_segmentwriter_seek_index() {
+    let demo = std::fs::read("../test-data/demo.ts").unwrap();
+    let prefix = std::env::temp_dir().join(format!("segmentwriter-index-{}", std::process::id()));
+    let prefix = std::ffi::CString::new(prefix.to_str().unwrap()).unwrap();
+    let suffix = std::ffi::CString::new(".ts").unwrap();
+    let mut hdl: *mut c_void = ptr::null_mut();
+    let mut filename = [0 as std::ffi::c_char; 512];
+
+    unsafe {
+        assert_eq!(
+            segmentwriter_alloc(&mut hdl, prefix.as_ptr(), suffix.as_ptr(), SEGMENTEDWRITER_SINGLE_FILE as c_int),
+            0
+        );
+        assert_eq!(segmentwriter_set_index(hdl, 0x31), 0);
+        for chunk in demo.chunks(7 * 188) {
+            assert_eq!(segmentwriter_write(hdl, chunk.as_ptr(), chunk.len()), chunk.len() as isize);
+        }
+
+        let mut tries = 0;
+        while segmentwriter_get_current_filename(hdl, filename.as_mut_ptr(), filename.len() as c_int) != 0 {
+            tries += 1;
+            assert!(tries < 100);
+            thread::sleep(time::Duration::from_millis(10));
+        }
+        segmentwriter_free(hdl);
+
+        let mut idx: *mut c_void = ptr::null_mut();
+        assert_eq!(segmentindex_open(&mut idx, filename.as_ptr()), 0);
+        let count = segmentindex_get_count(idx);
+        assert_eq!(count, 13);
+
+        let mut pcrs = 0;
+        let mut last: segmentindex_entry_s = std::mem::zeroed();
+        for nr in 0..count {
+            let mut e: segmentindex_entry_s = std::mem::zeroed();
+            assert_eq!(segmentindex_get_entry(idx, nr, &mut e), 0);
+            assert_eq!(e.pid, 0x31);
+            assert_eq!(demo[e.offset as usize], 0x47);
+            assert!(nr == 0 || e.offset > last.offset);
+            assert!(e.wallclockMs >= last.wallclockMs);
+            if e.flags as u32 & LTNTSTOOLS_SEGMENTINDEX_FLAG_PCR != 0 {
+                pcrs += 1;
+            }
+            last = e;
+        }
+        assert_eq!(pcrs, 7);
+
+        let (mut start, mut end) = (0u64, 0u64);
+        assert_eq!(segmentindex_find_range(idx, 0, last.wallclockMs, 0, &mut start, &mut end), 0);
+        assert_eq!(end, demo.len() as u64);
+        /* The sample holds no IDR */
+        assert!(segmentindex_find_range(idx, 0, last.wallclockMs, 1, &mut start, &mut end) < 0);
+        segmentindex_close(idx);
+    }
+
+    let filename = unsafe { std::ffi::CStr::from_ptr(filename.as_ptr()) };
+    let filename = filename.to_str().unwrap().to_owned();
+    std::fs::remove_file(format!("{}.idx", filename)).unwrap();
+    std::fs::remove_file(&filename).unwrap();
+}
+
+#[test]
+fn test_ts_file_reader() {
+    let demo = std::fs::read("../test-data/demo.ts").unwrap();
+
+    /* The same packets wrapped in RTP, 7 per datagram, preceded by a partial packet */
+    let rtp_path = std::env::temp_dir().join(format!("ts-file-reader-{}.ts", std::process::id()));
+    let mut rtp = demo[..100].to_vec();
+    for (seq, chunk) in demo.chunks(7 * 188).enumerate() {
+        rtp.extend_from_slice(&[0x80, 33, (seq >> 8) as u8, seq as u8, 0, 0, 0, 0, 0, 0, 0, 0]);
+        rtp.extend_from_slice(chunk);
+    }
+    std::fs::write(&rtp_path, &rtp).unwrap();
+
+    /* The first RTP header is discarded along with the partial packet while finding sync */
+    for (path, rtp_headers) in [("../test-data/demo.ts".to_owned(), 0), (rtp_path.to_str().unwrap().to_owned(), 714)] {
+        let filename = std::ffi::CString::new(path).unwrap();
+        let mut hdl: *mut c_void = ptr::null_mut();
+        let mut pkts: *const u8 = ptr::null();
+        let mut total = 0;
+
+        unsafe {
+            assert_eq!(ts_file_reader_alloc(&mut hdl, filename.as_ptr()), 0);
+            loop {
+                let count = ts_file_reader_next(hdl, &mut pkts, 7);
+                assert!(count >= 0);
+                if count == 0 {
+                    break;
+                }
+                assert!(count <= 7);
+                for i in 0..count as usize {
+                    assert_eq!(*pkts.add(i * 188), 0x47);
+                }
+                total += count;
+            }
+
+            let mut stats: ts_file_reader_stats_s = std::mem::zeroed();
+            assert_eq!(ts_file_reader_get_stats(hdl, &mut stats), 0);
+            assert_eq!(stats.rtpHeaders, rtp_headers);
+            assert_eq!(ts_file_reader_get_position(hdl), ts_file_reader_get_length(hdl));
+            ts_file_reader_free(hdl);
+        }
+        assert_eq!(total, 5000);
+    }
+
+    std::fs::remove_file(&rtp_path).unwrap();
+}
+
+/* cargo test --release -- --ignored --nocapture bench_ts_file_reader
+ * demo.ts from the page cache, 7 packet batches, the classic fread() and findSyncPosition()
+ * loop against the memory mapped reader, as a bare source and feeding pid statistics.
+ */
+#[test]
+#[ignore]
+fn bench_ts_file_reader() {
+    const PASSES: usize = 400;
+    const PACKETS: usize = 5000;
+    let path = std::ffi::CString::new("../test-data/demo.ts").unwrap();
+    let mode = std::ffi::CString::new("rb").unwrap();
+
+    for with_stats in [false, true] {
+        unsafe {
+            let mut stats = ptr::null_mut();
+            assert_eq!(pid_stats_alloc(&mut stats as _), 0);
+
+            /* fread() into a 7 packet buffer, find sync in every read */
+            let mut buffer = [0u8; 7 * 188];
+            let mut total = 0usize;
+            let start = time::Instant::now();
+            for _ in 0..PASSES {
+                let fh = libc::fopen(path.as_ptr(), mode.as_ptr());
+                assert!(!fh.is_null());
+                loop {
+                    let nbytes = libc::fread(buffer.as_mut_ptr() as *mut c_void, 1, buffer.len(), fh);
+                    let offset = findSyncPosition(buffer.as_ptr(), nbytes as _);
+                    if offset < 0 {
+                        break;
+                    }
+                    let count = (nbytes - offset as usize) / 188;
+                    if with_stats {
+                        pid_stats_update(stats, buffer.as_ptr().add(offset as usize), count as u32);
+                    }
+                    total += count;
+                }
+                libc::fclose(fh);
+            }
+            let fread_ns = start.elapsed().as_nanos() as f64 / total as f64;
+            assert_eq!(total, PASSES * PACKETS);
+
+            /* Zero copy batches straight from the mapping */
+            let mut pkts: *const u8 = ptr::null();
+            let mut total = 0usize;
+            let start = time::Instant::now();
+            for _ in 0..PASSES {
+                let mut hdl: *mut c_void = ptr::null_mut();
+                assert_eq!(ts_file_reader_alloc(&mut hdl, path.as_ptr()), 0);
+                loop {
+                    let count = ts_file_reader_next(hdl, &mut pkts, 7);
+                    if count <= 0 {
+                        break;
+                    }
+                    if with_stats {
+                        pid_stats_update(stats, pkts, count as u32);
+                    }
+                    total += count as usize;
+                }
+                ts_file_reader_free(hdl);
+            }
+            let mmap_ns = start.elapsed().as_nanos() as f64 / total as f64;
+            assert_eq!(total, PASSES * PACKETS);
+
+            pid_stats_free(stats);
+
+            println!(
+                "{:20} fread()+findSync {:6.1} ns/pkt, mmap reader {:6.1} ns/pkt",
+                if with_stats { "+ pid_stats_update" } else { "source only" },
+                fread_ns,
+                mmap_ns
+            );
+        }
+    }
+}
+
+#[test]
+fn test_pid_stats_analyze_file() {
+    let demo = std::fs::read("../test-data/demo.ts").unwrap();
+
+    /* Drop packets throughout, some of the discontinuities fall on the shard joins */
+    let path = std::env::temp_dir().join(format!("stats-offline-{}.ts", std::process::id()));
+    let damaged: Vec<u8> = demo
+        .chunks(188)
+        .enumerate()
+        .filter(|(i, _)| i % 97 != 5)
+        .flat_map(|(_, pkt)| pkt.to_vec())
+        .collect();
+    std::fs::write(&path, &damaged).unwrap();
+    let filename = std::ffi::CString::new(path.to_str().unwrap()).unwrap();
+
+    unsafe {
+        /* Single pass reference */
+        let mut single: *mut stream_statistics_s = ptr::null_mut();
+        assert_eq!(pid_stats_alloc(&mut single as _), 0);
+        for chunk in damaged.chunks(7 * 188) {
+            pid_stats_update(single, chunk.as_ptr(), (chunk.len() / 188) as u32);
+        }
+        assert_eq!(pid_stats_stream_get_cc_errors(single), 45);
+
+        for threads in [1, 4] {
+            let mut stats: *mut stream_statistics_s = ptr::null_mut();
+            assert_eq!(pid_stats_alloc(&mut stats as _), 0);
+            pid_stats_pid_set_contains_pcr(stats, 0x31);
+            assert_eq!(pid_stats_analyze_file(stats, filename.as_ptr(), threads), 0);
+
+            assert_eq!(pid_stats_stream_get_packet_count(stats), 4948);
+            assert_eq!(pid_stats_stream_get_cc_errors(stats), pid_stats_stream_get_cc_errors(single));
+            assert_eq!(pid_stats_stream_get_notmultipleofseven_errors(stats), 0);
+            for pid in [0x0, 0x30, 0x31, 0x32, 0x33, 0x1fff] {
+                assert_eq!(pid_stats_pid_get_packet_count(stats, pid), pid_stats_pid_get_packet_count(single, pid));
+                assert_eq!(pid_stats_pid_get_cc_errors(stats, pid), pid_stats_pid_get_cc_errors(single, pid));
+            }
+            assert_eq!(pid_stats_pid_get_contains_pcr(stats, 0x31), 1);
+            pid_stats_free(stats);
+        }
+        pid_stats_free(single);
+    }
+
+    std::fs::remove_file(&path).unwrap();
+}
+
+#[test]
+fn test_pid_stats_snapshots() {
+    let demo = std::fs::read("../test-data/demo.ts").unwrap();
+    let (first, second) = demo.split_at(2457 * 188);
+
+    unsafe {
+        let mut stats: *mut stream_statistics_s = ptr::null_mut();
+        assert_eq!(pid_stats_alloc(&mut stats as _), 0);
+
+        let mut a: Box<pid_stats_snapshot_s> = Box::new(std::mem::zeroed());
+        let mut b: Box<pid_stats_snapshot_s> = Box::new(std::mem::zeroed());
+        let mut d: Box<pid_stats_snapshot_s> = Box::new(std::mem::zeroed());
+
+        pid_stats_update(stats, first.as_ptr(), (first.len() / 188) as u32);
+        assert_eq!(pid_stats_snapshot_take(stats, a.as_mut()), 0);
+        pid_stats_update(stats, second.as_ptr(), (second.len() / 188) as u32);
+        assert_eq!(pid_stats_snapshot_take(stats, b.as_mut()), 0);
+
+        assert_eq!(b.packetCount, 5000);
+        assert_eq!(b.pidCount, 6);
+        assert!(b.pids[..b.pidCount as usize].windows(2).all(|w| w[0].pidNr < w[1].pidNr));
+
+        /* Activity in the second half only */
+        assert_eq!(pid_stats_snapshot_delta(d.as_mut(), b.as_ref(), a.as_ref()), 0);
+        assert_eq!(d.packetCount, 5000 - 2457);
+        let total: u64 = d.pids[..d.pidCount as usize].iter().map(|p| p.packetCount).sum();
+        assert_eq!(total, d.packetCount);
+        assert!(d.intervalUs >= 0);
+
+        /* Two identical streams rolled up */
+        assert_eq!(pid_stats_snapshot_merge(d.as_mut(), b.as_ref(), b.as_ref()), 0);
+        assert_eq!(d.packetCount, 10000);
+        assert_eq!(d.pidCount, 6);
+        let video = d.pids.iter().find(|p| p.pidNr == 0x31).unwrap();
+        assert_eq!(video.packetCount, 2 * pid_stats_pid_get_packet_count(stats, 0x31));
+
+        pid_stats_free(stats);
+    }
+}
+
+#[test]
+fn test_crc32_kernels() {
+    let kernel = unsafe { std::ffi::CStr::from_ptr(crc32_kernel_name()) };
+    println!("CRC32 kernel {:?}", kernel);
+
+    /* Every length the folding kernel splits differently, at every alignment */
+    let data: Vec<u8> = (0..4200u32).map(|i| (i.wrapping_mul(2654435761) >> 13) as u8).collect();
+    for offset in 0..16 {
+        for length in 1..(data.len() - offset) as c_int {
+            let buf = data[offset..].as_ptr();
+            let (mut crc, mut reference) = (0u32, 0u32);
+            unsafe {
+                assert_eq!(getCRC32(buf, length, &mut crc), 0);
+                assert_eq!(getCRC32_reference(buf, length, &mut reference), 0);
+            }
+            assert_eq!(crc, reference, "offset {} length {}", offset, length);
+        }
+    }
+
+    /* CRC-32/MPEG-2 check value, and a section carrying its own CRC validates */
+    let mut crc = 0u32;
+    unsafe { getCRC32(b"123456789".as_ptr(), 9, &mut crc) };
+    assert_eq!(crc, 0x0376e6e7);
+
+    let mut section = data[..1020].to_vec();
+    unsafe { getCRC32(section.as_ptr(), 1016, &mut crc) };
+    section[1016..].copy_from_slice(&crc.to_be_bytes());
+    assert_eq!(unsafe { checkCRC32(section.as_ptr(), 1020) }, 0);
+    section[500] ^= 0x10;
+    assert_eq!(unsafe { checkCRC32(section.as_ptr(), 1020) }, -1);
+}
+
+/* cargo test --release -- --ignored --nocapture bench_crc32
+ * ns per buffer for the dispatched kernel against the byte at a time reference.
+ */
+#[test]
+#[ignore]
+fn bench_crc32() {
+    let kernel = unsafe { std::ffi::CStr::from_ptr(crc32_kernel_name()) };
+    println!("CRC32 kernel {:?}", kernel);
+
+    let data: Vec<u8> = (0..65536u32).map(|i| (i.wrapping_mul(2654435761) >> 13) as u8).collect();
+    for length in [16usize, 64, 184, 1024, 4096, 65536] {
+        /* Roughly 64MB through each kernel */
+        let iterations = (64 * 1024 * 1024 / length).max(1000);
+        let (mut crc, mut reference) = (0u32, 0u32);
+
+        let start = time::Instant::now();
+        for _ in 0..iterations {
+            unsafe { getCRC32(data.as_ptr(), length as c_int, &mut crc) };
+        }
+        let fast_ns = start.elapsed().as_nanos() as f64 / iterations as f64;
+
+        let start = time::Instant::now();
+        for _ in 0..iterations / 8 {
+            unsafe { getCRC32_reference(data.as_ptr(), length as c_int, &mut reference) };
+        }
+        let reference_ns = start.elapsed().as_nanos() as f64 / (iterations / 8) as f64;
+
+        assert_eq!(crc, reference);
+        println!(
+            "{:6} bytes {:10.1} ns/buffer, reference {:10.1} ns/buffer, {:5.1}x",
+            length,
+            fast_ns,
+            reference_ns,
+            reference_ns / fast_ns
+        );
+    }
+}
@@ -3,7 +3,6 @@ use libc::{c_void, c_int};
 use std::{
     io::{self, prelude::*},
     marker::PhantomData,
-    alloc,
     ptr,
 };
 use std::sync::atomic::{AtomicUsize, Ordering};
@@ -11,7 +10,7 @@ use std::sync::atomic::{AtomicUsize, Ordering};
 #[derive(Debug)]
 pub struct StreamModel<F>
 where
-    F: FnMut(&mut sys::pat_s),
+    F: FnMut(&sys::psi_model_s),
 {
     handle: *mut c_void,
     callback: *mut F,
@@ -20,7 +19,7 @@ where
 
 impl<F> StreamModel<F>
 where
-    F: FnMut(&mut sys::pat_s),
+    F: FnMut(&sys::psi_model_s),
 {
     pub fn new(callback: F) -> Self {
         println!("Creating StreamModel");
@@ -42,7 +41,7 @@ where
 
 impl<F> Write for StreamModel<F>
 where
-    F: FnMut(&mut sys::pat_s),
+    F: FnMut(&sys::psi_model_s),
 {
     /// Write an entire MPTS into the framework, pid filtering and demuxing the stream.
     ///
@@ -79,30 +78,17 @@ where
             let _ = sys::streammodel_write(self.handle, buf.as_ptr(), len / 188, val_ptr, &mut timestamp);
 
             if val == 1 {
-                let mut pat = ptr::null_mut();
-
-                sys::streammodel_query_model(self.handle, &mut pat as _);
-                let mut sm = {
-                    let sm_layout = alloc::Layout::new::<sys::pat_s>();
-                    let sm_ptr = alloc::alloc(sm_layout);
-                    ptr::write_bytes(sm_ptr, 0, sm_layout.size());
-                    Box::from_raw(pat as *mut sys::pat_s)
-                };
-                let _sm_ptr = sm.as_mut();
-
-//                if !pat.is_null() {
-                    //callback(&mut *pat);
-//                }
-                let callback = &mut *(self.callback as *mut F);
-                callback(&mut *pat);
-
-                //println!("Total programs in stream {}", sm_ptr.program_count);
-
-                /* Display the entire pat, pmt and descriptor model to console */
-                //sys::pat_dprintf(pat, 1);
-                //sys::pat_free(pat);
-
-                //break;
+                // The model is shared with the framework, we hold a reference for the
+                // duration of the callback only.
+                let mut model: *const sys::psi_model_s = ptr::null();
+                if sys::streammodel_query_psi_model(self.handle, &mut model) == 0 && !model.is_null() {
+                    let callback = &mut *self.callback;
+                    callback(&*model);
+
+                    /* Display the entire pat, pmt and descriptor model to console */
+                    //sys::psi_model_dprintf(model, 1);
+                    sys::psi_model_unref(model);
+                }
             }
         };
 
@@ -116,7 +102,7 @@ where
 
 impl<F> Drop for StreamModel<F>
 where
-    F: FnMut(&mut sys::pat_s),
+    F: FnMut(&sys::psi_model_s),
 {
     fn drop(&mut self) {
         unsafe {
@@ -138,16 +124,17 @@ mod tests {
 
         let stop_looking = AtomicUsize::new(0);
 
-        let callback = |pat: &mut sys::pat_s| {
-            println!("StreamModel: Callback received buffer with entire pat object");
-            println!("StreamModel: Total programs in stream {}", pat.program_count);
-            if pat.program_count > 0 {
+        let callback = |model: &sys::psi_model_s| {
+            println!("StreamModel: Callback received the entire psi model");
+            println!("StreamModel: Total programs in stream {}", model.program_count);
+            let programs = unsafe {
+                std::slice::from_raw_parts(model.programs, model.program_count as usize)
+            };
+            for program in programs {
                 println!("StreamModel: program #{} PCR_PID 0x{:x} ",
-                    pat.programs[0].program_number, pat.programs[0].pmt.PCR_PID);
+                    program.program_number, program.PCR_PID);
             }
             stop_looking.store(1, Ordering::Relaxed);
-
-            // Do we need to release the pat or something?
         };
 
         // Instantiate a model object
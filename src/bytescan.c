@@ -0,0 +1,229 @@
+/* Copyright LiveTimeNet, Inc. 2026. All Rights Reserved. */
+
+#include <string.h>
+
+#include "libltntstools/bytescan.h"
+
+#if defined(__x86_64__)
+#define BYTESCAN_X86 1
+#include <immintrin.h>
+#endif
+
+typedef int (*start_code_fn)(const uint8_t *buf, int lengthBytes, int from);
+typedef const uint8_t *(*memmem_fn)(const uint8_t *haystack, size_t n, const uint8_t *needle, size_t m);
+
+/* The scalar versions also finish the tails for the vector kernels. */
+static int _start_code_scalar(const uint8_t *buf, int lengthBytes, int from)
+{
+	for (int i = from; i < lengthBytes - 3; i++) {
+		if (buf[i + 2] > 1) {
+			i += 2; /* Can't be part of a start code at i, i + 1 or i + 2 */
+			continue;
+		}
+		if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1) {
+			return i;
+		}
+	}
+
+	return -1; /* Not found */
+}
+
+static const uint8_t *_memmem_scalar(const uint8_t *haystack, size_t n, const uint8_t *needle, size_t m, size_t from)
+{
+	for (size_t i = from; i + m <= n; i++) {
+		if (haystack[i] == needle[0] && memcmp(haystack + i + 1, needle + 1, m - 1) == 0) {
+			return haystack + i;
+		}
+	}
+
+	return NULL;
+}
+
+#if BYTESCAN_X86
+
+/* SSE2 is part of the x86_64 baseline, no dispatch needed.
+ * Sixteen candidate positions per iteration, a start code is where
+ * byte[i] == 0, byte[i + 1] == 0 and byte[i + 2] == 1, from three overlapping loads.
+ */
+static int _start_code_sse2(const uint8_t *buf, int lengthBytes, int from)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi8(1);
+
+	int i = from;
+	for (; i + 16 <= lengthBytes - 3; i += 16) {
+		__m128i c = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buf + i + 2)), one);
+		if (_mm_movemask_epi8(c) == 0) {
+			continue; /* No 01 bytes, the overwhelmingly common case in coded slices */
+		}
+		__m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buf + i)), zero);
+		__m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buf + i + 1)), zero);
+		int mask = _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(a, b), c));
+		if (mask) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+
+	return _start_code_scalar(buf, lengthBytes, i);
+}
+
+/* Filter on the first, second and last needle bytes, confirm with memcmp. */
+static const uint8_t *_memmem_sse2(const uint8_t *haystack, size_t n, const uint8_t *needle, size_t m)
+{
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i second = _mm_set1_epi8(needle[1]);
+	const __m128i last = _mm_set1_epi8(needle[m - 1]);
+
+	size_t i = 0;
+	for (; i + 16 + m - 1 <= n; i += 16) {
+		__m128i f = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(haystack + i)), first);
+		__m128i s = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(haystack + i + 1)), second);
+		__m128i l = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(haystack + i + m - 1)), last);
+		unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(f, s), l));
+		while (mask) {
+			int bit = __builtin_ctz(mask);
+			if (memcmp(haystack + i + bit + 2, needle + 2, m - 2) == 0) {
+				return haystack + i + bit;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	return _memmem_scalar(haystack, n, needle, m, i);
+}
+
+__attribute__((target("avx2")))
+static int _start_code_avx2(const uint8_t *buf, int lengthBytes, int from)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi8(1);
+
+	int i = from;
+	for (; i + 32 <= lengthBytes - 3; i += 32) {
+		__m256i c = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buf + i + 2)), one);
+		if (_mm256_movemask_epi8(c) == 0) {
+			continue;
+		}
+		__m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buf + i)), zero);
+		__m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buf + i + 1)), zero);
+		unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(a, b), c));
+		if (mask) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+
+	/* Leaving for legacy SSE encoded code, avoid the AVX/SSE transition penalty. */
+	_mm256_zeroupper();
+
+	return _start_code_sse2(buf, lengthBytes, i);
+}
+
+__attribute__((target("avx2")))
+static const uint8_t *_memmem_avx2(const uint8_t *haystack, size_t n, const uint8_t *needle, size_t m)
+{
+	const __m256i first = _mm256_set1_epi8(needle[0]);
+	const __m256i second = _mm256_set1_epi8(needle[1]);
+	const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+
+	size_t i = 0;
+	for (; i + 32 + m - 1 <= n; i += 32) {
+		__m256i f = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(haystack + i)), first);
+		__m256i s = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(haystack + i + 1)), second);
+		__m256i l = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(haystack + i + m - 1)), last);
+		unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(f, s), l));
+		while (mask) {
+			int bit = __builtin_ctz(mask);
+			if (memcmp(haystack + i + bit + 2, needle + 2, m - 2) == 0) {
+				return haystack + i + bit;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	_mm256_zeroupper();
+
+	return _memmem_scalar(haystack, n, needle, m, i);
+}
+
+#endif /* BYTESCAN_X86 */
+
+static start_code_fn _start_code = NULL;
+static memmem_fn _memmem = NULL;
+static const char *_kernelName = "scalar";
+
+static void _select_kernels(void)
+{
+#if BYTESCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		_memmem = _memmem_avx2;
+		_start_code = _start_code_avx2;
+		_kernelName = "avx2";
+	} else {
+		_memmem = _memmem_sse2;
+		_start_code = _start_code_sse2;
+		_kernelName = "sse2";
+	}
+#else
+	_start_code = _start_code_scalar;
+#endif
+}
+
+const char *ltntstools_bytescan_kernel_name(void)
+{
+	if (!_start_code) {
+		_select_kernels();
+	}
+	return _kernelName;
+}
+
+int ltntstools_bytescan_start_code(const uint8_t *buf, int lengthBytes, int from)
+{
+	if (from < 0) {
+		from = 0;
+	}
+
+	if (!_start_code) {
+		_select_kernels();
+	}
+
+	return _start_code(buf, lengthBytes, from);
+}
+
+int ltntstools_bytescan_start_code_scalar(const uint8_t *buf, int lengthBytes, int from)
+{
+	if (from < 0) {
+		from = 0;
+	}
+
+	return _start_code_scalar(buf, lengthBytes, from);
+}
+
+const uint8_t *ltntstools_bytescan_memmem(const uint8_t *haystack, size_t n, const uint8_t *needle, size_t m)
+{
+	if (m > n || !m || !n) {
+		return NULL;
+	}
+	if (m == 1) {
+		return memchr(haystack, needle[0], n);
+	}
+
+#if BYTESCAN_X86
+	if (!_memmem) {
+		_select_kernels();
+	}
+
+	return _memmem(haystack, n, needle, m);
+#else
+	return _memmem_scalar(haystack, n, needle, m, 0);
+#endif
+}
+
+const uint8_t *ltntstools_bytescan_memmem_scalar(const uint8_t *haystack, size_t n, const uint8_t *needle, size_t m)
+{
+	if (m > n || !m || !n) {
+		return NULL;
+	}
+
+	return _memmem_scalar(haystack, n, needle, m, 0);
+}
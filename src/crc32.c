@@ -1,7 +1,21 @@
 /* Copyright Kernel Labs Inc 2015-2021. All Rights Reserved. */
 
+#include <pthread.h>
+
 #include "libltntstools/crc32.h"
 
+#if defined(__x86_64__)
+#define CRC32_X86 1
+#include <immintrin.h>
+#endif
+
+/* MPEG-2 CRC, x^32 + x^26 + x^23 + x^22 + x^16 + x^12 + x^11 + x^10 + x^8 + x^7 + x^5 + x^4 + x^2 + x + 1,
+ * msb first, no reflection, no final xor.
+ */
+#define CRC32_POLY 0x04c11db7
+
+typedef uint32_t (*crc32_kernel_fn)(uint32_t crc, const uint8_t *buf, int lengthBytes);
+
 /* CRC - Section checksumming helpers - common for ATSC/DVB */
 static unsigned int crc32_table[256] =
 {
@@ -71,34 +85,179 @@ static unsigned int crc32_table[256] =
 	0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
-int ltntstools_checkCRC32(const uint8_t *buf, int lengthBytes)
+/* Byte at a time, the reference every other kernel is validated against. */
+static uint32_t _crc32_bytewise(uint32_t crc, const uint8_t *buf, int lengthBytes)
 {
-	uint32_t crc = 0xffffffff;
 	const uint8_t *p = buf;
 
-	if ((!buf) || (lengthBytes < 4))
-		return -1;
-
 	while (p < buf + lengthBytes) {
 		crc = (crc << 8) ^ crc32_table[(crc >> 24) ^ (*p)];
 		p++;
 	}
 
-	return (crc == 0) ? 0 : -1;
+	return crc;
+}
+
+/* crc32_slice8_table[k][b] is the CRC contribution of byte b followed by k zero bytes,
+ * [0] is crc32_table. Built once by _select_kernel().
+ */
+static uint32_t crc32_slice8_table[8][256];
+
+/* Eight bytes per iteration, eight independent lookups rather than a serial chain of eight. */
+static uint32_t _crc32_slice8(uint32_t crc, const uint8_t *buf, int lengthBytes)
+{
+	const uint32_t (*t)[256] = (const uint32_t (*)[256])crc32_slice8_table;
+
+	while (lengthBytes >= 8) {
+		uint32_t a = crc ^ ((uint32_t)buf[0] << 24 | (uint32_t)buf[1] << 16 | (uint32_t)buf[2] << 8 | buf[3]);
+		crc = t[7][a >> 24] ^ t[6][(a >> 16) & 0xff] ^ t[5][(a >> 8) & 0xff] ^ t[4][a & 0xff] ^
+			t[3][buf[4]] ^ t[2][buf[5]] ^ t[1][buf[6]] ^ t[0][buf[7]];
+		buf += 8;
+		lengthBytes -= 8;
+	}
+
+	return _crc32_bytewise(crc, buf, lengthBytes);
+}
+
+#if CRC32_X86
+
+/* Fold constants, x^n mod P, high qword multiplies the high half of the accumulator. */
+static uint64_t _fold512[2]; /* x^576, x^512 */
+static uint64_t _fold128[2]; /* x^192, x^128 */
+
+/* acc * x^distance, reduced back into 128 bits, congruent mod P. */
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i _fold(__m128i acc, __m128i k)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(acc, k, 0x11), _mm_clmulepi64_si128(acc, k, 0x00));
+}
+
+/* Carry-less multiply folding, 64 bytes per iteration across four accumulators.
+ * Each 16 byte block is byte reversed, so bit n of the register is the coefficient of x^n.
+ * The 128 bit remainder is reduced to 32 bits by the table kernel, along with any tail.
+ */
+__attribute__((target("pclmul,ssse3")))
+static uint32_t _crc32_pclmul(uint32_t crc, const uint8_t *buf, int lengthBytes)
+{
+	if (lengthBytes < 64)
+		return _crc32_slice8(crc, buf, lengthBytes);
+
+	const __m128i bswap = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	const __m128i k512 = _mm_set_epi64x(_fold512[0], _fold512[1]);
+	const __m128i k128 = _mm_set_epi64x(_fold128[0], _fold128[1]);
+
+	__m128i x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf +  0)), bswap);
+	__m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + 16)), bswap);
+	__m128i x2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + 32)), bswap);
+	__m128i x3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + 48)), bswap);
+
+	/* The running CRC is xor'd into the leading 32 bits of the message. */
+	x0 = _mm_xor_si128(x0, _mm_set_epi32(crc, 0, 0, 0));
+	buf += 64;
+	lengthBytes -= 64;
+
+	while (lengthBytes >= 64) {
+		x0 = _mm_xor_si128(_fold(x0, k512), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf +  0)), bswap));
+		x1 = _mm_xor_si128(_fold(x1, k512), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + 16)), bswap));
+		x2 = _mm_xor_si128(_fold(x2, k512), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + 32)), bswap));
+		x3 = _mm_xor_si128(_fold(x3, k512), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buf + 48)), bswap));
+		buf += 64;
+		lengthBytes -= 64;
+	}
+
+	x0 = _mm_xor_si128(_fold(x0, k128), x1);
+	x0 = _mm_xor_si128(_fold(x0, k128), x2);
+	x0 = _mm_xor_si128(_fold(x0, k128), x3);
+
+	while (lengthBytes >= 16) {
+		x0 = _mm_xor_si128(_fold(x0, k128), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)buf), bswap));
+		buf += 16;
+		lengthBytes -= 16;
+	}
+
+	uint8_t remainder[16];
+	_mm_storeu_si128((__m128i *)remainder, _mm_shuffle_epi8(x0, bswap));
+
+	crc = _crc32_slice8(0, remainder, sizeof(remainder));
+	return _crc32_slice8(crc, buf, lengthBytes);
+}
+
+/* x^n mod P */
+static uint32_t _xpow_mod(int n)
+{
+	uint32_t r = 1;
+	while (n-- > 0)
+		r = (r << 1) ^ ((r & 0x80000000) ? CRC32_POLY : 0);
+	return r;
+}
+
+#endif /* CRC32_X86 */
+
+static pthread_once_t _kernelOnce = PTHREAD_ONCE_INIT;
+static crc32_kernel_fn _kernel = _crc32_bytewise;
+static const char *_kernelName = "bytewise";
+
+static void _select_kernel(void)
+{
+	for (int i = 0; i < 256; i++) {
+		crc32_slice8_table[0][i] = crc32_table[i];
+	}
+	for (int k = 1; k < 8; k++) {
+		for (int i = 0; i < 256; i++) {
+			uint32_t c = crc32_slice8_table[k - 1][i];
+			crc32_slice8_table[k][i] = (c << 8) ^ crc32_table[c >> 24];
+		}
+	}
+
+	_kernel = _crc32_slice8;
+	_kernelName = "slice8";
+
+#if CRC32_X86
+	_fold512[0] = _xpow_mod(576);
+	_fold512[1] = _xpow_mod(512);
+	_fold128[0] = _xpow_mod(192);
+	_fold128[1] = _xpow_mod(128);
+
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3")) {
+		_kernel = _crc32_pclmul;
+		_kernelName = "pclmul";
+	}
+#endif
+}
+
+const char *ltntstools_crc32_kernel_name(void)
+{
+	pthread_once(&_kernelOnce, _select_kernel);
+	return _kernelName;
+}
+
+int ltntstools_checkCRC32(const uint8_t *buf, int lengthBytes)
+{
+	if ((!buf) || (lengthBytes < 4))
+		return -1;
+
+	pthread_once(&_kernelOnce, _select_kernel);
+
+	return (_kernel(0xffffffff, buf, lengthBytes) == 0) ? 0 : -1;
 }
 
 int ltntstools_getCRC32(const uint8_t *buf, int lengthBytes, uint32_t *crc32)
 {
-	uint32_t crc = 0xffffffff;
-	const uint8_t *p = buf;
+	if ((!buf) || (lengthBytes < 1) || (!crc32))
+		return -1;
+
+	pthread_once(&_kernelOnce, _select_kernel);
 
+	*crc32 = _kernel(0xffffffff, buf, lengthBytes);
+	return 0;
+}
+
+int ltntstools_getCRC32_reference(const uint8_t *buf, int lengthBytes, uint32_t *crc32)
+{
 	if ((!buf) || (lengthBytes < 1) || (!crc32))
 		return -1;
 
-	while (p < buf + lengthBytes) {
-		crc = (crc << 8) ^ crc32_table[(crc >> 24) ^ (*p)];
-		p++;
-	}
-	*crc32 = crc;
+	*crc32 = _crc32_bytewise(0xffffffff, buf, lengthBytes);
 	return 0;
 }
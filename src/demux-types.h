@@ -15,6 +15,7 @@
 #include "libltntstools/demux.h"
 #include "libltntstools/ts.h"
 #include "libltntstools/pat.h"
+#include "libltntstools/psimodel.h"
 #include "libltntstools/timeval.h"
 
 #include "xorg-list.h"
@@ -62,11 +63,16 @@ struct demux_ctx_s
 	void *userContext;
 	struct ltntstools_demux_callbacks *callbacks;
 
-	const struct ltntstools_pat_s *pat;
+	const struct ltntstools_psi_model_s *model;
 
 	struct demux_pid_s pids[MAX_PIDS];
 	struct demux_pid_s *pidIndex[MAX_PIDS]; /* Quick array for looking up which pids are active - performance gain */
 	int pidIndexLength;
+
+	/* One statistics context for the entire mux, updated as packets are dispatched. Shared with every
+	 * PES extractor for its STC, so extractors only ever see packets for their own pid.
+	 */
+	struct ltntstools_stream_statistics_s *libstats;
 };
 
 void *demux_pid_pe_callback(void *userContext, struct ltn_pes_packet_s *pes);
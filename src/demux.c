@@ -11,7 +11,7 @@ void ltntstools_demux_free(void *hdl)
 {
 	struct demux_ctx_s *ctx = (struct demux_ctx_s *)hdl;
 
-	ltntstools_pat_free((struct ltntstools_pat_s *)ctx->pat);
+	ltntstools_psi_model_unref(ctx->model);
 
 	for (int i = 0; i < MAX_PIDS; i++) {
 		struct demux_pid_s *pid = _getPIDContext(ctx, i);
@@ -23,13 +23,28 @@ void ltntstools_demux_free(void *hdl)
 		free(ctx->callbacks);
 		ctx->callbacks = NULL;
 	}
+	ltntstools_pid_stats_free(ctx->libstats);
 	free(ctx);
 }
 
 int ltntstools_demux_alloc_from_pat(void **hdl, void *userContext,
 	const struct ltntstools_demux_callbacks *callbacks, const struct ltntstools_pat_s *pat)
 {
-	if (!pat) {
+	const struct ltntstools_psi_model_s *model = ltntstools_psi_model_alloc_from_pat(pat);
+	if (!model) {
+		return -1;
+	}
+
+	int ret = ltntstools_demux_alloc_from_psi_model(hdl, userContext, callbacks, model);
+	ltntstools_psi_model_unref(model);
+
+	return ret;
+}
+
+int ltntstools_demux_alloc_from_psi_model(void **hdl, void *userContext,
+	const struct ltntstools_demux_callbacks *callbacks, const struct ltntstools_psi_model_s *model)
+{
+	if (!model) {
 		return -1;
 	}
 
@@ -39,7 +54,7 @@ int ltntstools_demux_alloc_from_pat(void **hdl, void *userContext,
 	}
 
 	ctx->userContext = userContext;
-	ctx->pat = ltntstools_pat_clone((struct ltntstools_pat_s *)pat);
+	ctx->model = ltntstools_psi_model_ref(model);
 	ctx->verbose = 0;
 	if (callbacks) {
 		ctx->callbacks = malloc(sizeof(*ctx->callbacks));
@@ -50,6 +65,13 @@ int ltntstools_demux_alloc_from_pat(void **hdl, void *userContext,
 		ctx->callbacks = NULL;
 	}
 
+	if (ltntstools_pid_stats_alloc(&ctx->libstats) < 0) {
+		ltntstools_psi_model_unref(ctx->model);
+		free(ctx->callbacks);
+		free(ctx);
+		return -1;
+	}
+
 	for (int i = 0; i < MAX_PIDS;i++) {
 		struct demux_pid_s *pid = _getPIDContext(ctx, i);
 		if (pid) {
@@ -57,19 +79,21 @@ int ltntstools_demux_alloc_from_pat(void **hdl, void *userContext,
 		}
 	}
 
+	uint16_t pcrpid = 0;
+	int hasPCRPID = ltntstools_psi_model_query_first_program_pcr_pid(ctx->model, &pcrpid) == 0;
+
 	/* Now walk the PAT and allocate any needed PES extractors */
 	/* TODO: We need section extractors too */
-	for (int p = 0; p < ctx->pat->program_count; p++) {
-		const struct ltntstools_pat_program_s *program = &pat->programs[p];
+	for (int p = 0; p < ctx->model->program_count; p++) {
+		const struct ltntstools_psi_program_s *program = &ctx->model->programs[p];
 		if (program->program_number == 0) {
 			/* NIT */
 			continue;
 		}
 
 		/* For every elementary stream in a PMT */
-		const struct ltntstools_pmt_s *pmt = &program->pmt;
-		for (int s = 0; s < pmt->stream_count; s++) {
-			const struct ltntstools_pmt_entry_s *stream = &pmt->streams[s];
+		for (int s = 0; s < program->stream_count; s++) {
+			const struct ltntstools_psi_stream_s *stream = &program->streams[s];
 			struct demux_pid_s *pid = _getPIDContext(ctx, stream->elementary_PID);
 			if (!pid) {
 				continue;
@@ -86,7 +110,7 @@ int ltntstools_demux_alloc_from_pat(void **hdl, void *userContext,
 			/* TODO: No support for SCTE35, SMPTE2038 or other private streams currently */
 
 			if (stream->stream_type == 0x06 /* Private */) {
-				if (ltntstools_descriptor_list_contains_smpte2064_registration((struct ltntstools_descriptor_list_s *)&stream->descr_list)) {
+				if (ltntstools_descriptor_loop_contains_smpte2064_registration(&stream->descr)) {
 					/* Found a SMPTE-2064 stream. */
 					if (ltntstools_pes_extractor_alloc(&pid->pe, stream->elementary_PID,
 						0xbf, /* See SMPTE ST 2064-2 2015 section 7.2.1 */
@@ -94,13 +118,15 @@ int ltntstools_demux_alloc_from_pat(void **hdl, void *userContext,
 					{
 						fprintf(stderr, MODULE_PREFIX "Unable to allocate smpte2064 PE extractor for pid 0x%04x, skipping\n", stream->elementary_PID);
 					} else {
+						ltntstools_pes_extractor_set_stats(pid->pe, ctx->libstats);
+						ltntstools_pes_extractor_set_pooled_output(pid->pe, 1);
 						assert(ctx->pidIndex[ ctx->pidIndexLength ] == NULL);
 						ctx->pidIndex[ ctx->pidIndexLength++ ] = pid;
 						demux_pid_set_estype(pid, P_SMPTE2064);
 					}
 				}
 			} else
-			if (detectedAudioDescriptor || ltntstools_pmt_entry_is_audio(stream)) {
+			if (detectedAudioDescriptor || ltntstools_psi_stream_is_audio(stream)) {
 				/* Audio Stream */
 				/* TODO: convert the type to a stream ID */
 				uint8_t streamId = 0xc0;
@@ -111,8 +137,10 @@ int ltntstools_demux_alloc_from_pat(void **hdl, void *userContext,
 				{
 					fprintf(stderr, MODULE_PREFIX "Unable to allocate audio PE extractor for pid 0x%04x, skipping\n", stream->elementary_PID);
 				} else {
-					uint16_t pcrpid = 0;
-					if (ltntstools_streammodel_query_first_program_pcr_pid(NULL, (struct ltntstools_pat_s *)ctx->pat, &pcrpid) < 0) {
+					ltntstools_pes_extractor_set_stats(pid->pe, ctx->libstats);
+					ltntstools_pes_extractor_set_pooled_output(pid->pe, 1);
+
+					if (!hasPCRPID) {
 						fprintf(stderr, "unable to query first program PCR pid, ignoring, no PCR will be available\n");
 					} else {
 						printf("setting pcrpid for AUDIO to pid 0x%04x\n", pcrpid);
@@ -133,8 +161,10 @@ int ltntstools_demux_alloc_from_pat(void **hdl, void *userContext,
 				{
 					fprintf(stderr, MODULE_PREFIX "Unable to allocate video PE extractor for pid 0x%04x, skipping\n", stream->elementary_PID);
 				} else {
-					uint16_t pcrpid = 0;
-					if (ltntstools_streammodel_query_first_program_pcr_pid(NULL, (struct ltntstools_pat_s *)ctx->pat, &pcrpid) < 0) {
+					ltntstools_pes_extractor_set_stats(pid->pe, ctx->libstats);
+					ltntstools_pes_extractor_set_pooled_output(pid->pe, 1);
+
+					if (!hasPCRPID) {
 						fprintf(stderr, "unable to query first program PCR pid, ignoring, no PCR will be available\n");
 					} else {
 						ltntstools_pes_extractor_set_pcr_pid(pid->pe, pcrpid);
@@ -151,6 +181,50 @@ int ltntstools_demux_alloc_from_pat(void **hdl, void *userContext,
 	return 0; /* Success */
 }
 
+/* Deliver a contiguous run of same-pid packets to the pid owner, if any. */
+static void _demux_write_run(struct demux_ctx_s *ctx, uint16_t pidNr, const uint8_t *pkts, uint32_t packetCount)
+{
+	struct demux_pid_s *pid = _getPIDContext(ctx, pidNr);
+	if (pid->pe) {
+		ltntstools_pes_extractor_write(pid->pe, pkts, packetCount);
+	}
+	/* TODO: section extractors */
+}
+
+/* Single pass over the buffer, dispatch each packet only to the subsystem
+ * that owns its pid. Adjacent packets on the same pid are coalesced into
+ * a single write, so the cost per packet no longer grows with the number
+ * of elementary streams being extracted.
+ */
+static void _demux_dispatch(struct demux_ctx_s *ctx, const uint8_t *pkts, uint32_t packetCount)
+{
+	const uint8_t *run = pkts;
+	uint32_t runLength = 0;
+	uint16_t runPidNr = 0;
+
+	for (uint32_t i = 0; i < packetCount; i++) {
+		const uint8_t *pkt = pkts + (i * 188);
+		uint16_t pidNr = ltntstools_pid(pkt);
+
+		if (runLength && pidNr == runPidNr) {
+			runLength++;
+			continue;
+		}
+
+		if (runLength) {
+			_demux_write_run(ctx, runPidNr, run, runLength);
+		}
+
+		run = pkt;
+		runPidNr = pidNr;
+		runLength = 1;
+	}
+
+	if (runLength) {
+		_demux_write_run(ctx, runPidNr, run, runLength);
+	}
+}
+
 ssize_t ltntstools_demux_write(void *hdl, const uint8_t *pkts, uint32_t packetCount)
 {
 	struct demux_ctx_s *ctx = (struct demux_ctx_s *)hdl;
@@ -158,15 +232,21 @@ ssize_t ltntstools_demux_write(void *hdl, const uint8_t *pkts, uint32_t packetCo
 		return -1;
 	}
 
-	/* Enumerate each pid context we're tracking,
-	 * use efficient index, feed all packets to each subsystem.
+	/* One clock read for the entire buffer, regardless of how many runs it splits into. */
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	/* Every packet goes through the shared stats, extractors depend on it for their STC.
+	 * Update in datagram sized groups ahead of the runs they contain, so the STC stays close
+	 * to the packets being dispatched and only a genuinely short buffer counts as
+	 * a notMultipleOfSevenError.
 	 */
-	for (int i = 0; i < ctx->pidIndexLength; i++) {
-		struct demux_pid_s *pid = _getPIDContext(ctx, ctx->pidIndex[i]->pidNr);
-		if (pid->pe) {
-			ltntstools_pes_extractor_write(pid->pe, pkts, packetCount);
-		}
-		/* TODO: section extractors */
+	for (uint32_t i = 0; i < packetCount; i += 7) {
+		uint32_t count = packetCount - i < 7 ? packetCount - i : 7;
+		const uint8_t *group = pkts + (i * 188);
+
+		ltntstools_pid_stats_update_with_timestamp(ctx->libstats, group, count, &now);
+		_demux_dispatch(ctx, group, count);
 	}
 
 	return packetCount;
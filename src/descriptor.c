@@ -186,109 +186,171 @@ int ltntstools_descriptor_list_add(struct ltntstools_descriptor_list_s *list,
 	return 0;
 }
 
-int ltntstools_descriptor_list_contains_smpte2064_registration(struct ltntstools_descriptor_list_s *list)
+/* Per descriptor tests, shared by the list and the compact loop representations.
+ * Given the tag, length and payload only, the tests never read beyond data[len - 1].
+ */
+static int _is_smpte2064_registration(uint8_t tag, uint8_t len, const uint8_t *data)
 {
-	int found = 0;
+	return tag == 0x05 && len == 0x04 &&
+		data[0] == 'L' && data[1] == 'I' && data[2] == 'P' && data[3] == 'S';
+}
 
-	for (int i = 0; i < list->count; i++) {
-		struct ltntstools_descriptor_entry_s *d = &list->array[i];
+static int _is_scte35_cue_registration(uint8_t tag, uint8_t len, const uint8_t *data)
+{
+	return tag == 0x05 && len == 0x04 &&
+		data[0] == 'C' && data[1] == 'U' && data[2] == 'E' && data[3] == 'I';
+}
+
+static int _is_video_av1_registration(uint8_t tag, uint8_t len, const uint8_t *data)
+{
+	return tag == 0x05 && len >= 0x04 &&
+		data[0] == 'A' && data[1] == 'V' && data[2] == '0' && data[3] == '1';
+}
+
+static int _is_teletext(uint8_t tag, uint8_t len, const uint8_t *data)
+{
+	/* EN300468 - teletext_descriptor */
+	return tag == 0x56 && len == 0x05;
+}
 
-		if (d->tag == 0x05 && d->len == 0x04) {
-			if (d->data[0] == 'L' && d->data[1] == 'I' && d->data[2] == 'P' && d->data[3] == 'S') {
-				found = 1;
-				break;
-			}
+static int _is_smpte2038_registration(uint8_t tag, uint8_t len, const uint8_t *data)
+{
+	if (tag == 0xc4 && len == 0x09) {
+		char *s = "SMPTE2038"; /* LTN Encoder */
+		if (memcmp(data, s, strlen(s)) == 0) {
+			return 1;
 		}
+	} else 
+	if (tag == 0x05 && len == 0x04) {
+		char *t = "VANC"; /* SMPTE2038:2008 specification */
+		if (memcmp(data, t, strlen(t)) == 0) {
+			return 1;
+		}
+	} else 
+	if (tag == 0xc4 && len == 0) {
+		/* "This structure may be used to convey additional information about the ANC data component.
+		 *  The use is optional and currently undefined. Compliant receive devices shall ignore
+		 *  unrecognized descriptors."
+		 */
+		return 1;
 	}
 
-	return found;
+	return 0;
 }
 
-int ltntstools_descriptor_list_contains_scte35_cue_registration(struct ltntstools_descriptor_list_s *list)
-{
-	int found = 0;
+typedef int (*descriptor_match_fn)(uint8_t tag, uint8_t len, const uint8_t *data);
 
+static int _list_contains(struct ltntstools_descriptor_list_s *list, descriptor_match_fn match)
+{
 	for (int i = 0; i < list->count; i++) {
-		struct ltntstools_descriptor_entry_s *d = &list->array[i];
-
-		if (d->tag == 0x05 && d->len == 0x04) {
-			if (d->data[0] == 'C' && d->data[1] == 'U' && d->data[2] == 'E' && d->data[3] == 'I') {
-				found = 1;
-				break;
-			}
+		const struct ltntstools_descriptor_entry_s *d = &list->array[i];
+		if (match(d->tag, d->len, d->data)) {
+			return 1;
 		}
 	}
 
-	return found;
+	return 0;
 }
 
-int ltntstools_descriptor_list_contains_video_av1_registration(struct ltntstools_descriptor_list_s *list)
+static int _loop_contains(const struct ltntstools_descriptor_loop_s *loop, descriptor_match_fn match)
 {
-	int found = 0;
+	int offset = 0;
+	uint8_t tag, len;
+	const uint8_t *data;
 
-	for (int i = 0; i < list->count; i++) {
-		struct ltntstools_descriptor_entry_s *d = &list->array[i];
-
-		if (d->tag == 0x05 && d->len >= 0x04) {
-			if (d->data[0] == 'A' && d->data[1] == 'V' && d->data[2] == '0' && d->data[3] == '1') {
-				found = 1;
-				break;
-			}
+	while (ltntstools_descriptor_loop_next(loop, &offset, &tag, &len, &data) == 0) {
+		if (match(tag, len, data)) {
+			return 1;
 		}
 	}
 
-	return found;
+	return 0;
 }
 
-int ltntstools_descriptor_list_contains_teletext(struct ltntstools_descriptor_list_s *list)
+int ltntstools_descriptor_list_contains_smpte2064_registration(struct ltntstools_descriptor_list_s *list)
 {
-	int found = 0;
+	return _list_contains(list, _is_smpte2064_registration);
+}
 
-	for (int i = 0; i < list->count; i++) {
-		struct ltntstools_descriptor_entry_s *d = &list->array[i];
+int ltntstools_descriptor_list_contains_scte35_cue_registration(struct ltntstools_descriptor_list_s *list)
+{
+	return _list_contains(list, _is_scte35_cue_registration);
+}
 
-		/* EN300468 - teletext_descriptor */
-		if (d->tag == 0x56 && d->len == 0x05) {
-			found = 1;
-			break;
-		}
-	}
+int ltntstools_descriptor_list_contains_video_av1_registration(struct ltntstools_descriptor_list_s *list)
+{
+	return _list_contains(list, _is_video_av1_registration);
+}
 
-	return found;
+int ltntstools_descriptor_list_contains_teletext(struct ltntstools_descriptor_list_s *list)
+{
+	return _list_contains(list, _is_teletext);
 }
 
 int ltntstools_descriptor_list_contains_smpte2038_registration(struct ltntstools_descriptor_list_s *list)
 {
-	int found = 0;
+	return _list_contains(list, _is_smpte2038_registration);
+}
 
-	for (int i = 0; i < list->count; i++) {
-		struct ltntstools_descriptor_entry_s *d = &list->array[i];
+int ltntstools_descriptor_loop_next(const struct ltntstools_descriptor_loop_s *loop, int *offset,
+	uint8_t *tag, uint8_t *len, const uint8_t **data)
+{
+	if (!loop || !offset || *offset < 0 || *offset + 2 > loop->lengthBytes)
+		return -1;
 
-		if (d->tag == 0xc4 && d->len == 0x09) {
-			char *s = "SMPTE2038"; /* LTN Encoder */
-			if (memcmp(d->data, s, strlen(s)) == 0) {
-				found = 1;
-				break;
-			}
-		} else 
-		if (d->tag == 0x05 && d->len == 0x04) {
-			char *t = "VANC"; /* SMPTE2038:2008 specification */
-			if (memcmp(d->data, t, strlen(t)) == 0) {
-				found = 1;
-				break;
-			}
-		} else 
-		if (d->tag == 0xc4 && d->len == 0) {
-			/* "This structure may be used to convey additional information about the ANC data component.
-			 *  The use is optional and currently undefined. Compliant receive devices shall ignore
-			 *  unrecognized descriptors."
-			 */
-			found = 1;
-			break;
-		}
+	const uint8_t *p = loop->data + *offset;
+	if (*offset + 2 + p[1] > loop->lengthBytes)
+		return -1; /* Truncated */
+
+	*tag = p[0];
+	*len = p[1];
+	*data = p + 2;
+	*offset += 2 + p[1];
+
+	return 0;
+}
+
+int ltntstools_descriptor_loop_to_list(const struct ltntstools_descriptor_loop_s *loop, struct ltntstools_descriptor_list_s *list)
+{
+	if (!loop || !list)
+		return -1;
+
+	list->count = 0;
+
+	int offset = 0;
+	uint8_t tag, len;
+	const uint8_t *data;
+	while (ltntstools_descriptor_loop_next(loop, &offset, &tag, &len, &data) == 0) {
+		if (ltntstools_descriptor_list_add(list, tag, (uint8_t *)data, len) < 0)
+			return -1;
 	}
 
-	return found;
+	return 0;
+}
+
+int ltntstools_descriptor_loop_contains_smpte2064_registration(const struct ltntstools_descriptor_loop_s *loop)
+{
+	return _loop_contains(loop, _is_smpte2064_registration);
+}
+
+int ltntstools_descriptor_loop_contains_scte35_cue_registration(const struct ltntstools_descriptor_loop_s *loop)
+{
+	return _loop_contains(loop, _is_scte35_cue_registration);
+}
+
+int ltntstools_descriptor_loop_contains_video_av1_registration(const struct ltntstools_descriptor_loop_s *loop)
+{
+	return _loop_contains(loop, _is_video_av1_registration);
+}
+
+int ltntstools_descriptor_loop_contains_teletext(const struct ltntstools_descriptor_loop_s *loop)
+{
+	return _loop_contains(loop, _is_teletext);
+}
+
+int ltntstools_descriptor_loop_contains_smpte2038_registration(const struct ltntstools_descriptor_loop_s *loop)
+{
+	return _loop_contains(loop, _is_smpte2038_registration);
 }
 
 int ltntstools_descriptor_list_contains_ltn_encoder_sw_version(struct ltntstools_descriptor_list_s *list,
@@ -0,0 +1,61 @@
+#ifndef LIBLTNTSTOOLS_BYTESCAN_H
+#define LIBLTNTSTOOLS_BYTESCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file        bytescan.h
+ * @author      Steven Toth <steven.toth@ltnglobal.com>
+ * @copyright   Copyright (c) 2026 LTN Global,Inc. All Rights Reserved.
+ * @brief       Byte pattern searches shared by the NAL parsers and SEI timestamp discovery.
+ *              On x86 the AVX2 or SSE2 kernel is selected at runtime, with a portable
+ *              scalar fallback.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief       Find the first 00 00 01 start code at or after offset from, which is followed
+ *              by at least one more byte (the NAL header).
+ * @param[in]   const uint8_t *buf - Buffer to search
+ * @param[in]   int lengthBytes - Buffer length in bytes
+ * @param[in]   int from - Offset to begin searching from
+ * @return      Offset of the start code, else -1 if not found.
+ */
+int ltntstools_bytescan_start_code(const uint8_t *buf, int lengthBytes, int from);
+
+/**
+ * @brief       Portable reference implementation of ltntstools_bytescan_start_code(), never vectorized.
+ *              Identical results, useful for verification.
+ */
+int ltntstools_bytescan_start_code_scalar(const uint8_t *buf, int lengthBytes, int from);
+
+/**
+ * @brief       memmem() equivalent, find the first occurrence of needle in haystack.
+ * @param[in]   const uint8_t *haystack - Buffer to search
+ * @param[in]   size_t n - Haystack length in bytes
+ * @param[in]   const uint8_t *needle - Pattern to find
+ * @param[in]   size_t m - Needle length in bytes
+ * @return      Pointer to the first match inside haystack, else NULL.
+ */
+const uint8_t *ltntstools_bytescan_memmem(const uint8_t *haystack, size_t n, const uint8_t *needle, size_t m);
+
+/**
+ * @brief       Portable reference implementation of ltntstools_bytescan_memmem(), never vectorized.
+ *              Identical results, useful for verification.
+ */
+const uint8_t *ltntstools_bytescan_memmem_scalar(const uint8_t *haystack, size_t n, const uint8_t *needle, size_t m);
+
+/**
+ * @brief       Name of the kernels the bytescan functions dispatch to on this cpu, "avx2", "sse2" or "scalar".
+ */
+const char *ltntstools_bytescan_kernel_name(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* LIBLTNTSTOOLS_BYTESCAN_H */
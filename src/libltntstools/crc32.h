@@ -36,6 +36,22 @@ int ltntstools_checkCRC32(const uint8_t *buf, int lengthBytes);
  */
 int ltntstools_getCRC32(const uint8_t *buf, int lengthBytes, uint32_t *crc32);
 
+/**
+ * @brief       Byte at a time implementation of ltntstools_getCRC32(), the reference the faster
+ *              kernels are validated against. Slow, don't use it for stream processing.
+ * @param[in]   const uint8_t *buf - buffer
+ * @param[in]   int lengthBytes - length in bytes
+ * @param[out]  int32_t *crc32 - crc value
+ * @return      0 on success else < 0
+ */
+int ltntstools_getCRC32_reference(const uint8_t *buf, int lengthBytes, uint32_t *crc32);
+
+/**
+ * @brief       Name of the CRC kernel selected for this CPU: "pclmul", "slice8" or "bytewise".
+ * @return      static string
+ */
+const char *ltntstools_crc32_kernel_name(void);
+
 #ifdef __cplusplus
 };
 #endif
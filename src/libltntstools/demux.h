@@ -55,6 +55,17 @@ struct ltntstools_demux_callbacks
 int ltntstools_demux_alloc_from_pat(void **hdl, void *userContext,
     const struct ltntstools_demux_callbacks *callbacks, const struct ltntstools_pat_s *pat);
 
+/**
+ * @brief         As ltntstools_demux_alloc_from_pat(), describing the stream with a compact model.
+ *                Obtain the model from ltntstools_streammodel_query_psi_model().
+ *                This framework takes its own reference on the model, nothing is copied. Release yours whenever you like.
+ * @param[out]    void **hdl - Unique API context handle
+ * @return        0 - Success
+ * @return      < 0 - Error
+ */
+int ltntstools_demux_alloc_from_psi_model(void **hdl, void *userContext,
+    const struct ltntstools_demux_callbacks *callbacks, const struct ltntstools_psi_model_s *model);
+
 /**
  * @brief         Free and tear down any resources allocated from this handle.
  * @param[in]     void *hdl - Previously allocate context handle.
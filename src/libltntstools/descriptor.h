@@ -28,6 +28,17 @@ struct ltntstools_descriptor_list_s
 	struct ltntstools_descriptor_entry_s array[LTNTSTOOLS_DESCRIPTOR_ENTRIES_MAX];
 };
 
+/**
+ * @brief A compact, read only descriptor loop. Descriptors are packed back to back exactly as they
+ * appear in a PSI section, tag, length, then length bytes of payload. See psimodel.h
+ */
+struct ltntstools_descriptor_loop_s
+{
+	uint32_t count;                /**< Number of descriptors in the loop */
+	uint32_t lengthBytes;          /**< Size of the loop in bytes */
+	const uint8_t *data;
+};
+
 /**
  * @brief       Convert an ISO/IEC 13818-1 descriptor tag to a human readable string.
  * @param[in]   tag - descriptor_tag value.
@@ -46,6 +57,32 @@ int ltntstools_descriptor_list_contains_teletext(struct ltntstools_descriptor_li
 int ltntstools_descriptor_list_contains_smpte2064_registration(struct ltntstools_descriptor_list_s *list);
 int ltntstools_descriptor_list_contains_video_av1_registration(struct ltntstools_descriptor_list_s *list);
 
+/**
+ * @brief       Walk a compact descriptor loop.
+ * @param[in]   const struct ltntstools_descriptor_loop_s *loop - loop
+ * @param[in]   int *offset - Pass 0 value int on first call then don't modify afterwards
+ * @param[out]  uint8_t *tag - descriptor_tag
+ * @param[out]  uint8_t *len - descriptor_length
+ * @param[out]  const uint8_t **data - descriptor payload, len bytes
+ * @return      0 - Success, < 0 at the end of the loop.
+ */
+int ltntstools_descriptor_loop_next(const struct ltntstools_descriptor_loop_s *loop, int *offset,
+	uint8_t *tag, uint8_t *len, const uint8_t **data);
+
+/**
+ * @brief       Expand a compact descriptor loop into a fixed size descriptor list.
+ * @param[in]   const struct ltntstools_descriptor_loop_s *loop - loop
+ * @param[out]  struct ltntstools_descriptor_list_s *list - list
+ * @return      0 - Success, < 0 if the list overflowed, the list holds the first LTNTSTOOLS_DESCRIPTOR_ENTRIES_MAX.
+ */
+int ltntstools_descriptor_loop_to_list(const struct ltntstools_descriptor_loop_s *loop, struct ltntstools_descriptor_list_s *list);
+
+int ltntstools_descriptor_loop_contains_scte35_cue_registration(const struct ltntstools_descriptor_loop_s *loop);
+int ltntstools_descriptor_loop_contains_smpte2038_registration(const struct ltntstools_descriptor_loop_s *loop);
+int ltntstools_descriptor_loop_contains_teletext(const struct ltntstools_descriptor_loop_s *loop);
+int ltntstools_descriptor_loop_contains_smpte2064_registration(const struct ltntstools_descriptor_loop_s *loop);
+int ltntstools_descriptor_loop_contains_video_av1_registration(const struct ltntstools_descriptor_loop_s *loop);
+
 #ifdef __cplusplus
 };
 #endif
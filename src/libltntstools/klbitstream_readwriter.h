@@ -371,11 +371,13 @@ static uint64_t klbs_read_byte_aligned(struct klbs_context_s *ctx)
 }
 
 /**
- * @brief       Read between 1..64 bits from the bitstream.
+ * @brief       Read between 1..64 bits from the bitstream, one bit at a time.
+ *              Reference implementation, klbs_read_bits() defers to this near the end of the buffer
+ *              so both share identical overrun behaviour.
  * @param[in]   struct klbs_context_s *ctx  bitstream context
  * @return      uint64_t  bits
  */
-static inline uint64_t klbs_read_bits(struct klbs_context_s *ctx, uint32_t bitcount)
+static inline uint64_t klbs_read_bits_bitwise(struct klbs_context_s *ctx, uint32_t bitcount)
 {
 	uint64_t bits = 0;
 
@@ -412,6 +414,103 @@ static inline uint64_t klbs_read_bits(struct klbs_context_s *ctx, uint32_t bitco
 	return bits;
 }
 
+/**
+ * @brief       Load up to 8 bytes big endian, zero filling anything beyond avail.
+ */
+static inline uint64_t klbs_load_be64(const uint8_t *p, uint32_t avail)
+{
+	uint64_t v = 0;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	if (avail >= 8) {
+		memcpy(&v, p, sizeof(v));
+		return __builtin_bswap64(v);
+	}
+#endif
+	for (uint32_t i = 0; i < 8; i++) {
+		v <<= 8;
+		if (i < avail)
+			v |= p[i];
+	}
+	return v;
+}
+
+/**
+ * @brief       Read between 1..64 bits from the bitstream.
+ *              The bits are extracted from a single 64bit big endian load with shifts and masks, and the
+ *              byte shift register state is then rewound to match, so direct users of buflen_used and
+ *              reg_used (and mixed use with klbs_read_bit()) see exactly what the bitwise reader would produce.
+ *              Reads that would touch the final byte of the buffer take the bitwise path, preserving the
+ *              existing overrun semantics.
+ * @param[in]   struct klbs_context_s *ctx  bitstream context
+ * @return      uint64_t  bits
+ */
+static inline uint64_t klbs_read_bits(struct klbs_context_s *ctx, uint32_t bitcount)
+{
+#if KLBITSTREAM_RETURN_ON_OVERRUN
+	if (ctx->overrun)
+		return 0;
+#endif
+
+	if (bitcount == 8 && ctx->reg_used == 0)
+		return klbs_read_byte_aligned(ctx);
+
+	if (bitcount == 0 || bitcount > 64)
+		return klbs_read_bits_bitwise(ctx, bitcount);
+
+	/* Absolute bit position of the next bit to be read, and where we'll be afterwards */
+	uint64_t pos = ((uint64_t)ctx->buflen_used * 8) - ctx->reg_used;
+	uint64_t end = pos + bitcount;
+
+	/* The bitwise reader flags an overrun once it has loaded the final byte, leave those to it. */
+	if (((end + 7) / 8) >= ctx->buflen)
+		return klbs_read_bits_bitwise(ctx, bitcount);
+
+	uint32_t byte = pos / 8;
+	uint32_t shift = pos & 7;
+	uint64_t w = klbs_load_be64(ctx->buf + byte, ctx->buflen - byte) << shift;
+	uint64_t bits = w >> (64 - bitcount);
+	if (shift + bitcount > 64) {
+		/* 64 bit unaligned reads span a ninth byte */
+		uint32_t extra = shift + bitcount - 64;
+		bits |= ctx->buf[byte + 8] >> (8 - extra);
+	}
+
+	/* Rewind the 8 bit shift register to the state the bitwise reader would have left. */
+	if (end & 7) {
+		ctx->buflen_used = (end / 8) + 1;
+		ctx->reg_used = 8 - (end & 7);
+		ctx->reg = ctx->buf[end / 8] << (end & 7);
+	} else {
+		ctx->buflen_used = end / 8;
+		ctx->reg_used = 0;
+		ctx->reg = 0;
+	}
+
+	return bits;
+}
+
+/**
+ * @brief       Read lengthBytes bytes from the bitstream into dst. When the stream is byte aligned
+ *              this is a single memcpy, otherwise each byte is read via klbs_read_bits().
+ *              Aligned reads that fit in the remaining buffer, including one ending exactly at the
+ *              end of it, are copied. Longer reads take the bitwise path and its overrun semantics.
+ * @param[in]   struct klbs_context_s *ctx  bitstream context
+ * @param[out]  uint8_t *dst  destination
+ * @param[in]   uint32_t lengthBytes  number of bytes to read
+ */
+static inline void klbs_read_bytes(struct klbs_context_s *ctx, uint8_t *dst, uint32_t lengthBytes)
+{
+	if (ctx->reg_used == 0 && ctx->buflen_used <= ctx->buflen && lengthBytes <= klbs_get_byte_count_free(ctx)) {
+		memcpy(dst, ctx->buf + ctx->buflen_used, lengthBytes);
+		ctx->buflen_used += lengthBytes;
+		return;
+	}
+
+	for (uint32_t i = 0; i < lengthBytes; i++) {
+		dst[i] = klbs_read_bits(ctx, 8);
+	}
+}
+
 /**
  * @brief       Peek between 1..64 bits from the bitstream.
  *              Each call to peek copies the context, advances it, without changing the
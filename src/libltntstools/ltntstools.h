@@ -22,9 +22,13 @@
  */
 
 #include <libltntstools/ts.h>
+#include <libltntstools/ts-header-scan.h>
+#include <libltntstools/bytescan.h>
+#include <libltntstools/ts-file-reader.h>
 #include <libltntstools/ts_packetizer.h>
 #include <libltntstools/timeval.h>
 #include <libltntstools/udp_receiver.h>
+#include <libltntstools/packet_receiver.h>
 #include <libltntstools/stats.h>
 #include <libltntstools/pes.h>
 #include <libltntstools/histogram.h>
@@ -34,8 +38,10 @@
 #include <libltntstools/throughput_hires.h>
 #include <libltntstools/time.h>
 #include <libltntstools/segmentwriter.h>
+#include <libltntstools/segmentindex.h>
 #include <libltntstools/tr101290.h>
 #include <libltntstools/pat.h>
+#include <libltntstools/psimodel.h>
 #include <libltntstools/streammodel.h>
 #include <libltntstools/kl-queue.h>
 #include <libltntstools/descriptor.h>
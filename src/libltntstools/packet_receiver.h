@@ -0,0 +1,106 @@
+#ifndef LIBLTNTSTOOLS_PACKET_RECEIVER_H
+#define LIBLTNTSTOOLS_PACKET_RECEIVER_H
+
+#include <stdint.h>
+#include <libltntstools/udp_receiver.h>
+
+/**
+ * @file        packet_receiver.h
+ * @author      Steven Toth <steven.toth@ltnglobal.com>
+ * @copyright   Copyright (c) 2026 LTN Global,Inc. All Rights Reserved.
+ * @brief       Capture every UDP/IPv4 datagram arriving on a network interface from a single memory
+ *              mapped AF_PACKET (TPACKET_V3) ring, and demultiplex them by destination address and port
+ *              to per stream callbacks. One socket and one thread serve hundreds of streams, in place of
+ *              a ltntstools_udp_receiver_s per stream.
+ *              Payloads are delivered directly from the ring, without copying, along with the kernel
+ *              receive time. The kernel hands the ring over a block at a time, a block is released when
+ *              full or after 10ms, so a quiet stream may see up to 10ms of added delivery latency.
+ *              Linux only, requires CAP_NET_RAW. The capture sees whatever arrives on the interface,
+ *              multicast groups still need to be joined, see ltntstools_igmp_join(), or mirrored to the port.
+ *
+ * Usage:
+ *   void *hdl;
+ *   ltntstools_packet_receiver_alloc(&hdl, "eno2", 1048576, 64);
+ *   ltntstools_packet_receiver_add_stream(hdl, "227.1.1.1", 4001, cb, userContext, 0);
+ *   ltntstools_packet_receiver_add_stream(hdl, "227.1.1.2", 4001, cb, userContext, 0);
+ *   ltntstools_packet_receiver_thread_start(hdl);
+ *   ...
+ *   ltntstools_packet_receiver_free(hdl);
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief       Capture counters, see ltntstools_packet_receiver_get_stats().
+ */
+struct ltntstools_packet_receiver_stats_s
+{
+	uint64_t packets;      /**< Datagrams delivered to a stream callback */
+	uint64_t bytes;        /**< Payload bytes delivered to stream callbacks */
+	uint64_t unmatched;    /**< UDP datagrams for which no stream was registered */
+	uint64_t kernelDrops;  /**< Frames the kernel dropped because the ring was full */
+	uint64_t blocks;       /**< Ring blocks processed */
+};
+
+/**
+ * @brief       Allocate a capture context and map its ring. The ring is blockSize * blockCount bytes.
+ * @param[out]  void **hdl - Handle / context.
+ * @param[in]   const char *ifname - Network interface, eg. eno2 or lo
+ * @param[in]   unsigned int blockSize - Ring block size in bytes, a power of two multiple of the page size. Eg. 1048576
+ * @param[in]   unsigned int blockCount - Number of ring blocks. Eg. 64
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_packet_receiver_alloc(void **hdl, const char *ifname, unsigned int blockSize, unsigned int blockCount);
+
+/**
+ * @brief       Stop the capture thread, unmap the ring and free all streams.
+ * @param[in]   void *hdl - Handle / context.
+ */
+void ltntstools_packet_receiver_free(void *hdl);
+
+/**
+ * @brief       Deliver datagrams sent to ip_addr:ip_port to cb. May be called before or after the thread has started,
+ *              but not from within a stream callback.
+ *              The callback runs on the capture thread, buf points into the ring and is only valid during the callback.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   const char *ip_addr - Destination address, eg. 227.1.1.1
+ * @param[in]   unsigned short ip_port - Destination port
+ * @param[in]   tsudp_receiver_timestamp_callback cb - Per datagram callback, with the kernel receive time.
+ * @param[in]   void *userContext - Passed to cb
+ * @param[in]   int stripRTPHeader - Remove the 12 byte RTP header and any trailing padding, as the udp receiver does.
+ * @return      0 on success, else < 0. Adding an address and port twice is an error.
+ */
+int  ltntstools_packet_receiver_add_stream(void *hdl, const char *ip_addr, unsigned short ip_port,
+	tsudp_receiver_timestamp_callback cb, void *userContext, int stripRTPHeader);
+
+/**
+ * @brief       Stop delivering datagrams for ip_addr:ip_port. Not to be called from within a stream callback.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   const char *ip_addr - Destination address
+ * @param[in]   unsigned short ip_port - Destination port
+ * @return      0 on success, else < 0 if the stream was not found.
+ */
+int  ltntstools_packet_receiver_remove_stream(void *hdl, const char *ip_addr, unsigned short ip_port);
+
+/**
+ * @brief       Start the capture thread.
+ * @param[in]   void *hdl - Handle / context.
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_packet_receiver_thread_start(void *hdl);
+
+/**
+ * @brief       Query the capture counters, including the kernel drop count.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[out]  struct ltntstools_packet_receiver_stats_s *stats - Counters since allocation.
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_packet_receiver_get_stats(void *hdl, struct ltntstools_packet_receiver_stats_s *stats);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* LIBLTNTSTOOLS_PACKET_RECEIVER_H */
@@ -85,6 +85,20 @@ ssize_t ltntstools_pes_extractor_write(void *hdl, const uint8_t *pkts, int packe
  */
 int ltntstools_pes_extractor_set_skip_data(void *hdl, int tf);
 
+/**
+ * @brief       Deliver PES packets from a per extractor pool instead of the heap. Packet objects and
+ *              their raw buffers are recycled, and pes->data points into pes->rawBuffer rather than
+ *              being a second copy. Callers continue to release packets with ltn_pes_packet_free(),
+ *              but must not free or take ownership of pes->data directly. Use ltn_pes_packet_copy()
+ *              to retain an independent copy.
+ *              Packets may outlive the extractor, the pool is released once the last one is freed.
+ *              Enable before the first write. Once enabled it can't be disabled.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   int tf - Boolean. 1) pooled 0) heap (default)
+ * @return      0 on success, else < 0.
+ */
+int ltntstools_pes_extractor_set_pooled_output(void *hdl, int tf);
+
 /**
  * @brief       Ensure that the PES callbacks are always delivered ascending time order.
  *              The framework will cache a number of PES frames, then feed the callback the oldest
@@ -103,6 +117,21 @@ int ltntstools_pes_extractor_set_ordered_output(void *hdl, int tf);
 
 int ltntstools_pes_extractor_set_pcr_pid(void *hdl, uint16_t pcrpidnr);
 
+/**
+ * @brief       Take the PCR based STC from an externally owned statistics context, instead of
+ *              tracking the PCR pid internally. The owner is responsible for feeding EVERY packet in
+ *              the mux into the stats context, via ltntstools_pid_stats_update(), before the same
+ *              packets are written to this extractor. The extractor then only needs to be handed
+ *              packets for its own pid. CC loss and PES delivery time are always tracked by the
+ *              extractor for its own pid. This is how the demux framework avoids broadcasting the
+ *              entire mux to every extractor. Call this BEFORE ltntstools_pes_extractor_set_pcr_pid()
+ *              and the first _write call. The stats context must outlive the extractor.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   struct ltntstools_stream_statistics_s *stats - Shared statistics context.
+ * @return      0 on success, else < 0.
+ */
+int ltntstools_pes_extractor_set_stats(void *hdl, struct ltntstools_stream_statistics_s *stats);
+
 #ifdef __cplusplus
 };
 #endif
@@ -18,6 +18,7 @@ extern "C" {
 #endif
 
 struct klbs_context_s;
+struct ltn_pes_packet_pool_s;
 
 /**
  * @brief Context used by a packet writer to preserve ongoing state.
@@ -82,6 +83,11 @@ struct ltn_pes_packet_s
 	/* Other metrics relevant to when or how this pes was parsed */
 	int64_t pcr;           /**< pcr clock when this first arrived (synthesized - accurate) */
 	int32_t arrivalMs;     /**< How long the entire PES took to arrive (ms) */
+
+	/* Private memory management, see ltn_pes_packet_pool_alloc(). Don't modify. */
+	struct ltn_pes_packet_pool_s *pool;  /**< Owning pool, or NULL for a regular heap packet. */
+	uint32_t rawBufferCapacityBytes;     /**< Allocated size of rawBuffer, pooled packets only. */
+	uint32_t dataIsReference;            /**< data points into rawBuffer, it is not a separate allocation. */
 };
 
 /**
@@ -97,11 +103,39 @@ struct ltn_pes_packet_s *ltn_pes_packet_alloc();
 void ltn_pes_packet_init(struct ltn_pes_packet_s *pkt);
 
 /**
- * @brief       Free a previously allocate packet, and any attached payload
+ * @brief       Free a previously allocate packet, and any attached payload.
+ *              Packets that came from a pool are returned to it.
  * @param[in]   struct ltn_pes_packet_s *pkt - object
  */
 void ltn_pes_packet_free(struct ltn_pes_packet_s *pkt);
 
+/**
+ * @brief       Allocate a pool of reusable PES packets and raw buffers. Packets taken from the pool are
+ *              returned to it by ltn_pes_packet_free(), so callers need no special handling.
+ *              Safe to return packets from any thread. The pool is destroyed once
+ *              ltn_pes_packet_pool_free() has been called and every outstanding packet has been returned.
+ * @param[in]   uint32_t maxCached - Number of idle packets retained for reuse, beyond that they're freed.
+ * @return      pool, or NULL on error.
+ */
+struct ltn_pes_packet_pool_s *ltn_pes_packet_pool_alloc(uint32_t maxCached);
+
+/**
+ * @brief       Release the callers reference to a pool. See ltn_pes_packet_pool_alloc().
+ * @param[in]   struct ltn_pes_packet_pool_s *pool - object
+ */
+void ltn_pes_packet_pool_free(struct ltn_pes_packet_pool_s *pool);
+
+/**
+ * @brief       Take an initialized packet from the pool, with rawBuffer capable of holding at least
+ *              lengthBytes. rawBufferLengthBytes is left at zero for the caller to set.
+ *              If the packet is then parsed from its own rawBuffer, data references rawBuffer instead of
+ *              being copied. Release with ltn_pes_packet_free().
+ * @param[in]   struct ltn_pes_packet_pool_s *pool - object
+ * @param[in]   uint32_t lengthBytes - Required rawBuffer capacity
+ * @return      struct ltn_pes_packet_s *pkt, or NULL on error.
+ */
+struct ltn_pes_packet_s *ltn_pes_packet_pool_get(struct ltn_pes_packet_pool_s *pool, uint32_t lengthBytes);
+
 /**
  * @brief       Parse an existing bitstream into an existing pkt, returning the number of bits parsed.
  * @param[in]   struct ltn_pes_packet_s *pkt - object
@@ -0,0 +1,291 @@
+#ifndef LIBLTNTSTOOLS_PSIMODEL_H
+#define LIBLTNTSTOOLS_PSIMODEL_H
+
+/**
+ * @file        psimodel.h
+ * @author      Steven Toth <steven.toth@ltnglobal.com>
+ * @copyright   Copyright (c) 2026 LTN Global,Inc. All Rights Reserved.
+ * @brief       A compact, immutable and reference counted description of a transport stream, its PAT,
+ *              PMTs and SDT service details. The same information as struct ltntstools_pat_s, without
+ *              the fixed size arrays. A model is a single allocation sized to its content, typically a
+ *              few hundred bytes to a few kilobytes, where struct ltntstools_pat_s is several megabytes.
+ *              Models are never modified once built, sharing one between threads or holding on to it
+ *              is a reference count bump. See ltntstools_streammodel_query_psi_model().
+ *              Descriptors are kept in their on-the-wire form, see struct ltntstools_descriptor_loop_s.
+ *
+ * Usage:
+ *   const struct ltntstools_psi_model_s *model;
+ *   const struct ltntstools_psi_program_s *program;
+ *   int e = 0;
+ *   ltntstools_streammodel_query_psi_model(smHandle, &model);
+ *   while (ltntstools_psi_model_enum_services_video(model, &e, &program) == 0) {
+ *       uint16_t pid;
+ *       uint8_t estype;
+ *       ltntstools_psi_program_query_video_pid(program, &pid, &estype);
+ *   }
+ *   ltntstools_psi_model_unref(model);
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <libltntstools/descriptor.h>
+#include <libltntstools/pat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief       PMT table entry. An ES stream type and related descriptors.
+ */
+struct ltntstools_psi_stream_s
+{
+	uint32_t stream_type;
+	uint32_t elementary_PID;
+
+	struct ltntstools_descriptor_loop_s descr;
+};
+
+/**
+ * @brief       PAT table entry, its PMT and any SDT service details.
+ */
+struct ltntstools_psi_program_s
+{
+	uint32_t program_number;
+	uint32_t program_map_PID;
+
+	/* PMT */
+	uint32_t has_pmt;              /**< Boolean, the programs PMT was collected. The NIT (program 0) has none. */
+	uint32_t version_number;
+	uint32_t current_next_indicator;
+	uint32_t PCR_PID;
+	struct ltntstools_descriptor_loop_s descr;
+
+	uint32_t stream_count;
+	const struct ltntstools_psi_stream_s *streams;
+
+	/* Service type, name and provider, if available. */
+	uint16_t service_id;
+	uint8_t  service_type;
+	uint8_t  service_name[32];
+	uint8_t  service_provider[32];
+};
+
+/**
+ * @brief       The PAT and everything it references.
+ */
+struct ltntstools_psi_model_s
+{
+	uint32_t transport_stream_id;
+	uint32_t version_number;
+	uint32_t current_next_indicator;
+	struct ltntstools_descriptor_loop_s descr;
+
+	uint32_t program_count;
+	const struct ltntstools_psi_program_s *programs;
+
+	/* Private */
+	int      refCount;
+	uint32_t sizeBytes;
+};
+
+/**
+ * @brief       Build a model from a struct ltntstools_pat_s. The model has a reference count of one.
+ * @param[in]   const struct ltntstools_pat_s *pat - object
+ * @return      New model on Success, else NULL.
+ */
+const struct ltntstools_psi_model_s *ltntstools_psi_model_alloc_from_pat(const struct ltntstools_pat_s *pat);
+
+/**
+ * @brief       Convert a model back to a newly allocated struct ltntstools_pat_s, for APIs that need one.
+ *              Programs, streams and descriptors beyond the fixed struct limits are dropped.
+ *              Free with ltntstools_pat_free().
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @return      New allocation on Success, else NULL.
+ */
+struct ltntstools_pat_s *ltntstools_psi_model_to_pat(const struct ltntstools_psi_model_s *model);
+
+/**
+ * @brief       Take an additional reference on a model. Thread safe.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @return      model
+ */
+const struct ltntstools_psi_model_s *ltntstools_psi_model_ref(const struct ltntstools_psi_model_s *model);
+
+/**
+ * @brief       Release a reference, the model is freed with its last reference. Thread safe. NULL is ignored.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ */
+void ltntstools_psi_model_unref(const struct ltntstools_psi_model_s *model);
+
+/**
+ * @brief       Query the size of the models single allocation.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @return      Size in bytes
+ */
+size_t ltntstools_psi_model_get_size(const struct ltntstools_psi_model_s *model);
+
+/**
+ * @brief       Compare two models, with the same rules as ltntstools_pat_compare(). Table versions, programs,
+ *              PCR pids and elementary streams are compared, descriptors and service details are not.
+ * @param[in]   const struct ltntstools_psi_model_s *a - object
+ * @param[in]   const struct ltntstools_psi_model_s *b - object
+ * @return      0 if identical, else < 0.
+ */
+int ltntstools_psi_model_compare(const struct ltntstools_psi_model_s *a, const struct ltntstools_psi_model_s *b);
+
+/**
+ * @brief       A single difference between two models, see ltntstools_psi_model_diff().
+ */
+enum ltntstools_psi_change_e
+{
+	LTNTSTOOLS_PSI_CHANGE_TRANSPORT_STREAM_ID = 1, /**< PAT transport_stream_id */
+	LTNTSTOOLS_PSI_CHANGE_PROGRAM_ADDED,
+	LTNTSTOOLS_PSI_CHANGE_PROGRAM_REMOVED,
+	LTNTSTOOLS_PSI_CHANGE_PROGRAM_PMT_PID,         /**< The program moved its PMT to another pid */
+	LTNTSTOOLS_PSI_CHANGE_PROGRAM_PCR_PID,
+	LTNTSTOOLS_PSI_CHANGE_PROGRAM_DESCRIPTORS,     /**< PMT outer descriptor loop */
+	LTNTSTOOLS_PSI_CHANGE_STREAM_ADDED,
+	LTNTSTOOLS_PSI_CHANGE_STREAM_REMOVED,
+	LTNTSTOOLS_PSI_CHANGE_STREAM_TYPE,
+	LTNTSTOOLS_PSI_CHANGE_STREAM_DESCRIPTORS,      /**< ES descriptor loop */
+};
+
+struct ltntstools_psi_change_s
+{
+	enum ltntstools_psi_change_e type;
+	uint32_t program_number;
+	uint32_t pid;                                     /**< PMT pid for program changes, else the elementary pid */
+	const struct ltntstools_psi_program_s *programOld; /**< NULL when the program was added */
+	const struct ltntstools_psi_program_s *programNew; /**< NULL when the program was removed */
+	const struct ltntstools_psi_stream_s  *streamOld;  /**< Stream changes only, NULL when the stream was added */
+	const struct ltntstools_psi_stream_s  *streamNew;  /**< Stream changes only, NULL when the stream was removed */
+};
+
+/**
+ * @brief       Describe what changed between two models. Programs are matched on program_number,
+ *              streams on elementary_PID. Table version and current_next changes alone are not
+ *              reported, nor are service details. The change pointers refer into the models, they
+ *              are valid as long as both models are referenced. Caller is responsible for freeing the array.
+ * @param[in]   const struct ltntstools_psi_model_s *a - older model, or NULL, every program is reported added
+ * @param[in]   const struct ltntstools_psi_model_s *b - newer model
+ * @param[out]  struct ltntstools_psi_change_s **changes - array of changes, NULL when identical
+ * @param[out]  int *changeCount - number of elements in the array
+ * @return      0 - Success, else < 0.
+ */
+int ltntstools_psi_model_diff(const struct ltntstools_psi_model_s *a, const struct ltntstools_psi_model_s *b,
+	struct ltntstools_psi_change_s **changes, int *changeCount);
+
+/**
+ * @brief       Write the model to a file descriptor, in the same format as ltntstools_pat_dprintf().
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @param[in]   int fd - file descriptor
+ */
+void ltntstools_psi_model_dprintf(const struct ltntstools_psi_model_s *model, int fd);
+
+/**
+ * @brief       Enumerate all services in the model, return the program whose PMT is carried on pid.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @param[in]   int *e - used internally to enumerate objects. Pass 0 value int on first call then don't modify afterwards
+ * @param[in]   uint16_t pid - PMT pid
+ * @param[out]  const struct ltntstools_psi_program_s **program - program within the model
+ * @return      0 - Success. < 0, no more services, or error.
+ */
+int ltntstools_psi_model_enum_services(const struct ltntstools_psi_model_s *model, int *e, uint16_t pid,
+	const struct ltntstools_psi_program_s **program);
+
+/**
+ * @brief       Enumerate all services in the model, find any video programs and return the associated program.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @param[in]   int *e - used internally to enumerate objects. Pass 0 value int on first call then don't modify afterwards
+ * @param[out]  const struct ltntstools_psi_program_s **program - program within the model
+ * @return      0 - Success. < 0, no more services, or error.
+ */
+int ltntstools_psi_model_enum_services_video(const struct ltntstools_psi_model_s *model, int *e,
+	const struct ltntstools_psi_program_s **program);
+
+/**
+ * @brief       Enumerate all services in the model, find any audio programs and return the associated program
+ *              and its audio pids. Caller is responsible for freeing the arrays after use.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @param[in]   int *e - used internally to enumerate objects. Pass 0 value int on first call then don't modify afterwards
+ * @param[out]  const struct ltntstools_psi_program_s **program - program within the model
+ * @param[out]  uint32_t **stream_type_array - ptr to the stream type array
+ * @param[out]  uint16_t **pid_array - ptr to the pid array
+ * @param[out]  int *pid_count - ptr to the pid count
+ * @return      0 - Success. < 0, no more services, or error.
+ */
+int ltntstools_psi_model_enum_services_audio(const struct ltntstools_psi_model_s *model, int *e,
+	const struct ltntstools_psi_program_s **program, uint32_t **stream_type_array, uint16_t **pid_array, int *pid_count);
+
+/**
+ * @brief       Enumerate all services in the model, find any SCTE35 pids and return the associated program.
+ *              Caller is responsible for freeing the array after use.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @param[in]   int *e - used internally to enumerate objects. Pass 0 value int on first call then don't modify afterwards
+ * @param[out]  const struct ltntstools_psi_program_s **program - program within the model
+ * @param[out]  uint16_t **pid_array - list of SCTE35 pids
+ * @param[out]  int *pid_count - number of elements in the list
+ * @return      0 - Success. < 0, no more services, or error.
+ */
+int ltntstools_psi_model_enum_services_scte35(const struct ltntstools_psi_model_s *model, int *e,
+	const struct ltntstools_psi_program_s **program, uint16_t **pid_array, int *pid_count);
+
+/**
+ * @brief       Enumerate all services in the model, find any SMPTE2038 pids and return the associated program.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @param[in]   int *e - used internally to enumerate objects. Pass 0 value int on first call then don't modify afterwards
+ * @param[out]  const struct ltntstools_psi_program_s **program - program within the model
+ * @param[out]  uint16_t *pid - SMPTE2038 pid
+ * @return      0 - Success. < 0, no more services, or error.
+ */
+int ltntstools_psi_model_enum_services_smpte2038(const struct ltntstools_psi_model_s *model, int *e,
+	const struct ltntstools_psi_program_s **program, uint16_t *pid);
+
+/**
+ * @brief       Enumerate all services in the model, find any Teletext/OP47/WST pids and return the associated program.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @param[in]   int *e - used internally to enumerate objects. Pass 0 value int on first call then don't modify afterwards
+ * @param[out]  const struct ltntstools_psi_program_s **program - program within the model
+ * @return      0 - Success. < 0, no more services, or error.
+ */
+int ltntstools_psi_model_enum_services_teletext(const struct ltntstools_psi_model_s *model, int *e,
+	const struct ltntstools_psi_program_s **program);
+
+/**
+ * @brief       Find the first video stream in a program.
+ * @param[in]   const struct ltntstools_psi_program_s *program - program
+ * @param[out]  uint16_t *pid - elementary pid
+ * @param[out]  uint8_t *estype - stream type
+ * @return      0 - Success, else < 0 if the program has no video.
+ */
+int ltntstools_psi_program_query_video_pid(const struct ltntstools_psi_program_s *program, uint16_t *pid, uint8_t *estype);
+
+/**
+ * @brief       Look at the stream type AND descriptors to determine if this is an audio stream.
+ *              Same rules as ltntstools_pmt_entry_is_audio().
+ * @param[in]   const struct ltntstools_psi_stream_s *stream - stream
+ * @return      0 if not audio, 1 if the stream_type indicates the codec, else the matching descriptor tag.
+ */
+int ltntstools_psi_stream_is_audio(const struct ltntstools_psi_stream_s *stream);
+
+/**
+ * @brief       Determine if the model describes more than one service.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @return      Boolean.
+ */
+int ltntstools_psi_model_is_mpts(const struct ltntstools_psi_model_s *model);
+
+/**
+ * @brief       Find the PCR pid of the first program that carries streams.
+ * @param[in]   const struct ltntstools_psi_model_s *model - object
+ * @param[out]  uint16_t *PCRPID - pid
+ * @return      0 - Success, else < 0.
+ */
+int ltntstools_psi_model_query_first_program_pcr_pid(const struct ltntstools_psi_model_s *model, uint16_t *PCRPID);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* LIBLTNTSTOOLS_PSIMODEL_H */
@@ -84,6 +84,16 @@ void rtp_analyzer_reset(struct rtp_hdr_analyzer_s *ctx);
  */
 int rtp_hdr_write(struct rtp_hdr_analyzer_s *ctx, const struct rtp_hdr *hdr);
 
+/**
+ * @brief       As rtp_hdr_write(), with a caller supplied arrival time, such as a kernel receive
+ *              timestamp from ltntstools_udp_receiver_enable_kernel_timestamps().
+ * @param[in]   struct rtp_hdr_analyzer_s *ctx - A previously allocated context, see rtp_analyzer_init().
+ * @param[in]   const struct rtp_hdr *hdr - Header
+ * @param[in]   const struct timeval *ts - Arrival time of the packet
+ * @return      0 on success else < 0 if error
+ */
+int rtp_hdr_write_with_timestamp(struct rtp_hdr_analyzer_s *ctx, const struct rtp_hdr *hdr, const struct timeval *ts);
+
 int rtp_hdr_is_payload_type_valid(const struct rtp_hdr *hdr);
 int rtp_hdr_is_continious(struct rtp_hdr_analyzer_s *ctx, const struct rtp_hdr *hdr);
 void rtp_analyzer_report_dprintf(struct rtp_hdr_analyzer_s *ctx, int fd);
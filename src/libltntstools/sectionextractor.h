@@ -12,6 +12,7 @@
 
 #include <time.h>
 #include <inttypes.h>
+#include <sys/types.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -55,6 +56,102 @@ void ltntstools_sectionextractor_free(void *hdl);
  */
 int ltntstools_sectionextractor_query(void *hdl, uint8_t *dst, int lengthBytes);
 
+/**
+ * Section reassembly.
+ *
+ * A general purpose, per pid, section reassembler. Sections may span any number of packets, and any number
+ * of sections may be packed into a packet behind the pointer_field. Continuity counter errors, transport
+ * errors and scrambled packets abandon the section in progress. Every complete section is handed to the
+ * callback, with its CRC status.
+ * A small cache of recently validated sections, keyed by length and CRC_32 field, is kept per pid. Repeats
+ * of a cached section (the common case for PSI/SI tables) are confirmed byte identical with a compare,
+ * and the CRC isn't recomputed.
+ * An optional filter sees each section header before the rest of the section arrives, sections it declines
+ * are not copied or CRC checked, the callback receives only their header and CRC_32 field.
+ *
+ * Usage:
+ *   void *hdl;
+ *   ltntstools_sectionreassembler_alloc(&hdl, my_callback, userContext);
+ *   ltntstools_sectionreassembler_add_pid(hdl, 0x11);
+ *   ltntstools_sectionreassembler_write(hdl, pkts, 7);
+ *   ltntstools_sectionreassembler_free(hdl);
+ */
+
+/* Sections are limited to 4096 bytes, ISO13818-1 2.4.4.10 and EN300468 5.1.1 */
+#define LTNTSTOOLS_SECTION_MAX_BYTES 4096
+
+struct ltntstools_section_s
+{
+	uint16_t pid;
+	uint8_t  tableId;
+	uint16_t lengthBytes;       /**< Entire section, table_id through CRC_32 */
+	const uint8_t *header;      /**< First 8 bytes (or lengthBytes, if less), always present */
+	const uint8_t *data;        /**< The entire section, or NULL when the filter declined it */
+	uint32_t crc;               /**< Trailing CRC_32 field as transmitted, 0 during filtering */
+	int      crcValid;          /**< Boolean, sections with data only */
+	int      cached;            /**< Boolean, byte identical to a recently validated section, the CRC wasn't recomputed */
+};
+
+/**
+ * @brief       Called once for every complete section. The section is only valid for the duration of the call.
+ */
+typedef void (*ltntstools_sectionreassembler_callback)(void *userContext, const struct ltntstools_section_s *section);
+
+/**
+ * @brief       Called once the section header has arrived, data is NULL.
+ * @return      1 to collect the section, 0 to skip it.
+ */
+typedef int (*ltntstools_sectionreassembler_filter)(void *userContext, const struct ltntstools_section_s *section);
+
+/**
+ * @brief       Allocate a section reassembler, with no pids.
+ * @param[out]  void **hdl - Handle / context for further use.
+ * @param[in]   ltntstools_sectionreassembler_callback cb - Completed sections
+ * @param[in]   void *userContext - passed to the callback and filter
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_sectionreassembler_alloc(void **hdl, ltntstools_sectionreassembler_callback cb, void *userContext);
+
+/**
+ * @brief       Install a header filter, or NULL to collect everything.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   ltntstools_sectionreassembler_filter filter - filter
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_sectionreassembler_set_filter(void *hdl, ltntstools_sectionreassembler_filter filter);
+
+/**
+ * @brief       Start reassembling sections on a pid. Adding a pid twice has no effect.
+ *              Safe to call from the callback.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   uint16_t pid - pid
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_sectionreassembler_add_pid(void *hdl, uint16_t pid);
+
+/**
+ * @brief       Forget every pid, sections in progress and cached sections. Memory is kept for reuse.
+ *              Don't call from the callback.
+ * @param[in]   void *hdl - Handle / context.
+ */
+void ltntstools_sectionreassembler_reset(void *hdl);
+
+/**
+ * @brief       Write one or more aligned transport packets, packets on other pids are ignored.
+ *              Callbacks are made from within this call.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   const uint8_t *pkts - one or more aligned transport packets
+ * @param[in]   int packetCount - number of packets
+ * @return      number of packets processed
+ */
+ssize_t ltntstools_sectionreassembler_write(void *hdl, const uint8_t *pkts, int packetCount);
+
+/**
+ * @brief       Free a previously allocate context.
+ * @param[in]   void *hdl - Handle / context.
+ */
+void ltntstools_sectionreassembler_free(void *hdl);
+
 #ifdef __cplusplus
 };
 #endif
@@ -0,0 +1,127 @@
+#ifndef _SEGMENTINDEX_H
+#define _SEGMENTINDEX_H
+
+/**
+ * @file        segmentindex.h
+ * @author      Steven Toth <steven.toth@ltnglobal.com>
+ * @copyright   Copyright (c) 2026 LTN Global,Inc. All Rights Reserved.
+ * @brief       Seek index sidecar for recordings produced by the segment writer, see
+ *              ltntstools_segmentwriter_set_index(). Alongside each recording 'name.ts' the writer
+ *              produces 'name.ts.idx', a small header followed by fixed size entries, sorted by byte offset,
+ *              mapping file positions to wallclock, PCR and video PTS / IDR positions.
+ *              The reader maps the sidecar and binary searches it, a multi-hour recording is
+ *              located in O(log n) without touching the transport stream itself.
+ *              All fields are stored in host byte order.
+ *
+ * Usage:
+ *   void *hdl;
+ *   uint64_t start, end;
+ *   ltntstools_segmentindex_open(&hdl, "/recordings/cnn-20260101-120000.ts");
+ *   ltntstools_segmentindex_find_range(hdl, fromMs, toMs, 1, &start, &end);
+ *   ... read bytes start to end from the recording ...
+ *   ltntstools_segmentindex_close(hdl);
+ */
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LTNTSTOOLS_SEGMENTINDEX_MAGIC   "LTNSIDX1"
+#define LTNTSTOOLS_SEGMENTINDEX_VERSION 1
+#define LTNTSTOOLS_SEGMENTINDEX_SUFFIX  ".idx"
+
+#define LTNTSTOOLS_SEGMENTINDEX_FLAG_PCR 0x0001 /**< clock is a 27MHz PCR */
+#define LTNTSTOOLS_SEGMENTINDEX_FLAG_PTS 0x0002 /**< clock is the 90KHz PTS of a video PES header */
+#define LTNTSTOOLS_SEGMENTINDEX_FLAG_IDR 0x0004 /**< With FLAG_PTS, the access unit is an H.264 IDR */
+
+/**
+ * @brief       Sidecar file header.
+ */
+struct ltntstools_segmentindex_header_s
+{
+	char     magic[8];       /**< LTNTSTOOLS_SEGMENTINDEX_MAGIC, not terminated */
+	uint32_t version;        /**< LTNTSTOOLS_SEGMENTINDEX_VERSION */
+	uint32_t entrySize;      /**< sizeof(struct ltntstools_segmentindex_entry_s) */
+};
+
+/**
+ * @brief       Sidecar entry, one per PCR and one per video PES header.
+ */
+struct ltntstools_segmentindex_entry_s
+{
+	uint64_t offset;         /**< Byte offset of the transport packet in the recording */
+	int64_t  wallclockMs;    /**< Milliseconds since the epoch the packet was written. Never decreases. */
+	int64_t  clock;          /**< PCR (27MHz) or PTS (90KHz), see flags */
+	uint16_t pid;            /**< Transport packet identifier */
+	uint16_t flags;          /**< LTNTSTOOLS_SEGMENTINDEX_FLAG_* */
+	uint32_t reserved;
+};
+
+/**
+ * @brief       Open the sidecar index belonging to a recording. The index is mapped as it exists at
+ *              the time of the call, entries appended later by a live writer are not visible.
+ * @param[out]  void **hdl - Handle / context for further use.
+ * @param[in]   const char *filename - The recording, eg. '/tmp/myrecording-20260101-120000.ts'. The
+ *                                     sidecar is filename + LTNTSTOOLS_SEGMENTINDEX_SUFFIX
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_segmentindex_open(void **hdl, const char *filename);
+
+/**
+ * @brief       Unmap the index and free the context.
+ * @param[in]   void *hdl - Handle / context.
+ */
+void ltntstools_segmentindex_close(void *hdl);
+
+/**
+ * @brief       Query the number of entries in the index.
+ * @param[in]   void *hdl - Handle / context.
+ * @return      entry count
+ */
+int  ltntstools_segmentindex_get_count(void *hdl);
+
+/**
+ * @brief       Fetch a single entry.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   int nr - Entry number 0 to count - 1
+ * @param[out]  struct ltntstools_segmentindex_entry_s *entry - Destination
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_segmentindex_get_entry(void *hdl, int nr, struct ltntstools_segmentindex_entry_s *entry);
+
+/**
+ * @brief       Binary search for the last entry written at or before wallclockMs, optionally
+ *              restricted to entries carrying any of flagsMask. The restriction walks backwards
+ *              from the search result, a GOP at most for LTNTSTOOLS_SEGMENTINDEX_FLAG_IDR.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   int64_t wallclockMs - Milliseconds since the epoch
+ * @param[in]   uint16_t flagsMask - 0 for any entry, else LTNTSTOOLS_SEGMENTINDEX_FLAG_*
+ * @param[out]  struct ltntstools_segmentindex_entry_s *entry - Destination
+ * @return      entry number on success, else < 0 if no entry qualifies.
+ */
+int  ltntstools_segmentindex_find_wallclock(void *hdl, int64_t wallclockMs, uint16_t flagsMask,
+	struct ltntstools_segmentindex_entry_s *entry);
+
+/**
+ * @brief       Return the byte range of the recording covering wallclock fromMs to toMs.
+ *              The range starts at the last entry at or before fromMs (the last IDR when keyframeAligned
+ *              is set) and ends at the first entry after toMs, or the end of the recording.
+ *              Packets are whole, byteStart and byteEnd are transport packet boundaries.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   int64_t fromMs - Range start, milliseconds since the epoch
+ * @param[in]   int64_t toMs - Range end, milliseconds since the epoch
+ * @param[in]   int keyframeAligned - Boolean. Start the range on an IDR, so it's decodable.
+ * @param[out]  uint64_t *byteStart - First byte of the range
+ * @param[out]  uint64_t *byteEnd - One past the last byte of the range
+ * @return      0 on success, else < 0 if the range isn't covered by the recording.
+ */
+int  ltntstools_segmentindex_find_range(void *hdl, int64_t fromMs, int64_t toMs, int keyframeAligned,
+	uint64_t *byteStart, uint64_t *byteEnd);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* _SEGMENTINDEX_H */
@@ -7,6 +7,11 @@
  * @copyright   Copyright (c) 2020-2022 LTN Global,Inc. All Rights Reserved.
  * @brief       A threaded file writer. Produces single or segmented recordings.
  *              Capable of supporting any kind of bytestream, targeted at MPEG-TS streams.
+ *              Two I/O engines are available. SEGMENTEDWRITER_ENGINE_QUEUE (the default) queues
+ *              an allocated copy of every write and stores it through the page cache.
+ *              SEGMENTEDWRITER_ENGINE_DIRECT copies writes into a pool of 1MB page aligned buffers,
+ *              the I/O thread is woken as each buffer fills and writes it with O_DIRECT, bypassing
+ *              the page cache. Preferred when recording many high bitrate streams.
  */
 #include <time.h>
 #include <inttypes.h>
@@ -18,6 +23,24 @@ extern "C" {
 #define SEGMENTEDWRITER_SINGLE_FILE 0
 #define SEGMENTEDWRITER_SEGMENTED   1
 
+#define SEGMENTEDWRITER_ENGINE_QUEUE  0
+#define SEGMENTEDWRITER_ENGINE_DIRECT 1
+
+/**
+ * @brief       Writer I/O counters, see ltntstools_segmentwriter_get_stats().
+ */
+struct ltntstools_segmentwriter_stats_s
+{
+	uint64_t writes;              /**< Write calls made to storage */
+	uint64_t bytesWritten;        /**< Bytes written to storage, excluding segment headers in queue mode */
+	int64_t  writeLatencyLastuS;  /**< Duration of the most recent storage write */
+	int64_t  writeLatencyMaxuS;   /**< Longest storage write */
+	int64_t  writeLatencyAvguS;   /**< Average storage write */
+	uint64_t queueDepth;          /**< Items (queue engine) or 1MB buffers (direct engine) waiting for I/O */
+	uint64_t queueDepthMax;       /**< High water mark of queueDepth */
+	uint64_t overruns;            /**< Direct engine, writes dropped because storage couldn't keep up with the buffer pool */
+};
+
 /**
  * @brief       Allocate a framework context capable of smoothing MPEG-TS SPTS/MPTS multiplexes.
  * @param[in]   void **hdl - Handle / context for further use.
@@ -28,6 +51,20 @@ extern "C" {
  */
 int     ltntstools_segmentwriter_alloc(void **hdl, const char *filenamePrefix, const char *filenameSuffix, int writeMode);
 
+/**
+ * @brief       As ltntstools_segmentwriter_alloc(), selecting the I/O engine.
+ *              With SEGMENTEDWRITER_ENGINE_DIRECT the object_alloc/object_write calls are not supported,
+ *              and filesystems without O_DIRECT support (Eg. tmpfs) fall back to buffered I/O.
+ * @param[in]   void **hdl - Handle / context for further use.
+ * @param[in]   const char *filenamePrefix - Eg '/tmp/myrecording-'
+ * @param[in]   const char *filenameSuffix - Eg. '.pcap'
+ * @param[in]   int writeMode - SEGMENTEDWRITER_SEGMENTED or SEGMENTEDWRITER_SINGLE_FILE
+ * @param[in]   int engine - SEGMENTEDWRITER_ENGINE_QUEUE or SEGMENTEDWRITER_ENGINE_DIRECT
+ * @return      0 on success, else < 0.
+ */
+int     ltntstools_segmentwriter_alloc_with_engine(void **hdl, const char *filenamePrefix, const char *filenameSuffix,
+	int writeMode, int engine);
+
 /**
  * @brief       Certain types of segments (Ex. PCAP) need a fixed byte structure to be written out
  *              at the beginning of each segment. This function lets you create a 'segment header'
@@ -40,6 +77,17 @@ int     ltntstools_segmentwriter_alloc(void **hdl, const char *filenamePrefix, c
  */
 int     ltntstools_segmentwriter_set_header(void *hdl, const uint8_t *buf, size_t lengthBytes);
 
+/**
+ * @brief       Produce a seek index sidecar alongside each segment, see segmentindex.h for the format and
+ *              the reader. Every PCR is indexed, and when videoPid is given, the PTS of each H.264 PES header
+ *              along with whether it starts an IDR. Writes are expected to be transport packets.
+ *              Must be called before the first write.
+ * @param[in]   void *hdl - Handle / context for further use.
+ * @param[in]   uint16_t videoPid - H.264 video pid, or 0 to index PCRs only.
+ * @return      0 on success, else < 0.
+ */
+int     ltntstools_segmentwriter_set_index(void *hdl, uint16_t videoPid);
+
 /**
  * @brief       Queue data to the writer for later I/O to storage.
  * @param[in]   void *hdl - Handle / context for further use.
@@ -127,6 +175,14 @@ int     ltntstools_segmentwriter_object_write(void *hdl, void *object);
  */
 int     ltntstools_segmentwriter_get_queue_depth(void *hdl);
 
+/**
+ * @brief       Query the storage write latency and queue depth counters.
+ * @param[in]   void *hdl - Handle / context for further use.
+ * @param[out]  struct ltntstools_segmentwriter_stats_s *stats - Counters since allocation.
+ * @return      0 on success, else < 0.
+ */
+int     ltntstools_segmentwriter_get_stats(void *hdl, struct ltntstools_segmentwriter_stats_s *stats);
+
 #ifdef __cplusplus
 };
 #endif
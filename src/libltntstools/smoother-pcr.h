@@ -45,6 +45,13 @@ extern "C" {
 typedef int (*smoother_pcr_output_callback)(void *userContext, unsigned char *buf, int byteCount,
 	struct ltntstools_pcr_position_s *array, int arrayLength);
 
+/**
+ * @brief       Optional callback, made once the output callback has been called for every item due at
+ *              this moment. Output batched by the application (eg. ltntstools_udp_transmitter_flush())
+ *              should be sent here.
+ */
+typedef int (*smoother_pcr_output_flush_callback)(void *userContext);
+
 /**
  * @brief       Allocate a framework context capable of smoothing MPEG-TS SPTS/MPTS multiplexes.
  * @param[in]   void **hdl - Handle / context for further use.
@@ -69,10 +76,12 @@ void smoother_pcr_free(void *hdl);
  * @brief       Write an entire MPTS into the framework.
  *              At a later point in time, the packets will be handed back to your
  *              callback in a smooth jitter free timeline.
+ *              May be called from within the output callback, a full queue then grows even when
+ *              blocking writes are enabled, as waiting there for the queue to drain would never return.
  * @param[in]   void *hdl - Handle / context.
  * @param[in]   const uint8_t *pkts - one or more aligned transport packets
  * @param[in]   int lengthBytes - number of bytes
- * @param[in]   struct timeval *ts - current timestamp.
+ * @param[in]   struct timeval *ts - arrival time, eg. the kernel receive time from ltntstools_udp_receiver_enable_kernel_timestamps().
  * @return      0 on success, else < 0
  */
 int  smoother_pcr_write(void *hdl, const uint8_t *pkts, int lengthBytes, struct timeval *ts);
@@ -87,6 +96,8 @@ int64_t smoother_pcr_get_size(void *hdl);
 
 /**
  * @brief       Delete all queued content, reset clocks, used when rewinding files, going back in PCR time.
+ *              Safe to call from within the output callback, or before the output thread has started,
+ *              the reset is then applied directly rather than handed to the output thread.
  * @param[in]   void *hdl - Handle / context.
  */
 void smoother_pcr_reset(void *hdl);
@@ -127,6 +138,27 @@ int smoother_pcr_set_blocking_writes(void *hdl, unsigned int boolean);
  */
 int smoother_pcr_set_verbose(void *hdl, unsigned int verbose);
 
+/**
+ * @brief       Adjust the scheduling of the output thread, typically immediately after smoother_pcr_alloc().
+ *              The output thread paces each item to its scheduled time with an absolute deadline sleep
+ *              and a short spin, a realtime priority and a dedicated cpu keep that spin honest under load.
+ *              SCHED_FIFO requires CAP_SYS_NICE.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   int fifoPriority - SCHED_FIFO priority 1-99, or 0 for the default SCHED_OTHER policy.
+ * @param[in]   int cpu - cpu number to pin the output thread to, or -1 to leave unpinned.
+ * @return      0 on success, else < 0 on error
+ */
+int smoother_pcr_set_thread_scheduling(void *hdl, int fifoPriority, int cpu);
+
+/**
+ * @brief       Register a callback made after each group of due items has been output, see smoother_pcr_output_flush_callback.
+ *              Typically ltntstools_udp_transmitter_flush(), paired with ltntstools_udp_transmitter_smoother_pcr_output().
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   smoother_pcr_output_flush_callback cb - Callback, or NULL to disable.
+ * @return      0 on success, else < 0 on error
+ */
+int smoother_pcr_set_output_flush(void *hdl, smoother_pcr_output_flush_callback cb);
+
 #ifdef __cplusplus
 };
 #endif
@@ -45,6 +45,12 @@ struct ltntstools_rtp_position_s;
  */
 typedef int (*smoother_rtp_output_callback)(void *userContext, const unsigned char *buf, int byteCount);
 
+/**
+ * @brief       Optional callback, made once the output callback has been called for every frame due at
+ *              this moment. See smoother_pcr_output_flush_callback.
+ */
+typedef int (*smoother_rtp_output_flush_callback)(void *userContext);
+
 /**
  * @brief       Allocate a framework context capable of smoothing MPEG-TS SPTS/MPTS multiplexes.
  * @param[in]   void **hdl - Handle / context for further use.
@@ -72,7 +78,7 @@ void smoother_rtp_free(void *hdl);
  * @param[in]   void *hdl - Handle / context.
  * @param[in]   const uint8_t *pkts - one or more aligned transport packets
  * @param[in]   int lengthBytes - number of bytes
- * @param[in]   struct timeval *ts - current timestamp.
+ * @param[in]   struct timeval *ts - arrival time, eg. the kernel receive time from ltntstools_udp_receiver_enable_kernel_timestamps().
  * @return      0 on success, else < 0
  */
 int  smoother_rtp_write(void *hdl, const uint8_t *pkts, int lengthBytes, struct timeval *ts);
@@ -90,6 +96,25 @@ int64_t smoother_rtp_get_size(void *hdl);
  */
 void smoother_rtp_reset(void *hdl);
 
+/**
+ * @brief       Adjust the scheduling of the output thread, typically immediately after smoother_rtp_alloc().
+ *              See smoother_pcr_set_thread_scheduling().
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   int fifoPriority - SCHED_FIFO priority 1-99, or 0 for the default SCHED_OTHER policy.
+ * @param[in]   int cpu - cpu number to pin the output thread to, or -1 to leave unpinned.
+ * @return      0 on success, else < 0 on error
+ */
+int smoother_rtp_set_thread_scheduling(void *hdl, int fifoPriority, int cpu);
+
+/**
+ * @brief       Register a callback made after each group of due frames has been output.
+ *              Typically ltntstools_udp_transmitter_flush(), paired with ltntstools_udp_transmitter_smoother_rtp_output().
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   smoother_rtp_output_flush_callback cb - Callback, or NULL to disable.
+ * @return      0 on success, else < 0 on error
+ */
+int smoother_rtp_set_output_flush(void *hdl, smoother_rtp_output_flush_callback cb);
+
 //int  smoother_rtp_expire(void *hdl, struct timeval *ts);
 
 /* From is null then from default to 1 second ago.
@@ -164,6 +164,7 @@ struct ltntstools_pid_statistics_s
 	uint64_t payloadPUSIErrors;    /**< Number of times an illegal combination of PSUI and adaption fields occurs. */
 
 	uint8_t  lastCC;               /**< Last CC value sobserved */
+	uint8_t  firstHeader[4];       /**< Header of the first packet observed, used to check CC when merging, see ltntstools_pid_stats_merge() */
 
 	time_t   pps_last_update;      /**< Maintain a packets per second count, we can convert this into Mb/ps */
 	uint32_t pps;                  /**< Helper var for computing bitrate */
@@ -190,6 +191,24 @@ struct ltntstools_pid_statistics_s
 	int pusi_time_ms;                 /**< milliseconds between last time we saw a packet on this pid, and a PUSI=1 event. Typically updated every 10-30 ms. */
 };
 
+/**
+ * @brief Optional packed per-pid hot counters, see ltntstools_pid_stats_enable_packed_counters().
+ * One contiguous MAX_PID entry array, 32 bytes per pid, so per packet accounting touches a single
+ * cache line instead of chasing a pointer into a ~1KB ltntstools_pid_statistics_s.
+ */
+struct ltntstools_pid_hot_counters_s
+{
+	uint64_t packetCount;          /**< Number of packets processed. */
+	int64_t  lastSeenUs;           /**< walltime (us) of last packet on this pid */
+	uint32_t pps_window;           /**< Helper var for computing bitrate */
+	uint32_t pps_last_update;      /**< Second the pps_window last rolled over */
+	uint8_t  lastCC;               /**< Last CC value observed */
+#define LTNTSTOOLS_PID_HOT_ALLOCATED 0x01
+#define LTNTSTOOLS_PID_HOT_HAS_PCR   0x02
+	uint8_t  flags;
+	uint8_t  reserved[6];
+};
+
 /**
  * @brief A larger statistics container, representing all pids in an entire SPTS/MPTS.
  * The stream object owns a heap-allocated sparse array of PID statistics pointers.
@@ -205,6 +224,7 @@ struct ltntstools_stream_statistics_s
 	struct ltntstools_pid_statistics_s **internal_pids;
 	uint16_t *pidArray;
 	uint16_t  pidArrayCount;
+	struct ltntstools_pid_hot_counters_s *internal_hot; /**< NULL unless packed counters are enabled. */
 
 	uint64_t internal_packetCount;          /**< Total number of packets processed. */
 	uint64_t teiErrors;            /**< Total number of transport error indicator issues processed */
@@ -280,6 +300,23 @@ int ltntstools_isPayloadPUSIInError(const uint8_t *pkt);
  */
 void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream, const uint8_t *pkts, uint32_t packetCount);
 
+/**
+ * @brief       Identical to ltntstools_pid_stats_update() except the caller supplies the arrival time,
+ *              the framework makes no clock calls of its own. Use this to feed large batches (10k+ packets)
+ *              from a single receive thread with one timestamp per batch, such as the kernel SO_TIMESTAMPNS
+ *              receive time, or to replay captures offline with deterministic results.
+ *              The timestamp must be walltime (CLOCK_REALTIME based), the per-second bitrate expiry in the
+ *              query functions compares against time(). Interval (IAT) measurements are made between calls,
+ *              so with batching they describe the batch interval, not the datagram interval.
+ *              NotMultipleOfSeven errors are raised when packetCount is not a multiple of seven.
+ * @param[in]   struct ltntstools_stream_statistics_s *stream - Handle / context. Must not be NULL.
+ * @param[in]   const uint8_t *pkts - one or more aligned transport packets. Must not be NULL.
+ * @param[in]   uint32_t packetCount - number of packets
+ * @param[in]   const struct timeval *ts - arrival time of the packets. Must not be NULL.
+ */
+void ltntstools_pid_stats_update_with_timestamp(struct ltntstools_stream_statistics_s *stream, const uint8_t *pkts, uint32_t packetCount,
+	const struct timeval *ts);
+
 /**
  * @brief       Write a basic ascii pid report to the file descriptor;
  * @param[in]   struct ltntstools_stream_statistics_s *stream - Handle / context. Must not be NULL.
@@ -302,6 +339,20 @@ void ltntstools_pid_stats_reset(struct ltntstools_stream_statistics_s *stream);
  */
 int ltntstools_pid_stats_alloc(struct ltntstools_stream_statistics_s **stream);
 
+/**
+ * @brief       Switch a stats object to the packed per-pid counter layout. Packet counts, CC state and
+ *              bitrate windows live in a contiguous array indexed by pid, the per pid objects are only
+ *              touched on PUSI, errors, PCRs and once per second when bitrates roll over.
+ *              Recommended for high pid count MPTS. Existing measurements are carried over, so this may be
+ *              called at any time, but not concurrently with ltntstools_pid_stats_update().
+ *              With packed counters enabled, fields packetCount, lastCC and pusi_time_current in
+ *              struct ltntstools_pid_statistics_s are only refreshed once per second. Use the query
+ *              functions, not the struct, for current values.
+ * @param[in]   struct ltntstools_stream_statistics_s *stream - Handle / context. Must not be NULL.
+ * @return      0 - Success, else < 0 on error.
+ */
+int ltntstools_pid_stats_enable_packed_counters(struct ltntstools_stream_statistics_s *stream);
+
 /**
  * @brief       Free a previously allocated stats object.
  * @param[in]   struct ltntstools_stream_statistics_s *stream - Handle / context. NULL is accepted and ignored.
@@ -324,6 +375,121 @@ struct ltntstools_pid_statistics_s *ltntstools_pid_stats_get(struct ltntstools_s
  */
 struct ltntstools_stream_statistics_s * ltntstools_pid_stats_clone(struct ltntstools_stream_statistics_s *src);
 
+/**
+ * @brief       Fold the statistics of src into dst, where src measured the packets immediately following
+ *              those measured by dst. Eg. consecutive pieces of a capture, analyzed independently.
+ *              Counters are summed, histograms and CC error history are combined, pids only seen by
+ *              src are copied. Continuity is checked across the join, the first packet of each pid in src
+ *              against the last CC in dst, exactly as a single pass would have.
+ *              PCR timing isn't stitched, each piece establishes its own PCR timebase.
+ *              No notifications are raised. src is unchanged.
+ * @param[in]   struct ltntstools_stream_statistics_s *dst - Handle / context. Must not be NULL.
+ * @param[in]   struct ltntstools_stream_statistics_s *src - Handle / context. Must not be NULL.
+ * @return      0 - Success, else < 0 on error.
+ */
+int ltntstools_pid_stats_merge(struct ltntstools_stream_statistics_s *dst, struct ltntstools_stream_statistics_s *src);
+
+/**
+ * @brief       Analyze a transport stream capture file on multiple threads, accumulating the results into stream.
+ *              The file is split into packet aligned pieces, each piece is measured by its own stats object
+ *              on a pool of threads, then merged in file order with ltntstools_pid_stats_merge().
+ *              Packed counters and pids marked with ltntstools_pid_stats_pid_set_contains_pcr() on stream are
+ *              applied to every piece. Notification callbacks are not called during the analysis.
+ *              Packets are timestamped as they are read, so bitrates and IAT describe the read, not the capture,
+ *              and the PCR timebase restarts (including the PCR warm-up) in each piece.
+ *              A file has no datagrams, notMultipleOfSevenError is left as it was.
+ *              On error stream is left unchanged.
+ * @param[in]   struct ltntstools_stream_statistics_s *stream - Handle / context. Must not be NULL.
+ * @param[in]   const char *filename - Transport stream capture, raw or RTP wrapped, see ts-file-reader.h
+ * @param[in]   int threadCount - Number of threads, <= 0 for one per online cpu.
+ * @return      0 - Success, else < 0 on error.
+ */
+int ltntstools_pid_stats_analyze_file(struct ltntstools_stream_statistics_s *stream, const char *filename, int threadCount);
+
+#define LTNTSTOOLS_PID_STATS_SNAPSHOT_MAX_PIDS 256
+
+/**
+ * @brief A per pid entry in struct ltntstools_pid_stats_snapshot_s
+ */
+struct ltntstools_pid_stats_snapshot_pid_s
+{
+	uint16_t pidNr;                /**< ISO13818 Pid Number */
+	uint16_t hasPCR;               /**< Boolean. See ltntstools_pid_stats_pid_set_contains_pcr() */
+	uint32_t reserved;
+	uint64_t packetCount;          /**< Number of packets processed. */
+	uint64_t ccErrors;             /**< Number of continuity counter issues processed */
+	uint64_t teiErrors;            /**< Number of transport error indicator issues processed */
+	uint64_t scrambledCount;       /**< Number of times we've seen scrambled/encrypted packets */
+	uint64_t pcrExceeds40ms;       /**< Number of times the PCR interval has exceeded 40ms */
+	uint64_t payloadPUSIErrors;    /**< Number of times an illegal combination of PSUI and adaption fields occurs. */
+};
+
+/**
+ * @brief A compact, fixed size copy of the stream and pid counters. No pointers, so it can be copied,
+ * kept in arrays or handed between threads freely. Counters are cumulative for a snapshot taken with
+ * ltntstools_pid_stats_snapshot_take(), or cover intervalUs for one produced by ltntstools_pid_stats_snapshot_delta().
+ */
+struct ltntstools_pid_stats_snapshot_s
+{
+	struct timeval ts;             /**< Walltime the snapshot was taken */
+	int64_t  intervalUs;           /**< 0 for a snapshot, else the time period a delta covers */
+
+	uint64_t packetCount;          /**< Total number of packets processed. */
+	uint64_t ccErrors;             /**< Total number of continuity counter issues processed */
+	uint64_t teiErrors;            /**< Total number of transport error indicator issues processed */
+	uint64_t scrambledCount;       /**< Total number of times we've seen scrambled/encrypted packets */
+	uint64_t pcrExceeds40ms;       /**< Total number of times the PCR interval has exceeded 40ms */
+	uint64_t payloadPUSIErrors;    /**< Number of times an illegal combination of PSUI and adaption fields occurs. */
+	uint64_t notMultipleOfSevenError; /**< number of times ltntstools_pid_stats_update() was called with a packetCount !- 7 */
+	int      iat_lwm_us;           /**< IAT low watermark (us). Watermarks are not differenced by delta. */
+	int      iat_hwm_us;           /**< IAT high watermark (us) */
+
+	uint32_t pidCount;             /**< Number of valid entries in pids[] */
+	uint32_t pidOverflow;          /**< Pids that didn't fit in pids[], their packets are still in the stream totals */
+	struct ltntstools_pid_stats_snapshot_pid_s pids[LTNTSTOOLS_PID_STATS_SNAPSHOT_MAX_PIDS]; /**< Sorted by pidNr */
+};
+
+/**
+ * @brief       Capture the current stream and pid counters into a snapshot. Takes no locks and allocates
+ *              nothing, safe to call from a monitoring thread while another thread is calling
+ *              ltntstools_pid_stats_update(). Counters are read individually, a snapshot taken mid update
+ *              may be a few packets inconsistent between fields, the next snapshot corrects it.
+ * @param[in]   struct ltntstools_stream_statistics_s *stream - Handle / context. Must not be NULL.
+ * @param[out]  struct ltntstools_pid_stats_snapshot_s *snap - Destination
+ * @return      0 - Success, else < 0 on error.
+ */
+int ltntstools_pid_stats_snapshot_take(struct ltntstools_stream_statistics_s *stream, struct ltntstools_pid_stats_snapshot_s *snap);
+
+/**
+ * @brief       Combine two snapshots, eg. many streams into a site level rollup. Counters are summed,
+ *              pid entries with the same pidNr are combined. dst may be a or b.
+ * @param[out]  struct ltntstools_pid_stats_snapshot_s *dst - Destination
+ * @param[in]   const struct ltntstools_pid_stats_snapshot_s *a - Snapshot
+ * @param[in]   const struct ltntstools_pid_stats_snapshot_s *b - Snapshot
+ * @return      0 - Success, else < 0 on error.
+ */
+int ltntstools_pid_stats_snapshot_merge(struct ltntstools_pid_stats_snapshot_s *dst,
+	const struct ltntstools_pid_stats_snapshot_s *a, const struct ltntstools_pid_stats_snapshot_s *b);
+
+/**
+ * @brief       Compute the activity between two snapshots of the same stream, newer - older.
+ *              Pids absent from older count from zero. Counters lower in newer than older (the stats
+ *              were reset in between) count from zero. dst may be newer or older.
+ * @param[out]  struct ltntstools_pid_stats_snapshot_s *dst - Destination
+ * @param[in]   const struct ltntstools_pid_stats_snapshot_s *newer - Snapshot
+ * @param[in]   const struct ltntstools_pid_stats_snapshot_s *older - Snapshot
+ * @return      0 - Success, else < 0 on error.
+ */
+int ltntstools_pid_stats_snapshot_delta(struct ltntstools_pid_stats_snapshot_s *dst,
+	const struct ltntstools_pid_stats_snapshot_s *newer, const struct ltntstools_pid_stats_snapshot_s *older);
+
+/**
+ * @brief       Query the transport bitrate in Mb/ps over the period of a delta.
+ * @param[in]   const struct ltntstools_pid_stats_snapshot_s *snap - A delta, see ltntstools_pid_stats_snapshot_delta()
+ * @return      double - bitrate, or 0 if snap isn't a delta.
+ */
+double ltntstools_pid_stats_snapshot_get_mbps(const struct ltntstools_pid_stats_snapshot_s *snap);
+
 /**
  * @brief       Query CTP stream bitrate in Mb/ps
  * @param[in]   struct ltntstools_stream_statistics_s *stream - Handle / context. May be NULL.
@@ -89,6 +89,19 @@ void ltntstools_streammodel_dprintf(void *hdl, int fd);
  */
 int ltntstools_streammodel_query_model(void *hdl, struct ltntstools_pat_s **pat);
 
+/**
+ * @brief         Collect a reference to the current model, in its compact form. The model is built once per
+ *                detected stream change and shared by every caller, querying it is a reference count bump.
+ *                Release it with ltntstools_psi_model_unref() once you're done, it remains valid after the
+ *                framework moves on to a newer model.
+ *                Don't call this function until your last _write call returns complete = 1.
+ * @param[in]     void *hdl - Previously allocate context handle.
+ * @param[out]    const struct ltntstools_psi_model_s **model - A full representation of the stream.
+ * @return        0 - Success
+ * @return      < 0 - Error
+ */
+int ltntstools_streammodel_query_psi_model(void *hdl, const struct ltntstools_psi_model_s **model);
+
 /**
  * @brief         Helper function.
  *                For a given pat object, typically returned from _querymodel, make a determination
@@ -146,6 +159,32 @@ typedef void (*ltntstools_streammodel_callback)(void *userContext, struct stream
  */
 int ltntstools_streammodel_enable_tr101290_section_checks(void *hdl, ltntstools_streammodel_callback cb);
 
+/**
+ * @brief         Change notification, see ltntstools_streammodel_set_change_callback().
+ *                previous is NULL for the first model. The models and changes are valid for the duration
+ *                of the callback, take a reference with ltntstools_psi_model_ref() to keep a model.
+ *                Called from within _write() once the model lock is released, querying the model with
+ *                ltntstools_streammodel_query_psi_model() is safe, writing to it from the callback isn't.
+ */
+typedef void (*ltntstools_streammodel_change_callback)(void *userContext,
+	const struct ltntstools_psi_model_s *previous, const struct ltntstools_psi_model_s *current,
+	const struct ltntstools_psi_change_s *changes, int changeCount);
+
+/**
+ * @brief         Be told when a program, elementary stream or descriptor in the stream changes.
+ *                The current model keeps watching the PAT and PMT pids while the stream is stable, a
+ *                section with a new version_number, or the same version with a different CRC,
+ *                triggers an immediate collection of the next model. Unchanged sections are discarded
+ *                after a header peek. The callback fires with a structured diff only when
+ *                ltntstools_psi_model_diff() finds a difference, a version bump with identical
+ *                content completes a new model but doesn't call back.
+ * @param[in]     void *hdl - Previously allocate context handle.
+ * @param[in]     ltntstools_streammodel_change_callback cb - callback, or NULL to disable.
+ * @return        0 - Success
+ * @return      < 0 - Error
+ */
+int ltntstools_streammodel_set_change_callback(void *hdl, ltntstools_streammodel_change_callback cb);
+
 #ifdef __cplusplus
 };
 #endif
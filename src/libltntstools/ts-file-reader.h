@@ -0,0 +1,104 @@
+#ifndef LIBLTNTSTOOLS_TS_FILE_READER_H
+#define LIBLTNTSTOOLS_TS_FILE_READER_H
+
+#include <stdint.h>
+
+/**
+ * @file        ts-file-reader.h
+ * @author      Steven Toth <steven.toth@ltnglobal.com>
+ * @copyright   Copyright (c) 2026 LTN Global,Inc. All Rights Reserved.
+ * @brief       A memory mapped transport stream file source for offline tools. The capture is mapped
+ *              once and handed out as batches of aligned 188 byte packets, pointing directly into the
+ *              mapping, suitable for any of the packet write() APIs (stats, tr101290, demux, streammodel).
+ *              Sync is found at open, and found again whenever a packet fails to start with 0x47.
+ *              Captures of RTP payloads (a 12 byte RTP header ahead of each group of packets) are
+ *              detected and the RTP headers skipped. A batch never spans corruption or an RTP header,
+ *              so it may be shorter than requested.
+ *
+ * Usage:
+ *   void *hdl;
+ *   const uint8_t *pkts;
+ *   int count;
+ *   ltntstools_ts_file_reader_alloc(&hdl, "capture.ts");
+ *   while ((count = ltntstools_ts_file_reader_next(hdl, &pkts, 7)) > 0) {
+ *       ltntstools_pid_stats_update(stats, pkts, count);
+ *   }
+ *   ltntstools_ts_file_reader_free(hdl);
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief       Reader counters, see ltntstools_ts_file_reader_get_stats().
+ */
+struct ltntstools_ts_file_reader_stats_s
+{
+	uint64_t packets;        /**< Packets handed out */
+	uint64_t batches;        /**< Successful ltntstools_ts_file_reader_next() calls */
+	uint64_t resyncs;        /**< Number of times sync was lost and found again */
+	uint64_t skippedBytes;   /**< Bytes discarded while finding sync, excluding RTP headers */
+	uint64_t rtpHeaders;     /**< RTP headers skipped */
+};
+
+/**
+ * @brief       Map a transport stream file for reading. The whole file is mapped, with sequential
+ *              access and transparent hugepage hints.
+ * @param[out]  void **hdl - Handle / context for further use.
+ * @param[in]   const char *filename - Transport stream capture, raw or RTP wrapped
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_ts_file_reader_alloc(void **hdl, const char *filename);
+
+/**
+ * @brief       Unmap the file and free the context. Previously returned batches become invalid.
+ * @param[in]   void *hdl - Handle / context.
+ */
+void ltntstools_ts_file_reader_free(void *hdl);
+
+/**
+ * @brief       Return the next batch of contiguous, aligned packets, without copying.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[out]  const uint8_t **pkts - First packet of the batch, valid until the reader is freed.
+ * @param[in]   int maxPackets - Largest batch the caller will accept. Eg. 7
+ * @return      Number of packets in the batch, 0 at the end of the file, < 0 on error.
+ */
+int  ltntstools_ts_file_reader_next(void *hdl, const uint8_t **pkts, int maxPackets);
+
+/**
+ * @brief       Move to a byte offset in the file, sync is found again from there.
+ *              Eg. an offset from the segment writer seek index, see segmentindex.h
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   uint64_t offset - Byte offset
+ * @return      0 on success, else < 0 if the offset is beyond the end of the file.
+ */
+int  ltntstools_ts_file_reader_seek(void *hdl, uint64_t offset);
+
+/**
+ * @brief       Query the byte offset of the next packet to be returned.
+ * @param[in]   void *hdl - Handle / context.
+ * @return      Byte offset
+ */
+uint64_t ltntstools_ts_file_reader_get_position(void *hdl);
+
+/**
+ * @brief       Query the file size in bytes.
+ * @param[in]   void *hdl - Handle / context.
+ * @return      Length in bytes
+ */
+uint64_t ltntstools_ts_file_reader_get_length(void *hdl);
+
+/**
+ * @brief       Query the reader counters.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[out]  struct ltntstools_ts_file_reader_stats_s *stats - Counters since allocation.
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_ts_file_reader_get_stats(void *hdl, struct ltntstools_ts_file_reader_stats_s *stats);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* LIBLTNTSTOOLS_TS_FILE_READER_H */
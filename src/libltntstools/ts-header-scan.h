@@ -0,0 +1,100 @@
+#ifndef LIBLTNTSTOOLS_TS_HEADER_SCAN_H
+#define LIBLTNTSTOOLS_TS_HEADER_SCAN_H
+
+#include <stdint.h>
+
+/**
+ * @file        ts-header-scan.h
+ * @author      Steven Toth <steven.toth@ltnglobal.com>
+ * @copyright   Copyright (c) 2026 LTN Global,Inc. All Rights Reserved.
+ * @brief       Decode the 4 byte transport header of a buffer of aligned 188 byte packets in
+ *              a single pass, into compact per field arrays. On x86 the AVX2 or SSE4.2 kernel
+ *              is selected at runtime, with a portable scalar fallback.
+ *              Fields are decoded regardless of sync, the caller should consult syncErrors
+ *              before trusting the fields of any given packet.
+ *
+ * Usage:
+ *   struct ltntstools_ts_header_vector_s *v;
+ *   ltntstools_ts_header_vector_alloc(&v, 7);
+ *   ltntstools_ts_header_scan(v, pkts, 7);
+ *   for (uint32_t i = 0; i < v->count; i++) {
+ *       if (ltntstools_ts_header_vector_bit(v->syncErrors, i))
+ *           continue;
+ *       printf("pid 0x%04x cc %d\n", v->pid[i], v->cc[i]);
+ *   }
+ *   ltntstools_ts_header_vector_free(v);
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Decoded transport headers. Index N in every array describes packet N of the
+ *        most recent scan. Bitmaps hold one bit per packet, packet N is bit (N % 64) of word (N / 64).
+ */
+struct ltntstools_ts_header_vector_s
+{
+	uint32_t  maxPackets;      /**< Capacity, fixed at allocation time. */
+	uint32_t  count;           /**< Number of packets decoded by the most recent scan. */
+
+	uint16_t *pid;             /**< 13 bit PID */
+	uint8_t  *cc;              /**< 4 bit continuity counter */
+	uint8_t  *afc;             /**< 2 bit adaption field control */
+	uint8_t  *scrambling;      /**< 2 bit transport scrambling control */
+
+	uint64_t *pusi;            /**< Bitmap, payload unit start indicator */
+	uint64_t *tei;             /**< Bitmap, transport error indicator */
+	uint64_t *syncErrors;      /**< Bitmap, packet does not start with 0x47 */
+
+	uint32_t  syncErrorCount;  /**< Number of bits set in syncErrors */
+	uint32_t  teiCount;        /**< Number of bits set in tei */
+};
+
+/**
+ * @brief       Allocate a header vector capable of holding the results for up to maxPackets packets.
+ * @param[out]  struct ltntstools_ts_header_vector_s **vec - object
+ * @param[in]   uint32_t maxPackets - capacity
+ * @return      0 - Success, else < 0 on error.
+ */
+int ltntstools_ts_header_vector_alloc(struct ltntstools_ts_header_vector_s **vec, uint32_t maxPackets);
+
+/**
+ * @brief       Free a previously allocated header vector.
+ * @param[in]   struct ltntstools_ts_header_vector_s *vec - object
+ */
+void ltntstools_ts_header_vector_free(struct ltntstools_ts_header_vector_s *vec);
+
+/**
+ * @brief       Decode the headers of packetCount aligned 188 byte packets. Previous results are discarded.
+ * @param[in]   struct ltntstools_ts_header_vector_s *vec - object
+ * @param[in]   const uint8_t *pkts - Buffer of aligned transport packets
+ * @param[in]   uint32_t packetCount - Number of packets, must not exceed maxPackets
+ * @return      Number of packets decoded, else < 0 on error.
+ */
+int ltntstools_ts_header_scan(struct ltntstools_ts_header_vector_s *vec, const uint8_t *pkts, uint32_t packetCount);
+
+/**
+ * @brief       Portable reference implementation of ltntstools_ts_header_scan(), never vectorized.
+ *              Identical results, useful for verification.
+ */
+int ltntstools_ts_header_scan_scalar(struct ltntstools_ts_header_vector_s *vec, const uint8_t *pkts, uint32_t packetCount);
+
+/**
+ * @brief       Name of the kernel ltntstools_ts_header_scan() dispatches to on this cpu, "avx2", "sse4.2" or "scalar".
+ */
+const char *ltntstools_ts_header_scan_kernel_name(void);
+
+/**
+ * @brief       Test the bit for packet idx in one of the vector bitmaps.
+ */
+static inline int ltntstools_ts_header_vector_bit(const uint64_t *bitmap, uint32_t idx)
+{
+	return (bitmap[idx >> 6] >> (idx & 63)) & 1;
+}
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* LIBLTNTSTOOLS_TS_HEADER_SCAN_H */
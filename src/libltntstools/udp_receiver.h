@@ -37,6 +37,32 @@ extern "C" {
 #endif
 
 typedef void (*tsudp_receiver_callback)(void *userContext, unsigned char *buf, int byteCount);
+
+/**
+ * @brief       Per datagram callback, with the kernel receive time of the datagram.
+ *              The timestamp can be passed directly to ltntstools_pid_stats_update_with_timestamp(),
+ *              ltntstools_tr101290_write(), smoother_pcr_write() or rtp_hdr_write_with_timestamp().
+ */
+typedef void (*tsudp_receiver_timestamp_callback)(void *userContext, unsigned char *buf, int byteCount, const struct timeval *ts);
+
+/**
+ * @brief       A single received datagram, as delivered to a batch callback.
+ *              When RTP header stripping is enabled, buf and byteCount already exclude the RTP header
+ *              and any trailing padding.
+ */
+struct ltntstools_udp_datagram_s
+{
+	unsigned char *buf;
+	int byteCount;
+	struct timespec ts;  /**< Receive time (CLOCK_REALTIME) when kernel timestamps are enabled. Otherwise zero. */
+};
+
+/**
+ * @brief       Batch callback, all of the datagrams received by a single recvmmsg() call, in arrival order.
+ *              Buffers are owned by the receiver and only valid for the duration of the callback.
+ */
+typedef void (*tsudp_receiver_batch_callback)(void *userContext, struct ltntstools_udp_datagram_s *list, int count);
+
 struct ltntstools_udp_receiver_s
 {
 	int skt;
@@ -60,6 +86,24 @@ struct ltntstools_udp_receiver_s
 	/* Debug dumping to disk */
 	pthread_mutex_t fh_mutex;
 	FILE *fh;
+
+	/* Batched receive, see ltntstools_udp_receiver_set_batch_mode() */
+	unsigned int batchDepth;
+	tsudp_receiver_batch_callback batchCb;
+	struct mmsghdr *msgs;
+	struct iovec *iovecs;
+	unsigned char *batchBuffer;
+	struct ltntstools_udp_datagram_s *datagrams;
+
+	/* Kernel receive timestamps, see ltntstools_udp_receiver_enable_kernel_timestamps() */
+	int kernelTimestamps;
+	tsudp_receiver_timestamp_callback tsCb;
+	unsigned char *controlBuffer;
+
+	/* Serviced by a reactor worker instead of a private thread, see ltntstools_udp_receiver_reactor_add() */
+	void *reactor;
+	unsigned int reactorWorker;
+	unsigned int reactorSlot;
 };
 
 int ltntstools_udp_receiver_alloc(struct ltntstools_udp_receiver_s **p,
@@ -73,10 +117,180 @@ void ltntstools_udp_receiver_free(struct ltntstools_udp_receiver_s **p);
 ssize_t ltntstools_udp_receiver_read(struct ltntstools_udp_receiver_s *ctx, unsigned char *buf, unsigned int byteCount);
 int ltntstools_udp_receiver_thread_start(struct ltntstools_udp_receiver_s *ctx);
 
+/**
+ * @brief       Receive up to depth datagrams per system call with recvmmsg(), instead of one recv() per datagram.
+ *              Must be called before ltntstools_udp_receiver_thread_start().
+ *              With a batch callback, each recvmmsg() result is delivered as a single list. With a NULL batch
+ *              callback the regular per datagram callback is still called, once per datagram.
+ * @param[in]   struct ltntstools_udp_receiver_s *ctx - Context
+ * @param[in]   unsigned int depth - maximum datagrams per system call, 1-1024. Eg. 64
+ * @param[in]   tsudp_receiver_batch_callback cb - Optional batch callback
+ * @return      0 on success, else < 0.
+ */
+int ltntstools_udp_receiver_set_batch_mode(struct ltntstools_udp_receiver_s *ctx, unsigned int depth, tsudp_receiver_batch_callback cb);
+
+/**
+ * @brief       Ask the kernel to timestamp every datagram as it arrives (SO_TIMESTAMPNS), so downstream
+ *              IAT measurements exclude the scheduling jitter of the receive thread.
+ *              Must be called before ltntstools_udp_receiver_thread_start(). Compatible with batch mode,
+ *              where the timestamps are delivered in ltntstools_udp_datagram_s.ts.
+ *              With a timestamp callback, it replaces the regular per datagram callback.
+ *              If the kernel ever omits a timestamp, the wall clock time of the read is used instead.
+ * @param[in]   struct ltntstools_udp_receiver_s *ctx - Context
+ * @param[in]   tsudp_receiver_timestamp_callback cb - Optional timestamp aware per datagram callback
+ * @return      0 on success, else < 0.
+ */
+int ltntstools_udp_receiver_enable_kernel_timestamps(struct ltntstools_udp_receiver_s *ctx, tsudp_receiver_timestamp_callback cb);
+
+/**
+ * @brief       Reactor worker assignment policies, see ltntstools_udp_receiver_reactor_alloc().
+ */
+#define LTNTSTOOLS_UDP_REACTOR_ASSIGN_ROUND_ROBIN 0 /**< Spread receivers evenly, in the order they are added */
+#define LTNTSTOOLS_UDP_REACTOR_ASSIGN_HASH        1 /**< By address and port, a stream always lands on the same worker */
+
+/**
+ * @brief       Allocate a receive reactor, a fixed pool of worker threads each waiting on its own epoll set.
+ *              Many receivers share the pool instead of each running a private thread, which keeps cpu use and
+ *              wakeups predictable with hundreds of streams in a single process.
+ *              Receivers keep their usual callback contract (per datagram, batch or timestamp callbacks),
+ *              callbacks run on the worker thread that owns the socket. Linux only.
+ * @param[out]  void **hdl - Handle / context.
+ * @param[in]   int workerCount - Number of worker threads, 1-256.
+ * @param[in]   const int *cpus - Optional array of workerCount cpu numbers to pin each worker to, -1 leaves a worker unpinned.
+ * @param[in]   int assignment - LTNTSTOOLS_UDP_REACTOR_ASSIGN_ROUND_ROBIN or LTNTSTOOLS_UDP_REACTOR_ASSIGN_HASH
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_udp_receiver_reactor_alloc(void **hdl, int workerCount, const int *cpus, int assignment);
+
+/**
+ * @brief       Stop and free the workers. Receivers still registered are detached, not freed.
+ * @param[in]   void *hdl - Handle / context.
+ */
+void ltntstools_udp_receiver_reactor_free(void *hdl);
+
+/**
+ * @brief       Service a receiver from the reactor, use instead of ltntstools_udp_receiver_thread_start().
+ *              Batch mode and kernel timestamps must be configured beforehand.
+ *              ltntstools_udp_receiver_free() removes the receiver from its reactor automatically.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   struct ltntstools_udp_receiver_s *ctx - Receiver, not already started or registered.
+ * @return      The worker index the receiver was assigned to, else < 0.
+ */
+int  ltntstools_udp_receiver_reactor_add(void *hdl, struct ltntstools_udp_receiver_s *ctx);
+
+/**
+ * @brief       Stop servicing a receiver. On return no callback for it is running or will run.
+ *              Not to be called from within a receiver callback on the same worker.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   struct ltntstools_udp_receiver_s *ctx - Receiver
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_udp_receiver_reactor_remove(void *hdl, struct ltntstools_udp_receiver_s *ctx);
+
 /* Add or remove a specific network interface from the receiver, if its a multicast address */
 int  ltntstools_udp_receiver_join_multicast(struct ltntstools_udp_receiver_s *p, char *ifname);
 int  ltntstools_udp_receiver_drop_multicast(struct ltntstools_udp_receiver_s *p, char *ifname);
 
+/* UDP Transmitter ... */
+
+struct ltntstools_pcr_position_s;
+
+/**
+ * @brief       Transmitter counters, see ltntstools_udp_transmitter_get_stats().
+ */
+struct ltntstools_udp_transmitter_stats_s
+{
+	uint64_t datagrams;    /**< Datagrams accepted by the kernel */
+	uint64_t systemCalls;  /**< sendmmsg() / sendmsg() calls made */
+	uint64_t gsoSends;     /**< System calls that carried a UDP_SEGMENT super datagram */
+	uint64_t sendErrors;   /**< Datagrams dropped due to send errors */
+};
+
+/**
+ * @brief       Allocate a transmitter, a connected UDP socket that queues datagrams and sends them in batches,
+ *              with sendmmsg() or, when every queued datagram is the same size, a single UDP_SEGMENT (GSO) send.
+ *              The socket is connect()ed to the destination, sends carry no address. An ICMP port unreachable
+ *              for a unicast destination fails the next send, counted in sendErrors.
+ *              Queued datagrams are copied, the caller keeps ownership of its buffers. Not thread safe, typically
+ *              driven from a single smoother output thread.
+ *              Pair with a smoother:
+ *                smoother_pcr_alloc(&s, tx, ltntstools_udp_transmitter_smoother_pcr_output, ...);
+ *                smoother_pcr_set_output_flush(s, ltntstools_udp_transmitter_flush);
+ * @param[out]  void **hdl - Handle / context.
+ * @param[in]   const char *ip_addr - Destination address, eg. 227.1.1.1
+ * @param[in]   unsigned short ip_port - Destination port
+ * @param[in]   unsigned int batchDepth - Maximum datagrams queued before an automatic flush, 1-1024. Eg. 32
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_udp_transmitter_alloc(void **hdl, const char *ip_addr, unsigned short ip_port, unsigned int batchDepth);
+
+/**
+ * @brief       Send anything still queued, close the socket and free the context.
+ * @param[in]   void *hdl - Handle / context.
+ */
+void ltntstools_udp_transmitter_free(void *hdl);
+
+/**
+ * @brief       Prefix every datagram with a 12 byte RTP header, the sequence number increments per datagram.
+ *              The timestamp is 90KHz, from the stream PCR when fed by a PCR smoother, else from the monotonic clock.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   uint8_t payloadType - Eg. 33 for MP2T
+ * @param[in]   uint32_t ssrc - Synchronization source identifier
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_udp_transmitter_set_rtp(void *hdl, uint8_t payloadType, uint32_t ssrc);
+
+/**
+ * @brief       Enable or disable UDP_SEGMENT (GSO) sends. Enabled by default when the kernel supports it.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   int enable - Boolean
+ * @return      0 on success, else < 0 if GSO isn't available.
+ */
+int  ltntstools_udp_transmitter_set_gso(void *hdl, int enable);
+
+/**
+ * @brief       Queue a single datagram, the batch is sent once batchDepth datagrams are queued.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   const unsigned char *buf - Payload, eg. 7 * 188 bytes of transport packets
+ * @param[in]   int byteCount - Payload length, at most 2048 bytes including any RTP header
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_udp_transmitter_write(void *hdl, const unsigned char *buf, int byteCount);
+
+/**
+ * @brief       Send every queued datagram now. Matches smoother_pcr_output_flush_callback / smoother_rtp_output_flush_callback.
+ * @param[in]   void *hdl - Handle / context.
+ * @return      The number of datagrams sent, else < 0 on error.
+ */
+int  ltntstools_udp_transmitter_flush(void *hdl);
+
+/**
+ * @brief       smoother_pcr_output_callback adapter, pass the transmitter handle as the smoother userContext.
+ */
+int  ltntstools_udp_transmitter_smoother_pcr_output(void *userContext, unsigned char *buf, int byteCount,
+	struct ltntstools_pcr_position_s *array, int arrayLength);
+
+/**
+ * @brief       smoother_rtp_output_callback adapter, pass the transmitter handle as the smoother userContext.
+ *              Frames from the RTP smoother already carry a header, leave ltntstools_udp_transmitter_set_rtp() disabled.
+ */
+int  ltntstools_udp_transmitter_smoother_rtp_output(void *userContext, const unsigned char *buf, int byteCount);
+
+/**
+ * @brief       Query the transmitter counters.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[out]  struct ltntstools_udp_transmitter_stats_s *stats - Counters since allocation.
+ * @return      0 on success, else < 0.
+ */
+int  ltntstools_udp_transmitter_get_stats(void *hdl, struct ltntstools_udp_transmitter_stats_s *stats);
+
+/**
+ * @brief       Print the histogram of send system call durations, in microseconds.
+ * @param[in]   void *hdl - Handle / context.
+ * @param[in]   int fd - Output file descriptor, eg. STDOUT_FILENO
+ */
+void ltntstools_udp_transmitter_histogram_print(void *hdl, int fd);
+
 #ifdef __cplusplus
 };
 #endif
@@ -1,7 +1,7 @@
 #include <libltntstools/ts.h>
 #include <libltntstools/nal_h264.h>
 #include <inttypes.h>
-#include "memmem.h"
+#include <libltntstools/bytescan.h>
 
 #include <libltntstools/nal_bitreader.h>
 
@@ -43,14 +43,11 @@ int ltn_nal_h264_find_headers(const uint8_t *buf, int lengthBytes, struct ltn_na
 	if (!a) {
 		return -1;
 	}
-	const uint8_t start_code[3] = {0, 0, 1};
 	const uint8_t *end = buf + lengthBytes;
-	const uint8_t *p = buf;
+	int offset = 0;
 
-	while (p < end - 3) {
-		p = ltn_memmem(p, end - p, start_code, sizeof(start_code));
-		if (!p)
-				break;
+	while ((offset = ltntstools_bytescan_start_code(buf, lengthBytes, offset)) >= 0) {
+		const uint8_t *p = buf + offset;
 
 		if (idx >= maxitems) {
 				maxitems *= 2;
@@ -71,7 +68,7 @@ int ltn_nal_h264_find_headers(const uint8_t *buf, int lengthBytes, struct ltn_na
 		}
 
 		idx++;
-		p += 3; // Move past start code
+		offset += 3; // Move past start code
 	}
 
 	if (idx > 0) {
@@ -85,18 +82,16 @@ int ltn_nal_h264_find_headers(const uint8_t *buf, int lengthBytes, struct ltn_na
 
 int ltn_nal_h264_findHeader(const uint8_t *buffer, int lengthBytes, int *offset)
 {
-	const uint8_t sig[] = { 0, 0, 1 };
+	int i = *offset;
 
-	for (int i = (*offset + 1); i < lengthBytes - (int)sizeof(sig); i++) {
-		if (memcmp(buffer + i, sig, sizeof(sig)) == 0) {
+	while ((i = ltntstools_bytescan_start_code(buffer, lengthBytes, i + 1)) >= 0) {
 
-			/* Check for the forbidden zero bit, it's illegal to be high in a nal (conflicts with PES headers. */
-			if (*(buffer + i + 3) & 0x80)
-				continue;
+		/* Check for the forbidden zero bit, it's illegal to be high in a nal (conflicts with PES headers. */
+		if (*(buffer + i + 3) & 0x80)
+			continue;
 
-			*offset = i;
-			return 0; /* Success */
-		}
+		*offset = i;
+		return 0; /* Success */
 	}
 
 	return -1; /* Not found */
@@ -1,6 +1,7 @@
 #include <libltntstools/ts.h>
 #include <libltntstools/nal_h265.h>
 #include <inttypes.h>
+#include <libltntstools/bytescan.h>
 
 #include <libltntstools/nal_bitreader.h>
 
@@ -16,6 +17,17 @@ int ltn_nal_h265_find_headers(const uint8_t *buf, int lengthBytes, struct ltn_na
 	int offset = -1;
 	struct ltn_nal_headers_s *curr = a, *prev = a;
 	while (ltn_nal_h265_findHeader(buf, lengthBytes, &offset) == 0) {
+		if (idx >= maxitems) {
+			maxitems *= 2;
+			struct ltn_nal_headers_s *temp = realloc(a, sizeof(struct ltn_nal_headers_s) * maxitems);
+			if (!temp) {
+				free(a);
+				return -1;
+			}
+			prev = temp + (idx - 1);
+			curr = temp + idx;
+			a = temp;
+		}
 		curr->ptr = buf + offset;
 		curr->nalType = (buf[offset + 3] >> 1) & 0x3f;
 		curr->nalName = h265Nals_lookupName(curr->nalType);
@@ -43,18 +55,16 @@ int ltn_nal_h265_find_headers(const uint8_t *buf, int lengthBytes, struct ltn_na
 
 int ltn_nal_h265_findHeader(const uint8_t *buffer, int lengthBytes, int *offset)
 {
-	const uint8_t sig[] = { 0, 0, 1 };
+	int i = *offset;
 
-	for (int i = (*offset + 1); i < lengthBytes - (int)sizeof(sig); i++) {
-		if (memcmp(buffer + i, sig, sizeof(sig)) == 0) {
+	while ((i = ltntstools_bytescan_start_code(buffer, lengthBytes, i + 1)) >= 0) {
 
-			/* Check for the forbidden zero bit, it's illegal to be high in a nal (conflicts with PES headers. */
-			if (*(buffer + i + 3) & 0x80)
-				continue;
+		/* Check for the forbidden zero bit, it's illegal to be high in a nal (conflicts with PES headers. */
+		if (*(buffer + i + 3) & 0x80)
+			continue;
 
-			*offset = i;
-			return 0; /* Success */
-		}
+		*offset = i;
+		return 0; /* Success */
 	}
 
 	return -1; /* Not found */
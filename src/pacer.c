@@ -0,0 +1,172 @@
+/* Copyright LiveTimeNet, Inc. 2026. All Rights Reserved. */
+
+#define _GNU_SOURCE
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+
+#include "pacer.h"
+
+#define PACER_SPIN_MIN_US  20
+#define PACER_SPIN_MAX_US 500
+
+static inline void _cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+uint64_t ltn_pacer_now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+void ltn_pacer_init(struct ltn_pacer_s *p)
+{
+	p->spinuS = PACER_SPIN_MAX_US / 4;
+	p->lateAvguS = (p->spinuS / 2) << 4;
+	p->sleeps = 0;
+	p->spins = 0;
+}
+
+/* Track how late the kernel woke us. Size the spin window at twice the average, bounded. */
+static void _pacer_track_wake(struct ltn_pacer_s *p, uint64_t wakeuS)
+{
+	p->sleeps++;
+
+	int64_t late = ltn_pacer_now_us() - wakeuS;
+	if (late < 0) {
+		late = 0;
+	}
+	p->lateAvguS += late - (p->lateAvguS >> 4);
+	p->spinuS = (p->lateAvguS >> 4) * 2;
+	if (p->spinuS < PACER_SPIN_MIN_US) {
+		p->spinuS = PACER_SPIN_MIN_US;
+	}
+	if (p->spinuS > PACER_SPIN_MAX_US) {
+		p->spinuS = PACER_SPIN_MAX_US;
+	}
+}
+
+/* Sleep until wakeuS. With a condition variable, return 1 early when *wake is set or cond is signalled. */
+static int _pacer_sleep(struct ltn_pacer_s *p, uint64_t wakeuS, pthread_mutex_t *mutex, pthread_cond_t *cond, const int *wake)
+{
+	if (cond) {
+		struct timespec ts = { wakeuS / 1000000, (wakeuS % 1000000) * 1000 };
+		int woken = 0;
+
+		pthread_mutex_lock(mutex);
+		if (__atomic_load_n(wake, __ATOMIC_ACQUIRE)) {
+			woken = 1;
+		} else
+		if (pthread_cond_timedwait(cond, mutex, &ts) == 0) {
+			woken = 1; /* Signalled, or spurious. Either way the caller re-evaluates. */
+		}
+		pthread_mutex_unlock(mutex);
+
+		if (woken) {
+			return 1;
+		}
+	} else {
+#if defined(__linux__)
+		struct timespec ts = { wakeuS / 1000000, (wakeuS % 1000000) * 1000 };
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+			/* EINTR, resume the same absolute deadline */
+		}
+#else
+		uint64_t now = ltn_pacer_now_us();
+		if (wakeuS > now) {
+			usleep(wakeuS - now);
+		}
+#endif
+	}
+
+	_pacer_track_wake(p, wakeuS);
+	return 0;
+}
+
+static int _pacer_wait(struct ltn_pacer_s *p, uint64_t deadlineuS, uint64_t maxWaituS,
+	pthread_mutex_t *mutex, pthread_cond_t *cond, const int *wake)
+{
+	uint64_t now = ltn_pacer_now_us();
+	if (deadlineuS <= now) {
+		return 0;
+	}
+
+	int final = 1;
+	if (deadlineuS - now > maxWaituS) {
+		deadlineuS = now + maxWaituS;
+		final = 0; /* Caller re-evaluates, no point spinning */
+	}
+
+	uint64_t wakeuS = final ? deadlineuS - p->spinuS : deadlineuS;
+	if (wakeuS > now) {
+		if (_pacer_sleep(p, wakeuS, mutex, cond, wake)) {
+			return 1;
+		}
+	}
+
+	if (final) {
+		while (ltn_pacer_now_us() < deadlineuS) {
+			_cpu_relax();
+		}
+		p->spins++;
+	}
+
+	return 0;
+}
+
+void ltn_pacer_wait_until(struct ltn_pacer_s *p, uint64_t deadlineuS, uint64_t maxWaituS)
+{
+	_pacer_wait(p, deadlineuS, maxWaituS, NULL, NULL, NULL);
+}
+
+int ltn_pacer_wait_until_cond(struct ltn_pacer_s *p, uint64_t deadlineuS, uint64_t maxWaituS,
+	pthread_mutex_t *mutex, pthread_cond_t *cond, const int *wake)
+{
+	return _pacer_wait(p, deadlineuS, maxWaituS, mutex, cond, wake);
+}
+
+void ltn_pacer_thread_init(void)
+{
+#if defined(__linux__)
+	/* The default 50us of timer slack is larger than the jitter we're trying to remove. */
+	prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+#endif
+}
+
+int ltn_pacer_thread_scheduling(pthread_t thread, int fifoPriority, int cpu)
+{
+#if defined(__linux__)
+	int ret = 0;
+
+	struct sched_param sp = { 0 };
+	int policy = SCHED_OTHER;
+	if (fifoPriority > 0) {
+		policy = SCHED_FIFO;
+		sp.sched_priority = fifoPriority;
+	}
+	if (pthread_setschedparam(thread, policy, &sp) != 0) {
+		ret = -1;
+	}
+
+	if (cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		if (pthread_setaffinity_np(thread, sizeof(set), &set) != 0) {
+			ret = -1;
+		}
+	}
+
+	return ret;
+#else
+	return -1;
+#endif
+}
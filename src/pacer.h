@@ -0,0 +1,45 @@
+#ifndef LTNTOOLS_PACER_H
+#define LTNTOOLS_PACER_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+/* Output pacing for the smoother threads. Sleep on an absolute CLOCK_MONOTONIC
+ * deadline, waking slightly early and spinning out the remainder. The spin window
+ * tracks how late the kernel actually wakes us, so it stays short on a quiet
+ * box and widens on a busy one.
+ * All times are microseconds on the ltn_pacer_now_us() clock.
+ */
+struct ltn_pacer_s
+{
+	int64_t spinuS;           /* Current spin window */
+	int64_t lateAvguS;        /* Moving average of clock_nanosleep() wake latency, in 1/16 uS */
+	uint64_t sleeps;
+	uint64_t spins;
+};
+
+/* CLOCK_MONOTONIC, in microseconds. */
+uint64_t ltn_pacer_now_us(void);
+
+void ltn_pacer_init(struct ltn_pacer_s *p);
+
+/* Return once deadlineuS has been reached, or after at most maxWaituS, whichever is first. */
+void ltn_pacer_wait_until(struct ltn_pacer_s *p, uint64_t deadlineuS, uint64_t maxWaituS);
+
+/* As ltn_pacer_wait_until(), but the sleep is a timed wait on cond, which must use CLOCK_MONOTONIC,
+ * so another thread can end it early. The sleep is skipped when *wake is set, checked under mutex,
+ * set *wake and signal cond under mutex to interrupt.
+ * Returns 1 when interrupted (or woken spuriously), the deadline may not have been reached. Else 0.
+ */
+int ltn_pacer_wait_until_cond(struct ltn_pacer_s *p, uint64_t deadlineuS, uint64_t maxWaituS,
+	pthread_mutex_t *mutex, pthread_cond_t *cond, const int *wake);
+
+/* Prepare the calling thread for pacing, minimal kernel timer slack. */
+void ltn_pacer_thread_init(void);
+
+/* Apply SCHED_FIFO at fifoPriority (or SCHED_OTHER when 0), and pin to cpu (when >= 0).
+ * Returns 0 on success, else < 0.
+ */
+int ltn_pacer_thread_scheduling(pthread_t thread, int fifoPriority, int cpu);
+
+#endif /* LTNTOOLS_PACER_H */
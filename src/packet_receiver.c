@@ -0,0 +1,447 @@
+/* Copyright LiveTimeNet, Inc. 2026. All Rights Reserved. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/poll.h>
+
+#include "libltntstools/packet_receiver.h"
+#include "utils.h"
+
+#if defined(__linux__)
+
+#include <sys/mman.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+#define LOCAL_DEBUG 0
+
+/* Far more buckets than typical stream counts, so chains stay one deep. */
+#define STREAM_BUCKET_BITS 10
+#define STREAM_BUCKETS (1 << STREAM_BUCKET_BITS)
+
+/* Maximum time the kernel holds a partially filled block before handing it over. */
+#define BLOCK_RETIRE_MS 10
+
+struct packet_stream_s
+{
+	struct packet_stream_s *next;
+
+	uint32_t daddr; /* Network byte order */
+	uint16_t dport; /* Network byte order */
+
+	tsudp_receiver_timestamp_callback cb;
+	void *userContext;
+	int stripRTPHeader;
+};
+
+struct packet_receiver_s
+{
+	int skt;
+	char ifname[IFNAMSIZ];
+
+	/* Mapped TPACKET_V3 ring */
+	uint8_t *ring;
+	size_t ringSize;
+	struct tpacket_req3 req;
+	unsigned int blockIdx;
+
+	/* Held by the capture thread for the duration of each block, and by stream add/remove. */
+	pthread_mutex_t streamMutex;
+	struct packet_stream_s *buckets[STREAM_BUCKETS];
+	struct packet_stream_s *lastStream; /* Datagrams arrive in bursts per stream */
+
+	pthread_t threadId;
+	int threadRunning;
+	int threadTerminate;
+
+	struct ltntstools_packet_receiver_stats_s stats;
+};
+
+/* Accept unfragmented UDP over IPv4 only, everything else stays in the kernel. Fragments, including a first
+ * fragment with the MF bit set and offset zero, would hand the callback a truncated datagram.
+ * The ring presents VLAN tagged frames with the tag already removed, so the ethertype is always at offset 12.
+ */
+static struct sock_filter udp_filter[] = {
+	BPF_STMT(BPF_LD  + BPF_H   + BPF_ABS, 12),              /* Ethertype */
+	BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,   ETH_P_IP, 0, 5),
+	BPF_STMT(BPF_LD  + BPF_B   + BPF_ABS, 14 + 9),          /* IP protocol */
+	BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,   IPPROTO_UDP, 0, 3),
+	BPF_STMT(BPF_LD  + BPF_H   + BPF_ABS, 14 + 6),          /* MF flag and fragment offset */
+	BPF_JUMP(BPF_JMP + BPF_JSET + BPF_K,  0x3fff, 1, 0),
+	BPF_STMT(BPF_RET + BPF_K,             0x40000),         /* Accept the whole frame */
+	BPF_STMT(BPF_RET + BPF_K,             0),               /* Drop */
+};
+
+static inline unsigned int _hash(uint32_t daddr, uint16_t dport)
+{
+	/* Group addresses mostly differ in their low octets, mix them into the top bits */
+	uint32_t k = daddr ^ ((uint32_t)dport << 16) ^ dport;
+	return (k * 2654435761U) >> (32 - STREAM_BUCKET_BITS);
+}
+
+static struct packet_stream_s *_stream_find(struct packet_receiver_s *ctx, uint32_t daddr, uint16_t dport)
+{
+	struct packet_stream_s *s = ctx->lastStream;
+	if (s && s->daddr == daddr && s->dport == dport) {
+		return s;
+	}
+
+	for (s = ctx->buckets[_hash(daddr, dport)]; s; s = s->next) {
+		if (s->daddr == daddr && s->dport == dport) {
+			ctx->lastStream = s;
+			return s;
+		}
+	}
+
+	return NULL;
+}
+
+static void _process_packet(struct packet_receiver_s *ctx, struct tpacket3_hdr *ppd)
+{
+	uint8_t *frame = (uint8_t *)ppd;
+	struct sockaddr_ll *sll = (struct sockaddr_ll *)(frame + TPACKET_ALIGN(sizeof(*ppd)));
+	if (sll->sll_pkttype == PACKET_OUTGOING) {
+		return; /* Our own transmissions, seen twice on loopback */
+	}
+
+	/* tp_net is the IP header offset, snaplen is measured from tp_mac */
+	int avail = (int)ppd->tp_snaplen - (ppd->tp_net - ppd->tp_mac);
+	if (avail < (int)(sizeof(struct iphdr) + sizeof(struct udphdr))) {
+		return;
+	}
+
+	struct iphdr *iphdr = (struct iphdr *)(frame + ppd->tp_net);
+	int ihl = iphdr->ihl * 4;
+	if (ihl < (int)sizeof(struct iphdr) || avail < ihl + (int)sizeof(struct udphdr)) {
+		return;
+	}
+
+	struct udphdr *udphdr = (struct udphdr *)((uint8_t *)iphdr + ihl);
+	struct packet_stream_s *s = _stream_find(ctx, iphdr->daddr, udphdr->dest);
+	if (!s) {
+		ctx->stats.unmatched++;
+#if LOCAL_DEBUG
+		char *str = network_stream_ascii(iphdr, udphdr);
+		printf("%s() unmatched %s\n", __func__, str);
+		free(str);
+#endif
+		return;
+	}
+
+	unsigned char *buf = (unsigned char *)udphdr + sizeof(struct udphdr);
+	int byteCount = ntohs(udphdr->len) - (int)sizeof(struct udphdr);
+	if (byteCount > avail - ihl - (int)sizeof(struct udphdr)) {
+		byteCount = avail - ihl - (int)sizeof(struct udphdr); /* Truncated by the ring */
+	}
+
+	if (s->stripRTPHeader) {
+		if (byteCount < 12) {
+			return;
+		}
+		buf += 12;
+		byteCount = ((byteCount - 12) / 188) * 188;
+	}
+	if (byteCount <= 0) {
+		return;
+	}
+
+	struct timeval tv = { .tv_sec = ppd->tp_sec, .tv_usec = ppd->tp_nsec / 1000 };
+	s->cb(s->userContext, buf, byteCount, &tv);
+
+	ctx->stats.packets++;
+	ctx->stats.bytes += byteCount;
+}
+
+static void _process_block(struct packet_receiver_s *ctx, struct tpacket_block_desc *bd)
+{
+	uint32_t count = bd->hdr.bh1.num_pkts;
+	struct tpacket3_hdr *ppd = (struct tpacket3_hdr *)((uint8_t *)bd + bd->hdr.bh1.offset_to_first_pkt);
+
+	pthread_mutex_lock(&ctx->streamMutex);
+	for (uint32_t i = 0; i < count; i++) {
+		_process_packet(ctx, ppd);
+		ppd = (struct tpacket3_hdr *)((uint8_t *)ppd + ppd->tp_next_offset);
+	}
+	ctx->stats.blocks++;
+	pthread_mutex_unlock(&ctx->streamMutex);
+}
+
+static void *packet_receiver_threadfunc(void *p)
+{
+	struct packet_receiver_s *ctx = (struct packet_receiver_s *)p;
+
+	ltnpthread_setname_np(pthread_self(), "tstools-pktrx");
+
+	ctx->threadRunning = 1;
+	while (!__atomic_load_n(&ctx->threadTerminate, __ATOMIC_RELAXED)) {
+		struct tpacket_block_desc *bd = (struct tpacket_block_desc *)(ctx->ring + ((size_t)ctx->blockIdx * ctx->req.tp_block_size));
+
+		if ((__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+			struct pollfd fds = { .fd = ctx->skt, .events = POLLIN | POLLERR, .revents = 0 };
+			poll(&fds, 1, 250);
+			continue;
+		}
+
+		_process_block(ctx, bd);
+
+		/* Hand the block back to the kernel, payloads are no longer referenced */
+		__atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+		ctx->blockIdx = (ctx->blockIdx + 1) % ctx->req.tp_block_nr;
+	}
+	ctx->threadRunning = 0;
+
+	return NULL;
+}
+
+int ltntstools_packet_receiver_alloc(void **hdl, const char *ifname, unsigned int blockSize, unsigned int blockCount)
+{
+	long pageSize = sysconf(_SC_PAGESIZE);
+	if (!hdl || !ifname || strlen(ifname) >= IFNAMSIZ || blockCount < 1 ||
+		blockSize < pageSize || (blockSize & (blockSize - 1))) {
+		return -1;
+	}
+
+	unsigned int ifindex = if_nametoindex(ifname);
+	if (ifindex == 0) {
+		return -1;
+	}
+
+	struct packet_receiver_s *ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		return -1;
+	}
+	strcpy(ctx->ifname, ifname);
+	pthread_mutex_init(&ctx->streamMutex, NULL);
+
+	/* Protocol zero, nothing is queued until the filter is attached and the socket is bound */
+	ctx->skt = socket(AF_PACKET, SOCK_RAW, 0);
+	if (ctx->skt < 0) {
+		perror("socket(AF_PACKET)");
+		free(ctx);
+		return -1;
+	}
+
+	int version = TPACKET_V3;
+	if (setsockopt(ctx->skt, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		perror("packet_version");
+		goto fail;
+	}
+
+	struct sock_fprog prog = { .len = sizeof(udp_filter) / sizeof(udp_filter[0]), .filter = udp_filter };
+	if (setsockopt(ctx->skt, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+		perror("so_attach_filter");
+		goto fail;
+	}
+
+#if defined(PACKET_IGNORE_OUTGOING)
+	/* Optional, older kernels rely on the PACKET_OUTGOING check per frame */
+	int ignore = 1;
+	setsockopt(ctx->skt, SOL_PACKET, PACKET_IGNORE_OUTGOING, &ignore, sizeof(ignore));
+#endif
+
+	ctx->req.tp_block_size = blockSize;
+	ctx->req.tp_block_nr = blockCount;
+	ctx->req.tp_frame_size = 2048; /* Nominal with V3, frames are packed into blocks */
+	ctx->req.tp_frame_nr = (blockSize / ctx->req.tp_frame_size) * blockCount;
+	ctx->req.tp_retire_blk_tov = BLOCK_RETIRE_MS;
+	if (setsockopt(ctx->skt, SOL_PACKET, PACKET_RX_RING, &ctx->req, sizeof(ctx->req)) < 0) {
+		perror("packet_rx_ring");
+		goto fail;
+	}
+
+	ctx->ringSize = (size_t)blockSize * blockCount;
+	ctx->ring = mmap(NULL, ctx->ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, ctx->skt, 0);
+	if (ctx->ring == MAP_FAILED) {
+		perror("mmap");
+		ctx->ring = NULL;
+		goto fail;
+	}
+
+	struct sockaddr_ll sll = {
+		.sll_family = AF_PACKET,
+		.sll_protocol = htons(ETH_P_IP),
+		.sll_ifindex = ifindex,
+	};
+	if (bind(ctx->skt, (struct sockaddr *)&sll, sizeof(sll)) < 0) {
+		perror("bind");
+		goto fail;
+	}
+
+	*hdl = ctx;
+	return 0; /* Success */
+
+fail:
+	if (ctx->ring) {
+		munmap(ctx->ring, ctx->ringSize);
+	}
+	close(ctx->skt);
+	pthread_mutex_destroy(&ctx->streamMutex);
+	free(ctx);
+	return -1;
+}
+
+void ltntstools_packet_receiver_free(void *hdl)
+{
+	struct packet_receiver_s *ctx = (struct packet_receiver_s *)hdl;
+	if (!ctx) {
+		return;
+	}
+
+	if (ctx->threadId) {
+		__atomic_store_n(&ctx->threadTerminate, 1, __ATOMIC_RELAXED);
+		pthread_join(ctx->threadId, NULL);
+	}
+
+	munmap(ctx->ring, ctx->ringSize);
+	close(ctx->skt);
+
+	for (int i = 0; i < STREAM_BUCKETS; i++) {
+		struct packet_stream_s *s = ctx->buckets[i];
+		while (s) {
+			struct packet_stream_s *next = s->next;
+			free(s);
+			s = next;
+		}
+	}
+
+	pthread_mutex_destroy(&ctx->streamMutex);
+	free(ctx);
+}
+
+int ltntstools_packet_receiver_add_stream(void *hdl, const char *ip_addr, unsigned short ip_port,
+	tsudp_receiver_timestamp_callback cb, void *userContext, int stripRTPHeader)
+{
+	struct packet_receiver_s *ctx = (struct packet_receiver_s *)hdl;
+	struct in_addr addr;
+	if (!ctx || !ip_addr || !cb || inet_aton(ip_addr, &addr) == 0) {
+		return -1;
+	}
+
+	struct packet_stream_s *s = calloc(1, sizeof(*s));
+	if (!s) {
+		return -1;
+	}
+	s->daddr = addr.s_addr;
+	s->dport = htons(ip_port);
+	s->cb = cb;
+	s->userContext = userContext;
+	s->stripRTPHeader = stripRTPHeader;
+
+	pthread_mutex_lock(&ctx->streamMutex);
+	if (_stream_find(ctx, s->daddr, s->dport)) {
+		pthread_mutex_unlock(&ctx->streamMutex);
+		free(s);
+		return -1; /* Duplicate */
+	}
+	unsigned int idx = _hash(s->daddr, s->dport);
+	s->next = ctx->buckets[idx];
+	ctx->buckets[idx] = s;
+	pthread_mutex_unlock(&ctx->streamMutex);
+
+	return 0; /* Success */
+}
+
+int ltntstools_packet_receiver_remove_stream(void *hdl, const char *ip_addr, unsigned short ip_port)
+{
+	struct packet_receiver_s *ctx = (struct packet_receiver_s *)hdl;
+	struct in_addr addr;
+	if (!ctx || !ip_addr || inet_aton(ip_addr, &addr) == 0) {
+		return -1;
+	}
+
+	uint16_t dport = htons(ip_port);
+	int ret = -1;
+
+	pthread_mutex_lock(&ctx->streamMutex);
+	struct packet_stream_s **pp = &ctx->buckets[_hash(addr.s_addr, dport)];
+	while (*pp) {
+		struct packet_stream_s *s = *pp;
+		if (s->daddr == addr.s_addr && s->dport == dport) {
+			*pp = s->next;
+			if (ctx->lastStream == s) {
+				ctx->lastStream = NULL;
+			}
+			free(s);
+			ret = 0;
+			break;
+		}
+		pp = &s->next;
+	}
+	pthread_mutex_unlock(&ctx->streamMutex);
+
+	return ret;
+}
+
+int ltntstools_packet_receiver_thread_start(void *hdl)
+{
+	struct packet_receiver_s *ctx = (struct packet_receiver_s *)hdl;
+	if (!ctx || ctx->threadId) {
+		return -1;
+	}
+
+	return pthread_create(&ctx->threadId, NULL, packet_receiver_threadfunc, ctx);
+}
+
+int ltntstools_packet_receiver_get_stats(void *hdl, struct ltntstools_packet_receiver_stats_s *stats)
+{
+	struct packet_receiver_s *ctx = (struct packet_receiver_s *)hdl;
+	if (!ctx || !stats) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&ctx->streamMutex);
+
+	/* The kernel resets its counters on every read, accumulate them */
+	struct tpacket_stats_v3 ks;
+	socklen_t len = sizeof(ks);
+	if (getsockopt(ctx->skt, SOL_PACKET, PACKET_STATISTICS, &ks, &len) == 0) {
+		ctx->stats.kernelDrops += ks.tp_drops;
+	}
+	*stats = ctx->stats; /* Implicit struct copy */
+
+	pthread_mutex_unlock(&ctx->streamMutex);
+
+	return 0; /* Success */
+}
+
+#else
+
+/* AF_PACKET rings are linux only */
+
+int ltntstools_packet_receiver_alloc(void **hdl, const char *ifname, unsigned int blockSize, unsigned int blockCount)
+{
+	return -1;
+}
+
+void ltntstools_packet_receiver_free(void *hdl)
+{
+}
+
+int ltntstools_packet_receiver_add_stream(void *hdl, const char *ip_addr, unsigned short ip_port,
+	tsudp_receiver_timestamp_callback cb, void *userContext, int stripRTPHeader)
+{
+	return -1;
+}
+
+int ltntstools_packet_receiver_remove_stream(void *hdl, const char *ip_addr, unsigned short ip_port)
+{
+	return -1;
+}
+
+int ltntstools_packet_receiver_thread_start(void *hdl)
+{
+	return -1;
+}
+
+int ltntstools_packet_receiver_get_stats(void *hdl, struct ltntstools_packet_receiver_stats_s *stats)
+{
+	return -1;
+}
+
+#endif /* __linux__ */
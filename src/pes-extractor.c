@@ -9,6 +9,7 @@
 #define LOCAL_DEBUG 0
 #define ORDERED_LIST_DEPTH 60
 #define SIMULATE_TS_PACKET_LOSS 0
+#define PES_POOL_DEPTH 8
 
 struct pcr_item_s
 {
@@ -19,6 +20,31 @@ struct pcr_item_s
 };
 #define MAX_PCR_ITEMS 12
 
+/* Minimal per-pid state, we only ever need CC and PUSI timing for the one pid we extract.
+ * Replaces a full ltntstools_stream_statistics_s (8192 pid table, histograms) per extractor.
+ */
+struct pes_extractor_pid_state_s
+{
+	uint64_t packetCount;
+	uint64_t ccErrors;
+	uint8_t  lastCC;
+	struct timeval pusi_time_first;   /* walltime of last PUSI on our pid */
+	struct timeval pusi_time_current; /* walltime of last packet on our pid */
+};
+
+/* Track a system time clock from the PCR pid, advanced by a measured ticks per packet
+ * between PCRs. Only used when we're not sharing someones elses stats context.
+ */
+struct pes_extractor_stc_s
+{
+	int      enabled;
+	uint16_t pcrPID;
+	int64_t  lastPCR;          /* -1 until established */
+	uint32_t packetsSincePCR;
+	int64_t  ticksPerPacket;
+	int64_t  stc;
+};
+
 struct pes_extractor_s
 {
 	uint16_t pid;
@@ -51,8 +77,15 @@ struct pes_extractor_s
 	int largestRingFrame; /* Largest ever PES we've pulled from the ring buffer - useful for sizing */
 	uint64_t lastCCCounter; /* Track CC loss for the pid and help prevent partial / mangles PES construction. */
 
+	struct pes_extractor_pid_state_s pidState;
+	struct pes_extractor_stc_s stc;
+
+	/* Optional, owned and updated by someone else, see ltntstools_pes_extractor_set_stats() */
 	struct ltntstools_stream_statistics_s *libstats;
 
+	/* Optional, see ltntstools_pes_extractor_set_pooled_output() */
+	struct ltn_pes_packet_pool_s *pool;
+
 	/* PCR to ring position management */
 	struct xorg_list pcrList;
 	uint32_t pusi_time_ms; /* Arrival duration of the entire pes */
@@ -67,17 +100,6 @@ struct item_s
 	struct ltn_pes_packet_s *pes;
 };
 
-static void *notification_callback(struct pes_extractor_s *ctx, enum ltntstools_notification_event_e event,
-	const struct ltntstools_stream_statistics_s *stats,
-	const struct ltntstools_pid_statistics_s *pid)
-{
-	if (event == EVENT_UPDATE_PID_PUSI_DELIVERY_TIME) {
-		ctx->pusi_time_ms = pid->pusi_time_ms;
-	}
-
-	return NULL;
-}
-
 int ltntstools_pes_extractor_alloc(void **hdl, uint16_t pid, uint8_t streamId, pes_extractor_callback cb, void *userContext, int buffer_min, int buffer_max)
 {
 	struct pes_extractor_s *ctx = calloc(1, sizeof(*ctx));
@@ -102,9 +124,11 @@ int ltntstools_pes_extractor_alloc(void **hdl, uint16_t pid, uint8_t streamId, p
 	xorg_list_init(&ctx->pcrList);
 	xorg_list_init(&ctx->listOrdered);
 	pthread_mutex_init(&ctx->listOrderedMutex, NULL);
-	ltntstools_pid_stats_alloc(&ctx->libstats);
-	ltntstools_notification_register_callback(ctx->libstats, EVENT_UPDATE_PID_PUSI_DELIVERY_TIME,
-		ctx, (ltntstools_notification_callback)notification_callback);
+	ctx->libstats = NULL;
+	ctx->pool = NULL;
+	memset(&ctx->pidState, 0, sizeof(ctx->pidState));
+	memset(&ctx->stc, 0, sizeof(ctx->stc));
+	ctx->stc.lastPCR = -1;
 
 	/* initialize a 10 item deep list */
 	for (int i = 0; i < ORDERED_LIST_DEPTH; i++) {
@@ -290,8 +314,8 @@ void ltntstools_pes_extractor_free(void *hdl)
 		free(item);
 	}
 
-	ltntstools_notification_unregister_callbacks(ctx->libstats);
-	ltntstools_pid_stats_free(ctx->libstats);
+	/* PES still held by the application keep the pool alive until they're freed */
+	ltn_pes_packet_pool_free(ctx->pool);
 
 	//printf("%s() ctx->largestRingFrame largest size of a pes was %d bytes\n", __func__, ctx->largestRingFrame);
 	free(ctx);
@@ -311,6 +335,21 @@ int ltntstools_pes_extractor_set_skip_data(void *hdl, int tf)
 	return 0; /* Success */
 }
 
+int ltntstools_pes_extractor_set_pooled_output(void *hdl, int tf)
+{
+	struct pes_extractor_s *ctx = (struct pes_extractor_s *)hdl;
+	if (!tf || ctx->pool) {
+		return 0; /* Success, nothing to do. Once enabled, pooling stays on. */
+	}
+
+	ctx->pool = ltn_pes_packet_pool_alloc(PES_POOL_DEPTH);
+	if (!ctx->pool) {
+		return -1;
+	}
+
+	return 0; /* Success */
+}
+
 static int _processRing(struct pes_extractor_s *ctx)
 {
 	int rlen = rb_used(ctx->rb);
@@ -336,100 +375,124 @@ static int _processRing(struct pes_extractor_s *ctx)
 	printf("%s() ring size %ld, computed size %d\n", __func__, rb_used(ctx->rb), ctx->computedRingSize);
 #endif
 
-	unsigned char *buf = malloc(rlen);
-	if (buf) {
-		int plen = rb_peek(ctx->rb, (char *)buf, rlen);
-		if (plen == rlen) {
+	/* Peek the ring directly into the buffer the PES will carry as its rawBuffer. When pooled,
+	 * both come from the pool and the payload references rawBuffer, no allocations and one copy.
+	 */
+	struct ltn_pes_packet_s *pes;
+	if (ctx->pool) {
+		pes = ltn_pes_packet_pool_get(ctx->pool, rlen);
+	} else {
+		pes = ltn_pes_packet_alloc();
+		if (pes) {
+			pes->rawBuffer = malloc(rlen);
+			if (!pes->rawBuffer) {
+				ltn_pes_packet_free(pes);
+				pes = NULL;
+			}
+		}
+	}
+	if (!pes) {
+		return -1;
+	}
+
+	unsigned char *buf = pes->rawBuffer;
+	int plen = rb_peek(ctx->rb, (char *)buf, rlen);
+	if (plen != rlen) {
+		ltn_pes_packet_free(pes);
+		return 0;
+	}
 
 #if 0
-			printf("A, plen %d -- first ", plen);
-			for (int k = 0; k < 32; k++) {
-				printf("%02x ", buf[k]);
-			}
-			printf("\n");
+	printf("A, plen %d -- first ", plen);
+	for (int k = 0; k < 32; k++) {
+		printf("%02x ", buf[k]);
+	}
+	printf("\n");
 #endif
 
-			/* Track a useful stat */
-			if (plen > ctx->largestRingFrame) {
-				ctx->largestRingFrame = plen;
-			}
+	/* Track a useful stat */
+	if (plen > ctx->largestRingFrame) {
+		ctx->largestRingFrame = plen;
+	}
 
-			struct klbs_context_s bs;
-			klbs_init(&bs);
-			klbs_read_set_buffer(&bs, buf, rlen);
+	struct klbs_context_s bs;
+	klbs_init(&bs);
+	klbs_read_set_buffer(&bs, buf, rlen);
 
-			struct ltn_pes_packet_s *pes = ltn_pes_packet_alloc();
-			int bitsProcessed = ltn_pes_packet_parse(pes, &bs, ctx->skipDataExtraction);
+	/* Pooled packets are parsed from their own rawBuffer, so data references it rather than copying it.
+	 * Unpooled packets keep a separately allocated data, as existing callers expect.
+	 */
+	if (!ctx->pool) {
+		pes->rawBuffer = NULL;
+	}
+	int bitsProcessed = ltn_pes_packet_parse(pes, &bs, ctx->skipDataExtraction);
+	pes->rawBuffer = buf;
+	pes->rawBufferLengthBytes = rlen;
 
-			pes->pcr = findPcrFromPosition(ctx, rb_get_read_pos(ctx->rb));
-			if (pes->pcr == -1) {
-				fprintf(stderr, "%s() this should never happen, pcr was negative\n", __func__);
-			}
-			pes->arrivalMs = ctx->pusi_time_ms;
-
-			/* check for buffer overrun */
-			if (bs.overrun) {
-				fprintf(stderr, "KLBITSTREAM OVERRUN: (%s:%s:%d) Process Ring Buffer bs.overrun %d bs.buflen %d bs.buflen_used %d rlen %d\n",
-						__FILE__, __func__, __LINE__, bs.overrun, bs.buflen, bs.buflen_used, rlen);
-				ltn_pes_packet_dump(pes, "\t");
-				overrun = 1;
-			} else if (bs.truncated) {
-				ltn_pes_packet_dump(pes, "\t");
-			}
+	pes->pcr = findPcrFromPosition(ctx, rb_get_read_pos(ctx->rb));
+	if (pes->pcr == -1) {
+		fprintf(stderr, "%s() this should never happen, pcr was negative\n", __func__);
+	}
+	pes->arrivalMs = ctx->pusi_time_ms;
+
+	/* check for buffer overrun */
+	if (bs.overrun) {
+		fprintf(stderr, "KLBITSTREAM OVERRUN: (%s:%s:%d) Process Ring Buffer bs.overrun %d bs.buflen %d bs.buflen_used %d rlen %d\n",
+				__FILE__, __func__, __LINE__, bs.overrun, bs.buflen, bs.buflen_used, rlen);
+		ltn_pes_packet_dump(pes, "\t");
+		overrun = 1;
+	} else if (bs.truncated) {
+		ltn_pes_packet_dump(pes, "\t");
+	}
 
-			if (!overrun && bitsProcessed && ctx->cb) {
-				
-				pes->rawBufferLengthBytes = rlen;
-				pes->rawBuffer = malloc(pes->rawBufferLengthBytes);
-				memcpy(pes->rawBuffer, buf, pes->rawBufferLengthBytes);
-
-				if (ctx->orderedOutput) {
-					/* Send the PES's to the callback in the correct temporal order,
-					 * which compensates for B frames. IN other words, we've just built
-					 * a pes above, but this might not be the right PES to emit to the callback,
-					 * we're trying to emit an earlier PES to maintain temporal order.
-					 * Find the oldest, calback that, and put the NEW pes we've just created in the
-					 * right place in the time ordered queue, for later emmission.
-					 */
-					struct item_s *item = _list_find_oldest(ctx);
-					if (item) {
-						if (item->pes) {
-							/* User owns the lifetime of the object */
-							ctx->cb(ctx->userContext, item->pes);
-						}
-
-						/* Now re-use list item to store the newly constructed pes, put it back in the sorted list */
-						item->pes = pes;
-						ltntstools_corrected_clock_update(&ctx->correctedClock, pes->PTS);
-
-						/* Get a PTS value that includes continious wrapping over time. */
-						item->correctedPTS = ltntstools_corrected_clock_unwrapped(&ctx->correctedClock);
-
-						/* Now put the current parsed item on the list for future callback */
-						xorg_list_del(&item->list);
-						_list_insert(ctx, item);
-#if LOCAL_DEBUG
-						_list_print(ctx);
-#endif
-					}
+	if (!overrun && bitsProcessed && ctx->cb) {
 
-				} else {
-					ctx->cb(ctx->userContext, pes);
+		if (ctx->orderedOutput) {
+			/* Send the PES's to the callback in the correct temporal order,
+			 * which compensates for B frames. IN other words, we've just built
+			 * a pes above, but this might not be the right PES to emit to the callback,
+			 * we're trying to emit an earlier PES to maintain temporal order.
+			 * Find the oldest, calback that, and put the NEW pes we've just created in the
+			 * right place in the time ordered queue, for later emmission.
+			 */
+			struct item_s *item = _list_find_oldest(ctx);
+			if (item) {
+				if (item->pes) {
 					/* User owns the lifetime of the object */
+					ctx->cb(ctx->userContext, item->pes);
 				}
-			} else
-			if (bitsProcessed) {
+
+				/* Now re-use list item to store the newly constructed pes, put it back in the sorted list */
+				item->pes = pes;
+				ltntstools_corrected_clock_update(&ctx->correctedClock, pes->PTS);
+
+				/* Get a PTS value that includes continious wrapping over time. */
+				item->correctedPTS = ltntstools_corrected_clock_unwrapped(&ctx->correctedClock);
+
+				/* Now put the current parsed item on the list for future callback */
+				xorg_list_del(&item->list);
+				_list_insert(ctx, item);
 #if LOCAL_DEBUG
-				ltn_pes_packet_dump(pes, "\t");
-				ltn_pes_packet_free(pes);
+				_list_print(ctx);
 #endif
 			} else {
-#if LOCAL_DEBUG
-				printf("skipping, processedbits = %d\n", bitsProcessed);
-#endif
+				ltn_pes_packet_free(pes);
 			}
+
+		} else {
+			ctx->cb(ctx->userContext, pes);
+			/* User owns the lifetime of the object */
 		}
-		free(buf);
+	} else {
+#if LOCAL_DEBUG
+		if (bitsProcessed) {
+			ltn_pes_packet_dump(pes, "\t");
+		} else {
+			printf("skipping, processedbits = %d\n", bitsProcessed);
+		}
+#endif
+		/* Not delivered, nobody else will free it. */
+		ltn_pes_packet_free(pes);
 	}
 
 	if (overrun) {
@@ -439,20 +502,94 @@ static int _processRing(struct pes_extractor_s *ctx)
 	return 0; /* Success */
 }
 
+int ltntstools_pes_extractor_set_stats(void *hdl, struct ltntstools_stream_statistics_s *stats)
+{
+	struct pes_extractor_s *ctx = (struct pes_extractor_s *)hdl;
+	if (!ctx || !stats) {
+		return -1;
+	}
+
+	ctx->libstats = stats;
+
+	return 0; /* Success */
+}
+
 int ltntstools_pes_extractor_set_pcr_pid(void *hdl, uint16_t pcrpidnr)
 {
 	struct pes_extractor_s *ctx = (struct pes_extractor_s *)hdl;
-	ltntstools_pid_stats_pid_set_contains_pcr(ctx->libstats, pcrpidnr & 0x1fff);
+
+	ctx->stc.enabled = 1;
+	ctx->stc.pcrPID = pcrpidnr & 0x1fff;
+	ctx->stc.lastPCR = -1;
+	ctx->stc.packetsSincePCR = 0;
+
+	if (ctx->libstats) {
+		ltntstools_pid_stats_pid_set_contains_pcr(ctx->libstats, pcrpidnr & 0x1fff);
+	}
 
 	return 0; /* Success */
 }
 
+/* Called for every packet in the mux, when we're not using a shared stats context. */
+static void _stc_update(struct pes_extractor_s *ctx, const uint8_t *pkt, uint16_t pidnr)
+{
+	struct pes_extractor_stc_s *stc = &ctx->stc;
+
+	stc->stc += stc->ticksPerPacket;
+	stc->packetsSincePCR++;
+
+	if (pidnr != stc->pcrPID) {
+		return;
+	}
+
+	uint64_t pcr;
+	if (ltntstools_scr(pkt, &pcr) < 0) {
+		return;
+	}
+
+	if (stc->lastPCR > -1 && stc->packetsSincePCR) {
+		int64_t ticks = ltntstools_scr_diff(stc->lastPCR, pcr);
+		if (ticks > 0) {
+			stc->ticksPerPacket = ticks / stc->packetsSincePCR;
+		}
+	}
+	stc->lastPCR = pcr;
+	stc->packetsSincePCR = 0;
+	stc->stc = pcr;
+}
+
+/* Called for every packet on our pid, track CC loss and PES delivery time. */
+static void _pid_state_update(struct pes_extractor_s *ctx, const uint8_t *pkt, const struct timeval *now)
+{
+	struct pes_extractor_pid_state_s *ps = &ctx->pidState;
+
+	ps->packetCount++;
+
+	if (ltntstools_isCCInError(pkt, ps->lastCC) && ps->packetCount > 1) {
+		ps->ccErrors++;
+	}
+	ps->lastCC = ltntstools_continuity_counter(pkt);
+
+	/* Measure how long the previous PES took to arrive, between its PUSI and its last packet. */
+	if (ltntstools_payload_unit_start_indicator(pkt)) {
+		if (ps->pusi_time_first.tv_sec && ps->pusi_time_current.tv_sec) {
+			ctx->pusi_time_ms = ltn_timeval_subtract_ms(&ps->pusi_time_current, &ps->pusi_time_first);
+		}
+		ps->pusi_time_first = *now;
+	}
+	ps->pusi_time_current = *now;
+}
+
 ssize_t ltntstools_pes_extractor_write(void *hdl, const uint8_t *pkts, int packetCount)
 {
 	struct pes_extractor_s *ctx = (struct pes_extractor_s *)hdl;
 
 	int didOverflow;
 
+	/* One clock read per write, and only if the buffer contains our pid */
+	struct timeval now;
+	int haveNow = 0;
+
 	if (ctx->preventWrites) {
 		/* Library closing down */
 		return 0; /* Failed */
@@ -461,12 +598,23 @@ ssize_t ltntstools_pes_extractor_write(void *hdl, const uint8_t *pkts, int packe
 	for (int i = 0; i < packetCount; i++) {
 		const uint8_t *pkt = pkts + (i * 188);
 
-		/* Specifically fcall this per packet, not per buffer, for better STC generation.*/
-		ltntstools_pid_stats_update(ctx->libstats, pkt, 1);
+		uint16_t pidnr = ltntstools_pid(pkt);
+
+		/* Specifically update this per packet, not per buffer, for better STC generation.
+		 * When the stats are shared, the owner tracks the STC for us.
+		 */
+		if (ctx->stc.enabled && ctx->libstats == NULL) {
+			_stc_update(ctx, pkt, pidnr);
+		}
 
-		if (ltntstools_pid(pkt) != ctx->pid)
+		if (pidnr != ctx->pid)
 			continue;
 
+		if (!haveNow) {
+			gettimeofday(&now, NULL);
+			haveNow = 1;
+		}
+
 #if SIMULATE_TS_PACKET_LOSS
 		static uint64_t pidcount = 0;
 		if (pidcount++ % 256 == 0) {
@@ -482,7 +630,9 @@ ssize_t ltntstools_pes_extractor_write(void *hdl, const uint8_t *pkts, int packe
 		/* If we see a CC error on the pid we're extracting, restart the statemachine.
 		 * Out rule is, we won't pass malformed PES's downstream to the caller.
 		 */
-		uint64_t c = ltntstools_pid_stats_stream_get_cc_errors(ctx->libstats);
+		_pid_state_update(ctx, pkt, &now);
+
+		uint64_t c = ctx->pidState.ccErrors;
 		if (ctx->lastCCCounter != c) {
 			printf("%s() detected pkt loss on pid 0x%04x had %" PRIu64 " now %" PRIu64 "\n",
 				__func__,
@@ -552,8 +702,10 @@ ssize_t ltntstools_pes_extractor_write(void *hdl, const uint8_t *pkts, int packe
 			ctx->computedRingSize = 0;
 
 			if (1) {
-				int64_t pcr;
-				ltntstools_bitrate_calculator_query_stc(ctx->libstats, &pcr);
+				int64_t pcr = ctx->stc.stc;
+				if (ctx->libstats) {
+					ltntstools_bitrate_calculator_query_stc(ctx->libstats, &pcr);
+				}
 
 				/* The need to put rongpos and pcr on a list might be redundant, during
 				 * testing the ring pos was always zero for any pcr.
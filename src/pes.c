@@ -1,6 +1,7 @@
 #include "libltntstools/pes.h"
 #include "libltntstools/klbitstream_readwriter.h"
 #include <inttypes.h>
+#include <pthread.h>
 
 #include <libltntstools/ltntstools.h>
 
@@ -10,6 +11,22 @@
 #define DISPLAY_I64(indent, fn) printf("%s%s = %" PRIi64 " (0x%" PRIx64 ")\n", indent, #fn, fn, fn);
 #define DISPLAY_U32_SUFFIX(indent, fn, str) printf("%s%s = %d (0x%x) %s\n", indent, #fn, fn, fn, str);
 
+/* Packets and raw buffers recycled by the pes extractors. The pool lives until its owner
+ * has released it and every packet it handed out has come back.
+ */
+struct ltn_pes_packet_pool_s
+{
+	pthread_mutex_t mutex;
+	struct ltn_pes_packet_s **cache; /* LIFO of idle packets, most recently used (cache warm) on top */
+	uint32_t cacheCount;
+	uint32_t maxCached;
+	uint32_t outstanding;            /* Packets handed out and not yet returned */
+	int released;                    /* Owner has called ltn_pes_packet_pool_free() */
+};
+
+/* Raw buffers grow in 64KB steps, so a pool settles quickly on the streams largest PES. */
+#define PES_POOL_BUFFER_ROUNDING (64 * 1024)
+
 struct ltn_pes_packet_s *ltn_pes_packet_alloc()
 {
 	struct ltn_pes_packet_s *pkt = calloc(1, sizeof(*pkt));
@@ -18,30 +35,163 @@ struct ltn_pes_packet_s *ltn_pes_packet_alloc()
 
 void ltn_pes_packet_init(struct ltn_pes_packet_s *pkt)
 {
+	if (pkt->data && !pkt->dataIsReference) {
+		free(pkt->data);
+	}
+
+	if (pkt->pool) {
+		/* Pooled packets keep their raw buffer and pool membership */
+		struct ltn_pes_packet_pool_s *pool = pkt->pool;
+		unsigned char *rawBuffer = pkt->rawBuffer;
+		uint32_t capacity = pkt->rawBufferCapacityBytes;
+
+		memset(pkt, 0, sizeof(*pkt));
+		pkt->pool = pool;
+		pkt->rawBuffer = rawBuffer;
+		pkt->rawBufferCapacityBytes = capacity;
+		return;
+	}
+
 	if (pkt->rawBuffer) {
 		free(pkt->rawBuffer);
 	}
-	if (pkt->data) {
-		free(pkt->data);
-	}
 	memset(pkt, 0, sizeof(*pkt));
 }
 
-void ltn_pes_packet_free(struct ltn_pes_packet_s *pkt)
+static void _pes_packet_destroy(struct ltn_pes_packet_s *pkt)
 {
 	if (pkt->rawBuffer) {
 		free(pkt->rawBuffer);
 		pkt->rawBuffer = NULL;
 		pkt->rawBufferLengthBytes = 0;
 	}
-	if (pkt->data) {
+	if (pkt->data && !pkt->dataIsReference) {
 		free(pkt->data);
-		pkt->data = NULL;
-		pkt->dataLengthBytes = 0;
 	}
+	pkt->data = NULL;
+	pkt->dataLengthBytes = 0;
 	free(pkt);
 }
 
+static void _pes_packet_pool_destroy(struct ltn_pes_packet_pool_s *pool)
+{
+	for (uint32_t i = 0; i < pool->cacheCount; i++) {
+		_pes_packet_destroy(pool->cache[i]);
+	}
+	pthread_mutex_destroy(&pool->mutex);
+	free(pool->cache);
+	free(pool);
+}
+
+static void _pes_packet_pool_put(struct ltn_pes_packet_s *pkt)
+{
+	struct ltn_pes_packet_pool_s *pool = pkt->pool;
+
+	ltn_pes_packet_init(pkt);
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->outstanding--;
+	if (!pool->released && pool->cacheCount < pool->maxCached) {
+		pool->cache[pool->cacheCount++] = pkt;
+		pkt = NULL;
+	}
+	int destroy = pool->released && pool->outstanding == 0;
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (pkt) {
+		_pes_packet_destroy(pkt);
+	}
+	if (destroy) {
+		_pes_packet_pool_destroy(pool);
+	}
+}
+
+void ltn_pes_packet_free(struct ltn_pes_packet_s *pkt)
+{
+	if (pkt->pool) {
+		_pes_packet_pool_put(pkt);
+		return;
+	}
+
+	_pes_packet_destroy(pkt);
+}
+
+struct ltn_pes_packet_pool_s *ltn_pes_packet_pool_alloc(uint32_t maxCached)
+{
+	struct ltn_pes_packet_pool_s *pool = calloc(1, sizeof(*pool));
+	if (!pool) {
+		return NULL;
+	}
+
+	pool->maxCached = maxCached;
+	if (maxCached) {
+		pool->cache = calloc(maxCached, sizeof(*pool->cache));
+		if (!pool->cache) {
+			free(pool);
+			return NULL;
+		}
+	}
+	pthread_mutex_init(&pool->mutex, NULL);
+
+	return pool;
+}
+
+void ltn_pes_packet_pool_free(struct ltn_pes_packet_pool_s *pool)
+{
+	if (!pool) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->released = 1;
+	int destroy = pool->outstanding == 0;
+	pthread_mutex_unlock(&pool->mutex);
+
+	/* Otherwise, the last packet returned tears the pool down */
+	if (destroy) {
+		_pes_packet_pool_destroy(pool);
+	}
+}
+
+struct ltn_pes_packet_s *ltn_pes_packet_pool_get(struct ltn_pes_packet_pool_s *pool, uint32_t lengthBytes)
+{
+	struct ltn_pes_packet_s *pkt = NULL;
+
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->cacheCount) {
+		pkt = pool->cache[--pool->cacheCount];
+	}
+	pool->outstanding++;
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (!pkt) {
+		pkt = ltn_pes_packet_alloc();
+		if (!pkt) {
+			goto failed;
+		}
+		pkt->pool = pool;
+	}
+
+	if (pkt->rawBufferCapacityBytes < lengthBytes) {
+		uint32_t capacity = (lengthBytes + PES_POOL_BUFFER_ROUNDING - 1) & ~(PES_POOL_BUFFER_ROUNDING - 1);
+		unsigned char *buf = realloc(pkt->rawBuffer, capacity);
+		if (!buf) {
+			ltn_pes_packet_free(pkt); /* Back to the pool, with its original buffer */
+			return NULL;
+		}
+		pkt->rawBuffer = buf;
+		pkt->rawBufferCapacityBytes = capacity;
+	}
+
+	return pkt;
+
+failed:
+	pthread_mutex_lock(&pool->mutex);
+	pool->outstanding--;
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
 static void write33bit_ts(struct klbs_context_s *bs, int64_t value)
 {
 	klbs_write_bits(bs, value >> 30, 3);
@@ -225,6 +375,27 @@ ssize_t ltn_pes_packet_pack(struct ltn_pes_packet_s *pkt, struct klbs_context_s
 	return bits;
 }
 
+/* Attach lengthBytes of payload at the current bitstream position to the packet.
+ * When we're parsing a packets own rawBuffer, reference it in place instead of copying.
+ */
+static unsigned char *_pes_packet_payload(struct ltn_pes_packet_s *pkt, struct klbs_context_s *bs, uint32_t lengthBytes, ssize_t *bits)
+{
+	if (pkt->rawBuffer && bs->buf == pkt->rawBuffer && bs->reg_used == 0 && lengthBytes <= klbs_get_byte_count_free(bs)) {
+		unsigned char *data = bs->buf + bs->buflen_used;
+		bs->buflen_used += lengthBytes;
+		*bits += lengthBytes * 8;
+		pkt->dataIsReference = 1;
+		return data;
+	}
+
+	unsigned char *data = malloc(lengthBytes);
+	if (data) {
+		klbs_read_bytes(bs, data, lengthBytes);
+		*bits += lengthBytes * 8;
+	}
+	return data;
+}
+
 ssize_t ltn_pes_packet_parse(struct ltn_pes_packet_s *pkt, struct klbs_context_s *bs, int skipData)
 {
 	ssize_t bits = 0;
@@ -442,19 +613,8 @@ ssize_t ltn_pes_packet_parse(struct ltn_pes_packet_s *pkt, struct klbs_context_s
 			}
 
 			/* Handle data */
-			pkt->data = malloc(pkt->dataLengthBytes);
-			if (pkt->data) {
-				if (bs->reg_used == 0 && pkt->dataLengthBytes <= klbs_get_byte_count_free(bs)) {
-					memcpy(pkt->data, bs->buf + bs->buflen_used, pkt->dataLengthBytes);
-					bs->buflen_used += pkt->dataLengthBytes;
-					bits += pkt->dataLengthBytes * 8;
-				} else {
-					for (int i = 0; i < pkt->dataLengthBytes; i++) {
-						*(pkt->data + i) = klbs_read_bits(bs, 8);
-						bits += 8;
-					}
-				}
-			} else {
+			pkt->data = _pes_packet_payload(pkt, bs, pkt->dataLengthBytes, &bits);
+			if (!pkt->data) {
 				pkt->dataLengthBytes = 0;
 			}
 		}
@@ -487,19 +647,8 @@ ssize_t ltn_pes_packet_parse(struct ltn_pes_packet_s *pkt, struct klbs_context_s
 			return bits;
 #endif
 		}
-		pkt->data = malloc(pkt->PES_packet_length);
-		if (pkt->data) {
-			if (bs->reg_used == 0 && pkt->PES_packet_length <= klbs_get_byte_count_free(bs)) {
-				memcpy(pkt->data, bs->buf + bs->buflen_used, pkt->PES_packet_length);
-				bs->buflen_used += pkt->PES_packet_length;
-				bits += pkt->PES_packet_length * 8;
-			} else {
-				for (int i = 0; i < pkt->PES_packet_length; i++) {
-					*(pkt->data + i) = klbs_read_bits(bs, 8); /* PES_packet_data_byte */
-					bits += 8;
-				}
-			}
-		} else {
+		pkt->data = _pes_packet_payload(pkt, bs, pkt->PES_packet_length, &bits); /* PES_packet_data_byte */
+		if (!pkt->data) {
 			pkt->dataLengthBytes = 0;
 		}
 	} else if (pkt->stream_id == 0xBE /* padding_stream */) {
@@ -612,6 +761,12 @@ void ltn_pes_packet_dump(struct ltn_pes_packet_s *pkt, const char *indent)
 void ltn_pes_packet_copy(struct ltn_pes_packet_s *dst, struct ltn_pes_packet_s *src)
 {
 	memcpy(dst, src, sizeof(*src));
+
+	/* Copies are always regular, independent heap packets */
+	dst->pool = NULL;
+	dst->rawBufferCapacityBytes = 0;
+	dst->dataIsReference = 0;
+
 	if (src->data) {
 		dst->data = malloc(src->dataLengthBytes);
 		memcpy(dst->data, src->data, src->dataLengthBytes);
@@ -0,0 +1,692 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "libltntstools/ltntstools.h"
+
+/* A model is one allocation: the model, the program array, every stream array, then the
+ * descriptor bytes. The structures come first so they stay naturally aligned.
+ */
+struct psi_builder_s
+{
+	uint8_t *base;
+	size_t structOffset;
+	size_t byteOffset;
+};
+
+static int _descriptor_list_bytes(const struct ltntstools_descriptor_list_s *list)
+{
+	int bytes = 0;
+	for (int i = 0; i < list->count; i++) {
+		bytes += 2 + list->array[i].len;
+	}
+	return bytes;
+}
+
+static void *_builder_structs(struct psi_builder_s *b, size_t bytes)
+{
+	void *p = b->base + b->structOffset;
+	b->structOffset += bytes;
+	return p;
+}
+
+static void _builder_descriptors(struct psi_builder_s *b, struct ltntstools_descriptor_loop_s *loop,
+	const struct ltntstools_descriptor_list_s *list)
+{
+	uint8_t *p = b->base + b->byteOffset;
+
+	loop->count = list->count;
+	loop->lengthBytes = 0;
+	loop->data = p;
+
+	for (int i = 0; i < list->count; i++) {
+		const struct ltntstools_descriptor_entry_s *d = &list->array[i];
+		p[loop->lengthBytes++] = d->tag;
+		p[loop->lengthBytes++] = d->len;
+		memcpy(&p[loop->lengthBytes], d->data, d->len);
+		loop->lengthBytes += d->len;
+	}
+
+	b->byteOffset += loop->lengthBytes;
+}
+
+const struct ltntstools_psi_model_s *ltntstools_psi_model_alloc_from_pat(const struct ltntstools_pat_s *pat)
+{
+	if (!pat)
+		return NULL;
+
+	/* Size everything first, then a single allocation */
+	size_t structBytes = sizeof(struct ltntstools_psi_model_s);
+	size_t descrBytes = _descriptor_list_bytes(&pat->descr_list);
+
+	structBytes += pat->program_count * sizeof(struct ltntstools_psi_program_s);
+	for (int i = 0; i < pat->program_count; i++) {
+		const struct ltntstools_pmt_s *pmt = &pat->programs[i].pmt;
+
+		structBytes += pmt->stream_count * sizeof(struct ltntstools_psi_stream_s);
+		descrBytes += _descriptor_list_bytes(&pmt->descr_list);
+		for (int j = 0; j < pmt->stream_count; j++) {
+			descrBytes += _descriptor_list_bytes(&pmt->streams[j].descr_list);
+		}
+	}
+
+	struct psi_builder_s b;
+	b.base = calloc(1, structBytes + descrBytes);
+	if (!b.base)
+		return NULL;
+	b.structOffset = 0;
+	b.byteOffset = structBytes;
+
+	struct ltntstools_psi_model_s *m = _builder_structs(&b, sizeof(*m));
+	m->refCount = 1;
+	m->sizeBytes = structBytes + descrBytes;
+	m->transport_stream_id = pat->transport_stream_id;
+	m->version_number = pat->version_number;
+	m->current_next_indicator = pat->current_next_indicator;
+	_builder_descriptors(&b, &m->descr, &pat->descr_list);
+
+	struct ltntstools_psi_program_s *programs = _builder_structs(&b, pat->program_count * sizeof(*programs));
+	m->program_count = pat->program_count;
+	m->programs = programs;
+
+	for (int i = 0; i < pat->program_count; i++) {
+		const struct ltntstools_pat_program_s *src = &pat->programs[i];
+		struct ltntstools_psi_program_s *dst = &programs[i];
+
+		dst->program_number = src->program_number;
+		dst->program_map_PID = src->program_map_PID;
+		dst->has_pmt = src->program_number && src->pmt.program_number == src->program_number;
+		dst->version_number = src->pmt.version_number;
+		dst->current_next_indicator = src->pmt.current_next_indicator;
+		dst->PCR_PID = src->pmt.PCR_PID;
+		_builder_descriptors(&b, &dst->descr, &src->pmt.descr_list);
+
+		dst->service_id = src->service_id;
+		dst->service_type = src->service_type;
+		memcpy(dst->service_name, src->service_name, sizeof(dst->service_name));
+		memcpy(dst->service_provider, src->service_provider, sizeof(dst->service_provider));
+
+		struct ltntstools_psi_stream_s *streams = _builder_structs(&b, src->pmt.stream_count * sizeof(*streams));
+		dst->stream_count = src->pmt.stream_count;
+		dst->streams = streams;
+
+		for (int j = 0; j < src->pmt.stream_count; j++) {
+			streams[j].stream_type = src->pmt.streams[j].stream_type;
+			streams[j].elementary_PID = src->pmt.streams[j].elementary_PID;
+			_builder_descriptors(&b, &streams[j].descr, &src->pmt.streams[j].descr_list);
+		}
+	}
+
+	return m;
+}
+
+struct ltntstools_pat_s *ltntstools_psi_model_to_pat(const struct ltntstools_psi_model_s *model)
+{
+	if (!model)
+		return NULL;
+
+	struct ltntstools_pat_s *pat = ltntstools_pat_alloc();
+	if (!pat)
+		return NULL;
+
+	pat->transport_stream_id = model->transport_stream_id;
+	pat->version_number = model->version_number;
+	pat->current_next_indicator = model->current_next_indicator;
+	ltntstools_descriptor_loop_to_list(&model->descr, &pat->descr_list);
+
+	for (int i = 0; i < model->program_count && pat->program_count < LTNTSTOOLS_PAT_ENTRIES_MAX; i++) {
+		const struct ltntstools_psi_program_s *src = &model->programs[i];
+		struct ltntstools_pat_program_s *dst = &pat->programs[pat->program_count++];
+
+		dst->program_number = src->program_number;
+		dst->program_map_PID = src->program_map_PID;
+		dst->service_id = src->service_id;
+		dst->service_type = src->service_type;
+		memcpy(dst->service_name, src->service_name, sizeof(dst->service_name));
+		memcpy(dst->service_provider, src->service_provider, sizeof(dst->service_provider));
+
+		struct ltntstools_pmt_s *pmt = &dst->pmt;
+		pmt->program_number = src->has_pmt ? src->program_number : 0;
+		pmt->version_number = src->version_number;
+		pmt->current_next_indicator = src->current_next_indicator;
+		pmt->PCR_PID = src->PCR_PID;
+		ltntstools_descriptor_loop_to_list(&src->descr, &pmt->descr_list);
+
+		for (int j = 0; j < src->stream_count && pmt->stream_count < LTNTSTOOLS_PMT_ENTRIES_MAX; j++) {
+			struct ltntstools_pmt_entry_s *es = &pmt->streams[pmt->stream_count++];
+			es->stream_type = src->streams[j].stream_type;
+			es->elementary_PID = src->streams[j].elementary_PID;
+			ltntstools_descriptor_loop_to_list(&src->streams[j].descr, &es->descr_list);
+		}
+	}
+
+	return pat;
+}
+
+const struct ltntstools_psi_model_s *ltntstools_psi_model_ref(const struct ltntstools_psi_model_s *model)
+{
+	if (model) {
+		__atomic_add_fetch(&((struct ltntstools_psi_model_s *)model)->refCount, 1, __ATOMIC_RELAXED);
+	}
+	return model;
+}
+
+void ltntstools_psi_model_unref(const struct ltntstools_psi_model_s *model)
+{
+	if (!model)
+		return;
+
+	if (__atomic_sub_fetch(&((struct ltntstools_psi_model_s *)model)->refCount, 1, __ATOMIC_ACQ_REL) == 0) {
+		free((void *)model);
+	}
+}
+
+size_t ltntstools_psi_model_get_size(const struct ltntstools_psi_model_s *model)
+{
+	return model ? model->sizeBytes : 0;
+}
+
+int ltntstools_psi_model_compare(const struct ltntstools_psi_model_s *a, const struct ltntstools_psi_model_s *b)
+{
+	if (!a || !b)
+		return -1;
+	if (a == b)
+		return 0; /* Identical */
+
+	if (a->transport_stream_id != b->transport_stream_id)
+		return -1;
+	if (a->version_number != b->version_number)
+		return -1;
+	if (a->current_next_indicator != b->current_next_indicator)
+		return -1;
+	if (a->program_count != b->program_count)
+		return -1;
+
+	for (int i = 0; i < a->program_count; i++) {
+		const struct ltntstools_psi_program_s *pa = &a->programs[i];
+		const struct ltntstools_psi_program_s *pb = &b->programs[i];
+
+		if (pa->program_number != pb->program_number)
+			return -1;
+		if (pa->program_map_PID != pb->program_map_PID)
+			return -1;
+		if (pa->has_pmt != pb->has_pmt)
+			return -1;
+		if (pa->version_number != pb->version_number)
+			return -1;
+		if (pa->PCR_PID != pb->PCR_PID)
+			return -1;
+		if (pa->current_next_indicator != pb->current_next_indicator)
+			return -1;
+		if (pa->stream_count != pb->stream_count)
+			return -1;
+
+		for (int j = 0; j < pa->stream_count; j++) {
+			if (pa->streams[j].stream_type != pb->streams[j].stream_type)
+				return -1;
+			if (pa->streams[j].elementary_PID != pb->streams[j].elementary_PID)
+				return -1;
+		}
+	}
+
+	return 0; /* Identical */
+}
+
+struct psi_diff_s
+{
+	struct ltntstools_psi_change_s *array;
+	int count;
+	int allocated;
+	int error;
+};
+
+static void _diff_add(struct psi_diff_s *d, enum ltntstools_psi_change_e type,
+	const struct ltntstools_psi_program_s *pa, const struct ltntstools_psi_program_s *pb,
+	const struct ltntstools_psi_stream_s *sa, const struct ltntstools_psi_stream_s *sb)
+{
+	if (d->count == d->allocated) {
+		int allocated = d->allocated ? d->allocated * 2 : 8;
+		struct ltntstools_psi_change_s *array = realloc(d->array, allocated * sizeof(*array));
+		if (!array) {
+			d->error = 1;
+			return;
+		}
+		d->array = array;
+		d->allocated = allocated;
+	}
+
+	const struct ltntstools_psi_program_s *p = pb ? pb : pa;
+
+	struct ltntstools_psi_change_s *c = &d->array[d->count++];
+	c->type = type;
+	c->program_number = p ? p->program_number : 0;
+	c->pid = sb ? sb->elementary_PID : sa ? sa->elementary_PID : p ? p->program_map_PID : 0;
+	c->programOld = pa;
+	c->programNew = pb;
+	c->streamOld = sa;
+	c->streamNew = sb;
+}
+
+static int _descriptor_loop_compare(const struct ltntstools_descriptor_loop_s *a, const struct ltntstools_descriptor_loop_s *b)
+{
+	if (a->lengthBytes != b->lengthBytes)
+		return -1;
+	if (a->lengthBytes && memcmp(a->data, b->data, a->lengthBytes) != 0)
+		return -1;
+
+	return 0; /* Identical */
+}
+
+static const struct ltntstools_psi_program_s *_find_program(const struct ltntstools_psi_model_s *model, uint32_t program_number)
+{
+	for (int i = 0; model && i < model->program_count; i++) {
+		if (model->programs[i].program_number == program_number)
+			return &model->programs[i];
+	}
+
+	return NULL;
+}
+
+static const struct ltntstools_psi_stream_s *_find_stream(const struct ltntstools_psi_program_s *program, uint32_t pid)
+{
+	for (int i = 0; i < program->stream_count; i++) {
+		if (program->streams[i].elementary_PID == pid)
+			return &program->streams[i];
+	}
+
+	return NULL;
+}
+
+static void _diff_program(struct psi_diff_s *d, const struct ltntstools_psi_program_s *pa, const struct ltntstools_psi_program_s *pb)
+{
+	if (pa->program_map_PID != pb->program_map_PID)
+		_diff_add(d, LTNTSTOOLS_PSI_CHANGE_PROGRAM_PMT_PID, pa, pb, NULL, NULL);
+	if (pa->PCR_PID != pb->PCR_PID)
+		_diff_add(d, LTNTSTOOLS_PSI_CHANGE_PROGRAM_PCR_PID, pa, pb, NULL, NULL);
+	if (_descriptor_loop_compare(&pa->descr, &pb->descr) < 0)
+		_diff_add(d, LTNTSTOOLS_PSI_CHANGE_PROGRAM_DESCRIPTORS, pa, pb, NULL, NULL);
+
+	for (int i = 0; i < pa->stream_count; i++) {
+		const struct ltntstools_psi_stream_s *sa = &pa->streams[i];
+		const struct ltntstools_psi_stream_s *sb = _find_stream(pb, sa->elementary_PID);
+		if (!sb) {
+			_diff_add(d, LTNTSTOOLS_PSI_CHANGE_STREAM_REMOVED, pa, pb, sa, NULL);
+			continue;
+		}
+
+		if (sa->stream_type != sb->stream_type)
+			_diff_add(d, LTNTSTOOLS_PSI_CHANGE_STREAM_TYPE, pa, pb, sa, sb);
+		if (_descriptor_loop_compare(&sa->descr, &sb->descr) < 0)
+			_diff_add(d, LTNTSTOOLS_PSI_CHANGE_STREAM_DESCRIPTORS, pa, pb, sa, sb);
+	}
+
+	for (int i = 0; i < pb->stream_count; i++) {
+		const struct ltntstools_psi_stream_s *sb = &pb->streams[i];
+		if (!_find_stream(pa, sb->elementary_PID))
+			_diff_add(d, LTNTSTOOLS_PSI_CHANGE_STREAM_ADDED, pa, pb, NULL, sb);
+	}
+}
+
+int ltntstools_psi_model_diff(const struct ltntstools_psi_model_s *a, const struct ltntstools_psi_model_s *b,
+	struct ltntstools_psi_change_s **changes, int *changeCount)
+{
+	if (!b || !changes || !changeCount)
+		return -1;
+
+	struct psi_diff_s d;
+	memset(&d, 0, sizeof(d));
+
+	if (a && a != b) {
+		if (a->transport_stream_id != b->transport_stream_id)
+			_diff_add(&d, LTNTSTOOLS_PSI_CHANGE_TRANSPORT_STREAM_ID, NULL, NULL, NULL, NULL);
+
+		for (int i = 0; i < a->program_count; i++) {
+			const struct ltntstools_psi_program_s *pa = &a->programs[i];
+			const struct ltntstools_psi_program_s *pb = _find_program(b, pa->program_number);
+			if (pb)
+				_diff_program(&d, pa, pb);
+			else
+				_diff_add(&d, LTNTSTOOLS_PSI_CHANGE_PROGRAM_REMOVED, pa, NULL, NULL, NULL);
+		}
+	}
+
+	if (a != b) {
+		for (int i = 0; i < b->program_count; i++) {
+			const struct ltntstools_psi_program_s *pb = &b->programs[i];
+			if (!_find_program(a, pb->program_number))
+				_diff_add(&d, LTNTSTOOLS_PSI_CHANGE_PROGRAM_ADDED, NULL, pb, NULL, NULL);
+		}
+	}
+
+	if (d.error) {
+		free(d.array);
+		return -1;
+	}
+
+	*changes = d.array;
+	*changeCount = d.count;
+
+	return 0;
+}
+
+static void _dprintf_descriptors(int fd, const char *prefix, const struct ltntstools_descriptor_loop_s *loop)
+{
+	int offset = 0, nr = 0;
+	uint8_t tag, len;
+	const uint8_t *data;
+
+	while (ltntstools_descriptor_loop_next(loop, &offset, &tag, &len, &data) == 0) {
+		dprintf(fd, "%s.descr[%d].tag = 0x%02x  len %02x : ", prefix, nr++, tag, len);
+		for (int z = 0; z < len; z++)
+			dprintf(fd, "%02x ", data[z]);
+		dprintf(fd, "  [");
+		for (int z = 0; z < len; z++)
+			dprintf(fd, "%c", isprint(data[z]) ? data[z] : '.');
+		dprintf(fd, "]\n");
+	}
+}
+
+void ltntstools_psi_model_dprintf(const struct ltntstools_psi_model_s *model, int fd)
+{
+	dprintf(fd, "pat.transport_stream_id = 0x%x\n", model->transport_stream_id);
+	dprintf(fd, "pat.version_number = 0x%02x\n", model->version_number);
+	dprintf(fd, "pat.current_next_indicator = %d\n", model->current_next_indicator);
+	dprintf(fd, "pat.program_count = %d\n", model->program_count);
+	for (int i = 0; i < model->program_count; i++) {
+		const struct ltntstools_psi_program_s *p = &model->programs[i];
+
+		dprintf(fd, "\tpat.entry[%d].program_number = %d\n", i, p->program_number);
+		dprintf(fd, "\tpat.entry[%d].program_map_PID = 0x%04x\n", i, p->program_map_PID);
+
+		if (p->service_id == 0) {
+			dprintf(fd, "\tsdt.service_id       = n/a\n");
+			dprintf(fd, "\tsdt.service_type     = n/a\n");
+			dprintf(fd, "\tsdt.service_name     = n/a\n");
+			dprintf(fd, "\tsdt.service_provider = n/a\n");
+		} else {
+			dprintf(fd, "\tsdt.service_id       = 0x%04x\n", p->service_id);
+			dprintf(fd, "\tsdt.service_type     = 0x%02x\n", p->service_type);
+			dprintf(fd, "\tsdt.service_name     = %.32s\n", p->service_name);
+			dprintf(fd, "\tsdt.service_provider = %.32s\n", p->service_provider);
+		}
+
+		dprintf(fd, "\tpat.entry[%d].pmt\n", i);
+		dprintf(fd, "\t\tpmt.version_number = 0x%02x\n", p->version_number);
+		dprintf(fd, "\t\tpmt.program_number = %d\n", p->has_pmt ? p->program_number : 0);
+		dprintf(fd, "\t\tpmt.current_next_indicator = %d\n", p->current_next_indicator);
+		dprintf(fd, "\t\tpmt.PCR_PID = 0x%04x\n", p->PCR_PID);
+		dprintf(fd, "\t\tpmt.descriptor_count = %d\n", p->descr.count);
+		_dprintf_descriptors(fd, "\t\t\tpmt", &p->descr);
+
+		dprintf(fd, "\t\tpmt.stream_count = %d\n", p->stream_count);
+		for (int j = 0; j < p->stream_count; j++) {
+			const struct ltntstools_psi_stream_s *s = &p->streams[j];
+			char prefix[32];
+
+			dprintf(fd, "\t\t\tpmt.entry[%d].elementary_PID = 0x%04x\n", j, s->elementary_PID);
+			dprintf(fd, "\t\t\tpmt.entry[%d].stream_type = 0x%02x\n", j, s->stream_type);
+			dprintf(fd, "\t\t\tpmt.entry[%d].descriptor_count = %d\n", j, s->descr.count);
+			snprintf(prefix, sizeof(prefix), "\t\t\t\tpmt.entry[%d]", j);
+			_dprintf_descriptors(fd, prefix, &s->descr);
+		}
+	}
+}
+
+int ltntstools_psi_model_enum_services(const struct ltntstools_psi_model_s *model, int *e, uint16_t pid,
+	const struct ltntstools_psi_program_s **program)
+{
+	if (!model || !e || !program)
+		return -1;
+
+	while (*e < model->program_count) {
+		const struct ltntstools_psi_program_s *p = &model->programs[(*e)++];
+		if (p->program_map_PID == pid) {
+			*program = p;
+			return 0; /* Success */
+		}
+	}
+
+	return -1; /* Failed */
+}
+
+int ltntstools_psi_model_enum_services_video(const struct ltntstools_psi_model_s *model, int *e,
+	const struct ltntstools_psi_program_s **program)
+{
+	if (!model || !e || !program)
+		return -1;
+
+	while (*e < model->program_count) {
+		const struct ltntstools_psi_program_s *p = &model->programs[(*e)++];
+		for (int j = 0; j < p->stream_count; j++) {
+			if (ltntstools_is_ESPayloadType_Video(p->streams[j].stream_type)) {
+				*program = p;
+				return 0; /* Success */
+			}
+		}
+	}
+
+	return -1; /* Failed */
+}
+
+int ltntstools_psi_model_enum_services_audio(const struct ltntstools_psi_model_s *model, int *e,
+	const struct ltntstools_psi_program_s **program, uint32_t **stream_type_array, uint16_t **pid_array, int *pid_count)
+{
+	if (!model || !e || !program || !stream_type_array || !pid_array || !pid_count)
+		return -1;
+
+	*program = NULL;
+	*stream_type_array = NULL;
+	*pid_array = NULL;
+	*pid_count = 0;
+
+	while (*e < model->program_count) {
+		const struct ltntstools_psi_program_s *p = &model->programs[(*e)++];
+
+		int count = 0;
+		for (int j = 0; j < p->stream_count; j++) {
+			if (ltntstools_psi_stream_is_audio(&p->streams[j]))
+				count++;
+		}
+		if (count == 0)
+			continue;
+
+		*pid_array = malloc(count * sizeof(uint16_t));
+		*stream_type_array = malloc(count * sizeof(uint32_t));
+		if (!*pid_array || !*stream_type_array) {
+			free(*pid_array);
+			free(*stream_type_array);
+			*pid_array = NULL;
+			*stream_type_array = NULL;
+			return -1; /* Memory allocation failure */
+		}
+
+		for (int j = 0; j < p->stream_count; j++) {
+			if (ltntstools_psi_stream_is_audio(&p->streams[j])) {
+				(*pid_array)[*pid_count] = p->streams[j].elementary_PID;
+				(*stream_type_array)[*pid_count] = p->streams[j].stream_type;
+				(*pid_count)++;
+			}
+		}
+
+		*program = p;
+		return 0; /* Success */
+	}
+
+	return -1; /* Failed */
+}
+
+int ltntstools_psi_model_enum_services_scte35(const struct ltntstools_psi_model_s *model, int *e,
+	const struct ltntstools_psi_program_s **program, uint16_t **pid_array, int *pid_count)
+{
+	if (!model || !e || !program || !pid_array || !pid_count)
+		return -1;
+
+	*program = NULL;
+	*pid_array = NULL;
+	*pid_count = 0;
+
+	while (*e < model->program_count) {
+		const struct ltntstools_psi_program_s *p = &model->programs[(*e)++];
+
+		if (ltntstools_descriptor_loop_contains_scte35_cue_registration(&p->descr) == 0)
+			continue;
+
+		int count = 0;
+		for (int j = 0; j < p->stream_count; j++) {
+			if (p->streams[j].stream_type == 0x86)
+				count++;
+		}
+		if (count == 0)
+			continue;
+
+		*pid_array = malloc(count * sizeof(uint16_t));
+		if (!*pid_array)
+			return -1; /* Memory allocation failure */
+
+		for (int j = 0; j < p->stream_count; j++) {
+			if (p->streams[j].stream_type == 0x86) {
+				(*pid_array)[(*pid_count)++] = p->streams[j].elementary_PID;
+			}
+		}
+
+		*program = p;
+		return 0; /* Success */
+	}
+
+	return -1; /* Failed */
+}
+
+int ltntstools_psi_model_enum_services_smpte2038(const struct ltntstools_psi_model_s *model, int *e,
+	const struct ltntstools_psi_program_s **program, uint16_t *pid)
+{
+	if (!model || !e || !program || !pid)
+		return -1;
+
+	*program = NULL;
+	*pid = 0;
+
+	while (*e < model->program_count) {
+		const struct ltntstools_psi_program_s *p = &model->programs[(*e)++];
+
+		if (p->program_number == 0)
+			continue;
+
+		for (int j = 0; j < p->stream_count; j++) {
+			const struct ltntstools_psi_stream_s *s = &p->streams[j];
+
+			if (s->stream_type != 0x06)
+				continue;
+			if (ltntstools_descriptor_loop_contains_smpte2038_registration(&s->descr) == 0)
+				continue;
+
+			*pid = s->elementary_PID;
+			*program = p;
+			return 0; /* Success */
+		}
+	}
+
+	return -1; /* Failed */
+}
+
+int ltntstools_psi_model_enum_services_teletext(const struct ltntstools_psi_model_s *model, int *e,
+	const struct ltntstools_psi_program_s **program)
+{
+	if (!model || !e || !program)
+		return -1;
+
+	while (*e < model->program_count) {
+		const struct ltntstools_psi_program_s *p = &model->programs[(*e)++];
+		for (int j = 0; j < p->stream_count; j++) {
+			if (ltntstools_descriptor_loop_contains_teletext(&p->streams[j].descr)) {
+				*program = p;
+				return 0; /* Success */
+			}
+		}
+	}
+
+	return -1; /* Failed */
+}
+
+int ltntstools_psi_program_query_video_pid(const struct ltntstools_psi_program_s *program, uint16_t *pid, uint8_t *estype)
+{
+	if (!program || !pid || !estype)
+		return -1;
+
+	for (int j = 0; j < program->stream_count; j++) {
+		if (ltntstools_is_ESPayloadType_Video(program->streams[j].stream_type)) {
+			*pid = program->streams[j].elementary_PID;
+			*estype = program->streams[j].stream_type;
+
+			return 0; /* Success */
+		}
+	}
+
+	return -1; /* Failed */
+}
+
+int ltntstools_psi_stream_is_audio(const struct ltntstools_psi_stream_s *stream)
+{
+	if (ltntstools_is_ESPayloadType_Audio(stream->stream_type)) {
+		return 1;
+	}
+	if (stream->stream_type != 0x06) { /* 13818-1 PES private data */
+		return 0;
+	}
+
+	int offset = 0;
+	uint8_t tag, len;
+	const uint8_t *data;
+	while (ltntstools_descriptor_loop_next(&stream->descr, &offset, &tag, &len, &data) == 0) {
+		switch (tag) {
+			/* MPEG descriptors */
+			case 0x03: /* Audio stream descriptor */
+			case 0x1c: /* MPEG-4 audio descriptor */
+			case 0x2b: /* MPEG-2 AAC audio descriptor */
+
+			/* DVB descriptors */
+			case 0x6a: /* AC-3 descriptor */
+			case 0x7a: /* Enhanced AC-3 descriptor */
+			case 0x7c: /* AAC descriptor */
+
+			return tag;
+		}
+	}
+
+	return 0;
+}
+
+int ltntstools_psi_model_is_mpts(const struct ltntstools_psi_model_s *model)
+{
+	int validServices = 0;
+	for (int i = 0; model && i < model->program_count; i++) {
+		if (model->programs[i].program_number == 0)
+			continue;
+		validServices++;
+	}
+
+	return validServices > 1 ? 1 : 0;
+}
+
+int ltntstools_psi_model_query_first_program_pcr_pid(const struct ltntstools_psi_model_s *model, uint16_t *PCRPID)
+{
+	if (!model || !PCRPID)
+		return -1;
+
+	*PCRPID = 0;
+	for (int i = 0; i < model->program_count; i++) {
+		const struct ltntstools_psi_program_s *p = &model->programs[i];
+
+		if (p->program_number == 0)
+			continue; /* Skip the network pid */
+		if (p->stream_count == 0)
+			continue; /* Skip programs with no streams */
+
+		if (p->PCR_PID) {
+			*PCRPID = p->PCR_PID;
+			return 0; /* Success */
+		}
+	}
+
+	return -1; /* Failed */
+}
@@ -58,11 +58,18 @@ int rtp_hdr_is_continious(struct rtp_hdr_analyzer_s *ctx, const struct rtp_hdr *
 
 int rtp_hdr_write(struct rtp_hdr_analyzer_s *ctx, const struct rtp_hdr *hdr)
 {
-	ctx->totalPackets++;
-
 	struct timeval now;
 	gettimeofday(&now, NULL);
-    ltn_histogram_interval_update(ctx->tsArrival, &now);
+
+	return rtp_hdr_write_with_timestamp(ctx, hdr, &now);
+}
+
+int rtp_hdr_write_with_timestamp(struct rtp_hdr_analyzer_s *ctx, const struct rtp_hdr *hdr, const struct timeval *ts)
+{
+	ctx->totalPackets++;
+
+	struct timeval arrival = *ts;
+	ltn_histogram_interval_update(ctx->tsArrival, &arrival);
 
 	/* Push a clock measurement between old and new TS into a histogram */
 	if (ctx->last.ts) {
@@ -13,174 +13,437 @@
 #include "libltntstools/ts.h"
 #include "libltntstools/crc32.h"
 
+/* Recently validated sections per pid. Enough for a PAT, a handful of PMTs
+ * sharing a pid, or SDT and BAT sections cycling on the same pid.
+ */
+#define SECTION_CACHE_ENTRIES 8
+
+struct section_cache_s
+{
+	uint16_t lengthBytes;   /* 0 when unused */
+	uint32_t crc;
+	int      allocated;
+	uint8_t *data;
+};
+
+/* Reassembly state for a single pid. */
+struct section_pid_s
+{
+	int      active;        /* Boolean: A section is in progress */
+	int      skipping;      /* Boolean: The filter declined the section, keep the header and CRC only */
+	uint8_t  lastCC;        /* 0xff until the first packet */
+	uint16_t lengthBytes;   /* Entire section including the header, 0 until the header arrives */
+	uint16_t bytes;         /* Collected (or skipped) so far */
+	uint8_t  data[LTNTSTOOLS_SECTION_MAX_BYTES];
+
+	int      cacheNext;     /* Round robin replacement */
+	struct section_cache_s cache[SECTION_CACHE_ENTRIES];
+
+	struct section_pid_s *nextFree;
+};
+
+struct ltntstools_sectionreassembler_s
+{
+	struct section_pid_s *pids[0x2000];
+	struct section_pid_s *freeList; /* Released by reset, reused by add_pid */
+
+	ltntstools_sectionreassembler_callback cb;
+	ltntstools_sectionreassembler_filter filter;
+	void *userContext;
+};
+
+/* Single table extractor, see ltntstools_sectionextractor_alloc() */
 struct sectionextractor_ctx_s
 {
 	uint8_t tableID;
 	uint16_t PID;
+	void *reassembler;
+
+	/* Results of the current write() call */
 	int complete;
+	int crcValid;
 
-	int appending;
+	/* Last complete section */
+	int available;
 	unsigned char *section;
 	unsigned int sectionLength;
-	unsigned int sectionLengthCurrent;
 };
 
-void ltntstools_sectionextractor_free(void *hdl)
+static void _pid_reset(struct section_pid_s *ps)
 {
-	struct sectionextractor_ctx_s *ctx = (struct sectionextractor_ctx_s *)hdl;
-	if (!ctx)
+	ps->active = 0;
+	ps->lastCC = 0xff;
+	ps->cacheNext = 0;
+	for (int i = 0; i < SECTION_CACHE_ENTRIES; i++) {
+		ps->cache[i].lengthBytes = 0;
+	}
+}
+
+/* A valid section, byte identical to one we've validated before. */
+static int _cache_lookup(struct section_pid_s *ps, const uint8_t *sec, uint16_t lengthBytes, uint32_t crc)
+{
+	for (int i = 0; i < SECTION_CACHE_ENTRIES; i++) {
+		struct section_cache_s *c = &ps->cache[i];
+		if (c->lengthBytes == lengthBytes && c->crc == crc && memcmp(c->data, sec, lengthBytes) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void _cache_insert(struct section_pid_s *ps, const uint8_t *sec, uint16_t lengthBytes, uint32_t crc)
+{
+	struct section_cache_s *c = &ps->cache[ps->cacheNext];
+
+	if (c->allocated < lengthBytes) {
+		uint8_t *data = realloc(c->data, lengthBytes);
+		if (!data)
+			return; /* Not cached, harmless */
+		c->data = data;
+		c->allocated = lengthBytes;
+	}
+
+	memcpy(c->data, sec, lengthBytes);
+	c->lengthBytes = lengthBytes;
+	c->crc = crc;
+
+	ps->cacheNext = (ps->cacheNext + 1) % SECTION_CACHE_ENTRIES;
+}
+
+static void _section_complete(struct ltntstools_sectionreassembler_s *ctx, uint16_t pid, struct section_pid_s *ps)
+{
+	struct ltntstools_section_s s;
+	const uint8_t *crc = &ps->data[ps->lengthBytes - 4];
+
+	s.pid = pid;
+	s.tableId = ps->data[0];
+	s.lengthBytes = ps->lengthBytes;
+	s.header = ps->data;
+	s.data = NULL;
+	s.crc = (uint32_t)crc[0] << 24 | (uint32_t)crc[1] << 16 | (uint32_t)crc[2] << 8 | (uint32_t)crc[3];
+	s.crcValid = 0;
+	s.cached = 0;
+
+	if (!ps->skipping) {
+		s.data = ps->data;
+		if (_cache_lookup(ps, s.data, s.lengthBytes, s.crc)) {
+			s.crcValid = 1;
+			s.cached = 1;
+		} else
+		if (ltntstools_checkCRC32(s.data, s.lengthBytes) == 0) {
+			s.crcValid = 1;
+			_cache_insert(ps, s.data, s.lengthBytes, s.crc);
+		}
+	}
+
+	ctx->cb(ctx->userContext, &s);
+}
+
+/* Collect up to lengthBytes into the section in progress. Returns the number of bytes consumed. */
+static int _section_fill(struct ltntstools_sectionreassembler_s *ctx, uint16_t pid, struct section_pid_s *ps,
+	const uint8_t *p, int lengthBytes)
+{
+	int consumed = 0;
+
+	/* We need the first three bytes for the length, they may straddle packets. */
+	while (ps->bytes < 3 && consumed < lengthBytes) {
+		ps->data[ps->bytes++] = p[consumed++];
+	}
+	if (ps->bytes < 3)
+		return consumed;
+
+	if (ps->lengthBytes == 0) {
+		ps->lengthBytes = 3 + (((ps->data[1] & 0x0f) << 8) | ps->data[2]);
+		if (ps->lengthBytes < 4 || ps->lengthBytes > LTNTSTOOLS_SECTION_MAX_BYTES) {
+			/* Malformed. Nothing else in this packet can be trusted. */
+			ps->active = 0;
+			return lengthBytes;
+		}
+	}
+
+	/* The header is always collected, the filter decides about the rest. */
+	int headerBytes = ps->lengthBytes < 8 ? ps->lengthBytes : 8;
+	if (ps->bytes < headerBytes) {
+		while (ps->bytes < headerBytes && consumed < lengthBytes) {
+			ps->data[ps->bytes++] = p[consumed++];
+		}
+		if (ps->bytes < headerBytes)
+			return consumed;
+
+		if (ctx->filter) {
+			struct ltntstools_section_s s;
+			memset(&s, 0, sizeof(s));
+			s.pid = pid;
+			s.tableId = ps->data[0];
+			s.lengthBytes = ps->lengthBytes;
+			s.header = ps->data;
+			ps->skipping = !ctx->filter(ctx->userContext, &s);
+		}
+	}
+
+	int count = lengthBytes - consumed;
+	if (count > ps->lengthBytes - ps->bytes)
+		count = ps->lengthBytes - ps->bytes;
+
+	if (!ps->skipping) {
+		memcpy(&ps->data[ps->bytes], p + consumed, count);
+	} else {
+		/* Keep the trailing CRC */
+		int from = ps->lengthBytes - 4;
+		if (from < ps->bytes)
+			from = ps->bytes;
+		if (from < ps->bytes + count)
+			memcpy(&ps->data[from], p + consumed + (from - ps->bytes), ps->bytes + count - from);
+	}
+	ps->bytes += count;
+	consumed += count;
+
+	if (ps->bytes == ps->lengthBytes) {
+		ps->active = 0;
+		_section_complete(ctx, pid, ps);
+	}
+
+	return consumed;
+}
+
+static void _write_packet(struct ltntstools_sectionreassembler_s *ctx, struct section_pid_s *ps, const uint8_t *pkt)
+{
+	if (pkt[1] & 0x80)
+		return; /* Transport error */
+	if (pkt[3] & 0xc0)
+		return; /* Sections are never scrambled */
+	if ((pkt[3] & 0x10) == 0)
+		return; /* No payload */
+
+	uint8_t cc = ltntstools_continuity_counter(pkt);
+	if (ps->lastCC != 0xff) {
+		if (cc == ps->lastCC)
+			return; /* Duplicate */
+		if (cc != ((ps->lastCC + 1) & 0x0f))
+			ps->active = 0; /* Discontinuity, the section in progress is lost */
+	}
+	ps->lastCC = cc;
+
+	int offset = 4;
+	if (pkt[3] & 0x20) {
+		offset += 1 + pkt[4];
+	}
+	if (offset >= 188)
 		return;
-	if (ctx->section)
-		free(ctx->section);
-	ctx->section = NULL;
-	free(ctx);
-	ctx = NULL;
+
+	uint16_t pid = ltntstools_pid(pkt);
+	const uint8_t *p = pkt + offset;
+	int remain = 188 - offset;
+
+	if (ltntstools_payload_unit_start_indicator(pkt)) {
+		/* The pointer_field locates the first new section, anything before it ends the previous one. */
+		int pointer = *p++;
+		remain--;
+		if (pointer > remain) {
+			ps->active = 0;
+			return;
+		}
+		if (ps->active) {
+			_section_fill(ctx, pid, ps, p, pointer);
+			ps->active = 0;
+		}
+		p += pointer;
+		remain -= pointer;
+	} else {
+		/* A section continues, without sync there's nothing we can use. */
+		if (!ps->active)
+			return;
+
+		int count = _section_fill(ctx, pid, ps, p, remain);
+		if (ps->active)
+			return;
+
+		/* Some muxers start the next section right behind it, without signalling it. */
+		p += count;
+		remain -= count;
+	}
+
+	/* One or more sections, until stuffing or the end of the packet. */
+	while (remain > 0 && *p != 0xff) {
+		ps->active = 1;
+		ps->skipping = 0;
+		ps->bytes = 0;
+		ps->lengthBytes = 0;
+
+		int count = _section_fill(ctx, pid, ps, p, remain);
+		if (ps->active)
+			break; /* Continues in the next packet */
+
+		p += count;
+		remain -= count;
+	}
 }
 
-int ltntstools_sectionextractor_alloc(void **hdl, uint16_t PID, uint8_t tableID)
+int ltntstools_sectionreassembler_alloc(void **hdl, ltntstools_sectionreassembler_callback cb, void *userContext)
 {
-	struct sectionextractor_ctx_s *ctx = calloc(1, sizeof(*ctx));
+	if (!cb)
+		return -1;
+
+	struct ltntstools_sectionreassembler_s *ctx = calloc(1, sizeof(*ctx));
 	if (!ctx)
 		return -1;
 
-	ctx->tableID = tableID;
-	ctx->PID = PID;
-	ctx->section = malloc(4096);
+	ctx->cb = cb;
+	ctx->userContext = userContext;
+
 	*hdl = ctx;
 	return 0;
 }
 
-static ssize_t ltntstools_sectionextractor_write_packet(struct sectionextractor_ctx_s *ctx,
-	const uint8_t *pkt, int *complete, int *crcValid)
+int ltntstools_sectionreassembler_set_filter(void *hdl, ltntstools_sectionreassembler_filter filter)
 {
-	int section_offset = 4;
-	*crcValid = 0;
+	struct ltntstools_sectionreassembler_s *ctx = (struct ltntstools_sectionreassembler_s *)hdl;
+	if (!ctx)
+		return -1;
 
-	/* Limitations. The entire section has to fit within a single packet. */
+	ctx->filter = filter;
 
-#if 0
-	printf("packet:\n");
-	for (int i = 1; i <= 188; i++) {
-		printf("%02x ", *(pkt + i - 1));
-		if (i % 16 == 0)
-			printf("\n");
+	return 0;
+}
+
+int ltntstools_sectionreassembler_add_pid(void *hdl, uint16_t pid)
+{
+	struct ltntstools_sectionreassembler_s *ctx = (struct ltntstools_sectionreassembler_s *)hdl;
+	if (!ctx || pid > 0x1fff)
+		return -1;
+
+	if (ctx->pids[pid])
+		return 0; /* Already collecting */
+
+	struct section_pid_s *ps = ctx->freeList;
+	if (ps) {
+		ctx->freeList = ps->nextFree;
+	} else {
+		ps = calloc(1, sizeof(*ps));
+		if (!ps)
+			return -1;
 	}
-	printf("\n");
-#endif
-	/* Some basic sanity. */
-	if (*(pkt + 0) != 0x47)
-		return 0;
 
-	/* If the packet contains adaption, it appears before the table data,
-	 * adjust our offset to skip the adaption data.
-	 */
-	if (ltntstools_has_adaption((unsigned char *)pkt)) {
-		section_offset++;
-		section_offset += ltntstools_adaption_field_length((unsigned char *)pkt);
+	_pid_reset(ps);
+	ctx->pids[pid] = ps;
+
+	return 0;
+}
+
+void ltntstools_sectionreassembler_reset(void *hdl)
+{
+	struct ltntstools_sectionreassembler_s *ctx = (struct ltntstools_sectionreassembler_s *)hdl;
+	if (!ctx)
+		return;
+
+	for (int i = 0; i < 0x2000; i++) {
+		struct section_pid_s *ps = ctx->pids[i];
+		if (ps) {
+			ps->nextFree = ctx->freeList;
+			ctx->freeList = ps;
+			ctx->pids[i] = NULL;
+		}
 	}
+}
 
-	/* If the Packet Marker is set, this packet contains the start of the table_section,
-	 * and it could span multiple packets.
-	 * The start table is preceeded by a pointer_field, which in turn could shift the
-	 * position of the first table_section byte EVEN FURTHER into the packet, accomodate
-	 * a pointer_field.
-	 */
-	if (ltntstools_payload_unit_start_indicator(pkt)) {
-		/* Prior to the table_section we have a pointer field, consider this */
-		section_offset += *(pkt + section_offset);
-		section_offset++;
-
-		/* Safety */
-		if (section_offset >= 180)
-			return 0;
-	}
-
-	int copylength = 0;
-	if (ctx->appending == 0 && ctx->complete == 0 && *(pkt + section_offset) == ctx->tableID) {
-		ctx->appending = 1;
-		ctx->complete = 0;
-		ctx->sectionLengthCurrent = 0;
-		ctx->sectionLength = (*(pkt + section_offset + 1) << 8 | *(pkt + section_offset + 2)) & 0xfff;
-		ctx->sectionLength += 3;
-		copylength = ctx->sectionLength;
-		if (copylength > 183)
-			copylength = 183;
-#if 0
-		printf("section TID 0x%02x starts offset 0x%02x length 0x%x appending %d\n",
-			*(pkt + section_offset),
-			section_offset, ctx->sectionLength, ctx->appending);
-#endif
-	} else
-	if (ctx->appending == 1 && ctx->complete == 0) {
-		copylength = 183;
-		if (ctx->sectionLengthCurrent + copylength > ctx->sectionLength) {
-			copylength = ctx->sectionLength - ctx->sectionLengthCurrent;
+ssize_t ltntstools_sectionreassembler_write(void *hdl, const uint8_t *pkts, int packetCount)
+{
+	struct ltntstools_sectionreassembler_s *ctx = (struct ltntstools_sectionreassembler_s *)hdl;
+
+	for (int i = 0; i < packetCount; i++) {
+		const uint8_t *pkt = &pkts[i * 188];
+		struct section_pid_s *ps = ctx->pids[ltntstools_pid(pkt)];
+		if (ps) {
+			_write_packet(ctx, ps, pkt);
 		}
-	} else {
-		ctx->complete = 0;
-		ctx->appending = 0;
-		return -1;
 	}
 
-#if 0
-	printf("section appending 0x%x bytes from offset 0x%x\n", copylength, section_offset);
-#endif
-
-#if 0
-	for (int i = 1; i <= 188; i++) {
-		printf("%02x ", *(pkt + i - 1));
-		if (i % 16 == 0)
-			printf("\n");
-	}
-	printf("\n");
-#endif
-
-#if 0
-	printf("Section 0x%02x length 0x%02x/0x%x bytes, copying 0x%x, sectionLengthCurrent = 0x%x\n",
-		ctx->tableID, ctx->sectionLengthCurrent + copylength,
-		ctx->sectionLength, copylength, ctx->sectionLengthCurrent);
-#endif
-	memcpy(&ctx->section[ctx->sectionLengthCurrent], pkt + section_offset, copylength);
-	ctx->sectionLengthCurrent += copylength;
-
-	if (ctx->sectionLength == ctx->sectionLengthCurrent) {
-
-#if 0
-		printf("Checking CRC of len 0x%04x : ", ctx->sectionLength);
-		for (int i = 0; i < ctx->sectionLength; i++)
-			printf("%02x ", ctx->section[i]);
-		printf("\n");
-#endif
-		if (ltntstools_checkCRC32(ctx->section, ctx->sectionLength) == 0) {
-			/* CRC is correct. */
-			*crcValid = 1;
-		} else {
-			*crcValid = 0;
+	return packetCount;
+}
+
+void ltntstools_sectionreassembler_free(void *hdl)
+{
+	struct ltntstools_sectionreassembler_s *ctx = (struct ltntstools_sectionreassembler_s *)hdl;
+	if (!ctx)
+		return;
+
+	ltntstools_sectionreassembler_reset(ctx);
+
+	while (ctx->freeList) {
+		struct section_pid_s *ps = ctx->freeList;
+		ctx->freeList = ps->nextFree;
+
+		for (int i = 0; i < SECTION_CACHE_ENTRIES; i++) {
+			free(ps->cache[i].data);
 		}
+		free(ps);
+	}
+
+	free(ctx);
+}
+
+/* Single table extractor, a reassembler with one pid. */
+static void _extractor_cb(void *userContext, const struct ltntstools_section_s *section)
+{
+	struct sectionextractor_ctx_s *ctx = (struct sectionextractor_ctx_s *)userContext;
+
+	if (section->tableId != ctx->tableID)
+		return;
+
+	memcpy(ctx->section, section->data, section->lengthBytes);
+	ctx->sectionLength = section->lengthBytes;
+	ctx->available = 1;
 
-		ctx->complete = 1;
-		ctx->appending = 0;
-		*complete = 1;
+	ctx->complete = 1;
+	ctx->crcValid = section->crcValid;
+}
+
+void ltntstools_sectionextractor_free(void *hdl)
+{
+	struct sectionextractor_ctx_s *ctx = (struct sectionextractor_ctx_s *)hdl;
+	if (!ctx)
+		return;
+	if (ctx->reassembler)
+		ltntstools_sectionreassembler_free(ctx->reassembler);
+	if (ctx->section)
+		free(ctx->section);
+	ctx->section = NULL;
+	free(ctx);
+	ctx = NULL;
+}
+
+int ltntstools_sectionextractor_alloc(void **hdl, uint16_t PID, uint8_t tableID)
+{
+	struct sectionextractor_ctx_s *ctx = calloc(1, sizeof(*ctx));
+	if (!ctx)
+		return -1;
+
+	ctx->tableID = tableID;
+	ctx->PID = PID;
+	ctx->section = malloc(LTNTSTOOLS_SECTION_MAX_BYTES);
+
+	if (!ctx->section ||
+		ltntstools_sectionreassembler_alloc(&ctx->reassembler, _extractor_cb, ctx) < 0 ||
+		ltntstools_sectionreassembler_add_pid(ctx->reassembler, PID) < 0) {
+		ltntstools_sectionextractor_free(ctx);
+		return -1;
 	}
 
-	return copylength;
+	*hdl = ctx;
+	return 0;
 }
 
 ssize_t ltntstools_sectionextractor_write(void *hdl, const uint8_t *pkt, size_t packetCount, int *complete, int *crcValid)
 {
 	struct sectionextractor_ctx_s *ctx = (struct sectionextractor_ctx_s *)hdl;
 
-	*complete = 0;
+	ctx->complete = 0;
+	ctx->crcValid = 0;
 
-	ssize_t ret = 0;
-	for (int i = 0; i < packetCount; i++) {
-		if (ltntstools_pid(&pkt[i * 188]) != ctx->PID)
-			continue;
-		ret += ltntstools_sectionextractor_write_packet(ctx, &pkt[i * 188], complete, crcValid);
-	}
+	ssize_t ret = ltntstools_sectionreassembler_write(ctx->reassembler, pkt, packetCount);
 
-	if (*complete)
-		ctx->complete = 1;
+	*complete = ctx->complete;
+	*crcValid = ctx->crcValid;
 
 	return ret;
 }
@@ -189,12 +452,11 @@ int ltntstools_sectionextractor_query(void *hdl, uint8_t *dst, int lengthBytes)
 {
 	struct sectionextractor_ctx_s *ctx = (struct sectionextractor_ctx_s *)hdl;
 
-	if (!ctx->complete || !dst || lengthBytes < (ctx->sectionLength + 3))
+	if (!ctx->available || !dst || lengthBytes < ctx->sectionLength)
 		return -1;
 
-	memcpy(dst, &ctx->section[0], ctx->sectionLength + 3);
+	memcpy(dst, &ctx->section[0], ctx->sectionLength);
 
-	ctx->complete = 0;
-	ctx->appending = 0;
-	return ctx->sectionLength + 3;
+	ctx->available = 0;
+	return ctx->sectionLength;
 }
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libltntstools/segmentindex.h"
+
+struct ltntstools_segmentindex_s
+{
+	void *map;
+	size_t mapLength;
+
+	const struct ltntstools_segmentindex_entry_s *entries;
+	int entryCount;
+
+	uint64_t recordingLength; /* Size of the recording when the index was opened */
+};
+
+int ltntstools_segmentindex_open(void **hdl, const char *filename)
+{
+	struct stat st;
+	if (stat(filename, &st) < 0)
+		return -1;
+
+	char *idxname = malloc(strlen(filename) + strlen(LTNTSTOOLS_SEGMENTINDEX_SUFFIX) + 1);
+	if (!idxname)
+		return -1;
+	sprintf(idxname, "%s%s", filename, LTNTSTOOLS_SEGMENTINDEX_SUFFIX);
+
+	int fd = open(idxname, O_RDONLY);
+	free(idxname);
+	if (fd < 0)
+		return -1;
+
+	struct ltntstools_segmentindex_s *ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		close(fd);
+		return -1;
+	}
+	ctx->recordingLength = st.st_size;
+
+	if (fstat(fd, &st) < 0 || st.st_size < sizeof(struct ltntstools_segmentindex_header_s)) {
+		close(fd);
+		free(ctx);
+		return -1;
+	}
+
+	ctx->mapLength = st.st_size;
+	ctx->map = mmap(NULL, ctx->mapLength, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ctx->map == MAP_FAILED) {
+		free(ctx);
+		return -1;
+	}
+
+	const struct ltntstools_segmentindex_header_s *h = ctx->map;
+	if (memcmp(h->magic, LTNTSTOOLS_SEGMENTINDEX_MAGIC, sizeof(h->magic)) != 0 ||
+		h->version != LTNTSTOOLS_SEGMENTINDEX_VERSION ||
+		h->entrySize != sizeof(struct ltntstools_segmentindex_entry_s))
+	{
+		ltntstools_segmentindex_close(ctx);
+		return -1;
+	}
+
+	/* A live writer may have left a partial entry at the end, ignore it. */
+	ctx->entries = (const struct ltntstools_segmentindex_entry_s *)(h + 1);
+	ctx->entryCount = (ctx->mapLength - sizeof(*h)) / sizeof(struct ltntstools_segmentindex_entry_s);
+
+	*hdl = ctx;
+
+	return 0;
+}
+
+void ltntstools_segmentindex_close(void *hdl)
+{
+	struct ltntstools_segmentindex_s *ctx = (struct ltntstools_segmentindex_s *)hdl;
+
+	if (ctx->map && ctx->map != MAP_FAILED)
+		munmap(ctx->map, ctx->mapLength);
+
+	free(ctx);
+}
+
+int ltntstools_segmentindex_get_count(void *hdl)
+{
+	struct ltntstools_segmentindex_s *ctx = (struct ltntstools_segmentindex_s *)hdl;
+	return ctx->entryCount;
+}
+
+int ltntstools_segmentindex_get_entry(void *hdl, int nr, struct ltntstools_segmentindex_entry_s *entry)
+{
+	struct ltntstools_segmentindex_s *ctx = (struct ltntstools_segmentindex_s *)hdl;
+	if (nr < 0 || nr >= ctx->entryCount)
+		return -1;
+
+	*entry = ctx->entries[nr];
+
+	return 0;
+}
+
+/* Index of the last entry with wallclock <= ms, else -1. */
+static int _search_wallclock(struct ltntstools_segmentindex_s *ctx, int64_t ms)
+{
+	int lo = 0, hi = ctx->entryCount;
+
+	/* Find the first entry with wallclock > ms */
+	while (lo < hi) {
+		int mid = lo + ((hi - lo) / 2);
+		if (ctx->entries[mid].wallclockMs <= ms)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo - 1;
+}
+
+int ltntstools_segmentindex_find_wallclock(void *hdl, int64_t wallclockMs, uint16_t flagsMask,
+	struct ltntstools_segmentindex_entry_s *entry)
+{
+	struct ltntstools_segmentindex_s *ctx = (struct ltntstools_segmentindex_s *)hdl;
+
+	int nr = _search_wallclock(ctx, wallclockMs);
+	if (flagsMask) {
+		while (nr >= 0 && (ctx->entries[nr].flags & flagsMask) == 0)
+			nr--;
+	}
+	if (nr < 0)
+		return -1;
+
+	if (entry)
+		*entry = ctx->entries[nr];
+
+	return nr;
+}
+
+int ltntstools_segmentindex_find_range(void *hdl, int64_t fromMs, int64_t toMs, int keyframeAligned,
+	uint64_t *byteStart, uint64_t *byteEnd)
+{
+	struct ltntstools_segmentindex_s *ctx = (struct ltntstools_segmentindex_s *)hdl;
+
+	if (toMs < fromMs || ctx->entryCount == 0)
+		return -1;
+
+	struct ltntstools_segmentindex_entry_s e;
+	if (ltntstools_segmentindex_find_wallclock(ctx, fromMs,
+		keyframeAligned ? LTNTSTOOLS_SEGMENTINDEX_FLAG_IDR : 0, &e) < 0)
+	{
+		/* The range starts before the recording, begin with the first qualifying entry */
+		int nr = 0;
+		while (keyframeAligned && nr < ctx->entryCount && (ctx->entries[nr].flags & LTNTSTOOLS_SEGMENTINDEX_FLAG_IDR) == 0)
+			nr++;
+		if (nr == ctx->entryCount || ctx->entries[nr].wallclockMs > toMs)
+			return -1;
+		e = ctx->entries[nr];
+	}
+	*byteStart = e.offset;
+
+	int end = _search_wallclock(ctx, toMs) + 1;
+	if (end < ctx->entryCount)
+		*byteEnd = ctx->entries[end].offset;
+	else
+		*byteEnd = ctx->recordingLength;
+
+	if (*byteEnd < *byteStart)
+		return -1;
+
+	return 0;
+}
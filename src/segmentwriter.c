@@ -1,3 +1,4 @@
+#define _GNU_SOURCE /* O_DIRECT, sync_file_range */
 #include <stdio.h>
 #include <time.h>
 #include <inttypes.h>
@@ -5,11 +6,17 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/statvfs.h>
 
 #include "libltntstools/segmentwriter.h"
+#include "libltntstools/segmentindex.h"
+#include "libltntstools/ts.h"
+#include "libltntstools/nal_h264.h"
 #include "libltntstools/time.h"
 #include "libltntstools/kl-queue.h"
+#include "xorg-list.h"
 #include "klringbuffer.h"
 
 #define LOCAL_DEBUG 0
@@ -22,11 +29,16 @@ struct q_item_s
 	unsigned char *ptr;
 	int lengthBytes;
 	time_t datetime;
+	int openBefore; /* First item of a new segment, close any current file and open the next */
+
+	/* Seek index entries for data up to and including this item */
+	struct ltntstools_segmentindex_entry_s *entries;
+	int entryCount;
 };
 
 struct q_item_s *q_item_malloc(const unsigned char *buf, int lengthBytes)
 {
-	struct q_item_s *i = malloc(sizeof(*i));
+	struct q_item_s *i = calloc(1, sizeof(*i));
 	if (!i)
 		return NULL;
 
@@ -50,11 +62,35 @@ void q_item_free(struct q_item_s *i)
 		free(i->ptr);
 		i->lengthBytes = 0;
 	}
+	free(i->entries);
 	free(i);
 }
 
 #endif
 
+/* SEGMENTEDWRITER_ENGINE_DIRECT. Writes are copied straight into large aligned buffers,
+ * full buffers are handed to the I/O thread which writes them with O_DIRECT, bypassing
+ * the page cache. No allocations on the write path once the pool has warmed up.
+ */
+#define DIRECT_ALIGN        4096
+#define DIRECT_BUFFER_SIZE  (1024 * 1024)
+#define DIRECT_BUFFERS_MIN  4
+#define DIRECT_BUFFERS_MAX  64 /* Beyond this the disk can't keep up, drop rather than consume all ram */
+#define DIRECT_FLUSH_MS     250 /* Partially filled buffers are written at least this often */
+
+struct sw_buffer_s
+{
+	struct xorg_list list;
+	uint8_t *ptr;
+	size_t used;
+	int openBefore; /* First buffer of a new segment, close any current file and open the next */
+
+	/* Seek index entries for data up to and including this buffer */
+	struct ltntstools_segmentindex_entry_s *entries;
+	int entryCount;
+	int entryAlloc;
+};
+
 struct ltntstools_segmentwriter_s
 {
 	time_t lastOpen;
@@ -84,8 +120,321 @@ struct ltntstools_segmentwriter_s
 
 	unsigned char *fileHeader;
 	int fileHeaderLength;
+
+	int engine;
+	struct ltntstools_segmentwriter_stats_s stats; /* Protected by mutex */
+	int64_t writeLatencyTotaluS;
+	pthread_cond_t ioCond; /* Signalled when work is queued for I/O, or on termination */
+
+	/* SEGMENTEDWRITER_ENGINE_DIRECT, lists, fill and the segment state are protected by mutex */
+	int fd;
+	int fdDirect; /* O_DIRECT is in effect on fd */
+	struct xorg_list buffersFree;
+	struct xorg_list buffersBusy;
+	int busyCount;
+	int bufferCount;
+	struct sw_buffer_s *fill; /* Buffer currently being filled by the producer */
+	int pendingOpen; /* Next buffer handed to the producer starts a new segment */
+
+	/* Segment boundaries are decided by the producer, for both engines */
+	int segmentOpen;
+	time_t segmentStart;
+	uint64_t segmentOffset; /* File offset the next write will land at */
+
+	/* Seek index, see ltntstools_segmentwriter_set_index(). Scanner state belongs to the producer,
+	 * indexfh to the I/O thread.
+	 */
+	int indexEnabled;
+	uint16_t indexVideoPid;
+	struct ltntstools_segmentindex_entry_s *indexEntries; /* Scanned, not yet attached to a write */
+	int indexEntryCount;
+	int indexEntryAlloc;
+	int indexPending; /* indexEntries[indexPendingNr] is a PTS entry waiting on its first slice */
+	int indexPendingNr;
+	int indexPendingPackets;
+	uint8_t indexNalCarry[3]; /* Start codes straddle packets */
+	int indexNalCarryLength;
+	int64_t indexWallclockMs;
+	FILE *indexfh;
 };
 
+static int _isOpen(struct ltntstools_segmentwriter_s *s)
+{
+	return s->fh || s->fd >= 0;
+}
+
+static int64_t _nowuS(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((int64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/* Call with mutex held */
+static void _statsWriteLatency(struct ltntstools_segmentwriter_s *s, int64_t uS, size_t lengthBytes)
+{
+	s->stats.writes++;
+	s->stats.bytesWritten += lengthBytes;
+	s->stats.writeLatencyLastuS = uS;
+	s->writeLatencyTotaluS += uS;
+	if (uS > s->stats.writeLatencyMaxuS)
+		s->stats.writeLatencyMaxuS = uS;
+}
+
+/* Queue engine, track the high water mark of items waiting for I/O. Producer only, the mutex
+ * is held by the I/O thread for entire write batches.
+ */
+static void _statsQueueDepth(struct ltntstools_segmentwriter_s *s)
+{
+	uint64_t depth = klqueue_count(&s->q);
+	if (depth > s->stats.queueDepthMax)
+		s->stats.queueDepthMax = depth;
+}
+
+/* we're a super user, obtain any SUDO uid and change file ownership to it - if possible. */
+static void _chownSudoUser(const char *filename)
+{
+	if (getuid() == 0 && getenv("SUDO_UID") && getenv("SUDO_GID")) {
+		uid_t o_uid = atoi(getenv("SUDO_UID"));
+		gid_t o_gid = atoi(getenv("SUDO_GID"));
+
+		if (chown(filename, o_uid, o_gid) != 0) {
+			/* Error */
+			fprintf(stderr, "Error changing %s ownership to uid %d gid %d, ignoring\n",
+				filename, o_uid, o_gid);
+		}
+	}
+}
+
+static void _nextFilename(struct ltntstools_segmentwriter_s *s)
+{
+	char ts[64];
+	libltntstools_getTimestamp(&ts[0], sizeof(ts), NULL);
+	if (s->filename) {
+		free(s->filename);
+		s->filename = NULL;
+	}
+	s->filename = realloc(s->filename, 512);
+	sprintf(s->filename, "%s-%s%s", s->filenamePrefix, ts, s->filenameSuffix);
+}
+
+/* Seek index, producer side. Entries are attached to the write that completes them and
+ * travel with the data to the I/O thread, which appends them to the segments sidecar.
+ */
+static int _entriesAppend(struct ltntstools_segmentindex_entry_s **array, int *count, int *alloc,
+	const struct ltntstools_segmentindex_entry_s *e, int n)
+{
+	if (*count + n > *alloc) {
+		int a = *alloc ? *alloc * 2 : 64;
+		while (a < *count + n)
+			a *= 2;
+		struct ltntstools_segmentindex_entry_s *arr = realloc(*array, a * sizeof(*arr));
+		if (!arr)
+			return -1;
+		*array = arr;
+		*alloc = a;
+	}
+
+	memcpy(*array + *count, e, n * sizeof(*e));
+	*count += n;
+
+	return 0;
+}
+
+static void _indexResolve(struct ltntstools_segmentwriter_s *s, uint16_t flags)
+{
+	s->indexEntries[s->indexPendingNr].flags |= flags;
+	s->indexPending = 0;
+}
+
+/* Search the start of a video access unit for its first slice, to learn whether it's an IDR. */
+static void _indexScanNals(struct ltntstools_segmentwriter_s *s, const uint8_t *es, int lengthBytes)
+{
+	uint8_t buf[sizeof(s->indexNalCarry) + 188];
+	int len = s->indexNalCarryLength;
+
+	memcpy(&buf[0], &s->indexNalCarry[0], len);
+	memcpy(&buf[len], es, lengthBytes);
+	len += lengthBytes;
+
+	int offset = -1;
+	while (ltn_nal_h264_findHeader(&buf[0], len, &offset) == 0) {
+		int nalType = buf[offset + 3] & 0x1f;
+		if (nalType == 5) {
+			_indexResolve(s, LTNTSTOOLS_SEGMENTINDEX_FLAG_IDR);
+			return;
+		}
+		if (nalType == 1) {
+			_indexResolve(s, 0);
+			return;
+		}
+	}
+
+	/* Not H.264, or a very large SEI. Give up. */
+	if (++s->indexPendingPackets >= 64) {
+		_indexResolve(s, 0);
+		return;
+	}
+
+	s->indexNalCarryLength = len < sizeof(s->indexNalCarry) ? len : sizeof(s->indexNalCarry);
+	memcpy(&s->indexNalCarry[0], &buf[len - s->indexNalCarryLength], s->indexNalCarryLength);
+}
+
+static int _pesPTS(const uint8_t *pes, int lengthBytes, int64_t *pts, int *esOffset)
+{
+	if (lengthBytes < 14 || pes[0] != 0x00 || pes[1] != 0x00 || pes[2] != 0x01)
+		return -1;
+	if ((pes[7] & 0x80) == 0)
+		return -1;
+
+	*pts  = (int64_t)(pes[ 9] & 0x0e) << 29;
+	*pts |= (int64_t)(pes[10]       ) << 22;
+	*pts |= (int64_t)(pes[11] & 0xfe) << 14;
+	*pts |= (int64_t)(pes[12]       ) <<  7;
+	*pts |= (int64_t)(pes[13]       ) >>  1;
+	*esOffset = 9 + pes[8];
+
+	return 0;
+}
+
+/* Scan a write, due to land at s->segmentOffset, for PCRs and video PES headers. */
+static void _indexScan(struct ltntstools_segmentwriter_s *s, const uint8_t *buf, int lengthBytes)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	int64_t ms = ((int64_t)now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+	if (ms < s->indexWallclockMs)
+		ms = s->indexWallclockMs; /* Keep the index searchable if the clock steps backwards */
+	s->indexWallclockMs = ms;
+
+	int start = 0;
+	if (lengthBytes < 188 || buf[0] != 0x47) {
+		start = ltntstools_findSyncPosition(buf, lengthBytes);
+		if (start < 0)
+			return;
+	}
+
+	for (int i = start; i + 188 <= lengthBytes; i += 188) {
+		const uint8_t *pkt = buf + i;
+		if (pkt[0] != 0x47)
+			break;
+
+		struct ltntstools_segmentindex_entry_s e = {
+			.offset = s->segmentOffset + i,
+			.wallclockMs = ms,
+			.pid = ltntstools_pid(pkt),
+		};
+
+		uint64_t scr;
+		if (ltntstools_scr(pkt, &scr) == 0) {
+			e.clock = scr;
+			e.flags = LTNTSTOOLS_SEGMENTINDEX_FLAG_PCR;
+			_entriesAppend(&s->indexEntries, &s->indexEntryCount, &s->indexEntryAlloc, &e, 1);
+		}
+
+		if (s->indexVideoPid == 0 || e.pid != s->indexVideoPid)
+			continue;
+		if ((ltntstools_adaption_field_control(pkt) & 0x01) == 0)
+			continue; /* No payload */
+
+		int payload = 4;
+		if (ltntstools_has_adaption(pkt))
+			payload += 1 + ltntstools_adaption_field_length(pkt);
+		if (payload >= 188)
+			continue;
+
+		if (ltntstools_payload_unit_start_indicator(pkt)) {
+			if (s->indexPending)
+				_indexResolve(s, 0);
+
+			int64_t pts;
+			int esOffset;
+			if (_pesPTS(pkt + payload, 188 - payload, &pts, &esOffset) < 0)
+				continue;
+
+			e.clock = pts;
+			e.flags = LTNTSTOOLS_SEGMENTINDEX_FLAG_PTS;
+			if (_entriesAppend(&s->indexEntries, &s->indexEntryCount, &s->indexEntryAlloc, &e, 1) < 0)
+				continue;
+
+			s->indexPending = 1;
+			s->indexPendingNr = s->indexEntryCount - 1;
+			s->indexPendingPackets = 0;
+			s->indexNalCarryLength = 0;
+			payload += esOffset;
+		}
+
+		if (s->indexPending && payload < 188) {
+			_indexScanNals(s, pkt + payload, 188 - payload);
+		}
+	}
+}
+
+/* Move every entry not held back behind an unresolved PTS entry onto a write. Entries stay
+ * sorted by offset, PCRs following a video PES header wait until its IDR status is known.
+ */
+static void _indexDetach(struct ltntstools_segmentwriter_s *s,
+	struct ltntstools_segmentindex_entry_s **array, int *count, int *alloc)
+{
+	int n = s->indexPending ? s->indexPendingNr : s->indexEntryCount;
+	if (n == 0)
+		return;
+
+	_entriesAppend(array, count, alloc, s->indexEntries, n);
+
+	s->indexEntryCount -= n;
+	memmove(s->indexEntries, s->indexEntries + n, s->indexEntryCount * sizeof(*s->indexEntries));
+	if (s->indexPending)
+		s->indexPendingNr -= n;
+}
+
+/* A new segment starts, anything still held back belonged to data in the previous one. */
+static void _indexSegmentStart(struct ltntstools_segmentwriter_s *s)
+{
+	s->indexEntryCount = 0;
+	s->indexPending = 0;
+	s->indexNalCarryLength = 0;
+}
+
+/* Seek index, I/O thread side. Called once the segment file itself is open. */
+static void _indexOpen(struct ltntstools_segmentwriter_s *s)
+{
+	if (!s->indexEnabled)
+		return;
+
+	char *fn = malloc(strlen(s->filename) + strlen(LTNTSTOOLS_SEGMENTINDEX_SUFFIX) + 1);
+	if (!fn)
+		return;
+	sprintf(fn, "%s%s", s->filename, LTNTSTOOLS_SEGMENTINDEX_SUFFIX);
+
+	s->indexfh = fopen(fn, "wb");
+	if (s->indexfh) {
+		struct ltntstools_segmentindex_header_s h = { 0 };
+		memcpy(&h.magic[0], LTNTSTOOLS_SEGMENTINDEX_MAGIC, sizeof(h.magic));
+		h.version = LTNTSTOOLS_SEGMENTINDEX_VERSION;
+		h.entrySize = sizeof(struct ltntstools_segmentindex_entry_s);
+		fwrite(&h, 1, sizeof(h), s->indexfh);
+		_chownSudoUser(fn);
+	}
+
+	free(fn);
+}
+
+static void _indexClose(struct ltntstools_segmentwriter_s *s)
+{
+	if (s->indexfh) {
+		fclose(s->indexfh);
+		s->indexfh = NULL;
+	}
+}
+
+static void _indexWrite(struct ltntstools_segmentwriter_s *s, const struct ltntstools_segmentindex_entry_s *entries, int count)
+{
+	if (s->indexfh && count) {
+		fwrite(entries, sizeof(*entries), count, s->indexfh);
+	}
+}
+
 static void swlog(struct ltntstools_segmentwriter_s *s, const char *msg)
 {
 #if LOG_FILE
@@ -102,105 +451,94 @@ static void swlog(struct ltntstools_segmentwriter_s *s, const char *msg)
 #endif
 }
 
-static size_t _write(struct ltntstools_segmentwriter_s *s)
+static void _fileClose(struct ltntstools_segmentwriter_s *s)
 {
-	time_t now = time(NULL);
-
-	if (s->writeMode == 1 && (s->fh)) {
-		if (now >= (s->lastOpen + 60)) {
-			swlog(s, "Closing\n");
-			fclose(s->fh);
-			s->fh = NULL;
-		}
+	if (s->fh) {
+		swlog(s, "Closing\n");
+		fclose(s->fh);
+		s->fh = NULL;
 	}
+	_indexClose(s);
+}
 
-	if (s->writeMode == 0) {
-		if (s->fh == NULL) {
-			if (s->filename) {
-				free(s->filename);
-				s->filename = NULL;
-			}
-			char ts[64];
-			libltntstools_getTimestamp(&ts[0], sizeof(ts), NULL);
-			s->filename = realloc(s->filename, 512);
-			sprintf(s->filename, "%s-%s%s", s->filenamePrefix, ts, s->filenameSuffix);
-		}
-	} else
-	if (s->writeMode == 1) {
-		if (s->fh == NULL) {
-			char ts[64];
-			libltntstools_getTimestamp(&ts[0], sizeof(ts), NULL);
-			if (s->filename) {
-				free(s->filename);
-				s->filename = NULL;
-			}
-			s->filename = realloc(s->filename, 512);
-			sprintf(s->filename, "%s-%s%s", s->filenamePrefix, ts, s->filenameSuffix);
-		}
-	}
+static void _fileOpen(struct ltntstools_segmentwriter_s *s)
+{
+	_nextFilename(s);
 
-	if (s->fh == NULL) {
-		char msg[256];
-		sprintf(msg, "Opening %s\n", s->filename);
-		swlog(s, msg);
+	char msg[256];
+	sprintf(msg, "Opening %s\n", s->filename);
+	swlog(s, msg);
 #if LOCAL_DEBUG
-		printf(msg);
+	printf(msg);
 #endif
 
-		s->fh = fopen(s->filename, "wb");
-		s->lastOpen = time(NULL);
-		if (s->recordingStartTime == 0)
-			s->recordingStartTime = s->lastOpen;
-		s->totalSegmentsCreated++;
-
-		/* we're a super user, obtain any SUDO uid and change file ownership to it - if possible. */
-		if (s->fh && getuid() == 0 && getenv("SUDO_UID") && getenv("SUDO_GID")) {
-			uid_t o_uid = atoi(getenv("SUDO_UID"));
-			gid_t o_gid = atoi(getenv("SUDO_GID"));
-
-			if (chown(s->filename, o_uid, o_gid) != 0) {
-				/* Error */
-				fprintf(stderr, "Error changing %s ownership to uid %d gid %d, ignoring\n",
-					s->filename, o_uid, o_gid);
-			}
-		}
+	s->fh = fopen(s->filename, "wb");
+	s->lastOpen = time(NULL);
+	if (s->recordingStartTime == 0)
+		s->recordingStartTime = s->lastOpen;
+	s->totalSegmentsCreated++;
 
-		if (s->fh) {
-			fwrite(s->fileHeader, 1, s->fileHeaderLength, s->fh);
-			s->totalBytesWritten += s->fileHeaderLength;
-		}
+	if (s->fh) {
+		_chownSudoUser(s->filename);
 	}
 
 	if (s->fh) {
-		pthread_mutex_lock(&s->mutex);
+		fwrite(s->fileHeader, 1, s->fileHeaderLength, s->fh);
+		s->totalBytesWritten += s->fileHeaderLength;
+		_indexOpen(s);
+	}
+}
+
+static size_t _write(struct ltntstools_segmentwriter_s *s)
+{
 #if USE_QUEUE_NOT_RING
-		int maxwrites = 1000;
-		while (!klqueue_empty(&s->q)) {
-			struct q_item_s *qi = NULL;
-			int ret = klqueue_pop_non_blocking(&s->q, 2000, (void **)&qi);
-			if (ret == 0) {
-				if (s->writeMode == 1 && qi->datetime >= (s->lastOpen + 60)) {
-					/* bTerminate this write loop, vie the segmentor a chance
-					 * to switch segments.
-					 */
-					maxwrites = 0;
-				}
+	/* Segment boundaries are marked on the items by the producer */
+	pthread_mutex_lock(&s->mutex);
+	int maxwrites = 1000;
+	while (!klqueue_empty(&s->q)) {
+		struct q_item_s *qi = NULL;
+		int ret = klqueue_pop_non_blocking(&s->q, 2000, (void **)&qi);
+		if (ret == 0) {
+			if (qi->openBefore) {
+				_fileClose(s);
+				_fileOpen(s);
+			}
+			if (s->fh) {
+				int64_t t = _nowuS();
 				fwrite(qi->ptr, 1, qi->lengthBytes, s->fh);
+				_statsWriteLatency(s, _nowuS() - t, qi->lengthBytes);
 				s->totalBytesWritten += qi->lengthBytes;
-				q_item_free(qi);
-
-				/* After 10k writes, break and give the writer
-				 * a chance to split the file, if needed.
-				 * Else all the writes keep goinging into a single
-				 * file.
-				 */
-				if (maxwrites-- <= 0)
-					break;
-			} else {
-				break;
 			}
+			_indexWrite(s, qi->entries, qi->entryCount);
+			q_item_free(qi);
+
+			/* After 1k writes, break and give the producer a chance
+			 * to take the mutex.
+			 */
+			if (maxwrites-- <= 0)
+				break;
+		} else {
+			break;
 		}
+	}
+	if (s->indexfh)
+		fflush(s->indexfh);
+	pthread_mutex_unlock(&s->mutex);
 #else
+	time_t now = time(NULL);
+
+	if (s->writeMode == 1 && (s->fh)) {
+		if (now >= (s->lastOpen + 60)) {
+			_fileClose(s);
+		}
+	}
+
+	if (s->fh == NULL) {
+		_fileOpen(s);
+	}
+
+	if (s->fh) {
+		pthread_mutex_lock(&s->mutex);
 		int len = rb_used(s->rb);
 		if (len > 0) {
 			char *buf = malloc(len);
@@ -223,13 +561,29 @@ static size_t _write(struct ltntstools_segmentwriter_s *s)
 			s->totalBytesWritten += len;
 			free(buf);
 		}
-#endif
 		pthread_mutex_unlock(&s->mutex);
 	}
+#endif
 
 	return 0;
 }
 
+/* Called from the producer, returns 1 when a write starts a new segment. */
+static int _segmentBoundary(struct ltntstools_segmentwriter_s *s, time_t now)
+{
+	if (s->segmentOpen) {
+		if (s->writeMode != SEGMENTEDWRITER_SEGMENTED || now < (s->segmentStart + 60))
+			return 0;
+	}
+
+	s->segmentOpen = 1;
+	s->segmentStart = now;
+	s->segmentOffset = 0;
+	_indexSegmentStart(s);
+
+	return 1;
+}
+
 void *ltntstools_segmentwriter_threadFunc(void *p)
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)p;
@@ -237,7 +591,16 @@ void *ltntstools_segmentwriter_threadFunc(void *p)
 	s->threadRunning = 1;
 
 	while (!s->threadTerminate) {
-		usleep(10 * 1000); /* TODO: Replace this with a semaphore */
+		/* Batch up 10ms of writes, ltntstools_segmentwriter_free() wakes us early. */
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += 10 * 1000000;
+		ts.tv_sec += ts.tv_nsec / 1000000000;
+		ts.tv_nsec %= 1000000000;
+		pthread_mutex_lock(&s->mutex);
+		if (!s->threadTerminate)
+			pthread_cond_timedwait(&s->ioCond, &s->mutex, &ts);
+		pthread_mutex_unlock(&s->mutex);
 #if USE_QUEUE_NOT_RING
 		if (!klqueue_empty(&s->q)) {
 #else
@@ -253,11 +616,373 @@ void *ltntstools_segmentwriter_threadFunc(void *p)
 	return NULL;
 }
 
+/* SEGMENTEDWRITER_ENGINE_DIRECT */
+
+/* Call with mutex held. Returns NULL when the pool is exhausted, the disk isn't keeping up. */
+static struct sw_buffer_s *_bufferAlloc(struct ltntstools_segmentwriter_s *s)
+{
+	if (s->bufferCount >= DIRECT_BUFFERS_MAX)
+		return NULL;
+
+	struct sw_buffer_s *b = calloc(1, sizeof(*b));
+	if (!b)
+		return NULL;
+	if (posix_memalign((void **)&b->ptr, DIRECT_ALIGN, DIRECT_BUFFER_SIZE) != 0) {
+		free(b);
+		return NULL;
+	}
+	s->bufferCount++;
+
+	return b;
+}
+
+static struct sw_buffer_s *_bufferGet(struct ltntstools_segmentwriter_s *s)
+{
+	struct sw_buffer_s *b = NULL;
+
+	if (!xorg_list_is_empty(&s->buffersFree)) {
+		b = xorg_list_first_entry(&s->buffersFree, struct sw_buffer_s, list);
+		xorg_list_del(&b->list);
+	} else {
+		b = _bufferAlloc(s);
+		if (!b)
+			return NULL;
+	}
+
+	b->used = 0;
+	b->entryCount = 0;
+	b->openBefore = s->pendingOpen;
+	s->pendingOpen = 0;
+
+	return b;
+}
+
+static void _bufferFree(struct sw_buffer_s *b)
+{
+	free(b->entries);
+	free(b->ptr);
+	free(b);
+}
+
+/* Call with mutex held. Hand the fill buffer to the I/O thread. */
+static void _bufferQueue(struct ltntstools_segmentwriter_s *s)
+{
+	if (!s->fill)
+		return;
+
+	xorg_list_append(&s->fill->list, &s->buffersBusy);
+	s->fill = NULL;
+	s->busyCount++;
+	if (s->busyCount > s->stats.queueDepthMax)
+		s->stats.queueDepthMax = s->busyCount;
+
+	pthread_cond_signal(&s->ioCond);
+}
+
+/* Call with mutex held. Make sure length bytes fit in the fill buffer and the free list,
+ * allocating buffers up front, so an append never stops part way through.
+ */
+static int _bufferReserve(struct ltntstools_segmentwriter_s *s, size_t length)
+{
+	size_t space = s->fill ? DIRECT_BUFFER_SIZE - s->fill->used : 0;
+	if (length <= space)
+		return 0;
+
+	size_t needed = (length - space + DIRECT_BUFFER_SIZE - 1) / DIRECT_BUFFER_SIZE;
+	size_t available = 0;
+
+	struct sw_buffer_s *b = NULL;
+	xorg_list_for_each_entry(b, &s->buffersFree, list) {
+		if (++available >= needed)
+			return 0;
+	}
+
+	while (available < needed) {
+		b = _bufferAlloc(s);
+		if (!b)
+			return -1;
+		xorg_list_append(&b->list, &s->buffersFree);
+		available++;
+	}
+
+	return 0;
+}
+
+/* Call with mutex held. All or nothing, a torn transport packet in the recording is worse than a gap. */
+static int _bufferAppend(struct ltntstools_segmentwriter_s *s, const uint8_t *buf, size_t length)
+{
+	if (_bufferReserve(s, length) < 0) {
+		s->stats.overruns++;
+		return -1;
+	}
+
+	while (length) {
+		if (!s->fill) {
+			s->fill = _bufferGet(s);
+		}
+
+		size_t len = DIRECT_BUFFER_SIZE - s->fill->used;
+		if (len > length)
+			len = length;
+
+		memcpy(s->fill->ptr + s->fill->used, buf, len);
+		s->fill->used += len;
+		s->segmentOffset += len;
+		buf += len;
+		length -= len;
+
+		if (s->fill->used == DIRECT_BUFFER_SIZE) {
+			_bufferQueue(s);
+		}
+	}
+
+	return 0;
+}
+
+/* Call with mutex held. Called from the producer after _segmentBoundary(), emit the header. */
+static void _segmentStart(struct ltntstools_segmentwriter_s *s)
+{
+	/* The remainder of the previous segment goes out unaligned, the file is closed after it. */
+	_bufferQueue(s);
+
+	s->pendingOpen = 1;
+
+	if (s->fileHeader) {
+		_bufferAppend(s, s->fileHeader, s->fileHeaderLength);
+	}
+}
+
+static void _directClose(struct ltntstools_segmentwriter_s *s)
+{
+	if (s->fd >= 0) {
+		swlog(s, "Closing\n");
+		close(s->fd);
+		s->fd = -1;
+	}
+	_indexClose(s);
+}
+
+static void _directOpen(struct ltntstools_segmentwriter_s *s)
+{
+	_nextFilename(s);
+
+	char msg[256];
+	sprintf(msg, "Opening %s\n", s->filename);
+	swlog(s, msg);
+
+	s->fdDirect = 1;
+	s->fd = open(s->filename, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0666);
+	if (s->fd < 0 && errno == EINVAL) {
+		/* Filesystem (Eg. tmpfs) doesn't support O_DIRECT */
+		s->fdDirect = 0;
+		s->fd = open(s->filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	}
+	if (s->fd < 0) {
+		fprintf(stderr, "%s() unable to open %s, %s\n", __func__, s->filename, strerror(errno));
+		return;
+	}
+
+	s->lastOpen = time(NULL);
+	if (s->recordingStartTime == 0)
+		s->recordingStartTime = s->lastOpen;
+	s->totalSegmentsCreated++;
+
+	_chownSudoUser(s->filename);
+	_indexOpen(s);
+}
+
+static void _directWriteAll(struct ltntstools_segmentwriter_s *s, const uint8_t *buf, size_t length)
+{
+	while (length) {
+		ssize_t ret = write(s->fd, buf, length);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			fprintf(stderr, "%s() write to %s failed, %s\n", __func__, s->filename, strerror(errno));
+			return;
+		}
+		buf += ret;
+		length -= ret;
+	}
+}
+
+/* Called from the I/O thread without the mutex held. Only the last buffer of a segment
+ * may have an unaligned length, O_DIRECT is cleared for that tail.
+ */
+static void _directWrite(struct ltntstools_segmentwriter_s *s, struct sw_buffer_s *b)
+{
+	if (b->openBefore) {
+		_directClose(s);
+		_directOpen(s);
+	}
+	if (s->fd < 0)
+		return;
+
+	int64_t t = _nowuS();
+
+	size_t aligned = b->used & ~((size_t)DIRECT_ALIGN - 1);
+	if (aligned) {
+		_directWriteAll(s, b->ptr, aligned);
+	}
+	if (b->used > aligned) {
+		if (s->fdDirect) {
+			fcntl(s->fd, F_SETFL, fcntl(s->fd, F_GETFL) & ~O_DIRECT);
+			s->fdDirect = 0;
+		}
+		_directWriteAll(s, b->ptr + aligned, b->used - aligned);
+	}
+
+	int64_t uS = _nowuS() - t;
+
+	if (s->indexfh && b->entryCount) {
+		_indexWrite(s, b->entries, b->entryCount);
+		fflush(s->indexfh);
+	}
+
+	pthread_mutex_lock(&s->mutex);
+	_statsWriteLatency(s, uS, b->used);
+	s->totalBytesWritten += b->used;
+	pthread_mutex_unlock(&s->mutex);
+}
+
+/* Call with mutex held. The producer has gone quiet, write the aligned part of the fill buffer
+ * and carry the unaligned tail over into a fresh buffer, so the file offset stays aligned.
+ * Index entries for packets not wholly in the aligned part travel with the tail, the sidecar
+ * never points past data already on disk.
+ */
+static void _bufferFlushPartial(struct ltntstools_segmentwriter_s *s)
+{
+	if (!s->fill)
+		return;
+
+	size_t aligned = s->fill->used & ~((size_t)DIRECT_ALIGN - 1);
+	if (aligned == 0)
+		return;
+
+	struct sw_buffer_s *next = _bufferGet(s);
+	if (!next)
+		return;
+
+	struct sw_buffer_s *b = s->fill;
+	next->used = b->used - aligned;
+	memcpy(next->ptr, b->ptr + aligned, next->used);
+	b->used = aligned;
+
+	/* Entries are sorted by offset, the tail ends at the current segment offset */
+	uint64_t alignedEnd = s->segmentOffset - next->used;
+	int keep = 0;
+	while (keep < b->entryCount && b->entries[keep].offset + 188 <= alignedEnd)
+		keep++;
+	if (keep < b->entryCount) {
+		_entriesAppend(&next->entries, &next->entryCount, &next->entryAlloc, b->entries + keep, b->entryCount - keep);
+		b->entryCount = keep;
+	}
+
+	_bufferQueue(s);
+	s->fill = next;
+}
+
+static void *_directThreadFunc(void *p)
+{
+	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)p;
+
+	s->threadRunning = 1;
+
+	pthread_mutex_lock(&s->mutex);
+	while (!s->threadTerminate || !xorg_list_is_empty(&s->buffersBusy)) {
+		if (xorg_list_is_empty(&s->buffersBusy)) {
+			struct timespec ts;
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += DIRECT_FLUSH_MS * 1000000;
+			ts.tv_sec += ts.tv_nsec / 1000000000;
+			ts.tv_nsec %= 1000000000;
+			if (pthread_cond_timedwait(&s->ioCond, &s->mutex, &ts) == ETIMEDOUT) {
+				_bufferFlushPartial(s);
+			}
+			continue;
+		}
+
+		struct sw_buffer_s *b = xorg_list_first_entry(&s->buffersBusy, struct sw_buffer_s, list);
+		xorg_list_del(&b->list);
+		s->busyCount--;
+		pthread_mutex_unlock(&s->mutex);
+
+		_directWrite(s, b);
+
+		pthread_mutex_lock(&s->mutex);
+		xorg_list_append(&b->list, &s->buffersFree);
+	}
+	pthread_mutex_unlock(&s->mutex);
+
+	_directClose(s);
+
+	s->threadRunning = 0;
+	s->threadTerminated = 1;
+
+	return NULL;
+}
+
+static ssize_t _directWriteQueue(struct ltntstools_segmentwriter_s *s, const uint8_t *buf, size_t length)
+{
+	time_t now = time(NULL);
+
+	pthread_mutex_lock(&s->mutex);
+	if (_segmentBoundary(s, now)) {
+		_segmentStart(s);
+	}
+
+	/* Index only what's written, entries carry the segment offset of their packet. */
+	int dropped = _bufferReserve(s, length) < 0;
+	if (dropped) {
+		s->stats.overruns++;
+	} else {
+		if (s->indexEnabled) {
+			_indexScan(s, buf, length);
+		}
+		_bufferAppend(s, buf, length);
+	}
+
+	if (s->indexEnabled && s->indexEntryCount) {
+		/* Entries follow their data to the I/O thread */
+		if (!s->fill)
+			s->fill = _bufferGet(s);
+		if (s->fill)
+			_indexDetach(s, &s->fill->entries, &s->fill->entryCount, &s->fill->entryAlloc);
+	}
+	pthread_mutex_unlock(&s->mutex);
+
+	if (dropped) {
+		char msg[256];
+		sprintf(msg, "buffer pool exhausted, wlen %d dropped\n", (int)length);
+		swlog(s, msg);
+		return -1;
+	}
+
+	return length;
+}
+
 int ltntstools_segmentwriter_alloc(void **hdl, const char *filenamePrefix, const char *filenameSuffix, int writeMode)
 {
+	return ltntstools_segmentwriter_alloc_with_engine(hdl, filenamePrefix, filenameSuffix, writeMode,
+		SEGMENTEDWRITER_ENGINE_QUEUE);
+}
+
+int ltntstools_segmentwriter_alloc_with_engine(void **hdl, const char *filenamePrefix, const char *filenameSuffix,
+	int writeMode, int engine)
+{
+	if (engine != SEGMENTEDWRITER_ENGINE_QUEUE && engine != SEGMENTEDWRITER_ENGINE_DIRECT)
+		return -1;
+
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)calloc(1, sizeof(*s));
+	if (!s)
+		return -1;
 
 	pthread_mutex_init(&s->mutex, NULL);
+	pthread_cond_init(&s->ioCond, NULL);
+	s->engine = engine;
+	s->fd = -1;
+	xorg_list_init(&s->buffersFree);
+	xorg_list_init(&s->buffersBusy);
 	s->filenamePrefix = strdup(filenamePrefix);
 	if (filenameSuffix == NULL)
 		s->filenameSuffix = strdup(".ts");
@@ -270,19 +995,44 @@ int ltntstools_segmentwriter_alloc(void **hdl, const char *filenamePrefix, const
 	s->rb = rb_new(4 * 1048576, 16 * 1048576);
 #endif
 
+	if (engine == SEGMENTEDWRITER_ENGINE_DIRECT) {
+		/* Warm the pool so the first seconds of recording don't allocate */
+		pthread_mutex_lock(&s->mutex);
+		for (int i = 0; i < DIRECT_BUFFERS_MIN; i++) {
+			struct sw_buffer_s *b = _bufferGet(s);
+			if (b)
+				xorg_list_append(&b->list, &s->buffersFree);
+		}
+		pthread_mutex_unlock(&s->mutex);
+	}
+
 	*hdl = s;
 
+	if (engine == SEGMENTEDWRITER_ENGINE_DIRECT)
+		return pthread_create(&s->threadId, NULL, _directThreadFunc, s);
+
 	return pthread_create(&s->threadId, NULL, ltntstools_segmentwriter_threadFunc, s);
 }
 
 void ltntstools_segmentwriter_free(void *hdl)
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
-	if (s->threadRunning) {
-		s->threadTerminate = 1;
-		while (!s->threadTerminated) {
-			usleep(10 * 1000);
-		}
+
+	pthread_mutex_lock(&s->mutex);
+	if (s->engine == SEGMENTEDWRITER_ENGINE_DIRECT) {
+		/* The I/O thread drains every queued buffer before terminating */
+		_bufferQueue(s);
+	}
+	s->threadTerminate = 1;
+	pthread_cond_signal(&s->ioCond);
+	pthread_mutex_unlock(&s->mutex);
+
+	pthread_join(s->threadId, NULL);
+
+	while (!xorg_list_is_empty(&s->buffersFree)) {
+		struct sw_buffer_s *b = xorg_list_first_entry(&s->buffersFree, struct sw_buffer_s, list);
+		xorg_list_del(&b->list);
+		_bufferFree(b);
 	}
 
 	if (s->fh) {
@@ -311,7 +1061,14 @@ void ltntstools_segmentwriter_free(void *hdl)
 	}
 #endif
 
+	pthread_cond_destroy(&s->ioCond);
+	pthread_mutex_destroy(&s->mutex);
+
+	_indexClose(s);
+	free(s->indexEntries);
 	free(s->filenamePrefix);
+	free(s->filenameSuffix);
+	free(s->filename);
 	free(s);
 }
 
@@ -320,6 +1077,10 @@ void ltntstools_segmentwriter_free(void *hdl)
  */
 int ltntstools_segmentwriter_object_alloc(void *hdl, size_t length, void **obj, uint8_t **dst)
 {
+	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
+	if (s->engine != SEGMENTEDWRITER_ENGINE_QUEUE)
+		return -1;
+
 #if USE_QUEUE_NOT_RING
 	struct q_item_s *qi = q_item_malloc(NULL, length);
 	if (!qi) {
@@ -337,10 +1098,18 @@ int ltntstools_segmentwriter_object_alloc(void *hdl, size_t length, void **obj,
 int ltntstools_segmentwriter_object_write(void *hdl, void *object)
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
+	if (s->engine != SEGMENTEDWRITER_ENGINE_QUEUE)
+		return -1;
 
 	struct q_item_s *qi = (struct q_item_s *)object;
 	time(&qi->datetime);
+	if (_segmentBoundary(s, qi->datetime)) {
+		qi->openBefore = 1;
+		s->segmentOffset = s->fileHeaderLength;
+	}
+	s->segmentOffset += qi->lengthBytes;
 	klqueue_push(&s->q, qi);
+	_statsQueueDepth(s);
 
 	return qi->lengthBytes;
 
@@ -354,6 +1123,9 @@ ssize_t ltntstools_segmentwriter_write(void *hdl, const uint8_t *buf, size_t len
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
 
+	if (s->engine == SEGMENTEDWRITER_ENGINE_DIRECT)
+		return _directWriteQueue(s, buf, length);
+
 #if USE_QUEUE_NOT_RING
 	ssize_t len = 0;
 	struct q_item_s *qi = q_item_malloc(buf, length);
@@ -361,7 +1133,18 @@ ssize_t ltntstools_segmentwriter_write(void *hdl, const uint8_t *buf, size_t len
 		return 0;
 	}
 	time(&qi->datetime);
+	if (_segmentBoundary(s, qi->datetime)) {
+		qi->openBefore = 1;
+		s->segmentOffset = s->fileHeaderLength;
+	}
+	if (s->indexEnabled) {
+		int alloc = 0;
+		_indexScan(s, buf, length);
+		_indexDetach(s, &qi->entries, &qi->entryCount, &alloc);
+	}
+	s->segmentOffset += length;
 	klqueue_push(&s->q, qi);
+	_statsQueueDepth(s);
 #else
 	pthread_mutex_lock(&s->mutex);
 	int didOverflow;
@@ -389,7 +1172,7 @@ ssize_t ltntstools_segmentwriter_write(void *hdl, const uint8_t *buf, size_t len
 int ltntstools_segmentwriter_get_current_filename(void *hdl, char *dst, int lengthBytes)
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
-	if (!s->fh)
+	if (!_isOpen(s))
 		return -1;
 
 	strncpy(dst, &s->filename[0], lengthBytes);
@@ -397,6 +1180,20 @@ int ltntstools_segmentwriter_get_current_filename(void *hdl, char *dst, int leng
 	return 0;
 }
 
+int ltntstools_segmentwriter_set_index(void *hdl, uint16_t videoPid)
+{
+	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
+	if (s->segmentOpen)
+		return -1; /* Too late, the first segment has already started */
+	if (videoPid > 0x1fff)
+		return -1;
+
+	s->indexVideoPid = videoPid;
+	s->indexEnabled = 1;
+
+	return 0;
+}
+
 int ltntstools_segmentwriter_set_header(void *hdl, const uint8_t *buf, size_t length)
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
@@ -420,7 +1217,7 @@ int ltntstools_segmentwriter_set_header(void *hdl, const uint8_t *buf, size_t le
 double ltntstools_segmentwriter_get_freespace_pct(void *hdl)
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
-	if (!s->fh)
+	if (!_isOpen(s))
 		return -1;
 
 	/* If the file currently being written is removed while in use, its safe, but,
@@ -443,7 +1240,7 @@ double ltntstools_segmentwriter_get_freespace_pct(void *hdl)
 int ltntstools_segmentwriter_get_segment_count(void *hdl)
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
-	if (!s->fh)
+	if (!_isOpen(s))
 		return -1;
 
 	return s->totalSegmentsCreated;
@@ -452,7 +1249,7 @@ int ltntstools_segmentwriter_get_segment_count(void *hdl)
 int64_t ltntstools_segmentwriter_get_recording_size(void *hdl)
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
-	if (!s->fh)
+	if (!_isOpen(s))
 		return -1;
 
 	return s->totalBytesWritten;
@@ -461,7 +1258,7 @@ int64_t ltntstools_segmentwriter_get_recording_size(void *hdl)
 time_t ltntstools_segmentwriter_get_recording_start_time(void *hdl)
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
-	if (!s->fh)
+	if (!_isOpen(s))
 		return -1;
 
 	return s->recordingStartTime;
@@ -470,6 +1267,33 @@ time_t ltntstools_segmentwriter_get_recording_start_time(void *hdl)
 int ltntstools_segmentwriter_get_queue_depth(void *hdl)
 {
 	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
+	if (s->engine == SEGMENTEDWRITER_ENGINE_DIRECT) {
+		pthread_mutex_lock(&s->mutex);
+		int depth = s->busyCount;
+		pthread_mutex_unlock(&s->mutex);
+		return depth;
+	}
+
 	return klqueue_count(&s->q);
 }
 
+int ltntstools_segmentwriter_get_stats(void *hdl, struct ltntstools_segmentwriter_stats_s *stats)
+{
+	struct ltntstools_segmentwriter_s *s = (struct ltntstools_segmentwriter_s *)hdl;
+	if (!stats)
+		return -1;
+
+	pthread_mutex_lock(&s->mutex);
+	*stats = s->stats;
+	if (s->stats.writes)
+		stats->writeLatencyAvguS = s->writeLatencyTotaluS / (int64_t)s->stats.writes;
+	if (s->engine == SEGMENTEDWRITER_ENGINE_DIRECT)
+		stats->queueDepth = s->busyCount;
+	pthread_mutex_unlock(&s->mutex);
+
+	if (s->engine == SEGMENTEDWRITER_ENGINE_QUEUE)
+		stats->queueDepth = klqueue_count(&s->q);
+
+	return 0;
+}
+
@@ -7,7 +7,6 @@
 #include <libltntstools/ltntstools.h>
 
 #include "sei-timestamp.h"
-#include "memmem.h"
 
 int g_sei_timestamping = 0;
 
@@ -67,7 +66,7 @@ int ltn_uuid_find(const unsigned char *buf, unsigned int lengthBytes)
 	if (lengthBytes < SEI_TIMESTAMP_PAYLOAD_LENGTH)
 		return -1;
 
-	result = ltn_memmem(buf, lengthBytes, ltn_uuid_sei_timestamp, sizeof(ltn_uuid_sei_timestamp));
+	result = (void *)ltntstools_bytescan_memmem(buf, lengthBytes, ltn_uuid_sei_timestamp, sizeof(ltn_uuid_sei_timestamp));
 	if (result)
 		return (result - (void *)(buf));
 	else
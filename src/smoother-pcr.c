@@ -4,13 +4,12 @@
 #include <sys/errno.h>
 
 #include "libltntstools/ltntstools.h"
-#include "xorg-list.h"
+#include "pacer.h"
 
 #define LOCAL_DEBUG 0
 
 struct smoother_pcr_item_s
 {
-	struct xorg_list list;
 	uint64_t       seqno; /* Unique number per item, so we can check for loss/corruption in the lists. */
 
 	unsigned char *buf;
@@ -23,7 +22,7 @@ struct smoother_pcr_item_s
 	struct ltntstools_pcr_position_s pcrdata; /* PCR value from pid N in the buffer, first PCR only. */
 
 	/* Under no circumstances should received_TSuS be smaller than (now - (4 * ctx->latencyuS)) */
-	uint64_t       received_TSuS;  /* Item received timestamp Via makeTimestampFromNow */
+	uint64_t       received_TSuS;  /* Item received timestamp Via makeTimestampFromNow, CLOCK_MONOTONIC */
 
 	/* Under no circumstances should scheduled_TSuS be larger than (now + (4 * ctx->latencyuS)) */
 	uint64_t       scheduled_TSuS; /* Time this item is schedule for push via thread for smoothing output. */
@@ -106,19 +105,58 @@ const uint8_t *byte_array_addr(struct byte_array_s *ba)
 }
 /* byte_array.... ---------- */
 
+/* Single producer (smoother_pcr_write) / single consumer (thread-brsmooth) ring of
+ * preallocated items, all buffers carved from one slab.
+ * Item sequence number N lives in slot (N % capacity). Items in [tail, head) are busy,
+ * awaiting scheduled output, the remaining slots are free for the producer.
+ */
+struct smoother_pcr_ring_s
+{
+	struct smoother_pcr_item_s *items;
+	uint8_t *slab;
+	uint32_t capacity;
+};
+
+enum smoother_pcr_ctrl_e
+{
+	CTRL_NONE = 0,
+	CTRL_GROW,    /**< Consumer migrates the busy items into ctx->ctrlRing, and adopts it. */
+	CTRL_RESET,   /**< Consumer discards all busy items. */
+};
+
 struct smoother_pcr_context_s
 {
-	struct xorg_list itemsFree;
-	uint64_t qFreeCount;
-	struct xorg_list itemsBusy;
-	uint64_t qBusyCount;
+	struct smoother_pcr_ring_s *ring; /**< Replaced only on the consumer thread, or before it starts, see _ringRequest() */
+
+	/* Producer owned. Head is published with release semantics, tailCache is a stale copy of
+	 * tail so the producer rarely touches the consumers cache line.
+	 */
+	uint64_t head;
+	uint64_t tailCache;
+	uint64_t lastScheduled_TSuS;      /**< Schedule of the most recently written item */
+	uint8_t pad0[64];
+
+	/* Consumer owned. */
+	uint64_t tail;
+	int consumerSleeping;             /**< Boolean. Producer signals item_add only when set */
+	struct ltntstools_pcr_position_s *pcrArray; /**< Per packet PCRs handed to the output callback */
+	struct ltn_pacer_s pacer;         /**< Deadline sleeps until the next item is due */
+	uint8_t pad1[64];
+
+	/* Slow paths. Idle wakeups, control requests, statistics. */
 	pthread_mutex_t listMutex;
-	int64_t totalUserBytes;       /**< total number of bytes held on the busy queue, for scheduled output. */
+	pthread_cond_t item_add;      /**< signalling on queue addition, or a pending control request */
+	pthread_cond_t ctrl_done;     /**< signalling the producer once a control request is serviced */
+	int ctrlRequest;              /**< enum smoother_pcr_ctrl_e, posted by the producer, cleared by the consumer */
+	struct smoother_pcr_ring_s *ctrlRing;
+	struct smoother_pcr_ring_s *retiredRing; /**< Grown away from inside the output callback, freed once it returns */
+
+	int64_t totalUserBytes;       /**< total number of bytes held on the busy queue, for scheduled output. Atomic */
 	int itemLengthBytes;          /**< Typically 7 * 188, is the allocation size for each queue item. Be skeptical when a different value. */
-	pthread_cond_t item_add;      /**< signalling on queue addition */
 
 	void *userContext;
 	smoother_pcr_output_callback outputCb;
+	smoother_pcr_output_flush_callback outputFlushCb;
 
 	uint64_t walltimeFirstPCRuS; /**< Reset this when the clock significantly leaps backwards */
 	int64_t pcrFirst; /**< Reset this when the clock significantly leaps backwards */
@@ -175,13 +213,17 @@ int smoother_pcr_get_statistics(void *hdl, struct smoother_pcr_statistics *s)
 		return -1;
 	}
 
+	pthread_mutex_lock(&ctx->listMutex);
+	uint64_t busy = __atomic_load_n(&ctx->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ctx->tail, __ATOMIC_ACQUIRE);
+
 	s->measuredLatencyMs_hwm = ctx->measuredLatencyMs_hwm;
 	s->totalAllocFootprintBytes = ctx->totalAllocFootprintBytes;
 	s->totalItemGrowth = ctx->totalItemGrowth;
 	s->totalItems = ctx->totalItems;
-	s->totalUserBytes = ctx->totalUserBytes;
-	s->qBusyCount = ctx->qBusyCount;
-	s->qFreeCount = ctx->qFreeCount;
+	s->totalUserBytes = __atomic_load_n(&ctx->totalUserBytes, __ATOMIC_RELAXED);
+	s->qBusyCount = busy;
+	s->qFreeCount = ctx->totalItems - busy;
+	pthread_mutex_unlock(&ctx->listMutex);
 
 	return 0; /* Success */
 }
@@ -215,82 +257,147 @@ static uint64_t getScheduledOutputuS(struct smoother_pcr_context_s *ctx, int64_t
 	return scheduledTimeuS;
 }
 
-static inline uint64_t makeTimestampFromTimeval(struct timeval *ts)
+/* Scheduling runs on the monotonic clock, immune to wall clock steps, and shared with the pacer. */
+static inline uint64_t makeTimestampFromNow()
 {
-	uint64_t t = ((int64_t)ts->tv_sec * 1000000LL) + ts->tv_usec;
-	return t;
+	return ltn_pacer_now_us();
 }
 
-static inline uint64_t makeTimestampFromNow()
+static void itemReset(struct smoother_pcr_item_s *item)
 {
-	struct timeval now;
-	gettimeofday(&now, NULL);
-	return makeTimestampFromTimeval(&now);
+	item->lengthBytes = 0;
+	item->received_TSuS = 0;
+	item->scheduled_TSuS = 0;
+	item->pcrComputed = 0;
+	ltntstools_pcr_position_reset(&item->pcrdata);
 }
 
-static inline uint64_t makeTimestampFrom1SecondAgo()
+static void _ringFree(struct smoother_pcr_ring_s *ring)
 {
-	struct timeval now;
-	gettimeofday(&now, NULL);
-	now.tv_sec--;
-	return makeTimestampFromTimeval(&now);
+	if (ring) {
+		free(ring->items);
+		free(ring->slab);
+		free(ring);
+	}
 }
 
-static inline uint64_t makeTimestampFrom2SecondAgo()
+static struct smoother_pcr_ring_s *_ringAlloc(uint32_t capacity, int itemLengthBytes)
 {
-	struct timeval now;
-	gettimeofday(&now, NULL);
-	now.tv_sec--;
-	return makeTimestampFromTimeval(&now);
+	struct smoother_pcr_ring_s *ring = calloc(1, sizeof(*ring));
+	if (!ring) {
+		return NULL;
+	}
+
+	ring->items = calloc(capacity, sizeof(struct smoother_pcr_item_s));
+	ring->slab = calloc(capacity, itemLengthBytes);
+	if (!ring->items || !ring->slab) {
+		_ringFree(ring);
+		return NULL;
+	}
+	ring->capacity = capacity;
+
+	for (uint32_t i = 0; i < capacity; i++) {
+		struct smoother_pcr_item_s *item = &ring->items[i];
+		item->buf = ring->slab + ((size_t)i * itemLengthBytes);
+		item->maxLengthBytes = itemLengthBytes;
+		itemReset(item);
+	}
+
+	return ring;
 }
 
-static void itemFree(struct smoother_pcr_item_s *item)
+static inline struct smoother_pcr_item_s *_ringItem(struct smoother_pcr_ring_s *ring, uint64_t seq)
 {
-	if (item) {
-		free(item->buf);
-		free(item);
-	}
+	return &ring->items[seq % ring->capacity];
 }
 
-static void itemReset(struct smoother_pcr_item_s *item)
+/* Apply the pending control request, with listMutex held. Either on the consumer thread, or while
+ * the consumer is not running, so both head and tail are stable.
+ */
+static void _ringApplyRequest(struct smoother_pcr_context_s *ctx)
 {
-	item->lengthBytes = 0;
-	item->received_TSuS = 0;
-	item->scheduled_TSuS = 0;
-	item->pcrComputed = 0;
-	ltntstools_pcr_position_reset(&item->pcrdata);
+	if (ctx->ctrlRequest == CTRL_GROW) {
+		struct smoother_pcr_ring_s *src = ctx->ring;
+		struct smoother_pcr_ring_s *dst = ctx->ctrlRing;
+
+		for (uint64_t seq = ctx->tail; seq != ctx->head; seq++) {
+			struct smoother_pcr_item_s *s = _ringItem(src, seq);
+			struct smoother_pcr_item_s *d = _ringItem(dst, seq);
+			uint8_t *buf = d->buf;
+
+			*d = *s;
+			d->buf = buf;
+			memcpy(d->buf, s->buf, s->lengthBytes);
+		}
+
+		ctx->ring = dst;
+		ctx->ctrlRing = NULL;
+
+		/* _queueProcess() may be inside the output callback, holding an item of the ring
+		 * we're replacing. Keep the first one alive until it returns.
+		 */
+		if (ctx->threadRunning && ctx->retiredRing == NULL && pthread_equal(pthread_self(), ctx->threadId)) {
+			ctx->retiredRing = src;
+		} else {
+			_ringFree(src);
+		}
+	} else
+	if (ctx->ctrlRequest == CTRL_RESET) {
+		/* From the output callback another thread may still be writing, take what it has published. */
+		ctx->tail = __atomic_load_n(&ctx->head, __ATOMIC_ACQUIRE);
+		__atomic_store_n(&ctx->totalUserBytes, 0, __ATOMIC_RELAXED);
+	}
+
+	__atomic_store_n(&ctx->ctrlRequest, CTRL_NONE, __ATOMIC_RELEASE);
+	pthread_cond_signal(&ctx->ctrl_done);
 }
 
-static struct smoother_pcr_item_s *itemAlloc(int lengthBytes)
+/* Called by the consumer while the producer waits for the control request to complete. */
+static void _ringServiceRequest(struct smoother_pcr_context_s *ctx)
 {
-	struct smoother_pcr_item_s *item = calloc(1, sizeof(*item));
-	if (!item) {
-		return NULL;
+	pthread_mutex_lock(&ctx->listMutex);
+	if (ctx->ctrlRequest != CTRL_NONE) {
+		_ringApplyRequest(ctx);
 	}
+	pthread_mutex_unlock(&ctx->listMutex);
+}
+
+/* Producer side. Hand a request to the consumer thread and wait for it to be serviced.
+ * The consumer is either idle in _queueWait() or pacing in ltn_pacer_wait_until_cond(),
+ * both wait on item_add, so the request is picked up immediately.
+ * From the output callback, which runs on the consumer thread, or before the consumer thread
+ * is running, nobody would service it, so apply it directly.
+ */
+static void _ringRequest(struct smoother_pcr_context_s *ctx, enum smoother_pcr_ctrl_e request, struct smoother_pcr_ring_s *ring)
+{
+	pthread_mutex_lock(&ctx->listMutex);
+	ctx->ctrlRing = ring;
+	__atomic_store_n(&ctx->ctrlRequest, request, __ATOMIC_RELEASE);
 
-	item->buf = calloc(1, lengthBytes);
-	if (!item->buf) {
-		free(item);
-		item = NULL;
+	if (!ctx->threadRunning || ctx->threadTerminated || pthread_equal(pthread_self(), ctx->threadId)) {
+		_ringApplyRequest(ctx);
+		pthread_mutex_unlock(&ctx->listMutex);
+		return;
 	}
-	item->maxLengthBytes = lengthBytes;
-	itemReset(item);
 
-	return item;
+	pthread_cond_signal(&ctx->item_add);
+
+	while (ctx->ctrlRequest != CTRL_NONE) {
+		pthread_cond_wait(&ctx->ctrl_done, &ctx->listMutex);
+	}
+	pthread_mutex_unlock(&ctx->listMutex);
 }
 
 #if LOCAL_DEBUG
-static void _queuePrintList(struct smoother_pcr_context_s *ctx, struct xorg_list *head, const char *name)
+static void _queuePrintList(struct smoother_pcr_context_s *ctx, const char *name)
 {
-	int totalItems = 0;
+	uint64_t head = __atomic_load_n(&ctx->head, __ATOMIC_ACQUIRE);
 
 	printf("Queue %s -->\n", name);
-	struct smoother_pcr_item_s *e = NULL, *next = NULL;
-	xorg_list_for_each_entry_safe(e, next, head, list) {
-		totalItems++;
-		itemPrint(e);
+	for (uint64_t seq = ctx->tail; seq != head; seq++) {
+		itemPrint(_ringItem(ctx->ring, seq));
 	}
-	printf("Queue End --> %d items\n", totalItems);
+	printf("Queue End --> %" PRIu64 " items\n", head - ctx->tail);
 }
 #endif
 
@@ -306,20 +413,8 @@ void smoother_pcr_free(void *hdl)
 		}
 	}
 
-	pthread_mutex_lock(&ctx->listMutex);
-	while (!xorg_list_is_empty(&ctx->itemsFree)) {
-		struct smoother_pcr_item_s *item = xorg_list_first_entry(&ctx->itemsFree, struct smoother_pcr_item_s, list);
-		xorg_list_del(&item->list);
-		ctx->qFreeCount--;
-		itemFree(item);
-	}
-	while (!xorg_list_is_empty(&ctx->itemsBusy)) {
-		struct smoother_pcr_item_s *item = xorg_list_first_entry(&ctx->itemsBusy, struct smoother_pcr_item_s, list);
-		xorg_list_del(&item->list);
-		ctx->qBusyCount--;
-		itemFree(item);
-	}
-	pthread_mutex_unlock(&ctx->listMutex);
+	_ringFree(ctx->ring);
+	free(ctx->pcrArray);
 
 	byte_array_free(&ctx->ba);
 
@@ -329,112 +424,59 @@ void smoother_pcr_free(void *hdl)
 	free(ctx);
 }
 
-/* Take any node on the Busy list up to and including items with a timestamp of uS.
- * Put them on a local list so we can free the holding mutex as fast as possible.
- * We're being called with a thread holding the listmutex, don't linger.
- * 
- * The list is expected to have items with e->scheduled_TSuS <= uS
- * and items where e->scheduled_TSuS > uS
- */
-static int _queueProcess_makeloc(struct smoother_pcr_context_s *ctx, int64_t uS, struct xorg_list *loclist)
-{
-	int count = 0, totalItems = 0, redundantItems = 0;
-	struct smoother_pcr_item_s *e = NULL, *next = NULL;
-	xorg_list_for_each_entry_safe(e, next, &ctx->itemsBusy, list) {
-		totalItems++;
-
-		if (totalItems == 1) {
-			ctx->pcrHead = e->pcrdata.pcr;
-		}
-
-		if (e->scheduled_TSuS <= uS) {
-			xorg_list_del(&e->list);
-			ctx->qBusyCount--;
-			xorg_list_append(&e->list, loclist);
-			count++;
-		} else {
-			if (count > 0) {
-				/* Time ordering problem on the list now. Dump both lists and abort, later.*/
-				redundantItems++;
-			}
-			break; /* Everything beyond this point is in the future, don't service it yet. */
-		}
-	}
-	return count;
-}
-
-#if LOCAL_DEBUG
-static void _queueProcess_checkbusy(struct smoother_pcr_context_s *ctx, int64_t uS, struct xorg_list *loclist)
-{
-	/* Make sure the busy list is contigious */
-	int countSeq = 0;
-	uint64_t last_seq = 0;
-	struct smoother_pcr_item_s *e = NULL, *next = NULL;
-	xorg_list_for_each_entry_safe(e, next, &ctx->itemsBusy, list) {
-		countSeq++;
-
-		if (countSeq > 1) {
-			if (last_seq + 1 != e->seqno) {
-				/* Almost certainly, the schedule US time is out of order, warn. */
-				printf("List possibly mangled, seqnos might be bad now, %" PRIu64 ", %" PRIu64 "\n", last_seq, e->seqno);
 #if LOCAL_DEBUG
-				_queuePrintList(ctx, &ctx->itemsBusy, "Busy");
-				_queuePrintList(ctx, loclist, "loclist");
-				fflush(stdout);
-				fflush(stderr);
-				exit(1);
-#endif
-			}
+static void _queueProcess_checkbusy(struct smoother_pcr_context_s *ctx, uint64_t head)
+{
+	/* Make sure the busy items are contigious */
+	for (uint64_t seq = ctx->tail + 1; seq < head; seq++) {
+		struct smoother_pcr_item_s *prev = _ringItem(ctx->ring, seq - 1);
+		struct smoother_pcr_item_s *e = _ringItem(ctx->ring, seq);
+		if (prev->seqno + 1 != e->seqno) {
+			/* Almost certainly, the schedule US time is out of order, warn. */
+			printf("Ring possibly mangled, seqnos might be bad now, %" PRIu64 ", %" PRIu64 "\n", prev->seqno, e->seqno);
+			_queuePrintList(ctx, "Busy");
+			fflush(stdout);
+			fflush(stderr);
+			exit(1);
 		}
-		last_seq = e->seqno;
 	}
 }
 #endif
 
-/*  Service the busy list. Find any items due for output
- *  and send via the callback.
- *  It's important that we hold the mutex for a short time so we don't block
- *  the _write() method.
+/*  Service the busy items. Find any items due for output
+ *  and send via the callback. Each slot is handed back to the producer
+ *  as soon as its callback returns, no locks are taken.
  *  Returns: 0 when something was processed, < 0 when nothing was to be done.
  */
-static int _queueProcess(struct smoother_pcr_context_s *ctx, int64_t uS)
+static int _queueProcess(struct smoother_pcr_context_s *ctx, int64_t uS, uint64_t head)
 {
-	/* Take any node on the Busy list up to and including items with a timestamp of uS.
-	 * Put them on a local list so we can free the holding mutex as fast as possible
-	 */
-	struct xorg_list loclist;
-	xorg_list_init(&loclist);
-
-	int count = _queueProcess_makeloc(ctx, uS, &loclist);
+	int count = 0;
 
 #if LOCAL_DEBUG
-	_queueProcess_checkbusy(ctx, uS, &loclist); /* The performance of this sucks */
+	_queueProcess_checkbusy(ctx, head); /* The performance of this sucks */
 #endif
 
-	pthread_mutex_unlock(&ctx->listMutex);
+	ctx->pcrHead = _ringItem(ctx->ring, ctx->tail)->pcrdata.pcr;
 
-	if (count <= 0) {
-		return -1; /* Nothing scheduled, bail out early. */
-	}
+	while (ctx->tail != head) {
+		/* The output callback may grow or reset the ring, see _ringRequest(), re-read it per item. */
+		uint64_t seq = ctx->tail;
+		struct smoother_pcr_item_s *e = _ringItem(ctx->ring, seq);
+		if (e->scheduled_TSuS > uS) {
+			break; /* Everything beyond this point is in the future, don't service it yet. */
+		}
 
-	/* Process the local list.
-	 * Call the callback with any scheduled packets
-	 */
-	struct smoother_pcr_item_s *e = NULL, *next = NULL;
-	xorg_list_for_each_entry_safe(e, next, &loclist, list) {
 		if (ctx->outputCb) {
 
 			/* Create a PCR value for EVERY packet in the buffer,
 			 * let the callee decide what to do with them.
 			 */
-			struct ltntstools_pcr_position_s *array = NULL;
-			int arrayLength = 0;
-			for (int i = 0; i < e->lengthBytes / 188; i++) {
-				struct ltntstools_pcr_position_s p;
-				p.offset = i * 188;
-				p.pcr = e->pcrdata.pcr + (i * e->pcrIntervalPerPacketTicks);
-				p.pid = ltntstools_pid(e->buf + (i * 188));
-				ltntstools_pcr_position_append(&array, &arrayLength, &p);
+			int arrayLength = e->lengthBytes / 188;
+			for (int i = 0; i < arrayLength; i++) {
+				struct ltntstools_pcr_position_s *p = &ctx->pcrArray[i];
+				p->offset = i * 188;
+				p->pcr = e->pcrdata.pcr + (i * e->pcrIntervalPerPacketTicks);
+				p->pid = ltntstools_pid(e->buf + (i * 188));
 			}
 
 			struct timeval tv;
@@ -444,7 +486,7 @@ static int _queueProcess(struct smoother_pcr_context_s *ctx, int64_t uS)
 			int x = e->lengthBytes;
 			uint64_t sn = e->seqno;
 
-			ctx->outputCb(ctx->userContext, e->buf, e->lengthBytes, array, arrayLength);
+			ctx->outputCb(ctx->userContext, e->buf, e->lengthBytes, ctx->pcrArray, arrayLength);
 			if (x != e->lengthBytes) {
 				printf("%s() ERROR %d != %d, mangled returned object length\n", __func__, x, e->lengthBytes);
 			}
@@ -452,12 +494,6 @@ static int _queueProcess(struct smoother_pcr_context_s *ctx, int64_t uS)
 				printf("%s() ERROR %" PRIu64 " != %" PRIu64 ", mangled returned object seqno\n", __func__, sn, e->seqno);
 			}
 
-			pthread_mutex_lock(&ctx->listMutex);			
-			ctx->totalUserBytes -= e->lengthBytes;
-			pthread_mutex_unlock(&ctx->listMutex);
-
-			free(array);
-
 			/* Throw a packet loss warning if the queue gets confused, should never happen. */
 			if (ctx->last_seqno && ctx->last_seqno + 1 != e->seqno) {
 				printf("%s() seq err %" PRIu64 " vs %" PRIu64 "\n",__func__, ctx->last_seqno, e->seqno);
@@ -465,20 +501,54 @@ static int _queueProcess(struct smoother_pcr_context_s *ctx, int64_t uS)
 
 			ctx->last_seqno = e->seqno;
 		}
+
+		count++;
+		if (ctx->tail != seq) {
+			break; /* The callback reset the smoother, this item was discarded with the rest. */
+		}
+
+		__atomic_sub_fetch(&ctx->totalUserBytes, e->lengthBytes, __ATOMIC_RELAXED);
+
+		/* Return the slot to the producer */
+		__atomic_store_n(&ctx->tail, seq + 1, __ATOMIC_RELEASE);
+	}
+
+	if (count <= 0) {
+		return -1; /* Nothing scheduled. */
+	}
+
+	if (ctx->outputFlushCb) {
+		ctx->outputFlushCb(ctx->userContext);
 	}
 
-	/* Take the mutex again to return the spent items to the free list */
-	e = NULL, next = NULL;
+	return 0;
+}
+
+/* Nothing queued, sleep until the producer signals a new item or a control request. */
+static void _queueWait(struct smoother_pcr_context_s *ctx)
+{
+	struct timespec abstime;
+	clock_gettime(CLOCK_MONOTONIC, &abstime);
+	abstime.tv_nsec += 10 * 1000 * 1000;
+	if (abstime.tv_nsec >= 1000000000) {
+		abstime.tv_sec++;
+		abstime.tv_nsec -= 1000000000;
+	}
+
+	/* Pairs with the head store / consumerSleeping load in smoother_pcr_write2(),
+	 * either we see the new item or the producer sees us sleeping and signals.
+	 */
+	__atomic_store_n(&ctx->consumerSleeping, 1, __ATOMIC_SEQ_CST);
+
 	pthread_mutex_lock(&ctx->listMutex);
-	xorg_list_for_each_entry_safe(e, next, &loclist, list) {
-		itemReset(e);
-		xorg_list_del(&e->list);
-		xorg_list_append(&e->list, &ctx->itemsFree);
-		ctx->qFreeCount++;
+	if (__atomic_load_n(&ctx->head, __ATOMIC_SEQ_CST) == ctx->tail &&
+		ctx->ctrlRequest == CTRL_NONE && !ctx->threadTerminate)
+	{
+		pthread_cond_timedwait(&ctx->item_add, &ctx->listMutex, &abstime);
 	}
 	pthread_mutex_unlock(&ctx->listMutex);
 
-	return 0;
+	__atomic_store_n(&ctx->consumerSleeping, 0, __ATOMIC_RELAXED);
 }
 
 extern int ltnpthread_setname_np(pthread_t thread, const char *name);
@@ -489,58 +559,61 @@ static void * smoother_pcr_threadFunc(void *p)
 
 	pthread_detach(ctx->threadId);
 	ltnpthread_setname_np(ctx->threadId, "thread-brsmooth");
+	ltn_pacer_thread_init();
+	ltn_pacer_init(&ctx->pacer);
 
+	/* Under the lock, _ringRequest() applies requests itself until the consumer is running. */
+	pthread_mutex_lock(&ctx->listMutex);
 	ctx->threadTerminated = 0;
 	ctx->threadRunning = 1;
+	pthread_mutex_unlock(&ctx->listMutex);
 
-	int tocount = 0, rocount = 0, okcount = 0;
+	int tocount = 0, okcount = 0;
 	int q1count = 0, q2count = 0;
-	int ret;
-
-	struct timespec abstime = { 0, 50 * 1000 };
 
 	while (!ctx->threadTerminate) {
 
-		pthread_mutex_lock(&ctx->listMutex);
-
-		if (xorg_list_is_empty(&ctx->itemsBusy)) {
-			ret = pthread_cond_timedwait(&ctx->item_add, &ctx->listMutex, &abstime);
-		} else {
-			ret = 0;
+		if (__atomic_load_n(&ctx->ctrlRequest, __ATOMIC_ACQUIRE) != CTRL_NONE) {
+			_ringServiceRequest(ctx);
 		}
 
-		if (ret == ETIMEDOUT) {
-			pthread_mutex_unlock(&ctx->listMutex);
+		uint64_t head = __atomic_load_n(&ctx->head, __ATOMIC_ACQUIRE);
+		if (head == ctx->tail) {
+			_queueWait(ctx);
 			tocount++;
 			continue;
-		} else
-		if (ret == 0) {
-			okcount++;
+		}
 
-			int64_t uS = makeTimestampFromNow();
+		okcount++;
 
-			/* Service the output schedule queue, output any UDP packets when they're due.
-			 * Important to remember that we're calling this func while we're holding the mutex.
-			 * The function eventually unlocks the mutex.
-			 */
-			if (_queueProcess(ctx, uS) < 0) {
-				q1count++;
-				usleep(1 * 1000);
-			} else {
-				q2count++;
-			}
+		int64_t uS = makeTimestampFromNow();
+
+		/* Service the output schedule queue, output any UDP packets when they're due.
+		 * Otherwise sleep until the next item is due, a control request interrupts the sleep.
+		 */
+		int ret = _queueProcess(ctx, uS, head);
+		if (ctx->retiredRing) {
+			_ringFree(ctx->retiredRing);
+			ctx->retiredRing = NULL;
+		}
+
+		if (ret < 0) {
+			q1count++;
+			ltn_pacer_wait_until_cond(&ctx->pacer, _ringItem(ctx->ring, ctx->tail)->scheduled_TSuS, 10 * 1000,
+				&ctx->listMutex, &ctx->item_add, &ctx->ctrlRequest);
 		} else {
-			rocount++;
-			pthread_mutex_unlock(&ctx->listMutex);
+			q2count++;
 		}
 	}
 #if LOCAL_DEBUG
 	/* Show code path counts */
-	printf("to %d ro %d ok %d\n", tocount, rocount, okcount);
+	printf("to %d ok %d\n", tocount, okcount);
 	printf("q1 %d q2 %d\n", q1count, q2count);
 #endif
+	pthread_mutex_lock(&ctx->listMutex);
 	ctx->threadRunning = 1;
 	ctx->threadTerminated = 1;
+	pthread_mutex_unlock(&ctx->listMutex);
 
 	/* TODO: pthread detach else we'll cause a small leak in valgrind. */
 	return NULL;
@@ -554,9 +627,12 @@ int smoother_pcr_alloc(void **hdl, void *userContext, smoother_pcr_output_callba
 		return -1;
 	}
 
-	pthread_cond_init(&ctx->item_add, NULL);
-	xorg_list_init(&ctx->itemsFree);
-	xorg_list_init(&ctx->itemsBusy);
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&ctx->item_add, &attr);
+	pthread_cond_init(&ctx->ctrl_done, NULL);
+	pthread_condattr_destroy(&attr);
 	pthread_mutex_init(&ctx->listMutex, NULL);
 	ctx->userContext = userContext;
 	ctx->outputCb = cb;
@@ -578,18 +654,22 @@ int smoother_pcr_alloc(void **hdl, void *userContext, smoother_pcr_output_callba
 	 * calculate the number of items based on input bitrate value and
 	 * a (TODO) future latency/smoothing window.
 	 */
-	pthread_mutex_lock(&ctx->listMutex);
-	for (int i = 0; i < itemsPerSecond; i++) {
-		struct smoother_pcr_item_s *item = itemAlloc(itemLengthBytes);
-		if (!item) {
-			continue;
-		}
-		xorg_list_append(&item->list, &ctx->itemsFree);
-		ctx->qFreeCount++;
-		ctx->totalItems++;
-		ctx->totalAllocFootprintBytes += itemLengthBytes;
+	if (itemsPerSecond < 64) {
+		itemsPerSecond = 64;
 	}
-	pthread_mutex_unlock(&ctx->listMutex);
+	ctx->ring = _ringAlloc(itemsPerSecond, itemLengthBytes);
+	ctx->pcrArray = calloc(itemLengthBytes / 188, sizeof(struct ltntstools_pcr_position_s));
+	if (!ctx->ring || !ctx->pcrArray) {
+		_ringFree(ctx->ring);
+		free(ctx->pcrArray);
+		byte_array_free(&ctx->ba);
+		ltn_histogram_free(ctx->histReceive);
+		ltn_histogram_free(ctx->histTransmit);
+		free(ctx);
+		return -1;
+	}
+	ctx->totalItems = itemsPerSecond;
+	ctx->totalAllocFootprintBytes = (uint64_t)itemsPerSecond * itemLengthBytes;
 
 	/* Spawn a thread that manages the scheduled output queue. */
 	pthread_create(&ctx->threadId, NULL, smoother_pcr_threadFunc, ctx);
@@ -609,17 +689,21 @@ static int smoother_pcr_write2(void *hdl, const unsigned char *buf, unsigned int
 {
 	struct smoother_pcr_context_s *ctx = (struct smoother_pcr_context_s *)hdl;
 
-	if (ctx->blockingWrites) {
+	if (lengthBytes > ctx->itemLengthBytes) {
+		return -1; /* Items are fixed size, smoother_pcr_write() never asks for more. */
+	}
+
+	if (ctx->head - ctx->tailCache >= ctx->ring->capacity) {
+		ctx->tailCache = __atomic_load_n(&ctx->tail, __ATOMIC_ACQUIRE);
+	}
+
+	if (ctx->head - ctx->tailCache >= ctx->ring->capacity && ctx->blockingWrites &&
+		!pthread_equal(pthread_self(), ctx->threadId)) {
 		/* Blocking writes - Prevent faster than realitime filling of our queues, which will extend
 		 * indefintely until all platform memory is consumed (worst cast).
+		 * Never from the output callback, only the consumer drains the ring, it grows instead.
 		 */
-		while (1) {
-			pthread_mutex_lock(&ctx->listMutex);
-			if (!xorg_list_is_empty(&ctx->itemsFree)) {
-				break;
-			}
-			pthread_mutex_unlock(&ctx->listMutex);
-
+		while (ctx->head - ctx->tailCache >= ctx->ring->capacity) {
 			if (ctx->verbose) {
 				char ts[256];
 				time_t now = time(0);
@@ -642,46 +726,34 @@ static int smoother_pcr_write2(void *hdl, const unsigned char *buf, unsigned int
 			}
 
 			usleep(100 * 1000);
+			ctx->tailCache = __atomic_load_n(&ctx->tail, __ATOMIC_ACQUIRE);
 		}
-	} else {
+	} else
+	if (ctx->head - ctx->tailCache >= ctx->ring->capacity) {
 		/* None-blocking */
-		/* Consume as much platform ram to hold faster than realtime writes (from S3). */
-		pthread_mutex_lock(&ctx->listMutex);
-		if (xorg_list_is_empty(&ctx->itemsFree)) {
-			/* Grow the free queue */
-			for (int i = 0; i < 64; i++) {
-				struct smoother_pcr_item_s *item = itemAlloc(ctx->itemLengthBytes);
-				if (!item) {
-					continue;
-				}
-				xorg_list_append(&item->list, &ctx->itemsFree);
-				ctx->qFreeCount++;
-				ctx->totalItemGrowth++;
-				ctx->totalItems++;
-			}
+		/* Consume as much platform ram to hold faster than realtime writes (from S3).
+		 * Double the ring, the consumer migrates the busy items across.
+		 */
+		uint32_t capacity = ctx->ring->capacity * 2;
+		struct smoother_pcr_ring_s *ring = _ringAlloc(capacity, ctx->itemLengthBytes);
+		if (!ring) {
+			return -1;
 		}
-	}
+		_ringRequest(ctx, CTRL_GROW, ring);
 
-	struct smoother_pcr_item_s *item = xorg_list_first_entry(&ctx->itemsFree, struct smoother_pcr_item_s, list);
-	if (!item) {
+		pthread_mutex_lock(&ctx->listMutex);
+		ctx->totalItemGrowth += capacity - ctx->totalItems;
+		ctx->totalItems = capacity;
+		ctx->totalAllocFootprintBytes = (uint64_t)capacity * ctx->itemLengthBytes;
 		pthread_mutex_unlock(&ctx->listMutex);
-		return -1;
 	}
 
-	xorg_list_del(&item->list);
-	ctx->qFreeCount--;
-	pthread_mutex_unlock(&ctx->listMutex);
+	struct smoother_pcr_item_s *item = _ringItem(ctx->ring, ctx->head);
+	itemReset(item);
 
 	item->received_TSuS = makeTimestampFromNow();
 	item->pcrIntervalPerPacketTicks = pcrIntervalPerPacketTicks;
 
-	/* Grow the packet buffer if we really have to */
-	if (item->maxLengthBytes < lengthBytes) {
-		item->buf = realloc(item->buf, lengthBytes);
-		item->maxLengthBytes = lengthBytes;
-		ctx->totalAllocFootprintBytes += lengthBytes;
-	}
-
 	memcpy(item->buf, buf, lengthBytes);
 	item->lengthBytes = lengthBytes;
 
@@ -711,9 +783,8 @@ static int smoother_pcr_write2(void *hdl, const unsigned char *buf, unsigned int
 	item->scheduled_TSuS = getScheduledOutputuS(ctx, pcrValue, pcrIntervalTicks);
 	item->pcrComputed = 0;
 
-	pthread_mutex_lock(&ctx->listMutex);
 	item->seqno = ctx->seqno++;
-	ctx->totalUserBytes += item->lengthBytes;
+	__atomic_add_fetch(&ctx->totalUserBytes, item->lengthBytes, __ATOMIC_RELAXED);
 	if (item->lengthBytes <= 0) {
 		fprintf(stderr, "%s() bug, adding item with negative bytes %d\n", __func__, item->lengthBytes);
 	}
@@ -725,10 +796,8 @@ static int smoother_pcr_write2(void *hdl, const unsigned char *buf, unsigned int
 	 * to resampling the PCR timebase. never append an item with the scheduled time that goes
 	 * backwards, eotherwise they're pulled off the queue in the wrong order very occasionally.
 	 */
-	if (!xorg_list_is_empty(&ctx->itemsBusy)) {
-		struct smoother_pcr_item_s *last = xorg_list_last_entry(&ctx->itemsBusy, struct smoother_pcr_item_s, list);
-		//struct smoother_pcr_item_s *last = ctx->itemsBusy.prev;
-		if (last->scheduled_TSuS > item->scheduled_TSuS) {
+	if (ctx->head != __atomic_load_n(&ctx->tail, __ATOMIC_ACQUIRE)) {
+		if (ctx->lastScheduled_TSuS > item->scheduled_TSuS) {
 			/* Previous versions of this design added 1 tick to the scheduled_TSuS.
 			 * This works well when the input jitter of the stream is fairly low, such
 			 * as from a udp network, with IATs in the 10's of ms range.
@@ -738,16 +807,20 @@ static int smoother_pcr_write2(void *hdl, const unsigned char *buf, unsigned int
 			 * to transmit in packetTicks, and convert to uS.
 			 */
 			int64_t t_uS = (ctx->pcrIntervalPerPacketTicksLast * (item->lengthBytes / 188)) / 27;
-			item->scheduled_TSuS = last->scheduled_TSuS + t_uS;
+			item->scheduled_TSuS = ctx->lastScheduled_TSuS + t_uS;
 		}
 	}
+	ctx->lastScheduled_TSuS = item->scheduled_TSuS;
 
-	/* Queue this for scheduled output */
-	xorg_list_append(&item->list, &ctx->itemsBusy);
-	ctx->qBusyCount++;
-
-	pthread_cond_signal(&ctx->item_add);
-	pthread_mutex_unlock(&ctx->listMutex);
+	/* Queue this for scheduled output. Pairs with _queueWait(), wake the
+	 * consumer only if it went to sleep on an empty ring.
+	 */
+	__atomic_store_n(&ctx->head, ctx->head + 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ctx->consumerSleeping, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&ctx->listMutex);
+		pthread_cond_signal(&ctx->item_add);
+		pthread_mutex_unlock(&ctx->listMutex);
+	}
 
 	return 0;
 }
@@ -760,6 +833,11 @@ int smoother_pcr_write(void *hdl, const unsigned char *buf, int lengthBytes, str
 {
 	struct smoother_pcr_context_s *ctx = (struct smoother_pcr_context_s *)hdl;
 
+	struct timeval arrival;
+	if (!ts) {
+		gettimeofday(&arrival, NULL);
+		ts = &arrival;
+	}
 	ltn_histogram_interval_update(ctx->histReceive, ts);
 #if LOCAL_DEBUG
 	ltn_histogram_interval_print(STDOUT_FILENO, ctx->histReceive, 5);
@@ -924,13 +1002,11 @@ int smoother_pcr_write(void *hdl, const unsigned char *buf, int lengthBytes, str
 int64_t smoother_pcr_get_size(void *hdl)
 {
 	struct smoother_pcr_context_s *ctx = (struct smoother_pcr_context_s *)hdl;
-	int64_t sizeBytes = 0;
+	int64_t sizeBytes = __atomic_load_n(&ctx->totalUserBytes, __ATOMIC_RELAXED);
 
-	pthread_mutex_lock(&ctx->listMutex);
-	if (ctx->totalUserBytes > 0) {
-		sizeBytes = ctx->totalUserBytes;
+	if (sizeBytes < 0) {
+		sizeBytes = 0;
 	}
-	pthread_mutex_unlock(&ctx->listMutex);
 
 	return sizeBytes;
 }
@@ -946,6 +1022,27 @@ int smoother_pcr_set_blocking_writes(void *hdl, unsigned int tf)
 	return 0; /* Success */
 }
 
+int smoother_pcr_set_thread_scheduling(void *hdl, int fifoPriority, int cpu)
+{
+	struct smoother_pcr_context_s *ctx = (struct smoother_pcr_context_s *)hdl;
+	if (!ctx) {
+		return -1;
+	}
+
+	return ltn_pacer_thread_scheduling(ctx->threadId, fifoPriority, cpu);
+}
+
+int smoother_pcr_set_output_flush(void *hdl, smoother_pcr_output_flush_callback cb)
+{
+	struct smoother_pcr_context_s *ctx = (struct smoother_pcr_context_s *)hdl;
+	if (!ctx) {
+		return -1;
+	}
+	ctx->outputFlushCb = cb;
+
+	return 0; /* Success */
+}
+
 int smoother_pcr_set_verbose(void *hdl, unsigned int verbose)
 {
 	struct smoother_pcr_context_s *ctx = (struct smoother_pcr_context_s *)hdl;
@@ -961,22 +1058,12 @@ void smoother_pcr_reset(void *hdl)
 {
 	struct smoother_pcr_context_s *ctx = (struct smoother_pcr_context_s *)hdl;
 
-	pthread_mutex_lock(&ctx->listMutex);
 	ctx->walltimeFirstPCRuS = 0;
 	ctx->pcrFirst = -1;
 	ctx->pcrHead = -1;
 	ctx->pcrTail = -1;
-	ctx->totalUserBytes = 0;
+	ctx->lastScheduled_TSuS = 0;
 
-	while (!xorg_list_is_empty(&ctx->itemsBusy)) {
-		struct smoother_pcr_item_s *item = xorg_list_first_entry(&ctx->itemsBusy, struct smoother_pcr_item_s, list);
-		itemReset(item);
-		xorg_list_del(&item->list);
-		ctx->qBusyCount--;
-
-		xorg_list_append(&item->list, &ctx->itemsFree);
-		ctx->qFreeCount++;
-	}
-
-	pthread_mutex_unlock(&ctx->listMutex);
+	/* The consumer owns tail, have it discard every busy item. */
+	_ringRequest(ctx, CTRL_RESET, NULL);
 }
@@ -4,6 +4,7 @@
 
 #include "libltntstools/ltntstools.h"
 #include "xorg-list.h"
+#include "pacer.h"
 
 #define LOCAL_DEBUG 0
 
@@ -102,9 +103,11 @@ struct smoother_rtp_context_s
 	struct xorg_list itemsFree;
 	struct xorg_list itemsBusy;
 	pthread_mutex_t listMutex;
+	pthread_cond_t item_add;   /* signalling on addition to an empty busy list */
 
 	void *userContext;
 	smoother_rtp_output_callback outputCb;
+	smoother_rtp_output_flush_callback outputFlushCb;
 
 	uint64_t walltimeFirstTimestampuS; /* Reset this when the clock significantly leaps backwards */
 	int64_t tsFirst; /* Reset this when the clock significantly leaps backwards, 90KHz */
@@ -145,6 +148,9 @@ struct smoother_rtp_context_s
 
 	struct ltn_histogram_s *histReceive;
 	struct ltn_histogram_s *histTransmit;
+
+	struct ltn_pacer_s pacer;  /* Output thread only. Deadline sleeps until the next item is due */
+	uint64_t nextDueuS;        /* Output thread only. Schedule of the first busy item, 0 when idle */
 };
 
 /* based on first received pcr, and first received walltime, compute a new walltime
@@ -161,33 +167,10 @@ static uint64_t getScheduledOutputuS(struct smoother_rtp_context_s *ctx, int64_t
 	return scheduledTimeuS;
 }
 
-static inline uint64_t makeTimestampFromTimeval(struct timeval *ts)
-{
-	uint64_t t = ((int64_t)ts->tv_sec * 1000000LL) + ts->tv_usec;
-	return t;
-}
-
+/* Scheduling runs on the monotonic clock, immune to wall clock steps, and shared with the pacer. */
 static inline uint64_t makeTimestampFromNow()
 {
-	struct timeval now;
-	gettimeofday(&now, NULL);
-	return makeTimestampFromTimeval(&now);
-}
-
-static inline uint64_t makeTimestampFrom1SecondAgo()
-{
-	struct timeval now;
-	gettimeofday(&now, NULL);
-	now.tv_sec--;
-	return makeTimestampFromTimeval(&now);
-}
-
-static inline uint64_t makeTimestampFrom2SecondAgo()
-{
-	struct timeval now;
-	gettimeofday(&now, NULL);
-	now.tv_sec--;
-	return makeTimestampFromTimeval(&now);
+	return ltn_pacer_now_us();
 }
 
 static void itemFree(struct smoother_rtp_item_s *item)
@@ -285,8 +268,9 @@ static int _queueProcess(struct smoother_rtp_context_s *ctx, int64_t uS)
 	struct xorg_list loclist;
 	xorg_list_init(&loclist);
 
-	int count = 0, totalItems = 0, redundantItems = 0;
+	int count = 0, totalItems = 0;
 	struct smoother_rtp_item_s *e = NULL, *next = NULL;
+	ctx->nextDueuS = 0;
 	xorg_list_for_each_entry_safe(e, next, &ctx->itemsBusy, list) {
 		totalItems++;
 
@@ -299,17 +283,16 @@ static int _queueProcess(struct smoother_rtp_context_s *ctx, int64_t uS)
 			xorg_list_append(&e->list, &loclist);
 			count++;
 		} else {
-			if (count > 0) {
-				/* Time ordering problem on the list now. Dump both lists and abort, later.*/
-				redundantItems++;
-			}
+			/* The list is time ordered (see smoother_rtp_write2), everything beyond
+			 * this point is in the future. Remember when the next item is due.
+			 */
+			ctx->nextDueuS = e->scheduled_TSuS;
+			break;
 		}
-		/* TODO: The list is time ordered so we shoud be able to break
-		 * when we find a time that's beyond out window, and save CPU time.
-		 */
 	}
 
-	/* Make sure the busy list is contigious */
+#if LOCAL_DEBUG
+	/* Make sure the busy list is contigious. The performance of this sucks */
 	e = NULL;
 	next = NULL;
 	int countSeq = 0;
@@ -332,6 +315,7 @@ static int _queueProcess(struct smoother_rtp_context_s *ctx, int64_t uS)
 		}
 		last_seq = e->seqno;
 	}
+#endif
 
 	pthread_mutex_unlock(&ctx->listMutex);
 
@@ -366,6 +350,10 @@ static int _queueProcess(struct smoother_rtp_context_s *ctx, int64_t uS)
 		}
 	}
 
+	if (ctx->outputFlushCb) {
+		ctx->outputFlushCb(ctx->userContext);
+	}
+
 	/* Take the mutex again to return the spent items to the free list */
 	e = NULL, next = NULL;
 	pthread_mutex_lock(&ctx->listMutex);
@@ -379,6 +367,26 @@ static int _queueProcess(struct smoother_rtp_context_s *ctx, int64_t uS)
 	return 0;
 }
 
+/* Called with listMutex held and nothing busy, sleep until smoother_rtp_write2() queues an item.
+ * Bounded, so termination is noticed.
+ */
+static void _queueWait(struct smoother_rtp_context_s *ctx)
+{
+	struct timespec abstime;
+	clock_gettime(CLOCK_MONOTONIC, &abstime);
+	abstime.tv_nsec += 10 * 1000 * 1000;
+	if (abstime.tv_nsec >= 1000000000) {
+		abstime.tv_sec++;
+		abstime.tv_nsec -= 1000000000;
+	}
+
+	while (xorg_list_is_empty(&ctx->itemsBusy) && !ctx->threadTerminate) {
+		if (pthread_cond_timedwait(&ctx->item_add, &ctx->listMutex, &abstime) != 0) {
+			break;
+		}
+	}
+}
+
 extern int ltnpthread_setname_np(pthread_t thread, const char *name);
 
 static void * _threadFunc(void *p)
@@ -387,6 +395,8 @@ static void * _threadFunc(void *p)
 
 	pthread_detach(ctx->threadId);
 	ltnpthread_setname_np(ctx->threadId, "thread-rtpsmooth");
+	ltn_pacer_thread_init();
+	ltn_pacer_init(&ctx->pacer);
 
 	ctx->threadTerminated = 0;
 	ctx->threadRunning = 1;
@@ -394,8 +404,8 @@ static void * _threadFunc(void *p)
 	while (!ctx->threadTerminate) {
 		pthread_mutex_lock(&ctx->listMutex);
 		if (xorg_list_is_empty(&ctx->itemsBusy)) {
+			_queueWait(ctx);
 			pthread_mutex_unlock(&ctx->listMutex);
-			usleep(1 * 1000);
 			continue;
 		}
 
@@ -403,9 +413,11 @@ static void * _threadFunc(void *p)
 
 		/* Service the output schedule queue, output any UDP packets when they're due.
 		 * Important to remember that we're calling this func while we're holding the mutex.
+		 * Otherwise sleep until the next item is due, new items are never scheduled earlier.
 		 */
-		if (_queueProcess(ctx, uS) < 0)
-			usleep(1 * 1000);
+		if (_queueProcess(ctx, uS) < 0 && ctx->nextDueuS) {
+			ltn_pacer_wait_until(&ctx->pacer, ctx->nextDueuS, 10 * 1000);
+		}
 
 	}
 	ctx->threadRunning = 1;
@@ -429,6 +441,12 @@ int smoother_rtp_alloc(void **hdl, void *userContext, smoother_rtp_output_callba
 	xorg_list_init(&ctx->itemsFree);
 	xorg_list_init(&ctx->itemsBusy);
 	pthread_mutex_init(&ctx->listMutex, NULL);
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&ctx->item_add, &attr);
+	pthread_condattr_destroy(&attr);
 	ctx->userContext = userContext;
 	ctx->outputCb = cb;
 	ctx->itemLengthBytes = itemLengthBytes;
@@ -547,8 +565,12 @@ int smoother_rtp_write2(void *hdl, const unsigned char *buf, int lengthBytes, in
 		}
 	}
 
-	/* Queue this for scheduled output */
+	/* Queue this for scheduled output, the output thread only sleeps on an empty list. */
+	int wasEmpty = xorg_list_is_empty(&ctx->itemsBusy);
 	xorg_list_append(&item->list, &ctx->itemsBusy);
+	if (wasEmpty) {
+		pthread_cond_signal(&ctx->item_add);
+	}
 	pthread_mutex_unlock(&ctx->listMutex);
 
 	return 0;
@@ -558,6 +580,11 @@ int smoother_rtp_write(void *hdl, const unsigned char *buf, int lengthBytes, str
 {
 	struct smoother_rtp_context_s *ctx = (struct smoother_rtp_context_s *)hdl;
 
+	struct timeval arrival;
+	if (!ts) {
+		gettimeofday(&arrival, NULL);
+		ts = &arrival;
+	}
 	ltn_histogram_interval_update(ctx->histReceive, ts);
 #if LOCAL_DEBUG
 	ltn_histogram_interval_print(STDOUT_FILENO, ctx->histReceive, 5);
@@ -729,6 +756,26 @@ int64_t smoother_rtp_get_size(void *hdl)
 	return sizeBytes;
 }
 
+int smoother_rtp_set_thread_scheduling(void *hdl, int fifoPriority, int cpu)
+{
+	struct smoother_rtp_context_s *ctx = (struct smoother_rtp_context_s *)hdl;
+	if (!ctx)
+		return -1;
+
+	return ltn_pacer_thread_scheduling(ctx->threadId, fifoPriority, cpu);
+}
+
+int smoother_rtp_set_output_flush(void *hdl, smoother_rtp_output_flush_callback cb)
+{
+	struct smoother_rtp_context_s *ctx = (struct smoother_rtp_context_s *)hdl;
+	if (!ctx)
+		return -1;
+
+	ctx->outputFlushCb = cb;
+
+	return 0; /* Success */
+}
+
 void smoother_rtp_reset(void *hdl)
 {
 	struct smoother_rtp_context_s *ctx = (struct smoother_rtp_context_s *)hdl;
@@ -0,0 +1,227 @@
+/* Copyright LiveTimeNet, Inc. 2026. All Rights Reserved. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "libltntstools/ltntstools.h"
+
+/* Pieces start on whole UDP datagrams of 7 packets, so a clean capture is fed as a live receiver would see it.
+ * Batches are still cut short at piece ends, resyncs and the end of the file, a file has no datagrams to
+ * measure, so notMultipleOfSeven isn't taken from the pieces.
+ */
+#define SHARD_ALIGNMENT (7 * 188)
+#define SHARDS_PER_THREAD 4
+#define BATCH_PACKETS (7 * 32)
+
+struct shard_s
+{
+	uint64_t start; /* Nominal byte range, packets starting in [start, end) belong to this shard */
+	uint64_t end;
+	struct ltntstools_stream_statistics_s *stats;
+	int result;
+};
+
+struct analyze_s
+{
+	const char *filename;
+	struct ltntstools_stream_statistics_s *stream; /* Template configuration, read only until the merge */
+
+	struct shard_s *shards;
+	int shardCount;
+	int nextShard;
+};
+
+/* A fresh stats object, configured like the callers. */
+static struct ltntstools_stream_statistics_s *_shard_stats_alloc(struct ltntstools_stream_statistics_s *stream)
+{
+	struct ltntstools_stream_statistics_s *stats;
+	if (ltntstools_pid_stats_alloc(&stats) < 0)
+		return NULL;
+
+	if (stream->internal_hot && ltntstools_pid_stats_enable_packed_counters(stats) < 0) {
+		ltntstools_pid_stats_free(stats);
+		return NULL;
+	}
+
+	struct ltntstools_pid_statistics_s *pid;
+	ltntstools_stats_for_each_discovered_pid(stream, pidnr, pid) {
+		if (pid->hasPCR)
+			ltntstools_pid_stats_pid_set_contains_pcr(stats, pidnr);
+	}
+
+	return stats;
+}
+
+static int _shard_process(struct analyze_s *ctx, void *reader, struct shard_s *sh)
+{
+	sh->stats = _shard_stats_alloc(ctx->stream);
+	if (!sh->stats)
+		return -1;
+
+	if (ltntstools_ts_file_reader_seek(reader, sh->start) < 0)
+		return -1;
+
+	const uint8_t *pkts;
+	int count;
+	while ((count = ltntstools_ts_file_reader_next(reader, &pkts, BATCH_PACKETS)) > 0) {
+		uint64_t pos = ltntstools_ts_file_reader_get_position(reader) - (count * 188);
+		if (pos >= sh->end)
+			break;
+
+		/* Stop at the first packet that starts in the next shard, it resyncs to the same packet. */
+		uint64_t remain = (sh->end - pos + 187) / 188;
+		if (count > remain)
+			count = remain;
+
+		struct timeval ts;
+		gettimeofday(&ts, NULL);
+		ltntstools_pid_stats_update_with_timestamp(sh->stats, pkts, count, &ts);
+	}
+
+	sh->stats->notMultipleOfSevenError = 0;
+	sh->stats->last_notMultipleOfSeven_error = 0;
+
+	return 0;
+}
+
+/* Exchange the measurements of a and b. Each cc error history stays in place, its list head
+ * points at itself, so only the metrics move, from b to a. b is left for freeing.
+ */
+static void _stats_take(struct ltntstools_stream_statistics_s *a, struct ltntstools_stream_statistics_s *b)
+{
+	struct ltntstools_history_metric_collection_s ha = a->ccErrorHistory;
+	struct ltntstools_history_metric_collection_s hb = b->ccErrorHistory;
+	struct ltntstools_stream_statistics_s t = *a;
+
+	*a = *b;
+	*b = t;
+	a->ccErrorHistory = ha;
+	b->ccErrorHistory = hb;
+
+	ltntstools_history_metric_collection_reset(&a->ccErrorHistory);
+
+	/* Newest first, appending in turn keeps the order */
+	struct ltntstools_history_metric_s *m = NULL, *next = NULL;
+	pthread_mutex_lock(&a->ccErrorHistory.lock);
+	pthread_mutex_lock(&b->ccErrorHistory.lock);
+	xorg_list_for_each_entry_safe(m, next, &b->ccErrorHistory.list, list) {
+		xorg_list_del(&m->list);
+		xorg_list_append(&m->list, &a->ccErrorHistory.list);
+	}
+	pthread_mutex_unlock(&b->ccErrorHistory.lock);
+	pthread_mutex_unlock(&a->ccErrorHistory.lock);
+}
+
+static void *_analyze_thread(void *p)
+{
+	struct analyze_s *ctx = (struct analyze_s *)p;
+
+	void *reader;
+	if (ltntstools_ts_file_reader_alloc(&reader, ctx->filename) < 0) {
+		/* Leave the shards for the other threads, unclaimed shards fail the analysis. */
+		return NULL;
+	}
+
+	int nr;
+	while ((nr = __atomic_fetch_add(&ctx->nextShard, 1, __ATOMIC_RELAXED)) < ctx->shardCount) {
+		struct shard_s *sh = &ctx->shards[nr];
+		sh->result = _shard_process(ctx, reader, sh);
+	}
+
+	ltntstools_ts_file_reader_free(reader);
+
+	return NULL;
+}
+
+int ltntstools_pid_stats_analyze_file(struct ltntstools_stream_statistics_s *stream, const char *filename, int threadCount)
+{
+	if (!stream || !stream->internal_pids || !filename)
+		return -1;
+
+	void *reader;
+	if (ltntstools_ts_file_reader_alloc(&reader, filename) < 0)
+		return -1;
+	uint64_t length = ltntstools_ts_file_reader_get_length(reader);
+	ltntstools_ts_file_reader_free(reader);
+
+	if (threadCount <= 0)
+		threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threadCount <= 0)
+		threadCount = 1;
+
+	uint64_t shardCount = threadCount * SHARDS_PER_THREAD;
+	if (shardCount > length / SHARD_ALIGNMENT)
+		shardCount = length / SHARD_ALIGNMENT;
+	if (shardCount == 0)
+		shardCount = 1;
+	if (threadCount > shardCount)
+		threadCount = shardCount;
+
+	uint64_t shardSize = (length / shardCount) + SHARD_ALIGNMENT - 1;
+	shardSize -= shardSize % SHARD_ALIGNMENT;
+
+	struct analyze_s ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.filename = filename;
+	ctx.stream = stream;
+	ctx.shardCount = shardCount;
+	ctx.shards = calloc(shardCount, sizeof(struct shard_s));
+	if (!ctx.shards)
+		return -1;
+
+	for (int i = 0; i < shardCount; i++) {
+		ctx.shards[i].start = i * shardSize;
+		ctx.shards[i].end = (i + 1 == shardCount) ? length : (i + 1) * shardSize;
+		if (ctx.shards[i].start > length)
+			ctx.shards[i].start = length;
+		if (ctx.shards[i].end > length)
+			ctx.shards[i].end = length;
+		ctx.shards[i].result = -1; /* Until processed */
+	}
+
+	pthread_t *threads = calloc(threadCount, sizeof(pthread_t));
+	if (!threads) {
+		free(ctx.shards);
+		return -1;
+	}
+
+	int started = 0;
+	for (int i = 0; i < threadCount; i++) {
+		if (pthread_create(&threads[i], NULL, _analyze_thread, &ctx) != 0)
+			break;
+		started++;
+	}
+	if (started == 0) {
+		/* No threads available, do the work ourselves. */
+		_analyze_thread(&ctx);
+	}
+	for (int i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+
+	/* Merge in file order, so continuity is checked across every join. Into a copy,
+	 * the callers stream is only updated once every piece has merged.
+	 */
+	struct ltntstools_stream_statistics_s *merged = ltntstools_pid_stats_clone(stream);
+	int ret = merged ? 0 : -1;
+	for (int i = 0; i < shardCount; i++) {
+		struct shard_s *sh = &ctx.shards[i];
+		if (ret == 0 && (sh->result < 0 || ltntstools_pid_stats_merge(merged, sh->stats) < 0))
+			ret = -1;
+		if (sh->stats)
+			ltntstools_pid_stats_free(sh->stats);
+	}
+	free(ctx.shards);
+
+	if (ret == 0)
+		_stats_take(stream, merged);
+	if (merged)
+		ltntstools_pid_stats_free(merged);
+
+	return ret;
+}
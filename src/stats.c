@@ -15,6 +15,7 @@ void     ltntstools_cc_reorder_table_reset(struct ltntstools_cc_reorder_table_s
 static void _stream_increment_cc_errors(struct ltntstools_stream_statistics_s *stream, struct timeval *ts);
 static void _pidArrayFree(struct ltntstools_stream_statistics_s *stream);
 static int _pidArrayAdd(struct ltntstools_stream_statistics_s *stream, uint16_t pidNr);
+static struct ltntstools_pid_statistics_s *_pid_stats_alloc_pid(struct ltntstools_stream_statistics_s *stream, uint16_t pidnr);
 void ltntstools_pid_statistics_free(struct ltntstools_pid_statistics_s *pid);
 
 static int ltntstools_bitrate_calculator_init(struct ltntstools_stream_statistics_s *stream, uint16_t pcrpidnr);
@@ -22,6 +23,13 @@ static void ltntstools_bitrate_calculator_reset(struct ltntstools_stream_statist
 static int ltntstools_bitrate_calculator_write(struct ltntstools_stream_statistics_s *stream, const uint8_t *pkts,
 	unsigned int packetCount, int *complete);
 
+/* Counters that ltntstools_pid_stats_snapshot_take() reads from another thread. The update thread is
+ * the only writer, so a relaxed load and store is enough, no locked read-modify-write on the packet path.
+ */
+#define STAT_LOAD(x)     __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define STAT_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define STAT_INC(x)      STAT_STORE((x), (x) + 1)
+
 static struct ltn_histogram_s *ltntstools_histogram_clone(struct ltn_histogram_s *src)
 {
 	struct ltn_histogram_s *dst = NULL;
@@ -162,6 +170,7 @@ void ltntstools_pid_statistics_reset(struct ltntstools_pid_statistics_s *pid)
 	pid->prev_pcrExceeds40ms = 0;
 	pid->payloadPUSIErrors = 0;
 	pid->lastCC = 0;
+	memset(pid->firstHeader, 0, sizeof(pid->firstHeader));
 	pid->pps_last_update = 0;
 	pid->pps = 0;
 	pid->pps_window = 0;
@@ -271,9 +280,9 @@ void ltntstools_bytestream_stats_update(struct ltntstools_stream_statistics_s *s
 	time_t now;
 	time(&now);
 
-	stream->internal_packetCount++;
+	STAT_INC(stream->internal_packetCount);
 	if (lengthBytes != (7 * 188)) {
-		stream->notMultipleOfSevenError++;
+		STAT_INC(stream->notMultipleOfSevenError);
 		stream->last_notMultipleOfSeven_error = now;
 	}
 
@@ -295,7 +304,7 @@ void ltntstools_ctp_stats_update(struct ltntstools_stream_statistics_s *stream,
 	time(&now);
 
 	if (lengthBytes != (7 * 188)) {
-		stream->notMultipleOfSevenError++;
+		STAT_INC(stream->notMultipleOfSevenError);
 		stream->last_notMultipleOfSeven_error = now;
 	}
 	if (lengthBytes < 4) {
@@ -316,7 +325,7 @@ void ltntstools_ctp_stats_update(struct ltntstools_stream_statistics_s *stream,
 	 * But some rounding down will occur.
 	 * TODO: Add a CTP correct mechanism.
 	 */
-	stream->internal_packetCount++;
+	STAT_INC(stream->internal_packetCount);
 
 	/* Update / maintain bitrate */
 	if (now != stream->Bps_last_update) {
@@ -339,7 +348,7 @@ static void _stream_increment_cc_errors(struct ltntstools_stream_statistics_s *s
 		gettimeofday(&now, NULL);
 	}
 
-	stream->internal_ccErrors++;
+	STAT_INC(stream->internal_ccErrors);
 	stream->last_cc_error = now.tv_sec;
 
 	struct ltntstools_history_metric_s *m = ltntstools_history_metric_alloc(now.tv_sec, 1);
@@ -351,22 +360,197 @@ static void _stream_increment_cc_errors(struct ltntstools_stream_statistics_s *s
 	}
 }
 
-void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream, const uint8_t *pkts, uint32_t packetCount)
+/* The PCR timing for a pid the user has told us contains a PCR. */
+static void _pid_pcr_update(struct ltntstools_stream_statistics_s *stream, struct ltntstools_pid_statistics_s *pid,
+	const uint8_t *pkt, uint16_t pidnr)
 {
-	if (!stream || !stream->internal_pids || !pkts) {
-		return;
+	/* If the clock is not yet established. */
+	struct ltntstools_clock_s *pcrclk = &pid->clocks[ltntstools_CLOCK_PCR];
+	/* Attempt to extract a PCR from this packet. */
+	uint64_t pcr;
+	if (ltntstools_scr((uint8_t *)pkt, &pcr) == 0) {
+		if (pid->seenPCR++ < 100)
+			return;
+
+		if (ltntstools_clock_is_established_timebase(pcrclk) == 0) {
+			ltntstools_clock_initialize(pcrclk);
+			ltntstools_clock_establish_timebase(pcrclk, 27 * 1e6);
+
+			/* One time initialzation of our histograms. */
+			char title[64];
+			sprintf(title, "PCR Tick Intervals PID 0x%04x", pidnr);
+			ltn_histogram_alloc_video_defaults(&pid->pcrTickIntervals, title);
+
+			sprintf(title, "PCR Jitter PID 0x%04x (abs value)", pidnr);
+			ltn_histogram_alloc_video_defaults(&pid->pcrWallDrift, title);
+		}
+
+		if (ltntstools_clock_is_established_wallclock(pcrclk) == 0) {
+			ltntstools_clock_establish_wallclock(pcrclk, pcr);
+		}
+
+		/* Compute the interval in ticks, raise stats errors if they exceeed.
+		 * a) 100ms without a stated discontinuity or
+		 * b) 40ms.
+		 */
+		int64_t delta = ltntstools_clock_compute_delta(pcrclk, pcr, ltntstools_clock_get_ticks(pcrclk));
+		pid->prev_pcrExceeds40ms = pid->pcrExceeds40ms;
+		stream->prev_pcrExceeds40ms = stream->pcrExceeds40ms;
+		if (delta > (27000 * 40)) {
+			STAT_INC(pid->pcrExceeds40ms);
+			STAT_INC(stream->pcrExceeds40ms);
+		}
+
+		ltn_histogram_interval_update_with_value(pid->pcrTickIntervals, delta / 27000);
+
+		/* Update current value and re-compute drifts. */
+		ltntstools_clock_set_ticks(pcrclk, pcr);
+		ltntstools_clock_get_drift_us(pcrclk);
+
+		int64_t v = ltntstools_clock_get_drift_us(pcrclk) / 1000; /* In ms */
+		pid->lastPCRWalltimeDriftMs = v;
+
+		/* Normalize to remove drift direction - needed for histogram */
+		v = abs(v);
+		//printf("us %" PRIi64 "\n", v);
+		ltn_histogram_interval_update_with_value(pid->pcrWallDrift, v);
+
+		if (stream->notifications[EVENT_UPDATE_PID_PCR_WALLTIME].cb) {
+			stream->notifications[EVENT_UPDATE_PID_PCR_WALLTIME].cb(stream->notifications[EVENT_UPDATE_PID_PCR_WALLTIME].userContext, 
+				EVENT_UPDATE_PID_PCR_WALLTIME, stream, pid);
+		}
+		if (stream->notifications[EVENT_UPDATE_PID_PCR_EXCEEDS_40MS].cb && delta > (27000 * 40)) {
+			stream->notifications[EVENT_UPDATE_PID_PCR_EXCEEDS_40MS].cb(stream->notifications[EVENT_UPDATE_PID_PCR_EXCEEDS_40MS].userContext, 
+				EVENT_UPDATE_PID_PCR_EXCEEDS_40MS, stream, pid);
+		}
+
 	}
+}
 
-	struct timeval ts;
-	gettimeofday(&ts, NULL);
+/* Rare per packet events, and the once per second rollover, for the packed layout.
+ * The only place the cold pid object is touched on the packet path.
+ */
+static void _pid_stats_update_cold(struct ltntstools_stream_statistics_s *stream, struct ltntstools_pid_hot_counters_s *hot,
+	const uint8_t *pkt, uint16_t pidnr, const struct timeval *ts, int pusi, int isCCError, int rollover)
+{
+	struct ltntstools_pid_statistics_s *pid = stream->internal_pids[pidnr];
 
-	time_t now;
-	time(&now);
+	if (ltntstools_isPayloadPUSIInError(pkt)) {
+		STAT_INC(pid->payloadPUSIErrors);
+		STAT_INC(stream->payloadPUSIErrors);
+	}
 
-	if (packetCount != 7) {
-		stream->notMultipleOfSevenError++;
-		stream->last_notMultipleOfSeven_error = now;
+	if (pusi) {
+		pid->pusi_time_current.tv_sec = hot->lastSeenUs / 1000000;
+		pid->pusi_time_current.tv_usec = hot->lastSeenUs % 1000000;
+
+		if (pid->pusi_time_first.tv_sec && pid->pusi_time_current.tv_sec) {
+			pid->pusi_time_ms = ltn_timeval_subtract_ms(&pid->pusi_time_current, &pid->pusi_time_first);
+
+			if (stream->notifications[EVENT_UPDATE_PID_PUSI_DELIVERY_TIME].cb) {
+				stream->notifications[EVENT_UPDATE_PID_PUSI_DELIVERY_TIME].cb(stream->notifications[EVENT_UPDATE_PID_PUSI_DELIVERY_TIME].userContext, 
+					EVENT_UPDATE_PID_PUSI_DELIVERY_TIME, stream, pid);
+			}
+		}
+
+		pid->pusi_time_first = *ts; /* And the process resets collection again */
+	}
+
+	if (rollover) {
+		pid->pps = hot->pps_window;
+		hot->pps_window = 0;
+		pid->mbps = pid->pps;
+		pid->mbps *= (188 * 8);
+		pid->mbps /= 1e6;
+		pid->pps_last_update = ts->tv_sec;
+		hot->pps_last_update = ts->tv_sec;
+
+		/* Keep the cold object roughly current for anyone reading the struct directly. */
+		STAT_STORE(pid->internal_packetCount, hot->packetCount);
+		pid->lastCC = hot->lastCC;
+		pid->pusi_time_current = *ts;
+	}
+
+	if (isCCError) {
+		STAT_INC(pid->internal_ccErrors);
+		_stream_increment_cc_errors(stream, (struct timeval *)ts);
+	}
+
+	if (ltntstools_transport_scrambling_control(pkt) != 0) {
+		STAT_INC(pid->scrambledCount);
+		STAT_INC(stream->scrambledCount);
+
+		if (stream->notifications[EVENT_UPDATE_STREAM_SCRAMBLED_COUNT].cb) {
+			stream->notifications[EVENT_UPDATE_STREAM_SCRAMBLED_COUNT].cb(stream->notifications[EVENT_UPDATE_STREAM_SCRAMBLED_COUNT].userContext, 
+				EVENT_UPDATE_STREAM_SCRAMBLED_COUNT, stream, pid);
+		}
+	}
+
+	if (ltntstools_tei_set(pkt)) {
+		STAT_INC(pid->teiErrors);
+		STAT_INC(stream->teiErrors);
+		if (stream->notifications[EVENT_UPDATE_STREAM_TEI_COUNT].cb) {
+			stream->notifications[EVENT_UPDATE_STREAM_TEI_COUNT].cb(stream->notifications[EVENT_UPDATE_STREAM_TEI_COUNT].userContext, 
+				EVENT_UPDATE_STREAM_TEI_COUNT, stream, pid);
+		}
+	}
+
+	if (hot->flags & LTNTSTOOLS_PID_HOT_HAS_PCR) {
+		_pid_pcr_update(stream, pid, pkt, pidnr);
+	}
+}
+
+/* Per packet accounting against the packed hot counter array, one small struct per packet,
+ * no pointer chasing. See ltntstools_pid_stats_enable_packed_counters().
+ */
+static void _pid_stats_update_packed(struct ltntstools_stream_statistics_s *stream, const uint8_t *pkts, uint32_t packetCount,
+	const struct timeval *ts)
+{
+	uint32_t now = ts->tv_sec;
+	int64_t nowUs = ((int64_t)ts->tv_sec * 1000000) + ts->tv_usec;
+
+	for (int i = 0; i < packetCount; i++) {
+		const uint8_t *pkt = pkts + (i * 188);
+
+		uint16_t pidnr = ltntstools_pid(pkt);
+		struct ltntstools_pid_hot_counters_s *hot = &stream->internal_hot[pidnr];
+
+		if ((hot->flags & LTNTSTOOLS_PID_HOT_ALLOCATED) == 0) {
+			/* New pid arrived, cold data is allocated lazily, once. */
+			if (_pid_stats_alloc_pid(stream, pidnr) == NULL) {
+				continue;
+			}
+			hot->flags |= LTNTSTOOLS_PID_HOT_ALLOCATED;
+		}
+
+		STAT_INC(hot->packetCount);
+		if (hot->packetCount == 1) {
+			memcpy(stream->internal_pids[pidnr]->firstHeader, pkt, sizeof(stream->internal_pids[pidnr]->firstHeader));
+		}
+
+		int pusi = ltntstools_payload_unit_start_indicator(pkt);
+		int isCCError = ltntstools_isCCInError(pkt, hot->lastCC) && hot->packetCount > 1 && pidnr != 0x1fff;
+		int rollover = hot->pps_last_update != now;
+
+		if (pusi || isCCError || rollover ||
+			(pkt[1] & 0x80) /* TEI */ || (pkt[3] & 0xc0) /* Scrambled */ ||
+			(hot->flags & LTNTSTOOLS_PID_HOT_HAS_PCR))
+		{
+			_pid_stats_update_cold(stream, hot, pkt, pidnr, ts, pusi, isCCError, rollover);
+		}
+
+		hot->pps_window++;
+		hot->lastCC = ltntstools_continuity_counter(pkt);
+		hot->lastSeenUs = nowUs;
 	}
+}
+
+/* Everything downstream of here runs on the callers view of time, no clock reads. */
+static void _pid_stats_update(struct ltntstools_stream_statistics_s *stream, const uint8_t *pkts, uint32_t packetCount,
+	const struct timeval *timestamp)
+{
+	struct timeval ts = *timestamp;
+	time_t now = ts.tv_sec;
 
 	if (stream->bc_ctx.pcrpidnr) {
 		int complete;
@@ -380,7 +564,7 @@ void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream,
 	for (int i = 0; i < packetCount; i++) {
 		int offset = i * 188;
 		if (*(pkts + offset) == 0x47)
-			stream->internal_packetCount++;
+			STAT_INC(stream->internal_packetCount);
 		else {
 			_stream_increment_cc_errors(stream, &ts);
 		}
@@ -404,9 +588,9 @@ void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream,
 	if (stream->iat_last_frame.tv_sec) {
 		stream->iat_cur_us = ltn_timeval_subtract_us(&ts, &stream->iat_last_frame);
 		if (stream->iat_cur_us <= stream->iat_lwm_us)
-			stream->iat_lwm_us = stream->iat_cur_us;
+			STAT_STORE(stream->iat_lwm_us, stream->iat_cur_us);
 		if (stream->iat_cur_us >= stream->iat_hwm_us) {
-			stream->iat_hwm_us = stream->iat_cur_us;
+			STAT_STORE(stream->iat_hwm_us, stream->iat_cur_us);
 			if (stream->notifications[EVENT_UPDATE_STREAM_IAT_HWM].cb) {
 				stream->notifications[EVENT_UPDATE_STREAM_IAT_HWM].cb(stream->notifications[EVENT_UPDATE_STREAM_IAT_HWM].userContext, 
 					EVENT_UPDATE_STREAM_IAT_HWM, stream, NULL);
@@ -426,6 +610,12 @@ void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream,
 		ltn_histogram_interval_update_with_value(stream->packetIntervals, stream->iat_cur_us / 1000);
 	}
 
+	if (stream->internal_hot) {
+		_pid_stats_update_packed(stream, pkts, packetCount, &ts);
+		stream->iat_last_frame = ts;
+		return;
+	}
+
 	for (int i = 0; i < packetCount; i++) {
 		int offset = i * 188;
 
@@ -433,24 +623,21 @@ void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream,
 		struct ltntstools_pid_statistics_s *pid = stream->internal_pids[pidnr];
 		if (pid == NULL) {
 			/* New pid arrived, make sure we have space for it. */
-			stream->internal_pids[pidnr] = ltntstools_pid_statistics_alloc(pidnr);
-			pid = stream->internal_pids[pidnr];
+			pid = _pid_stats_alloc_pid(stream, pidnr);
 			if (!pid) {
 				continue;
 			}
-			if (_pidArrayAdd(stream, pidnr) < 0) {
-				ltntstools_pid_statistics_free(pid);
-				stream->internal_pids[pidnr] = NULL;
-				continue;
-			}
 		}
 
 		pid->enabled = 1;
-		pid->internal_packetCount++;
+		STAT_INC(pid->internal_packetCount);
+		if (pid->internal_packetCount == 1) {
+			memcpy(pid->firstHeader, pkts + offset, sizeof(pid->firstHeader));
+		}
 
 		if (ltntstools_isPayloadPUSIInError(pkts + offset)) {
-			pid->payloadPUSIErrors++;
-			stream->payloadPUSIErrors++;
+			STAT_INC(pid->payloadPUSIErrors);
+			STAT_INC(stream->payloadPUSIErrors);
 		}
 
 		/* Per pid, of PUSI is being used, track the time we see the header
@@ -497,7 +684,7 @@ void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream,
 		int isCCError = ltntstools_isCCInError(pkts + offset, pid->lastCC);
 		if (isCCError) {
 			if (pid->internal_packetCount > 1 && pidnr != 0x1fff) {
-				pid->internal_ccErrors++;
+				STAT_INC(pid->internal_ccErrors);
 				_stream_increment_cc_errors(stream, &ts);
 			}
 		}
@@ -510,8 +697,8 @@ void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream,
 #endif
 		uint8_t sc = ltntstools_transport_scrambling_control(pkts + offset);
 		if (sc != 0) {
-			pid->scrambledCount++;
-			stream->scrambledCount++;
+			STAT_INC(pid->scrambledCount);
+			STAT_INC(stream->scrambledCount);
 
 			if (stream->notifications[EVENT_UPDATE_STREAM_SCRAMBLED_COUNT].cb) {
 				stream->notifications[EVENT_UPDATE_STREAM_SCRAMBLED_COUNT].cb(stream->notifications[EVENT_UPDATE_STREAM_SCRAMBLED_COUNT].userContext, 
@@ -523,8 +710,8 @@ void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream,
 		pid->lastCC = cc;
 
 		if (ltntstools_tei_set(pkts + offset)) {
-			pid->teiErrors++;
-			stream->teiErrors++;
+			STAT_INC(pid->teiErrors);
+			STAT_INC(stream->teiErrors);
 			if (stream->notifications[EVENT_UPDATE_STREAM_TEI_COUNT].cb) {
 				stream->notifications[EVENT_UPDATE_STREAM_TEI_COUNT].cb(stream->notifications[EVENT_UPDATE_STREAM_TEI_COUNT].userContext, 
 					EVENT_UPDATE_STREAM_TEI_COUNT, stream, pid);
@@ -535,71 +722,44 @@ void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream,
 		 * then process the PCR timing.
 		 */
 		if (pid->hasPCR) {
-			/* If the clock is not yet established. */
-			struct ltntstools_clock_s *pcrclk = &pid->clocks[ltntstools_CLOCK_PCR];
-			/* Attempt to extract a PCR from this packet. */
-			uint64_t pcr;
-			if (ltntstools_scr((uint8_t *)(pkts + offset), &pcr) == 0) {
-				if (pid->seenPCR++ < 100)
-					continue;
-
-				if (ltntstools_clock_is_established_timebase(pcrclk) == 0) {
-					ltntstools_clock_initialize(pcrclk);
-					ltntstools_clock_establish_timebase(pcrclk, 27 * 1e6);
-
-					/* One time initialzation of our histograms. */
-					char title[64];
-					sprintf(title, "PCR Tick Intervals PID 0x%04x", pidnr);
-					ltn_histogram_alloc_video_defaults(&pid->pcrTickIntervals, title);
-
-					sprintf(title, "PCR Jitter PID 0x%04x (abs value)", pidnr);
-					ltn_histogram_alloc_video_defaults(&pid->pcrWallDrift, title);
-				}
-
-				if (ltntstools_clock_is_established_wallclock(pcrclk) == 0) {
-					ltntstools_clock_establish_wallclock(pcrclk, pcr);
-				}
+			_pid_pcr_update(stream, pid, pkts + offset, pidnr);
+		}
 
-				/* Compute the interval in ticks, raise stats errors if they exceeed.
-				 * a) 100ms without a stated discontinuity or
-				 * b) 40ms.
-				 */
-				int64_t delta = ltntstools_clock_compute_delta(pcrclk, pcr, ltntstools_clock_get_ticks(pcrclk));
-				pid->prev_pcrExceeds40ms = pid->pcrExceeds40ms;
-				stream->prev_pcrExceeds40ms = stream->pcrExceeds40ms;
-				if (delta > (27000 * 40)) {
-					pid->pcrExceeds40ms++;
-					stream->pcrExceeds40ms++;
-				}
+	} /* for each ts packet */
+	stream->iat_last_frame = ts;
+}
 
-				ltn_histogram_interval_update_with_value(pid->pcrTickIntervals, delta / 27000);
+void ltntstools_pid_stats_update(struct ltntstools_stream_statistics_s *stream, const uint8_t *pkts, uint32_t packetCount)
+{
+	if (!stream || !stream->internal_pids || !pkts) {
+		return;
+	}
 
-				/* Update current value and re-compute drifts. */
-				ltntstools_clock_set_ticks(pcrclk, pcr);
-				ltntstools_clock_get_drift_us(pcrclk);
+	struct timeval ts;
+	gettimeofday(&ts, NULL);
 
-				int64_t v = ltntstools_clock_get_drift_us(pcrclk) / 1000; /* In ms */
-				pid->lastPCRWalltimeDriftMs = v;
+	if (packetCount != 7) {
+		STAT_INC(stream->notMultipleOfSevenError);
+		stream->last_notMultipleOfSeven_error = ts.tv_sec;
+	}
 
-				/* Normalize to remove drift direction - needed for histogram */
-				v = abs(v);
-				//printf("us %" PRIi64 "\n", v);
-				ltn_histogram_interval_update_with_value(pid->pcrWallDrift, v);
+	_pid_stats_update(stream, pkts, packetCount, &ts);
+}
 
-				if (stream->notifications[EVENT_UPDATE_PID_PCR_WALLTIME].cb) {
-					stream->notifications[EVENT_UPDATE_PID_PCR_WALLTIME].cb(stream->notifications[EVENT_UPDATE_PID_PCR_WALLTIME].userContext, 
-						EVENT_UPDATE_PID_PCR_WALLTIME, stream, pid);
-				}
-				if (stream->notifications[EVENT_UPDATE_PID_PCR_EXCEEDS_40MS].cb && delta > (27000 * 40)) {
-					stream->notifications[EVENT_UPDATE_PID_PCR_EXCEEDS_40MS].cb(stream->notifications[EVENT_UPDATE_PID_PCR_EXCEEDS_40MS].userContext, 
-						EVENT_UPDATE_PID_PCR_EXCEEDS_40MS, stream, pid);
-				}
+void ltntstools_pid_stats_update_with_timestamp(struct ltntstools_stream_statistics_s *stream, const uint8_t *pkts, uint32_t packetCount,
+	const struct timeval *ts)
+{
+	if (!stream || !stream->internal_pids || !pkts || !ts) {
+		return;
+	}
 
-			}
-		}
+	/* Callers batch many datagrams per call, anything that isn't whole datagrams is still suspicious. */
+	if (packetCount % 7) {
+		STAT_INC(stream->notMultipleOfSevenError);
+		stream->last_notMultipleOfSeven_error = ts->tv_sec;
+	}
 
-	} /* for each ts packet */
-	stream->iat_last_frame = ts;
+	_pid_stats_update(stream, pkts, packetCount, ts);
 }
 
 void ltntstools_pid_stats_reset(struct ltntstools_stream_statistics_s *stream)
@@ -650,6 +810,15 @@ void ltntstools_pid_stats_reset(struct ltntstools_stream_statistics_s *stream)
 	ltntstools_stats_for_each_pid(stream, i, pid) {
 		ltntstools_pid_statistics_reset(pid);
 	}
+
+	if (stream->internal_hot) {
+		for (int i = 0; i < MAX_PID; i++) {
+			struct ltntstools_pid_hot_counters_s *hot = &stream->internal_hot[i];
+			uint8_t flags = hot->flags;
+			memset(hot, 0, sizeof(*hot));
+			hot->flags = flags; /* Cold objects and PCR configuration survive a reset */
+		}
+	}
 }
 
 static void _pidArrayFree(struct ltntstools_stream_statistics_s *stream)
@@ -679,6 +848,56 @@ static int _pidArrayAdd(struct ltntstools_stream_statistics_s *stream, uint16_t
 	return 0;
 }
 
+/* Allocate the cold pid object when a new pid is first observed. */
+static struct ltntstools_pid_statistics_s *_pid_stats_alloc_pid(struct ltntstools_stream_statistics_s *stream, uint16_t pidnr)
+{
+	struct ltntstools_pid_statistics_s *pid = ltntstools_pid_statistics_alloc(pidnr);
+	if (!pid) {
+		return NULL;
+	}
+	if (_pidArrayAdd(stream, pidnr) < 0) {
+		ltntstools_pid_statistics_free(pid);
+		return NULL;
+	}
+	/* Published last, the snapshot reader may walk the table at any time. */
+	__atomic_store_n(&stream->internal_pids[pidnr], pid, __ATOMIC_RELEASE);
+
+	return pid;
+}
+
+int ltntstools_pid_stats_enable_packed_counters(struct ltntstools_stream_statistics_s *stream)
+{
+	if (!stream || !stream->internal_pids) {
+		return -1;
+	}
+	if (stream->internal_hot) {
+		return 0; /* Already enabled */
+	}
+
+	struct ltntstools_pid_hot_counters_s *hot = NULL;
+	if (posix_memalign((void **)&hot, 64, MAX_PID * sizeof(*hot)) != 0) {
+		return -1;
+	}
+	memset(hot, 0, MAX_PID * sizeof(*hot));
+
+	/* Carry over anything we've already measured with the classic layout. */
+	struct ltntstools_pid_statistics_s *pid;
+	ltntstools_stats_for_each_pid(stream, i, pid) {
+		hot[i].packetCount = pid->internal_packetCount;
+		hot[i].lastSeenUs = ((int64_t)pid->pusi_time_current.tv_sec * 1000000) + pid->pusi_time_current.tv_usec;
+		hot[i].pps_window = pid->pps_window;
+		hot[i].pps_last_update = pid->pps_last_update;
+		hot[i].lastCC = pid->lastCC;
+		hot[i].flags = LTNTSTOOLS_PID_HOT_ALLOCATED;
+		if (pid->hasPCR) {
+			hot[i].flags |= LTNTSTOOLS_PID_HOT_HAS_PCR;
+		}
+	}
+
+	__atomic_store_n(&stream->internal_hot, hot, __ATOMIC_RELEASE);
+	return 0; /* Success */
+}
+
 int ltntstools_pid_stats_alloc(struct ltntstools_stream_statistics_s **ctx)
 {
 	*ctx = NULL;
@@ -731,6 +950,10 @@ void ltntstools_pid_stats_free(struct ltntstools_stream_statistics_s *stream)
 		free(stream->internal_pids);
 		stream->internal_pids = NULL;
 	}
+	if (stream->internal_hot) {
+		free(stream->internal_hot);
+		stream->internal_hot = NULL;
+	}
 	_pidArrayFree(stream);
 
 	free(stream);
@@ -757,6 +980,16 @@ struct ltntstools_stream_statistics_s * ltntstools_pid_stats_clone(struct ltntst
 	memset(dst->internal_pids, 0, sizeof(*dst->internal_pids) * MAX_PID);
 	dst->pidArray = NULL;
 	dst->pidArrayCount = 0;
+	dst->internal_hot = NULL;
+
+	if (src->internal_hot) {
+		if (posix_memalign((void **)&dst->internal_hot, 64, MAX_PID * sizeof(*dst->internal_hot)) != 0) {
+			dst->internal_hot = NULL;
+			ltntstools_pid_stats_free(dst);
+			return NULL;
+		}
+		memcpy(dst->internal_hot, src->internal_hot, MAX_PID * sizeof(*dst->internal_hot));
+	}
 
 	if (src->pidArrayCount) {
 		dst->pidArray = malloc(src->pidArrayCount * sizeof(*dst->pidArray));
@@ -795,6 +1028,371 @@ struct ltntstools_stream_statistics_s * ltntstools_pid_stats_clone(struct ltntst
 	return dst;
 }
 
+/* Sum the buckets of src into *dst, cloning src when *dst doesn't exist yet. */
+static int _histogram_merge(struct ltn_histogram_s **dst, struct ltn_histogram_s *src)
+{
+	if (!src)
+		return 0;
+
+	if (!*dst) {
+		*dst = ltntstools_histogram_clone(src);
+		return *dst ? 0 : -1;
+	}
+
+	struct ltn_histogram_s *h = *dst;
+	if (h->bucketCount != src->bucketCount || h->minValMs != src->minValMs)
+		return -1;
+
+	for (int i = 0; i < h->bucketCount; i++) {
+		h->buckets[i].count += src->buckets[i].count;
+		if (_compareTime(&src->buckets[i].lastUpdate, &h->buckets[i].lastUpdate) > 0)
+			h->buckets[i].lastUpdate = src->buckets[i].lastUpdate;
+	}
+	h->bucketMissCount += src->bucketMissCount;
+	h->totalCount += src->totalCount;
+
+	return 0;
+}
+
+/* Packet count and last CC, from wherever the layout keeps them current. */
+static uint64_t _pid_packet_count(struct ltntstools_stream_statistics_s *stream, uint16_t pidnr)
+{
+	if (stream->internal_hot)
+		return stream->internal_hot[pidnr].packetCount;
+	return stream->internal_pids[pidnr]->internal_packetCount;
+}
+
+static uint8_t _pid_last_cc(struct ltntstools_stream_statistics_s *stream, uint16_t pidnr)
+{
+	if (stream->internal_hot)
+		return stream->internal_hot[pidnr].lastCC;
+	return stream->internal_pids[pidnr]->lastCC;
+}
+
+static void _pid_set_packet_state(struct ltntstools_stream_statistics_s *stream, uint16_t pidnr, uint64_t packetCount, uint8_t lastCC)
+{
+	struct ltntstools_pid_statistics_s *pid = stream->internal_pids[pidnr];
+
+	pid->internal_packetCount = packetCount;
+	pid->lastCC = lastCC;
+	if (stream->internal_hot) {
+		struct ltntstools_pid_hot_counters_s *hot = &stream->internal_hot[pidnr];
+		hot->packetCount = packetCount;
+		hot->lastCC = lastCC;
+		hot->flags |= LTNTSTOOLS_PID_HOT_ALLOCATED;
+		if (pid->hasPCR) {
+			hot->flags |= LTNTSTOOLS_PID_HOT_HAS_PCR;
+		}
+	}
+}
+
+static int _pid_stats_merge_pid(struct ltntstools_stream_statistics_s *dst, struct ltntstools_stream_statistics_s *src, uint16_t pidnr)
+{
+	struct ltntstools_pid_statistics_s *s = src->internal_pids[pidnr];
+	struct ltntstools_pid_statistics_s *d = dst->internal_pids[pidnr];
+	uint64_t srcCount = _pid_packet_count(src, pidnr);
+
+	if (!d) {
+		d = ltntstools_pid_statistics_clone(s);
+		if (!d)
+			return -1;
+		if (_pidArrayAdd(dst, pidnr) < 0) {
+			ltntstools_pid_statistics_free(d);
+			return -1;
+		}
+		dst->internal_pids[pidnr] = d;
+		_pid_set_packet_state(dst, pidnr, srcCount, _pid_last_cc(src, pidnr));
+		return 0;
+	}
+
+	uint64_t dstCount = _pid_packet_count(dst, pidnr);
+	uint8_t lastCC = _pid_last_cc(dst, pidnr);
+
+	if (srcCount) {
+		if (dstCount == 0) {
+			memcpy(d->firstHeader, s->firstHeader, sizeof(d->firstHeader));
+		} else
+		if (pidnr != 0x1fff && ltntstools_isCCInError(s->firstHeader, lastCC)) {
+			/* The discontinuity falls on the join, neither side could see it. */
+			d->internal_ccErrors++;
+			dst->internal_ccErrors++;
+			dst->last_cc_error = time(NULL);
+			ltntstools_history_metric_collection_add(&dst->ccErrorHistory, ltntstools_history_metric_alloc(dst->last_cc_error, 1));
+		}
+		lastCC = _pid_last_cc(src, pidnr);
+	}
+
+	d->enabled |= s->enabled;
+	d->internal_ccErrors += s->internal_ccErrors;
+	d->teiErrors += s->teiErrors;
+	d->scrambledCount += s->scrambledCount;
+	d->pcrExceeds40ms += s->pcrExceeds40ms;
+	d->prev_pcrExceeds40ms += s->prev_pcrExceeds40ms;
+	d->payloadPUSIErrors += s->payloadPUSIErrors;
+	d->hasPCR |= s->hasPCR;
+	d->seenPCR += s->seenPCR;
+
+	/* The most recent clock state wins */
+	if (ltntstools_clock_is_established_timebase(&s->clocks[ltntstools_CLOCK_PCR])) {
+		d->clocks[ltntstools_CLOCK_PCR] = s->clocks[ltntstools_CLOCK_PCR];
+		d->lastPCRWalltimeDriftMs = s->lastPCRWalltimeDriftMs;
+	}
+	if (_compareTime(&s->pusi_time_current, &d->pusi_time_current) > 0) {
+		d->pusi_time_first = s->pusi_time_first;
+		d->pusi_time_current = s->pusi_time_current;
+		d->pusi_time_ms = s->pusi_time_ms;
+	}
+
+	if (_histogram_merge(&d->pcrTickIntervals, s->pcrTickIntervals) < 0)
+		return -1;
+	if (_histogram_merge(&d->pcrWallDrift, s->pcrWallDrift) < 0)
+		return -1;
+
+	_pid_set_packet_state(dst, pidnr, dstCount + srcCount, lastCC);
+
+	return 0;
+}
+
+int ltntstools_pid_stats_merge(struct ltntstools_stream_statistics_s *dst, struct ltntstools_stream_statistics_s *src)
+{
+	if (!dst || !dst->internal_pids || !src || !src->internal_pids || dst == src) {
+		return -1;
+	}
+
+	dst->internal_packetCount += src->internal_packetCount;
+	dst->teiErrors += src->teiErrors;
+	dst->internal_ccErrors += src->internal_ccErrors;
+	dst->scrambledCount += src->scrambledCount;
+	dst->pcrExceeds40ms += src->pcrExceeds40ms;
+	dst->prev_pcrExceeds40ms += src->prev_pcrExceeds40ms;
+	dst->payloadPUSIErrors += src->payloadPUSIErrors;
+	dst->notMultipleOfSevenError += src->notMultipleOfSevenError;
+#if EXPERIMENTAL_REORDERING
+	dst->reorderErrors += src->reorderErrors;
+#endif
+	if (src->last_cc_error > dst->last_cc_error)
+		dst->last_cc_error = src->last_cc_error;
+	if (src->last_notMultipleOfSeven_error > dst->last_notMultipleOfSeven_error)
+		dst->last_notMultipleOfSeven_error = src->last_notMultipleOfSeven_error;
+	if (src->iat_lwm_us < dst->iat_lwm_us)
+		dst->iat_lwm_us = src->iat_lwm_us;
+	if (src->iat_hwm_us > dst->iat_hwm_us)
+		dst->iat_hwm_us = src->iat_hwm_us;
+
+	if (_histogram_merge(&dst->packetIntervals, src->packetIntervals) < 0)
+		return -1;
+
+	struct ltntstools_history_metric_s *m = NULL;
+	pthread_mutex_lock(&src->ccErrorHistory.lock);
+	xorg_list_for_each_entry(m, &src->ccErrorHistory.list, list) {
+		struct ltntstools_history_metric_s *copy = ltntstools_history_metric_alloc(m->ts, m->count);
+		if (!copy) {
+			pthread_mutex_unlock(&src->ccErrorHistory.lock);
+			return -1;
+		}
+		ltntstools_history_metric_collection_add(&dst->ccErrorHistory, copy);
+	}
+	pthread_mutex_unlock(&src->ccErrorHistory.lock);
+
+	/* In pid discovery order, so dst's pidArray stays in stream order. */
+	struct ltntstools_pid_statistics_s *pid;
+	ltntstools_stats_for_each_discovered_pid(src, pidnr, pid) {
+		if (_pid_stats_merge_pid(dst, src, pidnr) < 0)
+			return -1;
+	}
+
+	return 0; /* Success */
+}
+
+int ltntstools_pid_stats_snapshot_take(struct ltntstools_stream_statistics_s *stream, struct ltntstools_pid_stats_snapshot_s *snap)
+{
+	if (!stream || !stream->internal_pids || !snap) {
+		return -1;
+	}
+
+	gettimeofday(&snap->ts, NULL);
+	snap->intervalUs = 0;
+
+	snap->packetCount = STAT_LOAD(stream->internal_packetCount);
+	snap->ccErrors = STAT_LOAD(stream->internal_ccErrors);
+	snap->teiErrors = STAT_LOAD(stream->teiErrors);
+	snap->scrambledCount = STAT_LOAD(stream->scrambledCount);
+	snap->pcrExceeds40ms = STAT_LOAD(stream->pcrExceeds40ms);
+	snap->payloadPUSIErrors = STAT_LOAD(stream->payloadPUSIErrors);
+	snap->notMultipleOfSevenError = STAT_LOAD(stream->notMultipleOfSevenError);
+	snap->iat_lwm_us = STAT_LOAD(stream->iat_lwm_us);
+	snap->iat_hwm_us = STAT_LOAD(stream->iat_hwm_us);
+	snap->pidCount = 0;
+	snap->pidOverflow = 0;
+
+	struct ltntstools_pid_hot_counters_s *hot = __atomic_load_n(&stream->internal_hot, __ATOMIC_ACQUIRE);
+
+	/* Walk the fixed pid table rather than pidArray, the update thread may be growing pidArray.
+	 * Walking it in order also leaves pids[] sorted.
+	 */
+	for (int i = 0; i < MAX_PID; i++) {
+		struct ltntstools_pid_statistics_s *pid = __atomic_load_n(&stream->internal_pids[i], __ATOMIC_ACQUIRE);
+		if (!pid) {
+			continue;
+		}
+		if (snap->pidCount == LTNTSTOOLS_PID_STATS_SNAPSHOT_MAX_PIDS) {
+			snap->pidOverflow++;
+			continue;
+		}
+
+		struct ltntstools_pid_stats_snapshot_pid_s *e = &snap->pids[snap->pidCount++];
+		e->pidNr = i;
+		e->hasPCR = STAT_LOAD(pid->hasPCR);
+		e->reserved = 0;
+		e->packetCount = hot ? STAT_LOAD(hot[i].packetCount) : STAT_LOAD(pid->internal_packetCount);
+		e->ccErrors = STAT_LOAD(pid->internal_ccErrors);
+		e->teiErrors = STAT_LOAD(pid->teiErrors);
+		e->scrambledCount = STAT_LOAD(pid->scrambledCount);
+		e->pcrExceeds40ms = STAT_LOAD(pid->pcrExceeds40ms);
+		e->payloadPUSIErrors = STAT_LOAD(pid->payloadPUSIErrors);
+	}
+
+	return 0; /* Success */
+}
+
+static uint64_t _counter_delta(uint64_t newer, uint64_t older)
+{
+	/* Lower than before, the stats were reset, count from zero. */
+	return newer >= older ? newer - older : newer;
+}
+
+static void _snapshot_add_pid(struct ltntstools_pid_stats_snapshot_s *snap, const struct ltntstools_pid_stats_snapshot_pid_s *e)
+{
+	if (snap->pidCount == LTNTSTOOLS_PID_STATS_SNAPSHOT_MAX_PIDS) {
+		snap->pidOverflow++;
+		return;
+	}
+	snap->pids[snap->pidCount++] = *e;
+}
+
+int ltntstools_pid_stats_snapshot_merge(struct ltntstools_pid_stats_snapshot_s *dst,
+	const struct ltntstools_pid_stats_snapshot_s *a, const struct ltntstools_pid_stats_snapshot_s *b)
+{
+	if (!dst || !a || !b) {
+		return -1;
+	}
+
+	/* dst may alias a or b, build the result aside only when it does. */
+	struct ltntstools_pid_stats_snapshot_s tmp;
+	struct ltntstools_pid_stats_snapshot_s *r = (dst == a || dst == b) ? &tmp : dst;
+
+	r->ts = _compareTime((struct timeval *)&a->ts, (struct timeval *)&b->ts) >= 0 ? a->ts : b->ts;
+	r->intervalUs = a->intervalUs > b->intervalUs ? a->intervalUs : b->intervalUs;
+	r->packetCount = a->packetCount + b->packetCount;
+	r->ccErrors = a->ccErrors + b->ccErrors;
+	r->teiErrors = a->teiErrors + b->teiErrors;
+	r->scrambledCount = a->scrambledCount + b->scrambledCount;
+	r->pcrExceeds40ms = a->pcrExceeds40ms + b->pcrExceeds40ms;
+	r->payloadPUSIErrors = a->payloadPUSIErrors + b->payloadPUSIErrors;
+	r->notMultipleOfSevenError = a->notMultipleOfSevenError + b->notMultipleOfSevenError;
+	r->iat_lwm_us = a->iat_lwm_us < b->iat_lwm_us ? a->iat_lwm_us : b->iat_lwm_us;
+	r->iat_hwm_us = a->iat_hwm_us > b->iat_hwm_us ? a->iat_hwm_us : b->iat_hwm_us;
+	r->pidCount = 0;
+	r->pidOverflow = a->pidOverflow + b->pidOverflow;
+
+	/* Both pid lists are sorted, join them. */
+	int i = 0, j = 0;
+	while (i < a->pidCount || j < b->pidCount) {
+		const struct ltntstools_pid_stats_snapshot_pid_s *pa = i < a->pidCount ? &a->pids[i] : NULL;
+		const struct ltntstools_pid_stats_snapshot_pid_s *pb = j < b->pidCount ? &b->pids[j] : NULL;
+
+		if (pa && (!pb || pa->pidNr < pb->pidNr)) {
+			_snapshot_add_pid(r, pa);
+			i++;
+		} else
+		if (!pa || pb->pidNr < pa->pidNr) {
+			_snapshot_add_pid(r, pb);
+			j++;
+		} else {
+			struct ltntstools_pid_stats_snapshot_pid_s e = *pa;
+			e.hasPCR |= pb->hasPCR;
+			e.packetCount += pb->packetCount;
+			e.ccErrors += pb->ccErrors;
+			e.teiErrors += pb->teiErrors;
+			e.scrambledCount += pb->scrambledCount;
+			e.pcrExceeds40ms += pb->pcrExceeds40ms;
+			e.payloadPUSIErrors += pb->payloadPUSIErrors;
+			_snapshot_add_pid(r, &e);
+			i++;
+			j++;
+		}
+	}
+
+	if (r != dst) {
+		memcpy(dst, r, offsetof(struct ltntstools_pid_stats_snapshot_s, pids) + (r->pidCount * sizeof(r->pids[0])));
+	}
+
+	return 0; /* Success */
+}
+
+int ltntstools_pid_stats_snapshot_delta(struct ltntstools_pid_stats_snapshot_s *dst,
+	const struct ltntstools_pid_stats_snapshot_s *newer, const struct ltntstools_pid_stats_snapshot_s *older)
+{
+	if (!dst || !newer || !older) {
+		return -1;
+	}
+
+	/* dst may alias newer or older, build the result aside only when it does. */
+	struct ltntstools_pid_stats_snapshot_s tmp;
+	struct ltntstools_pid_stats_snapshot_s *r = (dst == newer || dst == older) ? &tmp : dst;
+
+	r->ts = newer->ts;
+	r->intervalUs = ltn_timeval_subtract_us((struct timeval *)&newer->ts, (struct timeval *)&older->ts);
+	r->packetCount = _counter_delta(newer->packetCount, older->packetCount);
+	r->ccErrors = _counter_delta(newer->ccErrors, older->ccErrors);
+	r->teiErrors = _counter_delta(newer->teiErrors, older->teiErrors);
+	r->scrambledCount = _counter_delta(newer->scrambledCount, older->scrambledCount);
+	r->pcrExceeds40ms = _counter_delta(newer->pcrExceeds40ms, older->pcrExceeds40ms);
+	r->payloadPUSIErrors = _counter_delta(newer->payloadPUSIErrors, older->payloadPUSIErrors);
+	r->notMultipleOfSevenError = _counter_delta(newer->notMultipleOfSevenError, older->notMultipleOfSevenError);
+	r->iat_lwm_us = newer->iat_lwm_us;
+	r->iat_hwm_us = newer->iat_hwm_us;
+	r->pidCount = 0;
+	r->pidOverflow = newer->pidOverflow;
+
+	int j = 0;
+	for (int i = 0; i < newer->pidCount; i++) {
+		struct ltntstools_pid_stats_snapshot_pid_s e = newer->pids[i];
+
+		while (j < older->pidCount && older->pids[j].pidNr < e.pidNr)
+			j++;
+		if (j < older->pidCount && older->pids[j].pidNr == e.pidNr) {
+			const struct ltntstools_pid_stats_snapshot_pid_s *o = &older->pids[j];
+			e.packetCount = _counter_delta(e.packetCount, o->packetCount);
+			e.ccErrors = _counter_delta(e.ccErrors, o->ccErrors);
+			e.teiErrors = _counter_delta(e.teiErrors, o->teiErrors);
+			e.scrambledCount = _counter_delta(e.scrambledCount, o->scrambledCount);
+			e.pcrExceeds40ms = _counter_delta(e.pcrExceeds40ms, o->pcrExceeds40ms);
+			e.payloadPUSIErrors = _counter_delta(e.payloadPUSIErrors, o->payloadPUSIErrors);
+		}
+		_snapshot_add_pid(r, &e);
+	}
+
+	if (r != dst) {
+		memcpy(dst, r, offsetof(struct ltntstools_pid_stats_snapshot_s, pids) + (r->pidCount * sizeof(r->pids[0])));
+	}
+
+	return 0; /* Success */
+}
+
+double ltntstools_pid_stats_snapshot_get_mbps(const struct ltntstools_pid_stats_snapshot_s *snap)
+{
+	if (!snap || snap->intervalUs <= 0) {
+		return 0;
+	}
+
+	double mbps = snap->packetCount;
+	mbps *= (188 * 8);
+	mbps /= snap->intervalUs; /* bits per us is Mb/ps */
+
+	return mbps;
+}
+
 static void _expire_per_second_stream_stats(struct ltntstools_stream_statistics_s *stream)
 {
 	if (!stream) {
@@ -925,7 +1523,7 @@ uint64_t ltntstools_pid_stats_stream_get_packet_count(struct ltntstools_stream_s
 	return stream->internal_packetCount;
 }
 
-static void _expire_per_second_pid_stats(struct ltntstools_pid_statistics_s *pid)
+static void _expire_per_second_pid_stats(struct ltntstools_stream_statistics_s *stream, struct ltntstools_pid_statistics_s *pid)
 {
 	time_t now;
 	time(&now);
@@ -934,6 +1532,9 @@ static void _expire_per_second_pid_stats(struct ltntstools_pid_statistics_s *pid
 		pid->mbps = 0;
 		pid->pps = 0;
 		pid->pps_window = 0;
+		if (stream->internal_hot) {
+			stream->internal_hot[pid->pidNr].pps_window = 0;
+		}
 	}
 }
 
@@ -946,7 +1547,7 @@ double ltntstools_pid_stats_pid_get_mbps(struct ltntstools_stream_statistics_s *
 	if (!pid) {
 		return 0;
 	}
-	_expire_per_second_pid_stats(pid);
+	_expire_per_second_pid_stats(stream, pid);
 	return pid->mbps;
 }
 
@@ -959,7 +1560,7 @@ uint32_t ltntstools_pid_stats_pid_get_pps(struct ltntstools_stream_statistics_s
 	if (!pid) {
 		return 0;
 	}
-	_expire_per_second_pid_stats(pid);
+	_expire_per_second_pid_stats(stream, pid);
 	return pid->pps;
 }
 
@@ -972,7 +1573,7 @@ uint32_t ltntstools_pid_stats_pid_get_bps(struct ltntstools_stream_statistics_s
 	if (!pid) {
 		return 0;
 	}
-	_expire_per_second_pid_stats(pid);
+	_expire_per_second_pid_stats(stream, pid);
 	return pid->pps * 188 * 8;
 }
 
@@ -996,6 +1597,9 @@ uint64_t ltntstools_pid_stats_pid_get_packet_count(struct ltntstools_stream_stat
 	if (!pid) {
 		return 0;
 	}
+	if (stream->internal_hot) {
+		return stream->internal_hot[pidnr & 0x1fff].packetCount;
+	}
 	return pid->internal_packetCount;
 }
 
@@ -1033,18 +1637,15 @@ void ltntstools_pid_stats_pid_set_contains_pcr(struct ltntstools_stream_statisti
 
 	struct ltntstools_pid_statistics_s *pid = stream->internal_pids[pidnr];
 	if (!pid) {
-		pid = ltntstools_pid_statistics_alloc(pidnr);
+		pid = _pid_stats_alloc_pid(stream, pidnr);
 		if (!pid) {
 			return;
 		}
-		stream->internal_pids[pidnr] = pid;
-		if (_pidArrayAdd(stream, pidnr) < 0) {
-			ltntstools_pid_statistics_free(pid);
-			stream->internal_pids[pidnr] = NULL;
-			return;
-		}
 	}
-	pid->hasPCR = 1;
+	STAT_STORE(pid->hasPCR, 1);
+	if (stream->internal_hot) {
+		stream->internal_hot[pidnr].flags |= LTNTSTOOLS_PID_HOT_ALLOCATED | LTNTSTOOLS_PID_HOT_HAS_PCR;
+	}
 	ltntstools_bitrate_calculator_init(stream, pidnr & 0x1fff);
 }
 
@@ -1178,7 +1779,7 @@ void ltntstools_pid_stats_dprintf(struct ltntstools_stream_statistics_s *stream,
 		dprintf(fd, "0x%04x (%4d) %13" PRIu64 " %13" PRIu64 " %6.02f\n",
 			i,
 			i,
-			pid->internal_packetCount,
+			ltntstools_pid_stats_pid_get_packet_count(stream, i),
 			pid->internal_ccErrors,
 			pid->mbps);
 	}
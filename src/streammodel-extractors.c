@@ -7,6 +7,10 @@ void extractors_free(struct streammodel_ctx_s *ctx)
 	if (!ctx->enableSectionCRCChecks)
 		return;
 
+	if (ctx->seReassembler)
+		ltntstools_sectionreassembler_free(ctx->seReassembler);
+	ctx->seReassembler = NULL;
+
 	if (!ctx->seArray)
 		return;
 
@@ -14,10 +18,6 @@ void extractors_free(struct streammodel_ctx_s *ctx)
 	{
 		struct se_array_item_s *item = &ctx->seArray[idx];
 
-		if (item->hdl)
-			ltntstools_sectionextractor_free(item->hdl);
-		item->hdl = NULL;
-
 		if (item->name)
 			free(item->name);
 		item->name = NULL;
@@ -44,26 +44,57 @@ int extractors_add(struct streammodel_ctx_s *ctx, uint16_t pid, uint8_t tableId,
 #if LOCAL_DEBUG
 	printf("%s() Adding %s\n", __func__, name);
 #endif
-	ctx->seArray = realloc(ctx->seArray, sizeof(struct se_array_item_s) * (ctx->seCount + 1));
-	struct se_array_item_s *i = ctx->seArray + ctx->seCount;
+	int ret = ltntstools_sectionreassembler_add_pid(ctx->seReassembler, pid);
+	if (ret < 0) {
+		fprintf(stderr, "Failed to add section extarctor\n");
+		return ret;
+	}
 
+	struct se_array_item_s *array = realloc(ctx->seArray, sizeof(struct se_array_item_s) * (ctx->seCount + 1));
+	if (!array)
+		return -1;
+	ctx->seArray = array;
+
+	struct se_array_item_s *i = ctx->seArray + ctx->seCount;
+	memset(i, 0, sizeof(*i));
 	i->pid = pid;
 	i->tableId = tableId;
 	i->name = strdup(name);
 	i->context = context;
-
-	int ret = ltntstools_sectionextractor_alloc(&i->hdl, i->pid, i->tableId);
-	if (ret < 0) {
-		fprintf(stderr, "Failed to add section extarctor\n");
-		ctx->seCount--;
-		ctx->seArray = realloc(ctx->seArray, sizeof(struct se_array_item_s) * ctx->seCount);
-		return ret;
-	}
 	ctx->seCount++;
 
 	return 0; /* Success */
 }
 
+/* Every section on every pid we watch, report the CRC status of the tables we track. */
+static void _section_cb(void *userContext, const struct ltntstools_section_s *section)
+{
+	struct streammodel_ctx_s *ctx = (struct streammodel_ctx_s *)userContext;
+
+	for (int idx = 0; idx < ctx->seCount; idx++) {
+		struct se_array_item_s *item = &ctx->seArray[idx];
+		if (item->pid != section->pid || item->tableId != section->tableId)
+			continue;
+
+		if (ctx->cb) {
+			struct streammodel_callback_args_s args;
+
+			args.status  = STREAMMODEL_CB_CRC_STATUS;
+			args.context = item->context;
+			args.ptr     = NULL;
+			args.arg     = section->crcValid;
+
+			ctx->cb(ctx->userContext, &args);
+		}
+
+#if LOCAL_DEBUG
+		if (section->crcValid == 0) {
+			printf("SE [0x%04x:%02x %s] complete crcValid %d\n", item->pid, item->tableId, item->name, section->crcValid);
+		}
+#endif
+	}
+}
+
 /* For TR101290, we need to track CRC issues with certain tables.
  * for those that have fixed pids, take care of them here.
  * For those on varibale pids, we'll handle them in a different
@@ -84,6 +115,10 @@ int extractors_alloc(struct streammodel_ctx_s *ctx)
 	if (!ctx->enableSectionCRCChecks)
 		return 0;
 
+	/* One reassembler for every pid, byte identical repeats of a table skip the CRC calculation. */
+	if (ltntstools_sectionreassembler_alloc(&ctx->seReassembler, _section_cb, ctx) < 0)
+		return -1;
+
 	/* Static list of all DVB tables. */
 	/* Don't add anything between here.... */
 	extractors_add(ctx, 0x00, 0x00, "PAT", STREAMMODEL_CB_CONTEXT_PAT); /* PAT */
@@ -95,79 +130,14 @@ int extractors_alloc(struct streammodel_ctx_s *ctx)
 	extractors_add(ctx, 0x12, 0x5F, "EIT", STREAMMODEL_CB_CONTEXT_EIT); /* EIT */
 	extractors_add(ctx, 0x12, 0x6F, "EIT", STREAMMODEL_CB_CONTEXT_EIT); /* EIT */
 	extractors_add(ctx, 0x14, 0x73, "TOT", STREAMMODEL_CB_CONTEXT_TOT); /* TOT */
-	/* ... end here without adjusting the _write swtch table hard-coded indexes. */
+	/* ... end here, extractors_add() expects PMTs from index 9 onwards. */
 
 	return 0; /* Success */
 }
 
-static void _write_pkt(struct streammodel_ctx_s *ctx, struct se_array_item_s *item, const uint8_t *pkt)
-{
-	ltntstools_sectionextractor_write(item->hdl, pkt, 1, &item->complete, &item->crcValid);
-	if (item->complete) {
-		if (ctx->cb) {
-			struct streammodel_callback_args_s args;
-
-			args.status  = STREAMMODEL_CB_CRC_STATUS;
-			args.context = item->context;
-			args.ptr     = NULL;
-			args.arg     = item->crcValid;
-
-			ctx->cb(ctx->userContext, &args);
-		}
-	}
-
-#if LOCAL_DEBUG
-	if (item->complete && item->crcValid == 0) {
-		printf("SE [0x%04x:%02x %s] complete crcValid %d\n", item->pid, item->tableId, item->name, item->crcValid);
-	}
-#endif
-}
-
 int extractors_write(struct streammodel_ctx_s *ctx, const uint8_t *pkts, int packetCount)
 {
-	struct se_array_item_s *item = NULL;
-
-	for (int i = 0; i < packetCount; i++) {
-		const uint8_t *pkt = &pkts[i * 188];
-		uint16_t pid = ltntstools_pid(pkt);
-		switch (pid) {
-		case 0x00:
-			item = ctx->seArray + 0; /* PAT */
-			_write_pkt(ctx, item, pkt);
-			break;
-		case 0x10:
-			item = ctx->seArray + 1; /* NIT */
-			_write_pkt(ctx, item, pkt);
-			break;
-		case 0x11:
-			item = ctx->seArray + 2; /* BAT */
-			_write_pkt(ctx, item, pkt);
-			item = ctx->seArray + 3; /* SDT */
-			_write_pkt(ctx, item, pkt);
-			break;
-		case 0x12:
-			item = ctx->seArray + 4; /* EIT */
-			_write_pkt(ctx, item, pkt);
-			item = ctx->seArray + 5; /* EIT */
-			_write_pkt(ctx, item, pkt);
-			item = ctx->seArray + 6; /* EIT */
-			_write_pkt(ctx, item, pkt);
-			item = ctx->seArray + 7; /* EIT */
-			_write_pkt(ctx, item, pkt);
-			break;
-		case 0x14:
-			item = ctx->seArray + 8; /* TOT */
-			_write_pkt(ctx, item, pkt);
-			break;
-		default:
-			for (int i = 9; i < ctx->seCount; i++ ) {
-				item = ctx->seArray + i;
-				_write_pkt(ctx, item, pkt);
-			}
-		}
-	}
-
-	return packetCount;
+	return ltntstools_sectionreassembler_write(ctx->seReassembler, pkts, packetCount);
 }
 
 #if 0
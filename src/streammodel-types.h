@@ -10,34 +10,37 @@
 #include <inttypes.h>
 #include <unistd.h>
 
-#include <stdbool.h>
-#include <dvbpsi/dvbpsi.h>
-#include <dvbpsi/psi.h>
-#include <dvbpsi/descriptor.h>
-#include <dvbpsi/pat.h>
-#include <dvbpsi/pmt.h>
-#include <dvbpsi/sdt.h>
-#include <dvbpsi/dr.h>
-#include <dvbpsi/demux.h>
-
 #include "libltntstools/streammodel.h"
 #include "libltntstools/ts.h"
 #include "libltntstools/pat.h"
+#include "libltntstools/crc32.h"
+#include "libltntstools/sectionextractor.h"
 
-#if 0
-#define DVBPSI_REPORTING (DVBPSI_MSG_DEBUG)
-#else
-#define DVBPSI_REPORTING (DVBPSI_MSG_ERROR)
-#endif
+/* PAT, PMT and SDT sections are limited to 1024 bytes, ISO13818-1 2.4.4 and EN300468 5.1.1 */
+#define MAX_SECTION_BYTES 1024
 
-/* Any given PID could have multiple PMTs on a single pid.
- * We need to track all of this state.
- */
-struct streammodel_pid_parser_s
+struct streammodel_pat_program_s
+{
+	uint16_t program_number;
+	uint16_t program_map_PID;
+
+	int      pmtVersion;    /* -1 until the first valid PMT arrives */
+	uint16_t pmtLengthBytes;
+	uint8_t  pmt[MAX_SECTION_BYTES]; /* Last CRC validated PMT section for the program. */
+};
+
+/* The PAT as collected, possibly over multiple sections. */
+struct streammodel_pat_s
 {
-	dvbpsi_t *p_dvbpsi;
-	dvbpsi_pmt_t *p_pmt;
-	int programNumber;
+	int      version;             /* -1 until the first valid section */
+	int      complete;            /* Boolean: Every section of this version has arrived */
+	uint16_t transport_stream_id;
+	uint8_t  lastSectionNumber;
+	uint8_t  sectionsSeen[256 / 8];
+	uint32_t sectionCRC[256];
+
+	int      programCount;
+	struct streammodel_pat_program_s programs[LTNTSTOOLS_PAT_ENTRIES_MAX];
 };
 
 /* Running Object Model: A model of an entire ISO13818 stream,
@@ -64,10 +67,8 @@ struct streammodel_pid_s
 	/* Elementary Stream details */
 	//int estype;
 
-	/* DVBPSI Cached Data */
-#define MAX_PID_PARSERS 24
-	struct streammodel_pid_parser_s parser[MAX_PID_PARSERS];
-	dvbpsi_pat_t *p_pat;
+	int psi;	/* Boolean: PAT, PMT or SDT sections are reassembled on this pid */
+	int watched;	/* Boolean: The current model watches this pid for PAT/PMT changes, next rom only. */
 
 	/* Housekeeping */
 	struct streammodel_rom_s *rom;
@@ -103,6 +104,16 @@ struct streammodel_rom_s
 
 	int sdtCount;
 	struct streammodel_sdt_s sdt[MAX_SDT_ENTRIES]; /* TODO: We need to age these out, else they're stale in in complex aging mux configations */
+	int sdtVersion;                   /* -1 until the first valid SDT section */
+	uint8_t sdtSectionsSeen[256 / 8];
+
+	struct streammodel_pat_s pat;
+
+	/* Section reassembly for the PAT, SDT and every PMT pid. Allocated once, reset with the rom. */
+	void *reassembler;
+
+	/* Built once from the completed rom, on first use. Released when the rom is re-initialized. */
+	const struct ltntstools_psi_model_s *psiModel;
 
 	/* Housekeeping */
 	struct streammodel_ctx_s *ctx;
@@ -113,9 +124,6 @@ struct se_array_item_s
 	uint16_t pid;
 	uint8_t  tableId;
 	char    *name;
-	void    *hdl;
-	int      complete;
-	int      crcValid;
 	uint64_t packetCounts;
 	uint32_t context;  /* STREAMMODEL_CB_CONTEXT_PAT */
 
@@ -151,7 +159,18 @@ struct streammodel_ctx_s
 	int   enableSectionCRCChecks;
 	int   seCount;
 	struct se_array_item_s *seArray;
+	void *seReassembler;
 	ltntstools_streammodel_callback cb;
+
+	/* Change notifications. The diff is computed when the next model completes and
+	 * delivered once it's activated, the models are referenced until then.
+	 */
+	ltntstools_streammodel_change_callback changeCb;
+	int psiChanged;                         /* Boolean. The current model saw a PAT/PMT change. */
+	const struct ltntstools_psi_model_s *changePrevious;
+	const struct ltntstools_psi_model_s *changeCurrent;
+	struct ltntstools_psi_change_s *changes;
+	int changeCount;
 };
 
 int  extractors_alloc(struct streammodel_ctx_s *ctx);
@@ -11,16 +11,13 @@ extern "C" {
 };
 #endif
 
-#if 0
-#define DVBPSI_REPORTING (DVBPSI_MSG_DEBUG)
-#else
-#define DVBPSI_REPORTING (DVBPSI_MSG_ERROR)
-#endif
-
 extern void extractors_free(struct streammodel_ctx_s *ctx);
 
-static void message(dvbpsi_t *handle, const dvbpsi_msg_level_t level, const char* msg);
+static struct streammodel_pid_s *_rom_find_pid(struct streammodel_rom_s *rom, uint16_t pid);
+static void _rom_invalidate_model(struct streammodel_rom_s *rom);
+static uint32_t _section_crc(const uint8_t *sec, int lengthBytes);
 static int _streammodel_query_model(struct streammodel_ctx_s *ctx, struct streammodel_rom_s *rom, struct ltntstools_pat_s **pat);
+static const struct ltntstools_psi_model_s *_rom_query_psi_model(struct streammodel_ctx_s *ctx, struct streammodel_rom_s *rom);
 int _rom_compare_current_next(struct streammodel_ctx_s *ctx);
 
 /* ROM */
@@ -50,52 +47,42 @@ static void _rom_initialize(struct streammodel_ctx_s *ctx, struct streammodel_ro
 	for (int i = 0; i < MAX_ROM_PIDS; i++) {
 		struct streammodel_pid_s *ps = &rom->pids[i];
 
-		/* Free any pid allocations. */
 		ps->present = 0;
 		ps->pid = i;
 		ps->rom = rom;
-
-		if (ps->p_pat) {
-			dvbpsi_pat_delete(ps->p_pat);
-			ps->p_pat = NULL;
-		}
-		if (ps->pidType == PT_PAT && ps->parser[0].p_dvbpsi) {
-			dvbpsi_pat_detach(ps->parser[0].p_dvbpsi);
-		}
-
-		/* Bugfix: Work around an issue where the SDT and an ES shared the same PID, and
-		 * libdvbpsi raised an assert
-		 */
-		if (ps->pid == 0x011 && (ps->pidType == PT_SDT || ps->pidType == PT_ES) && ps->parser[0].p_dvbpsi) {
-			dvbpsi_DetachDemux(ps->parser[0].p_dvbpsi);
-		}
-
-		for (int j = 0; j < MAX_PID_PARSERS ; j++) {
-			if (ps->parser[j].p_pmt) {
-				dvbpsi_pmt_delete(ps->parser[j].p_pmt);
-				ps->parser[j].p_pmt = NULL;
-			}
-			if (ps->pidType == PT_PMT && ps->parser[j].p_dvbpsi) {
-				dvbpsi_pmt_detach(ps->parser[j].p_dvbpsi);
-			}
-		}
-
-		for (int j = 0; j < MAX_PID_PARSERS ; j++) {
-			if (ps->parser[j].p_dvbpsi) {
-				dvbpsi_delete(ps->parser[j].p_dvbpsi);
-				ps->parser[j].p_dvbpsi = NULL;
-			}
-		}
+		ps->psi = 0;
+		ps->watched = 0;
 
 		/* Everything else */
 		ps->packetCount = 0;
 	}
+
+	/* Release all PSI collection state, no allocations to free. */
+	if (rom->reassembler) {
+		ltntstools_sectionreassembler_reset(rom->reassembler);
+	}
+	memset(&rom->pat, 0, sizeof(rom->pat));
+	rom->pat.version = -1;
+	rom->sdtVersion = -1;
+	memset(rom->sdtSectionsSeen, 0, sizeof(rom->sdtSectionsSeen));
+
+	_rom_invalidate_model(rom);
+
 	rom->nr = nr;
 	rom->ctx = ctx;
 	rom->modelComplete = 0;
 	rom->parsedPMTs = 0;
 	rom->totalPMTsInPAT = 0;
 	rom->pmtCollectionTimer.tv_sec = 0;
+
+	/* Flag the pids the current model watches, in the rom we look up every packet anyway. */
+	if (rom == ctx->next && ctx->current->modelComplete) {
+		for (int i = 0; i < MAX_ROM_PIDS; i++) {
+			struct streammodel_pid_s *cps = &ctx->current->pids[i];
+			if (cps->psi && (cps->pidType == PT_PAT || cps->pidType == PT_PMT))
+				rom->pids[i].watched = 1;
+		}
+	}
 }
 
 uint64_t ltntstools_streammodel_get_current_version(void *hdl)
@@ -104,58 +91,131 @@ uint64_t ltntstools_streammodel_get_current_version(void *hdl)
 	return ctx->currentModelVersion;
 }
 
+/* Two complete roms collected the same PAT and PMT sections, by version and CRC. */
+static int _rom_psi_identical(struct streammodel_rom_s *a, struct streammodel_rom_s *b)
+{
+	if (a->pat.version != b->pat.version)
+		return 0;
+	if (a->pat.transport_stream_id != b->pat.transport_stream_id)
+		return 0;
+	if (a->pat.lastSectionNumber != b->pat.lastSectionNumber)
+		return 0;
+	if (a->pat.programCount != b->pat.programCount)
+		return 0;
+
+	for (int i = 0; i <= a->pat.lastSectionNumber; i++) {
+		if (a->pat.sectionCRC[i] != b->pat.sectionCRC[i])
+			return 0;
+	}
+
+	for (int i = 0; i < a->pat.programCount; i++) {
+		struct streammodel_pat_program_s *pa = &a->pat.programs[i];
+		struct streammodel_pat_program_s *pb = &b->pat.programs[i];
+
+		if (pa->program_number != pb->program_number)
+			return 0;
+		if (pa->program_map_PID != pb->program_map_PID)
+			return 0;
+		if (pa->pmtVersion != pb->pmtVersion)
+			return 0;
+		if (pa->pmtLengthBytes != pb->pmtLengthBytes)
+			return 0;
+		if (pa->pmtLengthBytes && _section_crc(pa->pmt, pa->pmtLengthBytes) != _section_crc(pb->pmt, pb->pmtLengthBytes))
+			return 0;
+	}
+
+	return 1;
+}
+
+static void _changes_release(struct streammodel_ctx_s *ctx)
+{
+	ltntstools_psi_model_unref(ctx->changePrevious);
+	ltntstools_psi_model_unref(ctx->changeCurrent);
+	free(ctx->changes);
+
+	ctx->changePrevious = NULL;
+	ctx->changeCurrent = NULL;
+	ctx->changes = NULL;
+	ctx->changeCount = 0;
+}
+
+/* Diff the models, hold on to the result for the change callback. Returns the number of changes. */
+static int _changes_prepare(struct streammodel_ctx_s *ctx, const struct ltntstools_psi_model_s *previous,
+	const struct ltntstools_psi_model_s *current)
+{
+	struct ltntstools_psi_change_s *changes;
+	int count;
+
+	_changes_release(ctx);
+
+	if (ltntstools_psi_model_diff(previous, current, &changes, &count) < 0)
+		return 0;
+
+	if (count == 0 || !ctx->changeCb) {
+		free(changes);
+		return count;
+	}
+
+	ctx->changePrevious = ltntstools_psi_model_ref(previous);
+	ctx->changeCurrent = ltntstools_psi_model_ref(current);
+	ctx->changes = changes;
+	ctx->changeCount = count;
+
+	return count;
+}
+
 int _rom_compare_current_next(struct streammodel_ctx_s *ctx)
 {
 	/* Compare current and next models, bounce the version if
 	 * we've detected a change.
 	 */
 
-	 int ret;
-
-	 struct ltntstools_pat_s *patCurrent = NULL;
-	 struct ltntstools_pat_s *patNext = NULL;
-	 ret = _streammodel_query_model(ctx, ctx->current, &patCurrent);
-	 ret = _streammodel_query_model(ctx, ctx->next, &patNext);
- 
-	 if (patCurrent && patNext) {
-		 ret = ltntstools_pat_compare(patCurrent, patNext);
-		 if (ret != 0) {
-			 ctx->currentModelVersion++;
-			 ctx->modelChanged = 1;
+	if (ctx->current->modelComplete && _rom_psi_identical(ctx->current, ctx->next)) {
+		/* The same sections, there's no need to build and compare the models. */
+		if (ctx->restartReason == 1) {
+			/* Models didnt change but the PAT indicated a CC error, force a new model */
+			ctx->currentModelVersion++;
+			ctx->modelChanged = 1;
+			ctx->restartReason = 0;
+		}
+		return ctx->modelChanged;
+	}
+
+	/* Each rom builds its model once, the current rom reuses the model it built when it completed. */
+	const struct ltntstools_psi_model_s *modelCurrent = _rom_query_psi_model(ctx, ctx->current);
+	const struct ltntstools_psi_model_s *modelNext = _rom_query_psi_model(ctx, ctx->next);
+
+	if (modelCurrent && modelNext) {
+		int changes = _changes_prepare(ctx, modelCurrent, modelNext);
+		if (ltntstools_psi_model_compare(modelCurrent, modelNext) != 0 || changes > 0) {
+			ctx->currentModelVersion++;
+			ctx->modelChanged = 1;
 #if CHATTY_CALLBACKS
-			 printf("*** NEW INCOMING MODEL DETECTED as 0x%016" PRIx64 "***\n", ctx->currentModelVersion);
+			printf("*** NEW INCOMING MODEL DETECTED as 0x%016" PRIx64 "***\n", ctx->currentModelVersion);
 #endif
-		 } else {
-			 // No model change detected
+		} else {
+			// No model change detected
 			if (ctx->restartReason == 1) {
 				/* Models didnt change but the PAT indicated a CC error, force a new model */
-			 	ctx->currentModelVersion++;
-			 	ctx->modelChanged = 1;
+				ctx->currentModelVersion++;
+				ctx->modelChanged = 1;
 				ctx->restartReason = 0;
 #if CHATTY_CALLBACKS
-			 	printf("*** NEW INCOMING MODEL DUE TO PAT DISCONTINUITY as 0x%016" PRIx64 "***\n", ctx->currentModelVersion);
+				printf("*** NEW INCOMING MODEL DUE TO PAT DISCONTINUITY as 0x%016" PRIx64 "***\n", ctx->currentModelVersion);
 #endif
 			}
-		 }
-	 } else
-	 if (patCurrent == NULL && patNext) {
+		}
+	} else
+	if (modelCurrent == NULL && modelNext) {
+		_changes_prepare(ctx, NULL, modelNext);
 		ctx->currentModelVersion++;
 		ctx->modelChanged = 1;
 #if CHATTY_CALLBACKS
 		printf("*** FIRST MODEL DETECTED as 0x%016" PRIx64 "***\n", ctx->currentModelVersion);
 #endif
-	 }
- 
-	 if (patCurrent) {
-		 ltntstools_pat_free(patCurrent);
-		 patCurrent = NULL;
-	 }
-	 if (patNext) {
-		 ltntstools_pat_free(patNext);
-		 patNext = NULL;
-	 }
+	}
 
-	 return ctx->modelChanged;
+	return ctx->modelChanged;
 }
 
 void _rom_activate(struct streammodel_ctx_s *ctx, int duringalloc)
@@ -200,17 +260,63 @@ static struct streammodel_pid_s *_rom_next_find_pid(struct streammodel_ctx_s *ct
 
 /* End: ROM */
 
-/* DVBPSI */
-static void message(dvbpsi_t *handle, const dvbpsi_msg_level_t level, const char* msg)
+/* PSI: PAT/PMT/SDT decode.
+ * Each rom reassembles sections on its PSI pids, see ltntstools_sectionreassembler_alloc().
+ * Sections are gated on their header (table_id, version, section_number) as soon as it arrives,
+ * sections we've already accepted are skipped without being copied or CRC checked, so a stable
+ * stream costs a header peek per section.
+ */
+static int _section_seen(const uint8_t *bitmap, uint8_t nr)
 {
-	switch(level) {
-	case DVBPSI_MSG_ERROR: fprintf(stderr, "Error: "); break;
-	case DVBPSI_MSG_WARN:  fprintf(stderr, "Warning: "); break;
-	case DVBPSI_MSG_DEBUG: fprintf(stderr, "Debug: "); break;
-	default: /* do nothing */
-		return;
+	return bitmap[nr >> 3] & (1 << (nr & 7));
+}
+
+static void _section_set_seen(uint8_t *bitmap, uint8_t nr)
+{
+	bitmap[nr >> 3] |= (1 << (nr & 7));
+}
+
+static uint32_t _section_crc(const uint8_t *sec, int lengthBytes)
+{
+	const uint8_t *p = sec + lengthBytes - 4;
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static void _rom_collect_sections(struct streammodel_rom_s *rom, struct streammodel_pid_s *ps)
+{
+	if (ltntstools_sectionreassembler_add_pid(rom->reassembler, ps->pid) == 0) {
+		ps->psi = 1;
+	}
+}
+
+/* The rom changed after its model was cached, rebuild the model on next use. */
+static void _rom_invalidate_model(struct streammodel_rom_s *rom)
+{
+	if (rom->psiModel) {
+		ltntstools_psi_model_unref(rom->psiModel);
+		rom->psiModel = NULL;
+	}
+}
+
+/* The stream no longer matches a completed model. The current model never changes, a new
+ * model is collected straight away instead of waiting for the next scheduled scan.
+ */
+static void _rom_psi_changed(struct streammodel_rom_s *rom)
+{
+	if (rom == rom->ctx->current) {
+		rom->ctx->psiChanged = 1;
 	}
-	fprintf(stderr, "%s\n", msg);
+}
+
+static struct streammodel_pat_program_s *_rom_find_program(struct streammodel_rom_s *rom, uint16_t program_number, uint16_t pid)
+{
+	for (int i = 0; i < rom->pat.programCount; i++) {
+		struct streammodel_pat_program_s *p = &rom->pat.programs[i];
+		if (p->program_number == program_number && p->program_map_PID == pid)
+			return p;
+	}
+
+	return NULL;
 }
 
 static int sdt_add(struct streammodel_rom_s *rom, struct streammodel_sdt_s *sdt)
@@ -226,25 +332,83 @@ static int sdt_add(struct streammodel_rom_s *rom, struct streammodel_sdt_s *sdt)
 
 	/* Add it */
 	memcpy(&rom->sdt[rom->sdtCount], sdt, sizeof(*sdt));
+
+	/* Service details changed, rebuild any cached model on next use */
+	_rom_invalidate_model(rom);
 //	printf("Added service id 0x%04x, count = %d to rom %p\n", sdt->service_id, rom->sdtCount, rom);
 	rom->sdtCount++;
 
 	return 0;
 }
 
-static void cb_sdt(void *p_zero, dvbpsi_sdt_t *p_sdt)
+/* Decode a descriptor loop into a list, truncated descriptors end the loop. */
+static void _descriptors_to_list(const uint8_t *p, int lengthBytes, struct ltntstools_descriptor_list_s *list)
 {
-	struct streammodel_pid_s *ps = p_zero;
-	struct streammodel_rom_s *rom = ps->rom;
+	while (lengthBytes >= 2) {
+		uint8_t tag = p[0];
+		uint8_t len = p[1];
+		if (2 + len > lengthBytes)
+			break;
 
-	dvbpsi_sdt_service_t* p_service = p_sdt->p_first_service;
+		if (ltntstools_descriptor_list_add(list, tag, (uint8_t *)&p[2], len) < 0) {
+			/* Error, skipping. */
+		}
 
-#if CHATTY_CALLBACKS
-	printf("%s(%p, sdt %p) pid 0x%x model#%d\n", __func__, ps, p_sdt, ps->pid, ps->rom->nr);
-#endif
+		p += 2 + len;
+		lengthBytes -= 2 + len;
+	}
+}
 
+/* Decode a CRC validated PMT section into the caller's pmt. */
+static void _pmt_section_to_pmt(const uint8_t *sec, int lengthBytes, struct ltntstools_pmt_s *pmt)
+{
+	const uint8_t *end = sec + lengthBytes - 4; /* CRC */
 
-	while (p_service) {
+	pmt->program_number = sec[3] << 8 | sec[4];
+	pmt->version_number = (sec[5] >> 1) & 0x1f;
+	pmt->current_next_indicator = sec[5] & 0x01;
+	pmt->PCR_PID = (sec[8] & 0x1f) << 8 | sec[9];
+
+	/* Outer descriptors */
+	int program_info_length = (sec[10] & 0x0f) << 8 | sec[11];
+	const uint8_t *p = sec + 12;
+	if (p + program_info_length > end)
+		return;
+	_descriptors_to_list(p, program_info_length, &pmt->descr_list);
+	p += program_info_length;
+
+	/* Add all of the ES streams. */
+	while (p + 5 <= end && pmt->stream_count < LTNTSTOOLS_PMT_ENTRIES_MAX) {
+		struct ltntstools_pmt_entry_s *es = &pmt->streams[ pmt->stream_count ];
+		es->stream_type = p[0];
+		es->elementary_PID = (p[1] & 0x1f) << 8 | p[2];
+
+		/* Inner descriptors */
+		int es_info_length = (p[3] & 0x0f) << 8 | p[4];
+		p += 5;
+		if (p + es_info_length > end)
+			break;
+		_descriptors_to_list(p, es_info_length, &es->descr_list);
+		p += es_info_length;
+
+		pmt->stream_count++;
+	}
+}
+
+static void _sdt_section(struct streammodel_rom_s *rom, const uint8_t *sec, int lengthBytes)
+{
+	uint8_t version = (sec[5] >> 1) & 0x1f;
+
+	if (rom->sdtVersion != version) {
+		rom->sdtVersion = version;
+		memset(rom->sdtSectionsSeen, 0, sizeof(rom->sdtSectionsSeen));
+	}
+	_section_set_seen(rom->sdtSectionsSeen, sec[6]);
+
+	const uint8_t *end = sec + lengthBytes - 4; /* CRC */
+	const uint8_t *p = sec + 11; /* After the original_network_id */
+
+	while (p + 5 <= end) {
 
 		if (rom->sdtCount >= 128)
 			break;
@@ -252,33 +416,40 @@ static void cb_sdt(void *p_zero, dvbpsi_sdt_t *p_sdt)
 		struct streammodel_sdt_s sdt;
 		memset(&sdt, 0, sizeof(sdt));
 
-		sdt.service_id = p_service->i_service_id;
+		sdt.service_id = p[0] << 8 | p[1];
 
 		/* Process descriptors */
-		dvbpsi_descriptor_t *p_descriptor = p_service->p_first_descriptor;
-		while (p_descriptor) {
+		int descriptors_loop_length = (p[3] & 0x0f) << 8 | p[4];
+		const uint8_t *d = p + 5;
+		p += 5 + descriptors_loop_length;
+		if (p > end)
+			break;
 
-			if (p_descriptor->i_tag == 0x48  /* DVB_SERVICE_DESCRIPTOR_TAG */) {
-				rom->sdt[ rom->sdtCount ].service_type = p_descriptor->p_data[0];
-#if 0
-				for (int i = 0; i < 16; i++)
-					printf("%02x ", p_descriptor->p_data[i]);
-				printf("\n");
-#endif
-				int pl = p_descriptor->p_data[1];
-				uint8_t *psrc = NULL;
-				if (pl) {
-					psrc = &p_descriptor->p_data[2];
-				}
+		while (d + 2 <= p) {
+			uint8_t tag = d[0];
+			uint8_t len = d[1];
+			const uint8_t *data = d + 2;
+			d += 2 + len;
+			if (d > p)
+				break;
 
-				int nl = p_descriptor->p_data[2 + pl];
-				uint8_t *nsrc = NULL;
-				if (nl) {
-					nsrc = &p_descriptor->p_data[2 + pl + 1];
-				}
+			if (tag == 0x48  /* DVB_SERVICE_DESCRIPTOR_TAG */ && len >= 3) {
+				sdt.service_type = data[0];
 
-				strncpy(&sdt.service_provider[0], (char *)psrc, pl);
-				strncpy(&sdt.service_name[0],     (char *)nsrc, nl);
+				int pl = data[1];
+				if (2 + pl + 1 > len)
+					continue;
+				int nl = data[2 + pl];
+				if (2 + pl + 1 + nl > len)
+					continue;
+
+				if (pl >= sizeof(sdt.service_provider))
+					pl = sizeof(sdt.service_provider) - 1;
+				if (nl >= sizeof(sdt.service_name))
+					nl = sizeof(sdt.service_name) - 1;
+
+				memcpy(&sdt.service_provider[0], &data[2], pl);
+				memcpy(&sdt.service_name[0], &data[2 + data[1] + 1], nl);
 #if 0
 				printf("pl %d nl %d, service id 0x%04x type 0x%02x name= '%s' provider = '%s'\n", pl, nl,
 					sdt.service_id,
@@ -288,54 +459,60 @@ static void cb_sdt(void *p_zero, dvbpsi_sdt_t *p_sdt)
 #endif
 				sdt_add(rom, &sdt);
 			}
-
-			p_descriptor = p_descriptor->p_next;
 		}
-		p_service = p_service->p_next;
 	}
-
-	dvbpsi_sdt_delete(p_sdt);
 }
 
-static void cb_pmt(void *p_zero, dvbpsi_pmt_t *p_pmt)
+static void _pmt_section(struct streammodel_rom_s *rom, struct streammodel_pid_s *ps, const uint8_t *sec, int lengthBytes)
 {
-	struct streammodel_pid_s *ps = p_zero;
-	struct streammodel_rom_s *rom = ps->rom;
 	struct streammodel_ctx_s *ctx = rom->ctx;
+	uint16_t program_number = sec[3] << 8 | sec[4];
 
-	dvbpsi_pmt_es_t* p_es = p_pmt->p_first_es;
+	/* Only PMTs the PAT told us to expect, on the pid it told us. */
+	struct streammodel_pat_program_s *prg = _rom_find_program(rom, program_number, ps->pid);
+	if (!prg)
+		return;
 
 #if CHATTY_CALLBACKS
 	printf("New active PMT (%d)\n", ps->pid);
-	printf("  program_number : %d\n", p_pmt->i_program_number);
+	printf("  program_number : %d\n", program_number);
 #endif
-	while(p_es) {
+
+	int firstPMT = prg->pmtVersion < 0;
+
+	/* Cache the section, the pat is built from it when the model is queried. */
+	prg->pmtVersion = (sec[5] >> 1) & 0x1f;
+	prg->pmtLengthBytes = lengthBytes;
+	memcpy(prg->pmt, sec, lengthBytes);
+	_rom_invalidate_model(rom);
+
+	/* Every ES pid is now expected in the stream */
+	const uint8_t *end = sec + lengthBytes - 4; /* CRC */
+	const uint8_t *p = sec + 12 + ((sec[10] & 0x0f) << 8 | sec[11]);
+	while (p + 5 <= end) {
+		uint8_t stream_type = p[0];
+		uint16_t elementary_PID = (p[1] & 0x1f) << 8 | p[2];
+		p += 5 + ((p[3] & 0x0f) << 8 | p[4]);
 #if CHATTY_CALLBACKS
-		printf("    pid 0x%04x estype %02x\n", p_es->i_pid, p_es->i_type);
+		printf("    pid 0x%04x estype %02x\n", elementary_PID, stream_type);
 #endif
-		if (p_es->i_pid >= 0x10) {
-			struct streammodel_pid_s *es = _rom_next_find_pid(ctx, p_es->i_pid);
+		if (elementary_PID >= 0x10) {
+			struct streammodel_pid_s *es = _rom_find_pid(rom, elementary_PID);
 			es->present = 1;
 			es->pidType = PT_ES;
 		} else {
 			static unsigned int complain = 1;
 			if (complain == 1) {
 				complain = 0;
-				printf("Illegal placement of ES type 0x%02x on pid 0x%04x, it's < 0x10\n", p_es->i_type, p_es->i_pid);
+				printf("Illegal placement of ES type 0x%02x on pid 0x%04x, it's < 0x10\n", stream_type, elementary_PID);
 			}
 		}
-
-		p_es = p_es->p_next;
 	}
 
-	/* Find the appropriate PMT in the array matching this program number. */
-	int idx = 0;
-	for (int j = 0; j < MAX_PID_PARSERS;j++) {
-		if (ps->parser[j].programNumber == p_pmt->i_program_number)
-			idx = j;
-	}
-	/* Don't delete p_pmt, we're caching it. */
-	ps->parser[idx].p_pmt = p_pmt;
+	/* A PMT version change during collection replaces the section, it doesn't count twice. */
+	if (!firstPMT)
+		return;
+
 	rom->parsedPMTs++;
 
 #if CHATTY_CALLBACKS
@@ -346,113 +523,221 @@ static void cb_pmt(void *p_zero, dvbpsi_pmt_t *p_pmt)
 	}
 }
 
-static void cb_pat(void *p_zero, dvbpsi_pat_t *p_pat)
+/* Every section of the PAT has arrived, start collecting the PMTs it describes. */
+static void _pat_complete(struct streammodel_rom_s *rom)
 {
-	struct streammodel_pid_s *ps = p_zero;
-	struct streammodel_rom_s *rom = ps->rom;
 	struct streammodel_ctx_s *ctx = rom->ctx;
 
-#if CHATTY_CALLBACKS
-	printf("%s(%p, pat %p) pid 0x%x model#%d\n", __func__, ps, p_pat, ps->pid, ps->rom->nr);
-#endif
-
-	dvbpsi_pat_program_t *p_program = p_pat->p_first_program;
-
-	if (rom->totalPMTsInPAT) {
-		/* We might already have a PAT in progress. If we do, and another pat has
-		 * arrived with a differnt version number, that means the stream was
-		 * randomly changed underneat is, and we're not receiving
-		 * a completely different stream.
-		 * Abort the processing of the previous PAT, cleanup the rom and start again
-		 * with the PAT.
-		 */
-		struct streammodel_pid_s *m = _rom_next_find_pid(ctx, 0);
-		if (m->p_pat->i_version != p_pat->i_version && p_pat->b_current_next) {
-#if CHATTY_CALLBACKS
-			printf("New PAT arrived before the prior PAT complete version 0x%02x vs 0x%02x.\n",
-				m->p_pat->i_version, p_pat->i_version);
-#endif
-			dvbpsi_pat_delete(p_pat);
-			ctx->restartModel = 1;
-			return;
-		}
-	}
-
 #if CHATTY_CALLBACKS
 	printf("\n");
 	printf("PAT\n");
-	printf("  transport_stream_id : 0x%04x\n", p_pat->i_ts_id);
-	printf("  version_number      : 0x%04x\n", p_pat->i_version);
-	printf("  current_next        : %d\n", p_pat->b_current_next);
+	printf("  transport_stream_id : 0x%04x\n", rom->pat.transport_stream_id);
+	printf("  version_number      : 0x%04x\n", rom->pat.version);
 	printf("    | program_number @ PID\n");
 #endif
 
 	/* Maximum of 1 second to gather PMT. */
 	struct timeval future = { 1, 0 };
-	timeradd(&future, &ctx->now, &ctx->next->pmtCollectionTimer);
+	timeradd(&future, &ctx->now, &rom->pmtCollectionTimer);
 
 	rom->totalPMTsInPAT = 0;
 
-	while(p_program) {
+	for (int i = 0; i < rom->pat.programCount; i++) {
+		struct streammodel_pat_program_s *p = &rom->pat.programs[i];
 #if CHATTY_CALLBACKS
-		printf("    | %14d @ 0x%04x (%d)\n", p_program->i_number, p_program->i_pid, p_program->i_pid);
+		printf("    | %14d @ 0x%04x (%d)\n", p->program_number, p->program_map_PID, p->program_map_PID);
 #endif
 
 		/* Program# 0 is reserved for NIT tables. We don't expect a PMT for these. */
-		if (p_program->i_number > 0) {
+		if (p->program_number == 0)
+			continue;
 
-			if (ctx->enableSectionCRCChecks) {
-				extractors_add(ctx, p_program->i_pid, 0x02 /* TableID */, "PMT", STREAMMODEL_CB_CONTEXT_PMT);
-			}
+		if (ctx->enableSectionCRCChecks) {
+			extractors_add(ctx, p->program_map_PID, 0x02 /* TableID */, "PMT", STREAMMODEL_CB_CONTEXT_PMT);
+		}
 
-			/* Build a new parser for the PMT. */
-			struct streammodel_pid_s *m = _rom_next_find_pid(ctx, p_program->i_pid);
+		/* Start collecting sections on the PMT pid, pids may be shared by programs. */
+		struct streammodel_pid_s *m = _rom_find_pid(rom, p->program_map_PID);
 
-			m->present = 1;
-			m->pidType = PT_PMT;
+		m->present = 1;
+		m->pidType = PT_PMT;
+		if (!m->psi) {
+			_rom_collect_sections(rom, m);
+		}
 
-			int idx = 0;
-			for (int i = 0; i < MAX_PID_PARSERS; i++) {
-				if (m->parser[i].p_dvbpsi == 0) {
-					idx = i;
-					break;
-				}
-			}
+		rom->totalPMTsInPAT++;
+	}
+#if CHATTY_CALLBACKS
+	printf(  "  PMTS %d\n", rom->totalPMTsInPAT);
+#endif
+}
 
-			if (m->parser[idx].p_dvbpsi) {
-				dvbpsi_pmt_detach(m->parser[idx].p_dvbpsi);
-				dvbpsi_delete(m->parser[idx].p_dvbpsi);
-				m->parser[idx].p_dvbpsi = NULL;
-			}
+static void _pat_section(struct streammodel_rom_s *rom, const uint8_t *sec, int lengthBytes)
+{
+	struct streammodel_ctx_s *ctx = rom->ctx;
+	uint8_t version = (sec[5] >> 1) & 0x1f;
+
+	if (rom->pat.version >= 0 && rom->pat.version != version) {
+		if (rom->totalPMTsInPAT) {
+			/* We might already have a PAT in progress. If we do, and another pat has
+			 * arrived with a differnt version number, that means the stream was
+			 * randomly changed underneat is, and we're not receiving
+			 * a completely different stream.
+			 * Abort the processing of the previous PAT, cleanup the rom and start again
+			 * with the PAT.
+			 */
+#if CHATTY_CALLBACKS
+			printf("New PAT arrived before the prior PAT complete version 0x%02x vs 0x%02x.\n",
+				rom->pat.version, version);
+#endif
+			ctx->restartModel = 1;
+			return;
+		}
 
-			m->parser[idx].p_dvbpsi = dvbpsi_new(&message, DVBPSI_REPORTING);
-			if (!m->parser[idx].p_dvbpsi) {
-				fprintf(stderr, "%s() PSI alloc. Should never happen\n", __func__);
-				exit(1);
-			}
+		/* An incomplete multi-section PAT changed, start again */
+		rom->pat.programCount = 0;
+		memset(rom->pat.sectionsSeen, 0, sizeof(rom->pat.sectionsSeen));
+	}
 
-			if (!dvbpsi_pmt_attach(m->parser[idx].p_dvbpsi, p_program->i_number, cb_pmt, m))
-			{
-				fprintf(stderr, "%s() PMT attach. Should never happen\n", __func__);
-				exit(1);
-			}
-			m->parser[idx].programNumber = p_program->i_number;
+	rom->pat.version = version;
+	rom->pat.transport_stream_id = sec[3] << 8 | sec[4];
+	rom->pat.lastSectionNumber = sec[7];
+	rom->pat.sectionCRC[sec[6]] = _section_crc(sec, lengthBytes);
+	_section_set_seen(rom->pat.sectionsSeen, sec[6]);
+
+	const uint8_t *end = sec + lengthBytes - 4; /* CRC */
+	for (const uint8_t *p = sec + 8; p + 4 <= end; p += 4) {
+		if (rom->pat.programCount >= LTNTSTOOLS_PAT_ENTRIES_MAX)
+			break;
 
-			rom->totalPMTsInPAT++;
+		struct streammodel_pat_program_s *prg = &rom->pat.programs[ rom->pat.programCount++ ];
+		prg->program_number = p[0] << 8 | p[1];
+		prg->program_map_PID = (p[2] & 0x1f) << 8 | p[3];
+		prg->pmtVersion = -1;
+		prg->pmtLengthBytes = 0;
+	}
+
+	for (int i = 0; i <= rom->pat.lastSectionNumber; i++) {
+		if (!_section_seen(rom->pat.sectionsSeen, i))
+			return; /* More to come */
+	}
+
+	rom->pat.complete = 1;
+	_pat_complete(rom);
+}
+
+/* Decide from its header whether a section is worth collecting. */
+static int _section_wanted(struct streammodel_rom_s *rom, struct streammodel_pid_s *ps, const uint8_t *hdr)
+{
+	uint8_t tableId = hdr[0];
+	uint16_t tableIdExtension = hdr[3] << 8 | hdr[4];
+	uint8_t version = (hdr[5] >> 1) & 0x1f;
+	uint8_t sectionNumber = hdr[6];
+	int wanted = 0;
+
+	if ((hdr[5] & 0x01) == 0)
+		return 0; /* current_next_indicator, not applicable yet */
+
+	if (tableId == 0x00 && ps->pid == TSTOOLS_PID_PAT) {
+		wanted = rom->pat.version != version || !_section_seen(rom->pat.sectionsSeen, sectionNumber);
+	} else
+	if (tableId == 0x02 && ps->pidType == PT_PMT) {
+		struct streammodel_pat_program_s *prg = _rom_find_program(rom, tableIdExtension, ps->pid);
+		wanted = prg && (prg->pmtVersion != version || prg->pmtLengthBytes == 0);
+	} else
+	if (tableId == 0x42 /* SDT Actual */ && ps->pid == 0x11) {
+		return rom->sdtVersion != version || !_section_seen(rom->sdtSectionsSeen, sectionNumber);
+	}
+
+	if (wanted && rom->modelComplete) {
+		/* A PAT or PMT the completed model doesn't have. */
+		_rom_psi_changed(rom);
+		return 0;
+	}
+
+	return wanted;
+}
+
+/* A section we skipped on its header alone. Its CRC tells us whether the content really is
+ * unchanged, some muxers change tables without bumping the version_number.
+ */
+static void _section_skipped(struct streammodel_rom_s *rom, struct streammodel_pid_s *ps, const uint8_t *sec, uint32_t crc)
+{
+	if ((sec[5] & 0x01) == 0)
+		return; /* current_next_indicator, not applicable yet */
+
+	if (sec[0] == 0x00 && ps->pid == TSTOOLS_PID_PAT) {
+		if (rom->pat.sectionCRC[sec[6]] == crc)
+			return;
+
+		if (rom->modelComplete) {
+			_rom_psi_changed(rom);
+		} else {
+			/* The PAT changed during collection, start again. */
+			rom->ctx->restartModel = 1;
+			rom->ctx->restartReason = 1;
+		}
+	} else
+	if (sec[0] == 0x02 && ps->pidType == PT_PMT) {
+		struct streammodel_pat_program_s *prg = _rom_find_program(rom, sec[3] << 8 | sec[4], ps->pid);
+		if (!prg || prg->pmtLengthBytes == 0 || _section_crc(prg->pmt, prg->pmtLengthBytes) == crc)
+			return;
+
+		if (rom->modelComplete) {
+			_rom_psi_changed(rom);
+		} else {
+			/* Collect the next copy, it replaces the one we have. */
+			prg->pmtLengthBytes = 0;
 		}
+	}
+}
 
-		p_program = p_program->p_next;
+static void _section_complete(struct streammodel_rom_s *rom, struct streammodel_pid_s *ps, const uint8_t *sec, int lengthBytes)
+{
+	/* The rom may have moved on since the header was filtered. */
+	if (!_section_wanted(rom, ps, sec)) {
+		_section_skipped(rom, ps, sec, _section_crc(sec, lengthBytes));
+		return;
+	}
 
+	switch (sec[0]) {
+	case 0x00: _pat_section(rom, sec, lengthBytes); break;
+	case 0x02: _pmt_section(rom, ps, sec, lengthBytes); break;
+	case 0x42: _sdt_section(rom, sec, lengthBytes); break;
 	}
-#if CHATTY_CALLBACKS
-	printf(  "  active              : %d\n", p_pat->b_current_next);
-	printf(  "  PMTS %d\n", rom->totalPMTsInPAT);
-#endif
+}
+
+/* Reassembler filter, the header of a section has arrived. */
+static int _section_filter(void *userContext, const struct ltntstools_section_s *section)
+{
+	struct streammodel_rom_s *rom = (struct streammodel_rom_s *)userContext;
+
+	if (section->lengthBytes < 12 || section->lengthBytes > MAX_SECTION_BYTES)
+		return 0; /* Malformed, or not a PSI table we parse */
+
+	return _section_wanted(rom, _rom_find_pid(rom, section->pid), section->header);
+}
+
+/* Reassembler callback, a complete section, or the header and CRC of one we filtered out. */
+static void _section_cb(void *userContext, const struct ltntstools_section_s *section)
+{
+	struct streammodel_rom_s *rom = (struct streammodel_rom_s *)userContext;
+	struct streammodel_pid_s *ps = _rom_find_pid(rom, section->pid);
+
+	if (section->lengthBytes < 12 || section->lengthBytes > MAX_SECTION_BYTES)
+		return;
 
-	/* Don't delete p_pat, we're caching it. */
-	ps->p_pat = p_pat;
+	if (!section->data) {
+		_section_skipped(rom, ps, section->header, section->crc);
+		return;
+	}
+
+	if (!section->crcValid)
+		return; /* Corrupt */
+
+	_section_complete(rom, ps, section->data, section->lengthBytes);
 }
-/* End: DVBPSI */
+/* End: PSI */
 
 int ltntstools_streammodel_alloc(void **hdl, void *userContext)
 {
@@ -462,6 +747,16 @@ int ltntstools_streammodel_alloc(void **hdl, void *userContext)
 
 	pthread_mutex_init(&ctx->rom_mutex, NULL);
 
+	for (int i = 0; i < 2; i++) {
+		struct streammodel_rom_s *rom = &ctx->roms[i];
+		if (ltntstools_sectionreassembler_alloc(&rom->reassembler, _section_cb, rom) < 0) {
+			ltntstools_sectionreassembler_free(ctx->roms[0].reassembler);
+			free(ctx);
+			return -1;
+		}
+		ltntstools_sectionreassembler_set_filter(rom->reassembler, _section_filter);
+	}
+
 	_rom_initialize(ctx, &ctx->roms[0], 0);
 	_rom_initialize(ctx, &ctx->roms[1], 1);
 	ctx->current = &ctx->roms[0];
@@ -489,20 +784,16 @@ void ltntstools_streammodel_free(void *hdl)
 	_rom_initialize(ctx, &ctx->roms[1], 1);
 
 	extractors_free(ctx);
+	_changes_release(ctx);
+
+	ltntstools_sectionreassembler_free(ctx->roms[0].reassembler);
+	ltntstools_sectionreassembler_free(ctx->roms[1].reassembler);
 
 	pthread_mutex_unlock(&ctx->rom_mutex);
 
 	free(ctx);
 }
 
-static void NewSubtable(dvbpsi_t *p_dvbpsi, uint8_t i_table_id, uint16_t i_extension, void * p_zero)
-{
-	if (i_table_id == 0x42 /* SDT Actual */) {
-		if (!dvbpsi_sdt_attach(p_dvbpsi, i_table_id, i_extension, cb_sdt, p_zero))
-			fprintf(stderr, "Failed to attach SDT subdecoder\n");
-	}
-}
-
 /* pkt lists must be aligned. list may contant one or more packets. */
 size_t ltntstools_streammodel_write(void *hdl, const unsigned char *pkt, int packetCount, int *complete, struct timeval *timestamp)
 {
@@ -584,17 +875,30 @@ size_t ltntstools_streammodel_write(void *hdl, const unsigned char *pkt, int pac
 		if (pid == 0x11 /* SDT PID */ && ps->packetCount == 0) {
 			ps->present = 1;
 			ps->pidType = PT_SDT;
+			_rom_collect_sections(ctx->next, ps);
+			ps->packetCount++;
+		}
 
-			ps->parser[0].p_dvbpsi = dvbpsi_new(&message, DVBPSI_REPORTING);
+		if (ps->psi && pid == 0x11) {
+			ltntstools_sectionreassembler_write(ctx->next->reassembler, &pkt[i * 188], 1);
+		}
 
-			if (!dvbpsi_AttachDemux(ps->parser[0].p_dvbpsi, NewSubtable, ps)) {
-				printf("Failed, Attaching a SDT - failed attached demux\n");
-			}
-			ps->packetCount++;
+		/* The current model watches its PAT and PMT pids, an unchanged section costs a header peek. */
+		if (ps->watched && ctx->current->modelComplete) {
+			ltntstools_sectionreassembler_write(ctx->current->reassembler, &pkt[i * 188], 1);
 		}
+	}
+
+	if (ctx->psiChanged) {
+		ctx->psiChanged = 0;
 
-		if (ps->parser[0].p_dvbpsi && pid == 0x11) {
-			dvbpsi_packet_push(ps->parser[0].p_dvbpsi, (unsigned char *)&pkt[i * 188]);
+		/* Start collecting the next model now, unless it's already collecting. */
+		if (!ctx->writePackets) {
+#if CHATTY_CALLBACKS
+			printf("PSI change detected by the current model, collecting a new model\n");
+#endif
+			ctx->next->allowableWriteTime = ctx->now;
+			ctx->writePackets = 1;
 		}
 	}
 
@@ -609,27 +913,16 @@ size_t ltntstools_streammodel_write(void *hdl, const unsigned char *pkt, int pac
 		/* Find the next pid struct for this pid */
 		struct streammodel_pid_s *ps = _rom_next_find_pid(ctx, pid);
 
-		/* Initialize the PAT parser if this is the first time around. */
+		/* Start collecting the PAT if this is the first time around. */
 		if (pid == 0 && ps->packetCount == 0) {
 			ps->present = 1;
 			ps->pidType = PT_PAT;
-
-			ps->parser[0].p_dvbpsi = dvbpsi_new(&message, DVBPSI_REPORTING);
-
-			if (!dvbpsi_pat_attach(ps->parser[0].p_dvbpsi, cb_pat, ps))
-			{
-				fprintf(stderr, "%s() PAT attach. Should never happen\n", __func__);
-				exit(1);
-			}
-
+			_rom_collect_sections(ctx->next, ps);
 		}
 
-		if (ps->present) {
-			for (int j = 0; j < MAX_PID_PARSERS; j++) {
-				if (ps->parser[j].p_dvbpsi == NULL)
-					continue;
-				dvbpsi_packet_push(ps->parser[j].p_dvbpsi, (unsigned char *)&pkt[i * 188]);
-			}
+		/* Only PSI pids are reassembled, everything else costs a flag test. */
+		if (ps->psi) {
+			ltntstools_sectionreassembler_write(ctx->next->reassembler, &pkt[i * 188], 1);
 		}
 
 		ps->packetCount++;
@@ -657,16 +950,44 @@ size_t ltntstools_streammodel_write(void *hdl, const unsigned char *pkt, int pac
 		}
 	}
 
+	/* The change callback runs unlocked, it may query the model it's being told about. */
+	ltntstools_streammodel_change_callback changeCb = NULL;
+	const struct ltntstools_psi_model_s *changePrevious = NULL, *changeCurrent = NULL;
+	struct ltntstools_psi_change_s *changes = NULL;
+	int changeCount = 0;
+
 	if (ctx->modelChanged) {
 		_rom_activate(ctx, 0);
 		*complete = 1;;
 		ctx->modelChanged = 0;
+
+		if (ctx->changeCount) {
+			changeCb = ctx->changeCb;
+			changePrevious = ctx->changePrevious;
+			changeCurrent = ctx->changeCurrent;
+			changes = ctx->changes;
+			changeCount = ctx->changeCount;
+
+			/* Ownership moves to us, released below */
+			ctx->changePrevious = NULL;
+			ctx->changeCurrent = NULL;
+			ctx->changes = NULL;
+			ctx->changeCount = 0;
+		}
 	} else {
 		*complete = 0;
 	}
 
 	pthread_mutex_unlock(&ctx->rom_mutex);
 
+	if (changeCount) {
+		if (changeCb)
+			changeCb(ctx->userContext, changePrevious, changeCurrent, changes, changeCount);
+		ltntstools_psi_model_unref(changePrevious);
+		ltntstools_psi_model_unref(changeCurrent);
+		free(changes);
+	}
+
 	return packetCount;
 }
 
@@ -720,15 +1041,25 @@ static int _streammodel_query_model(struct streammodel_ctx_s *ctx, struct stream
 
 //		_streammodel_dprintf(ctx, 0, rom);
 
-		struct streammodel_pid_s *ps = &rom->pids[0];
-
-		dvbpsi_pat_t *stream_pat = ps->p_pat;
-		if (stream_pat) {
+		struct streammodel_pat_s *stream_pat = &rom->pat;
+		struct ltntstools_pat_s *newpat = NULL;
+		if (stream_pat->complete) {
+			newpat = ltntstools_pat_alloc();
+		}
+		if (newpat) {
 
-			struct ltntstools_pat_s *newpat = ltntstools_pat_alloc_from_existing(stream_pat);
+			newpat->transport_stream_id = stream_pat->transport_stream_id;
+			newpat->version_number = stream_pat->version;
+			newpat->current_next_indicator = 1; /* We only collect current tables */
 
 			/* For each pmt in the model, add this to our new object. */
-			for (int i = 0; i < newpat->program_count; i++) {
+			for (int i = 0; i < stream_pat->programCount; i++) {
+				struct streammodel_pat_program_s *prg = &stream_pat->programs[i];
+
+				newpat->programs[i].program_number = prg->program_number;
+				newpat->programs[i].program_map_PID = prg->program_map_PID;
+				newpat->program_count++;
+
 				if (newpat->programs[i].program_number == 0)
 					continue; /* Network PID */
 
@@ -743,19 +1074,9 @@ static int _streammodel_query_model(struct streammodel_ctx_s *ctx, struct stream
 					}
 				}
 
-
-				struct streammodel_pid_s *c = _rom_find_pid(rom, newpat->programs[i].program_map_PID);
-				if (c->present == 0)
-					continue;
-
-				for (int j = 0; j < MAX_PID_PARSERS; j++) {
-					if (c->parser[j].p_pmt && c->parser[j].programNumber ==
-						newpat->programs[i].program_number)
-					{
-						ltntstools_pat_add_from_existing(newpat, c->parser[j].p_pmt);
-					}
+				if (prg->pmtVersion >= 0) {
+					_pmt_section_to_pmt(prg->pmt, prg->pmtLengthBytes, &newpat->programs[i].pmt);
 				}
-				
 			}
 
 			*pat = newpat;
@@ -786,6 +1107,45 @@ int ltntstools_streammodel_query_model(void *hdl, struct ltntstools_pat_s **pat)
 	return ret;
 }
 
+/* Returns the roms cached model, building it if needed. The rom holds the reference. */
+static const struct ltntstools_psi_model_s *_rom_query_psi_model(struct streammodel_ctx_s *ctx, struct streammodel_rom_s *rom)
+{
+	if (!rom->modelComplete)
+		return NULL;
+	if (rom->psiModel)
+		return rom->psiModel;
+
+	struct ltntstools_pat_s *pat = NULL;
+	if (_streammodel_query_model(ctx, rom, &pat) < 0)
+		return NULL;
+
+	rom->psiModel = ltntstools_psi_model_alloc_from_pat(pat);
+	ltntstools_pat_free(pat);
+
+	return rom->psiModel;
+}
+
+int ltntstools_streammodel_query_psi_model(void *hdl, const struct ltntstools_psi_model_s **model)
+{
+	struct streammodel_ctx_s *ctx = (struct streammodel_ctx_s *)hdl;
+	int ret = -1;
+
+	if (!ctx || !model)
+		return -1;
+
+	pthread_mutex_lock(&ctx->rom_mutex);
+	if (ctx->current->modelComplete == 1) {
+		const struct ltntstools_psi_model_s *m = _rom_query_psi_model(ctx, ctx->current);
+		if (m) {
+			*model = ltntstools_psi_model_ref(m);
+			ret = 0;
+		}
+	}
+	pthread_mutex_unlock(&ctx->rom_mutex);
+
+	return ret;
+}
+
 int ltntstools_streammodel_is_model_mpts(void *hdl, struct ltntstools_pat_s *pat)
 {
 	int validServices = 0;
@@ -820,6 +1180,19 @@ int ltntstools_streammodel_query_first_program_pcr_pid(void *hdl, struct ltntsto
 	return -1; /* Failed */
 }
 
+int ltntstools_streammodel_set_change_callback(void *hdl, ltntstools_streammodel_change_callback cb)
+{
+	struct streammodel_ctx_s *ctx = (struct streammodel_ctx_s *)hdl;
+	if (!ctx)
+		return -1;
+
+	pthread_mutex_lock(&ctx->rom_mutex);
+	ctx->changeCb = cb;
+	pthread_mutex_unlock(&ctx->rom_mutex);
+
+	return 0;
+}
+
 int ltntstools_streammodel_enable_tr101290_section_checks(void *hdl, ltntstools_streammodel_callback cb)
 {
 	struct streammodel_ctx_s *ctx = (struct streammodel_ctx_s *)hdl;
@@ -30,7 +30,7 @@ static int isPIDActive(struct ltntstools_tr101290_s *s, uint16_t pidNr, time_t n
 
 /* P1.6 - Referred PID does not occur for a user specified period. */
 /* We're called with a valid stream model. */
-static void p1_process_p1_6(struct ltntstools_tr101290_s *s, struct ltntstools_pat_s *pat, struct timeval time_now, time_t now)
+static void p1_process_p1_6(struct ltntstools_tr101290_s *s, const struct ltntstools_psi_model_s *model, struct timeval time_now, time_t now)
 {
 	/* Walk each pid in the model, make sure we've received a packet in the last 1000ms
 	 * or less, otherwise raise an error.
@@ -40,8 +40,8 @@ static void p1_process_p1_6(struct ltntstools_tr101290_s *s, struct ltntstools_p
 	char msg[256];
 	msg[0] = 0;
 
-	for (int i = 0; i < pat->program_count; i++) {
-		struct ltntstools_pat_program_s *prg = &pat->programs[i];
+	for (int i = 0; i < model->program_count; i++) {
+		const struct ltntstools_psi_program_s *prg = &model->programs[i];
 
 		/* Specifically, don't skip the network pid program_number 0 */
 
@@ -52,8 +52,8 @@ static void p1_process_p1_6(struct ltntstools_tr101290_s *s, struct ltntstools_p
 		}
 
 		/* Check every ES in the PMT. */
-		for (int j = 0; j < prg->pmt.stream_count; j++) {
-			struct ltntstools_pmt_entry_s *strm = &prg->pmt.streams[j];
+		for (int j = 0; j < prg->stream_count; j++) {
+			const struct ltntstools_psi_stream_s *strm = &prg->streams[j];
 
 			/* Check each ES */
 			if (isPIDActive(s, strm->elementary_PID, now) == 0) {
@@ -101,28 +101,29 @@ static ssize_t p1_process_p1_56(struct ltntstools_tr101290_s *s, const uint8_t *
 	ltntstools_streammodel_write(s->smHandle, buf, packetCount, &complete, &time_now);
 
 	/* If the stream model is completing, then the PMT's must be ok.
-	 * DVBPSI enforces the scrambling control check.
+	 * The stream model ignores scrambled PSI packets, enforcing the scrambling control check.
 	 */
 	if (complete) {
 
-		struct ltntstools_pat_s *pat;
-		if (ltntstools_streammodel_query_model(s->smHandle, &pat) == 0) {
+		const struct ltntstools_psi_model_s *model;
+		if (ltntstools_streammodel_query_psi_model(s->smHandle, &model) == 0) {
 
-			if (s->cachedPAT) {
-				ltntstools_pat_free(s->cachedPAT);
-				s->cachedPAT = NULL;
+			/* We keep the reference, the model is shared with the stream model. */
+			if (s->cachedModel) {
+				ltntstools_psi_model_unref(s->cachedModel);
+				s->cachedModel = NULL;
 			}
-			s->cachedPAT = ltntstools_pat_clone(pat);
+			s->cachedModel = model;
 			s->lastCompleteTime = time(NULL);
 
 			/* Reset the array of PMTS and timers */
 			s->lastPMTArrayIndex = 0;
-			for (int i = 0; i < pat->program_count; i++) {
-				if (pat->programs[i].program_number == 0) {
+			for (int i = 0; i < model->program_count; i++) {
+				if (model->programs[i].program_number == 0) {
 					continue;
 				}
 
-				s->lastPMTArray[ s->lastPMTArrayIndex ].pmtpid = pat->programs[i].program_map_PID;
+				s->lastPMTArray[ s->lastPMTArrayIndex ].pmtpid = model->programs[i].program_map_PID;
 				s->lastPMTArray[ s->lastPMTArrayIndex ].lastChanged = time_now;
 				s->lastPMTArrayIndex++;
 
@@ -131,25 +132,23 @@ static ssize_t p1_process_p1_56(struct ltntstools_tr101290_s *s, const uint8_t *
 					break;
 				}
 			}
-
-			ltntstools_pat_free(pat);
 		}
 	}
 
 	/* We might already have a cached PAT from the last time the model
 	 * changed. Run our checks against it.
 	 */
-	if (s->cachedPAT) {
+	if (s->cachedModel) {
 		ltntstools_tr101290_alarm_clear(s, E101290_P1_5__PMT_ERROR, &time_now);
 		ltntstools_tr101290_alarm_clear(s, E101290_P1_5a__PMT_ERROR_2, &time_now);
 
 		/* Some of the P2 PCR checks need to know which pics have PCRs.
 			* Give the P2 processor a sneak peak at the model.
 			*/
-		p2_process_pat_model(s, s->cachedPAT);
+		p2_process_pat_model(s, s->cachedModel);
 
 		/* Check 1.6 Now that we have a stream model. */
-		p1_process_p1_6(s, s->cachedPAT, time_now, now);
+		p1_process_p1_6(s, s->cachedModel, time_now, now);
 	}
 
 	for (int i = 0; i < packetCount; i++) {
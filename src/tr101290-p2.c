@@ -17,13 +17,13 @@
 /* Called from the P1 layer when a new streammodel arrives every send or so.
  * take a look at the PCR pids and enable those in the general TS stats model,
  * so PCR timing analysis is auto-enabled.
- * We won't own the pat, don't change or free it.
+ * We won't own the model, don't unref it.
  */
-void p2_process_pat_model(struct ltntstools_tr101290_s *s, struct ltntstools_pat_s *pat)
+void p2_process_pat_model(struct ltntstools_tr101290_s *s, const struct ltntstools_psi_model_s *model)
 {
-	for (int i = 0; i < pat->program_count; i++) {
-		if (pat->programs[i].pmt.PCR_PID) {
-			ltntstools_pid_stats_pid_set_contains_pcr(s->streamStatistics, pat->programs[i].pmt.PCR_PID);
+	for (int i = 0; i < model->program_count; i++) {
+		if (model->programs[i].PCR_PID) {
+			ltntstools_pid_stats_pid_set_contains_pcr(s->streamStatistics, model->programs[i].PCR_PID);
 		}
 	}
 }
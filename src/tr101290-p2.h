@@ -22,7 +22,7 @@ ssize_t p2_write(struct ltntstools_tr101290_s *s, const uint8_t *buf, size_t pac
 void *p2_streammodel_callback(void *userContext, struct streammodel_callback_args_s *args);
 
 void p2_process_p2_2(struct ltntstools_tr101290_s *s);
-void p2_process_pat_model(struct ltntstools_tr101290_s *s, struct ltntstools_pat_s *pat);
+void p2_process_pat_model(struct ltntstools_tr101290_s *s, const struct ltntstools_psi_model_s *model);
 
 #ifdef __cplusplus
 };
@@ -103,7 +103,7 @@ struct ltntstools_tr101290_s
 	uint64_t preTEIErrors;
 	uint64_t preScrambledCount;
 	struct timeval lastPAT;
-	struct ltntstools_pat_s *cachedPAT;
+	const struct ltntstools_psi_model_s *cachedModel;
 
 	/* used exclusively to measure if PMTs are arriving within 0.5s
 	 * Up to a maximum of N PMTS. We scan the stream model, for each
@@ -312,9 +312,9 @@ void ltntstools_tr101290_free(void *hdl)
 		s->logFilename = NULL;
 	}
 
-	if (s->cachedPAT) {
-		ltntstools_pat_free(s->cachedPAT);
-		s->cachedPAT = NULL;
+	if (s->cachedModel) {
+		ltntstools_psi_model_unref(s->cachedModel);
+		s->cachedModel = NULL;
 	}
 	
 	free(s);
@@ -330,7 +330,7 @@ ssize_t ltntstools_tr101290_write(void *hdl, const uint8_t *buf, size_t packetCo
 		gettimeofday(&s->now, NULL);
 	}
 
-	ltn_histogram_interval_update(s->h1, timestamp);
+	ltn_histogram_interval_update(s->h1, &s->now);
 	//ltn_histogram_interval_print(STDOUT_FILENO, s->h1, 10);
 
 #if ENABLE_TESTING
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libltntstools/ts-file-reader.h"
+#include "libltntstools/ts.h"
+
+#define RTP_HEADER_SIZE 12
+
+struct ltntstools_ts_file_reader_s
+{
+	const uint8_t *map;
+	uint64_t length;
+	uint64_t pos;
+	int synced; /* pos is known to be a packet boundary */
+
+	struct ltntstools_ts_file_reader_stats_s stats;
+};
+
+int ltntstools_ts_file_reader_alloc(void **hdl, const char *filename)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		return -1;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -1;
+
+	/* Hints only, failures are harmless */
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	madvise(map, st.st_size, MADV_HUGEPAGE);
+#endif
+
+	struct ltntstools_ts_file_reader_s *ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		munmap(map, st.st_size);
+		return -1;
+	}
+	ctx->map = map;
+	ctx->length = st.st_size;
+
+	*hdl = ctx;
+
+	return 0;
+}
+
+void ltntstools_ts_file_reader_free(void *hdl)
+{
+	struct ltntstools_ts_file_reader_s *ctx = (struct ltntstools_ts_file_reader_s *)hdl;
+
+	munmap((void *)ctx->map, ctx->length);
+	free(ctx);
+}
+
+/* A 12 byte RTP header at pos, followed by a transport packet. Same test as ltntstools_queryPCRs(). */
+static int _isRTP(struct ltntstools_ts_file_reader_s *ctx, uint64_t pos)
+{
+	if (pos + RTP_HEADER_SIZE + 188 > ctx->length)
+		return 0;
+
+	return ctx->map[pos] == 0x80 && ctx->map[pos + RTP_HEADER_SIZE] == 0x47;
+}
+
+/* Position on the next packet boundary, skipping RTP headers and corruption.
+ * Returns 0 on success, else -1 at the end of the file.
+ */
+static int _sync(struct ltntstools_ts_file_reader_s *ctx)
+{
+	while (ctx->pos + 188 <= ctx->length) {
+		const uint8_t *p = ctx->map + ctx->pos;
+
+		if (*p == 0x47 && ctx->synced)
+			return 0;
+
+		if (_isRTP(ctx, ctx->pos)) {
+			ctx->pos += RTP_HEADER_SIZE;
+			ctx->stats.rtpHeaders++;
+			ctx->synced = 1;
+			continue;
+		}
+
+		if (ctx->synced) {
+			ctx->synced = 0;
+			ctx->stats.resyncs++;
+		}
+
+		uint64_t remain = ctx->length - ctx->pos;
+		if (remain < 3 * 188) {
+			/* Too short to confirm, trust a sync byte */
+			if (*p == 0x47) {
+				ctx->synced = 1;
+				return 0;
+			}
+			ctx->pos++;
+			ctx->stats.skippedBytes++;
+			continue;
+		}
+
+		/* Three sync bytes in a row, within the next 188 byte window */
+		int offset = ltntstools_findSyncPosition(p, remain > 4 * 188 ? 4 * 188 : remain);
+		if (offset < 0) {
+			ctx->pos += 188;
+			ctx->stats.skippedBytes += 188;
+			continue;
+		}
+
+		ctx->pos += offset;
+		ctx->stats.skippedBytes += offset;
+		ctx->synced = 1;
+		return 0;
+	}
+
+	ctx->stats.skippedBytes += ctx->length - ctx->pos;
+	ctx->pos = ctx->length;
+
+	return -1;
+}
+
+int ltntstools_ts_file_reader_next(void *hdl, const uint8_t **pkts, int maxPackets)
+{
+	struct ltntstools_ts_file_reader_s *ctx = (struct ltntstools_ts_file_reader_s *)hdl;
+
+	if (maxPackets <= 0)
+		return -1;
+
+	if (_sync(ctx) < 0)
+		return 0; /* End of file */
+
+	const uint8_t *p = ctx->map + ctx->pos;
+	uint64_t avail = (ctx->length - ctx->pos) / 188;
+	if (avail > maxPackets)
+		avail = maxPackets;
+
+	/* The first packet is known good, extend the batch while sync holds */
+	int count = 1;
+	while (count < avail && p[count * 188] == 0x47)
+		count++;
+
+	*pkts = p;
+	ctx->pos += count * 188;
+	ctx->stats.packets += count;
+	ctx->stats.batches++;
+
+	return count;
+}
+
+int ltntstools_ts_file_reader_seek(void *hdl, uint64_t offset)
+{
+	struct ltntstools_ts_file_reader_s *ctx = (struct ltntstools_ts_file_reader_s *)hdl;
+
+	if (offset > ctx->length)
+		return -1;
+
+	ctx->pos = offset;
+	ctx->synced = 0;
+
+	return 0;
+}
+
+uint64_t ltntstools_ts_file_reader_get_position(void *hdl)
+{
+	struct ltntstools_ts_file_reader_s *ctx = (struct ltntstools_ts_file_reader_s *)hdl;
+	return ctx->pos;
+}
+
+uint64_t ltntstools_ts_file_reader_get_length(void *hdl)
+{
+	struct ltntstools_ts_file_reader_s *ctx = (struct ltntstools_ts_file_reader_s *)hdl;
+	return ctx->length;
+}
+
+int ltntstools_ts_file_reader_get_stats(void *hdl, struct ltntstools_ts_file_reader_stats_s *stats)
+{
+	struct ltntstools_ts_file_reader_s *ctx = (struct ltntstools_ts_file_reader_s *)hdl;
+	if (!stats)
+		return -1;
+
+	*stats = ctx->stats;
+
+	return 0;
+}
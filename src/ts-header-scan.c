@@ -0,0 +1,257 @@
+/* Copyright LiveTimeNet, Inc. 2026. All Rights Reserved. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libltntstools/ts-header-scan.h"
+
+#if defined(__x86_64__)
+#define TS_HEADER_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*scan_kernel_fn)(struct ltntstools_ts_header_vector_s *vec, const uint8_t *pkts, uint32_t start, uint32_t packetCount);
+
+int ltntstools_ts_header_vector_alloc(struct ltntstools_ts_header_vector_s **vec, uint32_t maxPackets)
+{
+	if (!vec || maxPackets == 0) {
+		return -1;
+	}
+
+	struct ltntstools_ts_header_vector_s *v = calloc(1, sizeof(*v));
+	if (!v) {
+		return -1;
+	}
+
+	/* Round up so the kernels never need to special case the final bitmap word. */
+	uint32_t words = (maxPackets + 63) / 64;
+
+	v->maxPackets = maxPackets;
+	v->pid = malloc(maxPackets * sizeof(*v->pid));
+	v->cc = malloc(maxPackets);
+	v->afc = malloc(maxPackets);
+	v->scrambling = malloc(maxPackets);
+	v->pusi = calloc(words, sizeof(uint64_t));
+	v->tei = calloc(words, sizeof(uint64_t));
+	v->syncErrors = calloc(words, sizeof(uint64_t));
+	if (!v->pid || !v->cc || !v->afc || !v->scrambling || !v->pusi || !v->tei || !v->syncErrors) {
+		ltntstools_ts_header_vector_free(v);
+		return -1;
+	}
+
+	*vec = v;
+	return 0; /* Success */
+}
+
+void ltntstools_ts_header_vector_free(struct ltntstools_ts_header_vector_s *vec)
+{
+	if (!vec) {
+		return;
+	}
+
+	free(vec->pid);
+	free(vec->cc);
+	free(vec->afc);
+	free(vec->scrambling);
+	free(vec->pusi);
+	free(vec->tei);
+	free(vec->syncErrors);
+	free(vec);
+}
+
+/* Decode packets [start, packetCount) one at a time. Also used by the vector kernels for their tails. */
+static void _scan_scalar(struct ltntstools_ts_header_vector_s *vec, const uint8_t *pkts, uint32_t start, uint32_t packetCount)
+{
+	for (uint32_t i = start; i < packetCount; i++) {
+		const uint8_t *pkt = pkts + (i * 188);
+		uint32_t shift = i & 63;
+
+		vec->pid[i] = ((pkt[1] & 0x1f) << 8) | pkt[2];
+		vec->cc[i] = pkt[3] & 0x0f;
+		vec->afc[i] = (pkt[3] >> 4) & 0x03;
+		vec->scrambling[i] = pkt[3] >> 6;
+
+		/* Branch free, corrupt input shouldn't cost mispredictions. */
+		vec->syncErrors[i >> 6] |= (uint64_t)(pkt[0] != 0x47) << shift;
+		vec->tei[i >> 6] |= (uint64_t)(pkt[1] >> 7) << shift;
+		vec->pusi[i >> 6] |= (uint64_t)((pkt[1] >> 6) & 1) << shift;
+	}
+}
+
+#if TS_HEADER_SCAN_X86
+
+static inline uint32_t _load_header(const uint8_t *pkt)
+{
+	uint32_t w;
+	memcpy(&w, pkt, sizeof(w));
+	return w;
+}
+
+/* Headers are loaded as little endian 32 bit words, one packet per lane: b0 | b1 << 8 | b2 << 16 | b3 << 24.
+ * Four packets per iteration, the individual loads are the cost, decode and stores are a handful of ops.
+ */
+__attribute__((target("sse4.2")))
+static void _scan_sse42(struct ltntstools_ts_header_vector_s *vec, const uint8_t *pkts, uint32_t start, uint32_t packetCount)
+{
+	const __m128i sync = _mm_set1_epi32(0x47);
+	const __m128i lowbyte = _mm_set1_epi32(0xff);
+	const __m128i pidmask = _mm_set1_epi16(0x1fff);
+	const __m128i two_bits = _mm_set1_epi8(0x03);
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+	/* Byte swapped {b2, b1} pairs in the low 8 bytes, and b3 of each lane in the low 4 bytes. */
+	const __m128i pidshuf = _mm_setr_epi8(2, 1, 6, 5, 10, 9, 14, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i b3shuf = _mm_setr_epi8(3, 7, 11, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	uint32_t i = start;
+	for (; i + 4 <= packetCount; i += 4) {
+		const uint8_t *p = pkts + (i * 188);
+		__m128i w = _mm_setr_epi32(_load_header(p), _load_header(p + 188), _load_header(p + 376), _load_header(p + 564));
+
+		uint64_t sbits = (~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(w, lowbyte), sync)))) & 0x0f;
+		uint64_t tbits = _mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(w, 16)));
+		uint64_t ubits = _mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(w, 17)));
+
+		__m128i pid = _mm_and_si128(_mm_shuffle_epi8(w, pidshuf), pidmask);
+		_mm_storel_epi64((__m128i *)&vec->pid[i], pid);
+
+		__m128i b3 = _mm_shuffle_epi8(w, b3shuf);
+		uint32_t cc = _mm_cvtsi128_si32(_mm_and_si128(b3, nibble));
+		uint32_t afc = _mm_cvtsi128_si32(_mm_and_si128(_mm_srli_epi16(b3, 4), two_bits));
+		uint32_t sc = _mm_cvtsi128_si32(_mm_and_si128(_mm_srli_epi16(b3, 6), two_bits));
+		memcpy(&vec->cc[i], &cc, 4);
+		memcpy(&vec->afc[i], &afc, 4);
+		memcpy(&vec->scrambling[i], &sc, 4);
+
+		/* Groups of 4 never straddle a 64 bit word when start is a multiple of 4. */
+		vec->syncErrors[i >> 6] |= sbits << (i & 63);
+		vec->tei[i >> 6] |= tbits << (i & 63);
+		vec->pusi[i >> 6] |= ubits << (i & 63);
+	}
+
+	_scan_scalar(vec, pkts, i, packetCount);
+}
+
+/* As above, eight packets per iteration using a strided gather. */
+__attribute__((target("avx2")))
+static void _scan_avx2(struct ltntstools_ts_header_vector_s *vec, const uint8_t *pkts, uint32_t start, uint32_t packetCount)
+{
+	const __m256i stride = _mm256_setr_epi32(0, 188, 376, 564, 752, 940, 1128, 1316);
+	const __m256i sync = _mm256_set1_epi32(0x47);
+	const __m256i lowbyte = _mm256_set1_epi32(0xff);
+	const __m256i pidmask = _mm256_set1_epi16(0x1fff);
+	const __m256i two_bits = _mm256_set1_epi8(0x03);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	/* Shuffles operate per 128 bit half, results are joined afterwards. */
+	const __m256i pidshuf = _mm256_setr_epi8(2, 1, 6, 5, 10, 9, 14, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+						 2, 1, 6, 5, 10, 9, 14, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m256i b3shuf = _mm256_setr_epi8(3, 7, 11, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+						3, 7, 11, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	/* After the shuffles, the low bytes of each half hold results for packets 0-3 and 4-7 respectively. */
+	const __m256i pidjoin = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+	const __m256i b3join = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	uint32_t i = start;
+	for (; i + 8 <= packetCount; i += 8) {
+		const uint8_t *p = pkts + (i * 188);
+		__m256i w = _mm256_i32gather_epi32((const int *)p, stride, 1);
+
+		uint64_t sbits = (~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(w, lowbyte), sync)))) & 0xff;
+		uint64_t tbits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_slli_epi32(w, 16)));
+		uint64_t ubits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_slli_epi32(w, 17)));
+
+		__m256i pid = _mm256_permutevar8x32_epi32(_mm256_and_si256(_mm256_shuffle_epi8(w, pidshuf), pidmask), pidjoin);
+		_mm_storeu_si128((__m128i *)&vec->pid[i], _mm256_castsi256_si128(pid));
+
+		__m256i b3 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(w, b3shuf), b3join);
+		uint64_t cc = _mm_cvtsi128_si64(_mm256_castsi256_si128(_mm256_and_si256(b3, nibble)));
+		uint64_t afc = _mm_cvtsi128_si64(_mm256_castsi256_si128(_mm256_and_si256(_mm256_srli_epi16(b3, 4), two_bits)));
+		uint64_t sc = _mm_cvtsi128_si64(_mm256_castsi256_si128(_mm256_and_si256(_mm256_srli_epi16(b3, 6), two_bits)));
+		memcpy(&vec->cc[i], &cc, 8);
+		memcpy(&vec->afc[i], &afc, 8);
+		memcpy(&vec->scrambling[i], &sc, 8);
+
+		vec->syncErrors[i >> 6] |= sbits << (i & 63);
+		vec->tei[i >> 6] |= tbits << (i & 63);
+		vec->pusi[i >> 6] |= ubits << (i & 63);
+	}
+
+	/* The tail runs legacy SSE encoded code, avoid the AVX/SSE transition penalty. */
+	_mm256_zeroupper();
+
+	_scan_sse42(vec, pkts, i, packetCount);
+}
+
+#endif /* TS_HEADER_SCAN_X86 */
+
+static scan_kernel_fn _kernel = NULL;
+static const char *_kernelName = "scalar";
+
+static scan_kernel_fn _select_kernel(void)
+{
+	scan_kernel_fn fn = _scan_scalar;
+	const char *name = "scalar";
+
+#if TS_HEADER_SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		fn = _scan_avx2;
+		name = "avx2";
+	} else if (__builtin_cpu_supports("sse4.2")) {
+		fn = _scan_sse42;
+		name = "sse4.2";
+	}
+#endif
+
+	/* Benign race, every thread resolves the same answer. */
+	_kernelName = name;
+	_kernel = fn;
+
+	return fn;
+}
+
+const char *ltntstools_ts_header_scan_kernel_name(void)
+{
+	if (!_kernel) {
+		_select_kernel();
+	}
+	return _kernelName;
+}
+
+static int _scan(struct ltntstools_ts_header_vector_s *vec, const uint8_t *pkts, uint32_t packetCount, scan_kernel_fn fn)
+{
+	if (!vec || !pkts || packetCount > vec->maxPackets) {
+		return -1;
+	}
+
+	uint32_t words = (packetCount + 63) / 64;
+	memset(vec->pusi, 0, words * sizeof(uint64_t));
+	memset(vec->tei, 0, words * sizeof(uint64_t));
+	memset(vec->syncErrors, 0, words * sizeof(uint64_t));
+
+	fn(vec, pkts, 0, packetCount);
+
+	vec->count = packetCount;
+	vec->syncErrorCount = 0;
+	vec->teiCount = 0;
+	for (uint32_t i = 0; i < words; i++) {
+		vec->syncErrorCount += __builtin_popcountll(vec->syncErrors[i]);
+		vec->teiCount += __builtin_popcountll(vec->tei[i]);
+	}
+
+	return packetCount;
+}
+
+int ltntstools_ts_header_scan(struct ltntstools_ts_header_vector_s *vec, const uint8_t *pkts, uint32_t packetCount)
+{
+	scan_kernel_fn fn = _kernel;
+	if (!fn) {
+		fn = _select_kernel();
+	}
+
+	return _scan(vec, pkts, packetCount, fn);
+}
+
+int ltntstools_ts_header_scan_scalar(struct ltntstools_ts_header_vector_s *vec, const uint8_t *pkts, uint32_t packetCount)
+{
+	return _scan(vec, pkts, packetCount, _scan_scalar);
+}
@@ -19,10 +19,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#define _GNU_SOURCE /* recvmmsg */
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
 #include <sys/time.h>
 #include <sys/poll.h>
 #include <assert.h>
@@ -33,7 +35,16 @@
 #include <net/if.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+#include <netinet/udp.h>
 #include "libltntstools/udp_receiver.h"
+#include "libltntstools/ts.h"
+#include "libltntstools/histogram.h"
+#include "pacer.h"
+#include "utils.h"
 
 /* Compilation issues on centos, trouble headers won't include
  *  * even with reasonable #defines.
@@ -44,9 +55,18 @@
 #ifndef NI_NUMERICHOST
 #define NI_NUMERICHOST 0x01
 #endif
+#if defined(__linux__) && !defined(UDP_SEGMENT)
+#define UDP_SEGMENT 103 /* linux/udp.h, older libc headers lack it */
+#endif
 
 /* UDP Receiver ... */
 
+/* Space for the SCM_TIMESTAMPNS control message attached to each datagram. */
+#define CONTROL_SLOT_SIZE CMSG_SPACE(sizeof(struct timespec))
+
+/* Datagrams read per readable socket before checking the others. */
+#define RECEIVE_BUDGET 64
+
 static int modifyMulticastInterfaces(int skt, struct sockaddr_in *sin, char *ipaddr, unsigned short port, int option, char *ifname)
 {
 	/* Setup multicast on all IPV4 network interfaces, IPV6 interfaces are ignored */
@@ -141,12 +161,14 @@ int ltntstools_udp_receiver_alloc(struct ltntstools_udp_receiver_s **p,
 	int n = socket_buffer_size;
 	if (setsockopt(ctx->skt, SOL_SOCKET, SO_RCVBUF, &n, sizeof(n)) == -1) {
 		perror("so_rcvbuf");
+		close(ctx->skt);
 		free(ctx);
 		return -1;
 	}
 
 	int reuse = 1;
 	if (setsockopt(ctx->skt, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
+		close(ctx->skt);
 		free(ctx);
 		return -1;
 	}
@@ -156,6 +178,7 @@ int ltntstools_udp_receiver_alloc(struct ltntstools_udp_receiver_s **p,
 	ctx->sin.sin_addr.s_addr = inet_addr(ctx->ip_addr);
 	if (bind(ctx->skt, (struct sockaddr *)&ctx->sin, sizeof(ctx->sin)) < 0) {
 		perror("bind");
+		close(ctx->skt);
 		free(ctx);
 		return -1;
 	}
@@ -168,12 +191,14 @@ int ltntstools_udp_receiver_alloc(struct ltntstools_udp_receiver_s **p,
 	int fl = fcntl(ctx->skt, F_GETFL, 0);
 	if (fcntl(ctx->skt, F_SETFL, fl | O_NONBLOCK) < 0) {
 		perror("fcntl");
+		close(ctx->skt);
 		free(ctx);
 		return -1;
 	}
 
 	ctx->rxbuffer = malloc(ctx->rxbuffer_size);
 	if (!ctx->rxbuffer) {
+		close(ctx->skt);
 		free(ctx);
 		return -1;
 	}
@@ -187,6 +212,10 @@ void ltntstools_udp_receiver_free(struct ltntstools_udp_receiver_s **p)
 {
 	struct ltntstools_udp_receiver_s *ctx = (struct ltntstools_udp_receiver_s *)*p;
 
+	if (ctx->reactor) {
+		ltntstools_udp_receiver_reactor_remove(ctx->reactor, ctx);
+	}
+
 	ctx->thread_terminate = 1;
 	if (ctx->thread_running) {
 		while (!ctx->thread_complete)
@@ -200,6 +229,11 @@ void ltntstools_udp_receiver_free(struct ltntstools_udp_receiver_s **p)
 	}
 
 	free(ctx->rxbuffer);
+	free(ctx->msgs);
+	free(ctx->iovecs);
+	free(ctx->batchBuffer);
+	free(ctx->datagrams);
+	free(ctx->controlBuffer);
 	free(ctx);
 	*p = 0;
 }
@@ -222,6 +256,247 @@ int ltntstools_udp_receiver_drop_multicast(struct ltntstools_udp_receiver_s *ctx
 	return modifyMulticastInterfaces(ctx->skt, &ctx->sin, ctx->ip_addr, ctx->ip_port, IP_DROP_MEMBERSHIP, ifname);
 }
 
+/* One control message slot for the single datagram path, then one per batch message. */
+static int _control_setup(struct ltntstools_udp_receiver_s *ctx)
+{
+	unsigned char *buffer = calloc(ctx->batchDepth + 1, CONTROL_SLOT_SIZE);
+	if (!buffer)
+		return -1;
+
+	free(ctx->controlBuffer);
+	ctx->controlBuffer = buffer;
+
+	for (unsigned int i = 0; i < ctx->batchDepth; i++) {
+		ctx->msgs[i].msg_hdr.msg_control = buffer + ((i + 1) * CONTROL_SLOT_SIZE);
+		ctx->msgs[i].msg_hdr.msg_controllen = CONTROL_SLOT_SIZE;
+	}
+
+	return 0; /* Success */
+}
+
+int ltntstools_udp_receiver_set_batch_mode(struct ltntstools_udp_receiver_s *ctx, unsigned int depth, tsudp_receiver_batch_callback cb)
+{
+	if (!ctx || depth < 1 || depth > 1024 || ctx->threadId)
+		return -1;
+
+#if !defined(__linux__)
+	return -1; /* recvmmsg() is linux only */
+#else
+	struct mmsghdr *msgs = calloc(depth, sizeof(*msgs));
+	struct iovec *iovecs = calloc(depth, sizeof(*iovecs));
+	unsigned char *buffer = malloc((size_t)depth * ctx->rxbuffer_size);
+	struct ltntstools_udp_datagram_s *datagrams = calloc(depth, sizeof(*datagrams));
+	if (!msgs || !iovecs || !buffer || !datagrams) {
+		free(msgs);
+		free(iovecs);
+		free(buffer);
+		free(datagrams);
+		return -1;
+	}
+
+	for (unsigned int i = 0; i < depth; i++) {
+		iovecs[i].iov_base = buffer + (i * ctx->rxbuffer_size);
+		iovecs[i].iov_len = ctx->rxbuffer_size;
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	free(ctx->msgs);
+	free(ctx->iovecs);
+	free(ctx->batchBuffer);
+	free(ctx->datagrams);
+
+	ctx->msgs = msgs;
+	ctx->iovecs = iovecs;
+	ctx->batchBuffer = buffer;
+	ctx->datagrams = datagrams;
+	ctx->batchCb = cb;
+	ctx->batchDepth = depth;
+
+	if (ctx->kernelTimestamps) {
+		return _control_setup(ctx);
+	}
+
+	return 0; /* Success */
+#endif
+}
+
+int ltntstools_udp_receiver_enable_kernel_timestamps(struct ltntstools_udp_receiver_s *ctx, tsudp_receiver_timestamp_callback cb)
+{
+	if (!ctx || ctx->threadId)
+		return -1;
+
+#if defined(SO_TIMESTAMPNS)
+	int on = 1;
+	if (setsockopt(ctx->skt, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+		perror("so_timestampns");
+		return -1;
+	}
+
+	ctx->tsCb = cb;
+	ctx->kernelTimestamps = 1;
+
+	return _control_setup(ctx);
+#else
+	return -1; /* No nanosecond receive timestamps on this platform */
+#endif
+}
+
+/* Find the kernel receive time in the control messages of a datagram, or fall back to the wall clock. */
+static void _datagram_timestamp(struct msghdr *msg, struct timespec *ts)
+{
+#if defined(SO_TIMESTAMPNS)
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+			memcpy(ts, CMSG_DATA(cmsg), sizeof(*ts));
+			return;
+		}
+	}
+#endif
+	clock_gettime(CLOCK_REALTIME, ts);
+}
+
+/* Fill in the payload for a single datagram, stripping the RTP header if required.
+ * Returns the number of payload bytes, which may be zero.
+ */
+static int _datagram_payload(struct ltntstools_udp_receiver_s *ctx, struct ltntstools_udp_datagram_s *d, unsigned char *buf, int rxbytes)
+{
+	if (ctx->stripRTPHeader) {
+		if (rxbytes < 12) {
+			rxbytes = 12;
+		}
+		/* Some implementations pad the trailer of the packet with
+		 * dummy bytes, we don't want to pass these along.
+		 * Hint: Ceton does, silicondust doesn't */
+		d->buf = buf + 12;
+		d->byteCount = ((rxbytes - 12) / 188) * 188;
+	} else {
+		d->buf = buf;
+		d->byteCount = rxbytes;
+	}
+
+	return d->byteCount;
+}
+
+/* Drain the socket, depth datagrams per system call, until the kernel has nothing more queued. */
+static void _receive_batch(struct ltntstools_udp_receiver_s *ctx)
+{
+#if defined(__linux__)
+	int count;
+
+	do {
+		count = recvmmsg(ctx->skt, ctx->msgs, ctx->batchDepth, MSG_DONTWAIT, NULL);
+		if (count <= 0) {
+			break;
+		}
+
+		int dcount = 0;
+		for (int i = 0; i < count; i++) {
+			struct ltntstools_udp_datagram_s *d = &ctx->datagrams[dcount];
+			if (ctx->kernelTimestamps) {
+				_datagram_timestamp(&ctx->msgs[i].msg_hdr, &d->ts);
+				/* The kernel shrinks this to the bytes it wrote, rearm for the next call */
+				ctx->msgs[i].msg_hdr.msg_controllen = CONTROL_SLOT_SIZE;
+			} else {
+				d->ts.tv_sec = 0;
+				d->ts.tv_nsec = 0;
+			}
+			if (_datagram_payload(ctx, d, ctx->iovecs[i].iov_base, ctx->msgs[i].msg_len) > 0) {
+				dcount++;
+			}
+		}
+
+		if (ctx->batchCb) {
+			if (dcount)
+				ctx->batchCb(ctx->userContext, ctx->datagrams, dcount);
+		} else
+		if (ctx->tsCb) {
+			for (int i = 0; i < dcount; i++) {
+				struct ltntstools_udp_datagram_s *d = &ctx->datagrams[i];
+				struct timeval tv = { .tv_sec = d->ts.tv_sec, .tv_usec = d->ts.tv_nsec / 1000 };
+				ctx->tsCb(ctx->userContext, d->buf, d->byteCount, &tv);
+			}
+		} else
+		if (ctx->cb) {
+			for (int i = 0; i < dcount; i++) {
+				ctx->cb(ctx->userContext, ctx->datagrams[i].buf, ctx->datagrams[i].byteCount);
+			}
+		}
+
+	} while (count == ctx->batchDepth && !ctx->thread_terminate);
+#endif
+}
+
+/* A single datagram and its kernel receive time. Returns 0 when the socket is empty. */
+static int _receive_timestamped(struct ltntstools_udp_receiver_s *ctx)
+{
+	struct iovec iov = { .iov_base = ctx->rxbuffer, .iov_len = ctx->rxbuffer_size };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = ctx->controlBuffer,
+		.msg_controllen = CONTROL_SLOT_SIZE,
+	};
+
+	ssize_t rxbytes = recvmsg(ctx->skt, &msg, 0);
+	if (rxbytes < 0) {
+		return 0;
+	}
+
+	struct ltntstools_udp_datagram_s d;
+	_datagram_timestamp(&msg, &d.ts);
+	if (_datagram_payload(ctx, &d, ctx->rxbuffer, rxbytes) <= 0) {
+		return 1;
+	}
+
+	if (ctx->tsCb) {
+		struct timeval tv = { .tv_sec = d.ts.tv_sec, .tv_usec = d.ts.tv_nsec / 1000 };
+		ctx->tsCb(ctx->userContext, d.buf, d.byteCount, &tv);
+	} else
+	if (ctx->cb) {
+		ctx->cb(ctx->userContext, d.buf, d.byteCount);
+	}
+
+	return 1;
+}
+
+/* Push the arbitrary buffer of bytes, output is fully aligned
+ * packets via the tool_realign_callback callback, which are
+ * then pushed directly into the core.
+ * Returns 0 when the socket is empty.
+ */
+static int _receive_one(struct ltntstools_udp_receiver_s *ctx)
+{
+	ssize_t rxbytes = recv(ctx->skt, ctx->rxbuffer, ctx->rxbuffer_size, 0);
+	if (rxbytes < 0) {
+		return 0;
+	}
+
+	struct ltntstools_udp_datagram_s d;
+	if (ctx->cb && _datagram_payload(ctx, &d, ctx->rxbuffer, rxbytes) > 0) {
+		ctx->cb(ctx->userContext, d.buf, d.byteCount);
+	}
+
+	return 1;
+}
+
+/* Socket is readable, drain up to budget datagrams (or batches) before returning to the
+ * caller, so a single busy socket can't starve its neighbours on a shared reactor thread.
+ */
+static void _receive_service(struct ltntstools_udp_receiver_s *ctx, int budget)
+{
+	if (ctx->batchDepth) {
+		_receive_batch(ctx);
+		return;
+	}
+
+	for (int i = 0; i < budget; i++) {
+		int ret = ctx->kernelTimestamps ? _receive_timestamped(ctx) : _receive_one(ctx);
+		if (ret == 0)
+			break;
+	}
+}
+
 static void *udp_receiver_threadfunc(void *p)
 {
 	struct ltntstools_udp_receiver_s *ctx = (struct ltntstools_udp_receiver_s *)p;
@@ -245,35 +520,7 @@ static void *udp_receiver_threadfunc(void *p)
 		}
 
 		/* Ret > 0, meaning our FD returned data is available. */
-
-		/* Push the arbitrary buffer of bytes, output is fully aligned
-		 * packets via the tool_realign_callback callback, which are
-		 * then pushed directly into the core.
-		 */
-#if 0
-		struct msghdr mh;
-		mh.msg_iovlen = 0;
-		size_t rxbytes = recvmsg(ctx->skt, &mh, MSG_DONTWAIT);
-		if (rxbytes && ctx->cb && !ctx->stripRTPHeader) {
-			for (int j = 0; j < mh.msg_iovlen; j++) {
-				ctx->cb(ctx->userContext, mh.msg_iov[j].iov_base, mh.msg_iov[j].iov_len);
-			}
-		}
-#else
-		size_t rxbytes = recv(ctx->skt, ctx->rxbuffer, ctx->rxbuffer_size, 0);
-		if (rxbytes && ctx->cb && !ctx->stripRTPHeader) {
-			ctx->cb(ctx->userContext, ctx->rxbuffer, rxbytes);
-		}
-		else
-		if (rxbytes && ctx->cb && ctx->stripRTPHeader) {
-			/* Some implementations pad the trailer of the packet with
-			 * dummy bytes, we don't want to pass these along.
-			 * Hint: Ceton does, silicondust doesn't */
-			int bytes = ((rxbytes - 12) / 188) * 188;
-			ctx->cb(ctx->userContext, ctx->rxbuffer + 12, bytes);
-		}
-#endif
-
+		_receive_service(ctx, RECEIVE_BUDGET);
 	}
 	ctx->thread_complete = 1;
 	ctx->thread_running = 0;
@@ -284,7 +531,584 @@ int ltntstools_udp_receiver_thread_start(struct ltntstools_udp_receiver_s *ctx)
 {
 	assert(ctx);
 	assert(ctx->threadId == 0);
+	if (ctx->reactor)
+		return -1; /* Serviced by a reactor worker */
+
 	return pthread_create(&ctx->threadId, 0, udp_receiver_threadfunc, ctx);
 }
 
+/* UDP Receiver Reactor ... */
+
+#if defined(__linux__)
+
+#define REACTOR_WAKE_SLOT UINT32_MAX
+
+struct udp_receiver_reactor_s;
+
+struct udp_receiver_reactor_worker_s
+{
+	struct udp_receiver_reactor_s *reactor;
+	int efd;
+	int cpu;
+	pthread_t threadId;
+
+	/* Epoll events carry a slot index, not a receiver pointer. A receiver removed while its
+	 * event is pending leaves a NULL slot behind, instead of a dangling pointer.
+	 * Held by the worker for each batch of events, and by add/remove.
+	 */
+	pthread_mutex_t mutex;
+	struct ltntstools_udp_receiver_s **slots;
+	uint32_t slotCount;
+	uint32_t receiverCount;
+};
+
+struct udp_receiver_reactor_s
+{
+	int workerCount;
+	int assignment;
+	unsigned int nextWorker;
+	int wakefd;
+	int terminate;
+	struct udp_receiver_reactor_worker_s *workers;
+};
+
+static void *udp_receiver_reactor_threadfunc(void *p)
+{
+	struct udp_receiver_reactor_worker_s *w = (struct udp_receiver_reactor_worker_s *)p;
+	struct epoll_event events[64];
+
+	ltnpthread_setname_np(pthread_self(), "tstools-udprx");
+
+	while (!__atomic_load_n(&w->reactor->terminate, __ATOMIC_ACQUIRE)) {
+		int count = epoll_wait(w->efd, events, sizeof(events) / sizeof(events[0]), -1);
+		if (count <= 0) {
+			continue; /* EINTR */
+		}
+
+		pthread_mutex_lock(&w->mutex);
+		for (int i = 0; i < count; i++) {
+			uint32_t slot = events[i].data.u32;
+			if (slot == REACTOR_WAKE_SLOT || slot >= w->slotCount || w->slots[slot] == NULL) {
+				continue;
+			}
+			_receive_service(w->slots[slot], RECEIVE_BUDGET);
+		}
+		pthread_mutex_unlock(&w->mutex);
+	}
+
+	return NULL;
+}
+
+int ltntstools_udp_receiver_reactor_alloc(void **hdl, int workerCount, const int *cpus, int assignment)
+{
+	if (!hdl || workerCount < 1 || workerCount > 256)
+		return -1;
+
+	struct udp_receiver_reactor_s *r = calloc(1, sizeof(*r));
+	if (!r)
+		return -1;
+
+	r->assignment = assignment;
+	r->workers = calloc(workerCount, sizeof(*r->workers));
+	r->wakefd = eventfd(0, EFD_NONBLOCK);
+	if (!r->workers || r->wakefd < 0) {
+		if (r->wakefd >= 0)
+			close(r->wakefd);
+		free(r->workers);
+		free(r);
+		return -1;
+	}
+
+	for (int i = 0; i < workerCount; i++) {
+		struct udp_receiver_reactor_worker_s *w = &r->workers[i];
+		w->reactor = r;
+		w->cpu = cpus ? cpus[i] : -1;
+		pthread_mutex_init(&w->mutex, NULL);
+
+		w->efd = epoll_create1(0);
+		if (w->efd < 0)
+			break;
+
+		/* Every worker watches the shared wake eventfd, it fires once at shutdown */
+		struct epoll_event ev = { .events = EPOLLIN, .data.u32 = REACTOR_WAKE_SLOT };
+		if (epoll_ctl(w->efd, EPOLL_CTL_ADD, r->wakefd, &ev) < 0 ||
+			pthread_create(&w->threadId, NULL, udp_receiver_reactor_threadfunc, w) != 0) {
+			close(w->efd);
+			break;
+		}
+
+		if (w->cpu >= 0) {
+			ltn_pacer_thread_scheduling(w->threadId, 0, w->cpu);
+		}
+		r->workerCount++;
+	}
+
+	if (r->workerCount != workerCount) {
+		ltntstools_udp_receiver_reactor_free(r);
+		return -1;
+	}
+
+	*hdl = r;
+	return 0; /* Success */
+}
+
+void ltntstools_udp_receiver_reactor_free(void *hdl)
+{
+	struct udp_receiver_reactor_s *r = (struct udp_receiver_reactor_s *)hdl;
+	if (!r)
+		return;
+
+	__atomic_store_n(&r->terminate, 1, __ATOMIC_RELEASE);
+	uint64_t one = 1;
+	if (write(r->wakefd, &one, sizeof(one)) < 0) {
+		perror("eventfd");
+	}
+
+	for (int i = 0; i < r->workerCount; i++) {
+		struct udp_receiver_reactor_worker_s *w = &r->workers[i];
+		pthread_join(w->threadId, NULL);
+		close(w->efd);
+
+		/* Receivers outlive the reactor, detach any still registered */
+		for (uint32_t j = 0; j < w->slotCount; j++) {
+			if (w->slots[j])
+				w->slots[j]->reactor = NULL;
+		}
+		free(w->slots);
+		pthread_mutex_destroy(&w->mutex);
+	}
+
+	close(r->wakefd);
+	free(r->workers);
+	free(r);
+}
+
+int ltntstools_udp_receiver_reactor_add(void *hdl, struct ltntstools_udp_receiver_s *ctx)
+{
+	struct udp_receiver_reactor_s *r = (struct udp_receiver_reactor_s *)hdl;
+	if (!r || !ctx || ctx->threadId || ctx->reactor)
+		return -1;
+
+	unsigned int idx;
+	if (r->assignment == LTNTSTOOLS_UDP_REACTOR_ASSIGN_HASH) {
+		/* Stable, the same address and port always lands on the same worker */
+		uint32_t k = ctx->sin.sin_addr.s_addr ^ ((uint32_t)ctx->sin.sin_port << 16);
+		idx = ((uint64_t)(k * 2654435761U) * r->workerCount) >> 32;
+	} else {
+		idx = __atomic_fetch_add(&r->nextWorker, 1, __ATOMIC_RELAXED) % r->workerCount;
+	}
+	struct udp_receiver_reactor_worker_s *w = &r->workers[idx];
+
+	pthread_mutex_lock(&w->mutex);
+
+	uint32_t slot = 0;
+	while (slot < w->slotCount && w->slots[slot]) {
+		slot++;
+	}
+	if (slot == w->slotCount) {
+		uint32_t count = w->slotCount ? w->slotCount * 2 : 64;
+		struct ltntstools_udp_receiver_s **slots = realloc(w->slots, count * sizeof(*slots));
+		if (!slots) {
+			pthread_mutex_unlock(&w->mutex);
+			return -1;
+		}
+		memset(slots + w->slotCount, 0, (count - w->slotCount) * sizeof(*slots));
+		w->slots = slots;
+		w->slotCount = count;
+	}
+
+	struct epoll_event ev = { .events = EPOLLIN, .data.u32 = slot };
+	if (epoll_ctl(w->efd, EPOLL_CTL_ADD, ctx->skt, &ev) < 0) {
+		pthread_mutex_unlock(&w->mutex);
+		return -1;
+	}
+	w->slots[slot] = ctx;
+	w->receiverCount++;
+	ctx->reactor = r;
+	ctx->reactorWorker = idx;
+	ctx->reactorSlot = slot;
+
+	pthread_mutex_unlock(&w->mutex);
+
+	return idx;
+}
+
+int ltntstools_udp_receiver_reactor_remove(void *hdl, struct ltntstools_udp_receiver_s *ctx)
+{
+	struct udp_receiver_reactor_s *r = (struct udp_receiver_reactor_s *)hdl;
+	if (!r || !ctx || ctx->reactor != r)
+		return -1;
+
+	struct udp_receiver_reactor_worker_s *w = &r->workers[ctx->reactorWorker];
+
+	/* Once the lock is ours the worker is between batches, any event still pending for
+	 * this receiver finds an empty slot.
+	 */
+	pthread_mutex_lock(&w->mutex);
+	epoll_ctl(w->efd, EPOLL_CTL_DEL, ctx->skt, NULL);
+	w->slots[ctx->reactorSlot] = NULL;
+	w->receiverCount--;
+	ctx->reactor = NULL;
+	pthread_mutex_unlock(&w->mutex);
+
+	return 0; /* Success */
+}
+
+#else
+
+/* epoll is linux only */
+
+int ltntstools_udp_receiver_reactor_alloc(void **hdl, int workerCount, const int *cpus, int assignment)
+{
+	return -1;
+}
+
+void ltntstools_udp_receiver_reactor_free(void *hdl)
+{
+}
+
+int ltntstools_udp_receiver_reactor_add(void *hdl, struct ltntstools_udp_receiver_s *ctx)
+{
+	return -1;
+}
+
+int ltntstools_udp_receiver_reactor_remove(void *hdl, struct ltntstools_udp_receiver_s *ctx)
+{
+	return -1;
+}
+
+#endif /* __linux__ */
+
 /* UDP Transmitter ... */
+
+/* Largest datagram, including any RTP header, the transmitter queues. Matches the receiver. */
+#define TX_DATAGRAM_MAX 2048
+
+/* Kernel limits for a single UDP_SEGMENT send */
+#define TX_GSO_MAX_SEGMENTS 64
+#define TX_GSO_MAX_BYTES 65000
+
+struct udp_transmitter_s
+{
+	int skt;
+	struct sockaddr_in sin;
+
+	/* Queued datagrams, packed back to back so a run of equal sized datagrams
+	 * can be handed to the kernel as a single GSO super datagram.
+	 */
+	unsigned int depth;
+	unsigned int count;
+	unsigned char *slab;
+	size_t slabUsed;
+	struct iovec *iovecs;
+	struct mmsghdr *msgs;
+
+	int gso;
+
+	/* Optional RTP header */
+	int rtp;
+	uint8_t rtpPayloadType;
+	uint16_t rtpSeq;
+	uint32_t rtpSSRC;
+
+	struct ltn_histogram_s *histSend; /* Duration of each send system call, in uS */
+	struct ltntstools_udp_transmitter_stats_s stats;
+};
+
+int ltntstools_udp_transmitter_alloc(void **hdl, const char *ip_addr, unsigned short ip_port, unsigned int batchDepth)
+{
+	if (!hdl || !ip_addr || batchDepth < 1 || batchDepth > 1024)
+		return -1;
+
+	struct udp_transmitter_s *ctx = calloc(1, sizeof(*ctx));
+	if (!ctx)
+		return -1;
+
+	ctx->depth = batchDepth;
+	ctx->sin.sin_family = AF_INET;
+	ctx->sin.sin_port = htons(ip_port);
+	if (inet_aton(ip_addr, &ctx->sin.sin_addr) == 0) {
+		free(ctx);
+		return -1;
+	}
+
+	ctx->skt = socket(AF_INET, SOCK_DGRAM, 0);
+	if (ctx->skt < 0) {
+		free(ctx);
+		return -1;
+	}
+
+	/* Fix the destination once, sends carry no address and skip the per call route lookup */
+	if (connect(ctx->skt, (struct sockaddr *)&ctx->sin, sizeof(ctx->sin)) < 0) {
+		perror("connect");
+		close(ctx->skt);
+		free(ctx);
+		return -1;
+	}
+
+	ctx->slab = malloc((size_t)batchDepth * TX_DATAGRAM_MAX);
+	ctx->iovecs = calloc(batchDepth, sizeof(*ctx->iovecs));
+	ctx->msgs = calloc(batchDepth, sizeof(*ctx->msgs));
+	ltn_histogram_alloc(&ctx->histSend, "udp transmitter send latency (uS)", 0, 10 * 1000);
+	if (!ctx->slab || !ctx->iovecs || !ctx->msgs || !ctx->histSend) {
+		ltntstools_udp_transmitter_free(ctx);
+		return -1;
+	}
+
+#if defined(__linux__)
+	/* Probe for GSO, the socket option is only accepted when the kernel supports it */
+	int gsoSize = 0;
+	ctx->gso = setsockopt(ctx->skt, IPPROTO_UDP, UDP_SEGMENT, &gsoSize, sizeof(gsoSize)) == 0;
+#endif
+
+	*hdl = ctx;
+	return 0; /* Success */
+}
+
+void ltntstools_udp_transmitter_free(void *hdl)
+{
+	struct udp_transmitter_s *ctx = (struct udp_transmitter_s *)hdl;
+	if (!ctx)
+		return;
+
+	if (ctx->skt >= 0) {
+		ltntstools_udp_transmitter_flush(ctx);
+		close(ctx->skt);
+	}
+	if (ctx->histSend)
+		ltn_histogram_free(ctx->histSend);
+	free(ctx->slab);
+	free(ctx->iovecs);
+	free(ctx->msgs);
+	free(ctx);
+}
+
+int ltntstools_udp_transmitter_set_rtp(void *hdl, uint8_t payloadType, uint32_t ssrc)
+{
+	struct udp_transmitter_s *ctx = (struct udp_transmitter_s *)hdl;
+	if (!ctx || payloadType > 127)
+		return -1;
+
+	ctx->rtp = 1;
+	ctx->rtpPayloadType = payloadType;
+	ctx->rtpSSRC = ssrc;
+
+	return 0; /* Success */
+}
+
+int ltntstools_udp_transmitter_set_gso(void *hdl, int enable)
+{
+	struct udp_transmitter_s *ctx = (struct udp_transmitter_s *)hdl;
+	if (!ctx)
+		return -1;
+
+#if defined(__linux__)
+	if (enable) {
+		int gsoSize = 0;
+		if (setsockopt(ctx->skt, IPPROTO_UDP, UDP_SEGMENT, &gsoSize, sizeof(gsoSize)) < 0)
+			return -1; /* Not supported by this kernel */
+	}
+	ctx->gso = enable;
+	return 0; /* Success */
+#else
+	return enable ? -1 : 0;
+#endif
+}
+
+#if defined(__linux__)
+/* Every datagram except the last must be the same size, the last may be shorter. */
+static int _gso_eligible(struct udp_transmitter_s *ctx)
+{
+	if (ctx->count < 2 || ctx->count > TX_GSO_MAX_SEGMENTS || ctx->slabUsed > TX_GSO_MAX_BYTES)
+		return 0;
+
+	size_t segment = ctx->iovecs[0].iov_len;
+	for (unsigned int i = 1; i < ctx->count - 1; i++) {
+		if (ctx->iovecs[i].iov_len != segment)
+			return 0;
+	}
+
+	return ctx->iovecs[ctx->count - 1].iov_len <= segment;
+}
+
+/* One system call, the kernel splits the packed slab back into datagrams. */
+static int _send_gso(struct udp_transmitter_s *ctx)
+{
+	char control[CMSG_SPACE(sizeof(uint16_t))] = { 0 };
+	struct iovec iov = { .iov_base = ctx->slab, .iov_len = ctx->slabUsed };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control,
+		.msg_controllen = sizeof(control),
+	};
+
+	struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+	cm->cmsg_level = IPPROTO_UDP;
+	cm->cmsg_type = UDP_SEGMENT;
+	cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+	uint16_t segment = ctx->iovecs[0].iov_len;
+	memcpy(CMSG_DATA(cm), &segment, sizeof(segment));
+
+	if (sendmsg(ctx->skt, &msg, 0) < 0) {
+		if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT) {
+			ctx->gso = 0; /* The device or path can't segment, sendmmsg() from now on */
+		}
+		return -1;
+	}
+	ctx->stats.gsoSends++;
+
+	return ctx->count;
+}
+#endif
+
+int ltntstools_udp_transmitter_flush(void *hdl)
+{
+	struct udp_transmitter_s *ctx = (struct udp_transmitter_s *)hdl;
+	if (!ctx)
+		return -1;
+	if (ctx->count == 0)
+		return 0;
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	int sent = -1;
+#if defined(__linux__)
+	if (ctx->gso && _gso_eligible(ctx)) {
+		sent = _send_gso(ctx);
+	}
+	if (sent < 0) {
+		unsigned int done = 0;
+		while (done < ctx->count) {
+			for (unsigned int i = done; i < ctx->count; i++) {
+				ctx->msgs[i].msg_hdr.msg_iov = &ctx->iovecs[i];
+				ctx->msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+			int ret = sendmmsg(ctx->skt, &ctx->msgs[done], ctx->count - done, 0);
+			if (ret <= 0) {
+				/* Drop the datagram at fault, carry on with the remainder */
+				ctx->stats.sendErrors++;
+				ret = 1;
+			} else {
+				sent = (sent < 0 ? 0 : sent) + ret;
+			}
+			done += ret;
+			ctx->stats.systemCalls++;
+		}
+	} else {
+		ctx->stats.systemCalls++;
+	}
+#else
+	for (unsigned int i = 0; i < ctx->count; i++) {
+		if (send(ctx->skt, ctx->iovecs[i].iov_base, ctx->iovecs[i].iov_len, 0) < 0)
+			ctx->stats.sendErrors++;
+		else
+			sent = (sent < 0 ? 0 : sent) + 1;
+		ctx->stats.systemCalls++;
+	}
+#endif
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	int64_t uS = ((t1.tv_sec - t0.tv_sec) * 1000000LL) + ((t1.tv_nsec - t0.tv_nsec) / 1000);
+	ltn_histogram_interval_update_with_value(ctx->histSend, uS);
+
+	if (sent > 0)
+		ctx->stats.datagrams += sent;
+	ctx->count = 0;
+	ctx->slabUsed = 0;
+
+	return sent < 0 ? -1 : sent;
+}
+
+/* Queue a datagram, prefixed with an RTP header when enabled, sending the batch once full. */
+static int _transmitter_queue(struct udp_transmitter_s *ctx, const unsigned char *buf, int byteCount, uint32_t rtpTimestamp)
+{
+	int hdrLength = ctx->rtp ? 12 : 0;
+	if (byteCount <= 0 || byteCount + hdrLength > TX_DATAGRAM_MAX)
+		return -1;
+
+	unsigned char *dst = ctx->slab + ctx->slabUsed;
+	if (ctx->rtp) {
+		dst[0] = 0x80; /* V=2, no padding, extension or CSRCs */
+		dst[1] = ctx->rtpPayloadType;
+		dst[2] = ctx->rtpSeq >> 8;
+		dst[3] = ctx->rtpSeq;
+		dst[4] = rtpTimestamp >> 24;
+		dst[5] = rtpTimestamp >> 16;
+		dst[6] = rtpTimestamp >> 8;
+		dst[7] = rtpTimestamp;
+		dst[8] = ctx->rtpSSRC >> 24;
+		dst[9] = ctx->rtpSSRC >> 16;
+		dst[10] = ctx->rtpSSRC >> 8;
+		dst[11] = ctx->rtpSSRC;
+		ctx->rtpSeq++;
+	}
+	memcpy(dst + hdrLength, buf, byteCount);
+
+	ctx->iovecs[ctx->count].iov_base = dst;
+	ctx->iovecs[ctx->count].iov_len = byteCount + hdrLength;
+	ctx->slabUsed += byteCount + hdrLength;
+	ctx->count++;
+
+	if (ctx->count == ctx->depth) {
+		ltntstools_udp_transmitter_flush(ctx);
+	}
+
+	return 0; /* Success */
+}
+
+int ltntstools_udp_transmitter_write(void *hdl, const unsigned char *buf, int byteCount)
+{
+	struct udp_transmitter_s *ctx = (struct udp_transmitter_s *)hdl;
+	if (!ctx || !buf)
+		return -1;
+
+	/* 90KHz media clock from the monotonic wall clock */
+	uint32_t rtpTimestamp = 0;
+	if (ctx->rtp) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		rtpTimestamp = (uint32_t)((now.tv_sec * 90000ULL) + (now.tv_nsec / 11111));
+	}
+
+	return _transmitter_queue(ctx, buf, byteCount, rtpTimestamp);
+}
+
+int ltntstools_udp_transmitter_smoother_pcr_output(void *userContext, unsigned char *buf, int byteCount,
+	struct ltntstools_pcr_position_s *array, int arrayLength)
+{
+	struct udp_transmitter_s *ctx = (struct udp_transmitter_s *)userContext;
+	if (!ctx || !buf)
+		return -1;
+
+	/* The RTP timestamp tracks the stream clock, the PCR of the first packet in 90KHz units */
+	uint32_t rtpTimestamp = arrayLength > 0 ? (uint32_t)(array[0].pcr / 300) : 0;
+
+	return _transmitter_queue(ctx, buf, byteCount, rtpTimestamp);
+}
+
+int ltntstools_udp_transmitter_smoother_rtp_output(void *userContext, const unsigned char *buf, int byteCount)
+{
+	return ltntstools_udp_transmitter_write(userContext, buf, byteCount);
+}
+
+int ltntstools_udp_transmitter_get_stats(void *hdl, struct ltntstools_udp_transmitter_stats_s *stats)
+{
+	struct udp_transmitter_s *ctx = (struct udp_transmitter_s *)hdl;
+	if (!ctx || !stats)
+		return -1;
+
+	*stats = ctx->stats; /* Implicit struct copy */
+
+	return 0; /* Success */
+}
+
+void ltntstools_udp_transmitter_histogram_print(void *hdl, int fd)
+{
+	struct udp_transmitter_s *ctx = (struct udp_transmitter_s *)hdl;
+	if (!ctx)
+		return;
+
+	ltn_histogram_interval_print(fd, ctx->histSend, 0);
+}
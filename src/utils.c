@@ -156,6 +156,7 @@ int network_addr_compare(
 
 	return 1; /* Success, matched */
 }
+#endif
 
 char *network_stream_ascii(struct iphdr *iphdr, struct udphdr *udphdr)
 {
@@ -183,4 +184,3 @@ char *network_stream_ascii(struct iphdr *iphdr, struct udphdr *udphdr)
 
 	return str;
 }
-#endif